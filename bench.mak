@@ -0,0 +1,45 @@
+# Micro-benchmarks for this project
+# These are not unit tests: they print timing results to stdout.
+# Usage: make -f bench.mak [target]
+
+all: tsm cov mstp crc trendlog rpm router device
+
+tsm: test/tsm_bench.mak
+	$(MAKE) -s -C test -f tsm_bench.mak clean all
+	( ./test/tsm_bench )
+	$(MAKE) -s -C test -f tsm_bench.mak clean
+
+cov: test/cov_bench.mak
+	$(MAKE) -s -C test -f cov_bench.mak clean all
+	( ./test/cov_bench )
+	$(MAKE) -s -C test -f cov_bench.mak clean
+
+mstp: test/mstp_bench.mak
+	$(MAKE) -s -C test -f mstp_bench.mak clean all
+	( ./test/mstp_bench )
+	$(MAKE) -s -C test -f mstp_bench.mak clean
+
+crc: test/crc_bench.mak
+	$(MAKE) -s -C test -f crc_bench.mak clean all
+	( ./test/crc_bench )
+	$(MAKE) -s -C test -f crc_bench.mak clean
+
+trendlog: test/trendlog_bench.mak
+	$(MAKE) -s -C test -f trendlog_bench.mak clean all
+	( ./test/trendlog_bench )
+	$(MAKE) -s -C test -f trendlog_bench.mak clean
+
+rpm: test/rpm_bench.mak
+	$(MAKE) -s -C test -f rpm_bench.mak clean all
+	( ./test/rpm_bench )
+	$(MAKE) -s -C test -f rpm_bench.mak clean
+
+router: test/router_bench.mak
+	$(MAKE) -s -C test -f router_bench.mak clean all
+	( ./test/router_bench )
+	$(MAKE) -s -C test -f router_bench.mak clean
+
+device: test/device_bench.mak
+	$(MAKE) -s -C test -f device_bench.mak clean all
+	( ./test/device_bench )
+	$(MAKE) -s -C test -f device_bench.mak clean
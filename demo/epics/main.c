@@ -875,7 +875,8 @@ static uint8_t Read_Properties(
             array_index = BACNET_ARRAY_ALL;
 
             switch (prop) {
-                    /* These are all potentially long arrays, so they may abort */
+                    /* These are all potentially long arrays, so they may abort
+                       if the device can't send them in segments */
                 case PROP_OBJECT_LIST:
                 case PROP_STATE_TEXT:
                 case PROP_STRUCTURED_OBJECT_LIST:
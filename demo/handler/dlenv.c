@@ -203,6 +203,9 @@ void dlenv_maintenance_timer(
  *   - BACNET_APDU_TIMEOUT - set this value in milliseconds to change
  *     the APDU timeout.  APDU Timeout is how much time a client
  *     waits for a response from a BACnet device.
+ *   - BACNET_SEGMENT_WINDOW - set this value (1..127) to change the
+ *     number of segments sent, or accepted from a server, before a
+ *     SegmentACK.  Default is 8.
  *   - BACNET_IFACE - set this value to dotted IP address (Windows) of
  *     the interface (see ipconfig command on Windows) for which you
  *     want to bind.  On Linux, set this to the /dev interface
@@ -290,6 +293,10 @@ void dlenv_init(
         apdu_timeout_set(60000);
 #endif
     }
+    pEnv = getenv("BACNET_SEGMENT_WINDOW");
+    if (pEnv) {
+        apdu_segment_window_set((uint8_t) strtol(pEnv, NULL, 0));
+    }
     if (!datalink_init(getenv("BACNET_IFACE"))) {
         exit(1);
     }
@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include "config.h"
@@ -40,6 +41,9 @@
 #include "cov.h"
 #include "tsm.h"
 #include "dcc.h"
+#include "deadline.h"
+#include "covqueue.h"
+#include "hashtab.h"
 #if PRINT_ENABLED
 #include "bactext.h"
 #endif
@@ -55,6 +59,7 @@ typedef struct BACnet_COV_Subscription_Flags {
     bool valid:1;
     bool issueConfirmedNotifications:1; /* optional */
     bool send_requested:1;
+    bool pending:1;     /* in the pending list */
 } BACNET_COV_SUBSCRIPTION_FLAGS;
 
 typedef struct BACnet_COV_Subscription {
@@ -63,13 +68,193 @@ typedef struct BACnet_COV_Subscription {
     uint32_t subscriberProcessIdentifier;
     BACNET_OBJECT_ID monitoredObjectIdentifier;
     uint8_t invokeID;   /* for confirmed COV */
-    uint32_t lifetime;  /* optional */
+    uint32_t lifetime;  /* optional - 0=indefinite */
+    BACNET_DEADLINE lifetime_timer;     /* counts down a definite lifetime */
+    /* next in the subscription hash chain when valid, or in the free list */
+    struct BACnet_COV_Subscription *next_key;
+    /* next in the monitored object hash chain, when valid */
+    struct BACnet_COV_Subscription *next_object;
+    /* next in the pending list */
+    struct BACnet_COV_Subscription *next_pending;
 } BACNET_COV_SUBSCRIPTION;
 
+/* The subscriptions grow on demand in blocks, up to MAX_COV_SUBCRIPTIONS.
+   The blocks are never moved, so the subscriptions can be linked into
+   the hash chains and the lifetime queue by pointer. */
 #ifndef MAX_COV_SUBCRIPTIONS
-#define MAX_COV_SUBCRIPTIONS 128
+#define MAX_COV_SUBCRIPTIONS 4096
 #endif
-static BACNET_COV_SUBSCRIPTION COV_Subscriptions[MAX_COV_SUBCRIPTIONS];
+#ifndef COV_SUBSCRIPTION_BLOCK
+#define COV_SUBSCRIPTION_BLOCK 32
+#endif
+#define COV_SUBSCRIPTION_BLOCKS \
+    ((MAX_COV_SUBCRIPTIONS + COV_SUBSCRIPTION_BLOCK - 1) / \
+    COV_SUBSCRIPTION_BLOCK)
+
+/* number of hash buckets for each of the subscription and monitored
+   object indexes */
+#ifndef COV_HASH_SIZE
+#if (MAX_COV_SUBCRIPTIONS > 2048)
+#define COV_HASH_SIZE 1024
+#elif (MAX_COV_SUBCRIPTIONS > 256)
+#define COV_HASH_SIZE 256
+#else
+#define COV_HASH_SIZE 64
+#endif
+#endif
+
+static BACNET_COV_SUBSCRIPTION *COV_Block[COV_SUBSCRIPTION_BLOCKS];
+/* number of subscriptions handed out from the blocks so far */
+static unsigned COV_Slots;
+/* subscriptions handed out and freed again */
+static BACNET_COV_SUBSCRIPTION *COV_Free;
+/* valid subscriptions by subscriber address, process and monitored object */
+static BACNET_COV_SUBSCRIPTION *COV_Key_Hash[COV_HASH_SIZE];
+/* valid subscriptions by monitored object, so that a changed object
+   finds its subscribers directly */
+static BACNET_COV_SUBSCRIPTION *COV_Object_Hash[COV_HASH_SIZE];
+/* subscriptions with a notification to send or a confirmation to wait
+   for.  A freed subscription stays in the list until the list is next
+   walked, so it may be handed out again while still in the list. */
+static BACNET_COV_SUBSCRIPTION *COV_Pending;
+/* a notification was requested since the pending list was last walked.
+   The others in the list wait for the TSM or the datalink, which wake
+   the main loop by themselves. */
+static bool COV_Requested;
+/* lifetime expiration of the subscriptions, in seconds */
+static BACNET_DEADLINE_QUEUE COV_Timers;
+
+/* the subscription in a slot, or NULL if the slot has not been used yet */
+static BACNET_COV_SUBSCRIPTION *cov_slot(
+    unsigned index)
+{
+    if (index < COV_Slots) {
+        return &COV_Block[index / COV_SUBSCRIPTION_BLOCK][index %
+            COV_SUBSCRIPTION_BLOCK];
+    }
+
+    return NULL;
+}
+
+static unsigned cov_object_hash(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    return (((uint32_t) object_type * 31) ^ object_instance) % COV_HASH_SIZE;
+}
+
+/* hash of the subscriber address, as compared by bacnet_address_same(),
+   the process identifier and the monitored object */
+static unsigned cov_key_hash(
+    BACNET_ADDRESS * dest,
+    uint32_t process_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    uint32_t hash = 0;
+    uint8_t octets[4];
+    uint8_t max_len = 0;
+
+    octets[0] = (uint8_t) (dest->net & 0xFF);
+    octets[1] = (uint8_t) (dest->net >> 8);
+    hash = fnv1a32(octets, 2, FNV1A32_SEED);
+    max_len = dest->len;
+    if (max_len > MAX_MAC_LEN)
+        max_len = MAX_MAC_LEN;
+    hash = fnv1a32(dest->adr, max_len, hash);
+    if (dest->net == 0) {
+        max_len = dest->mac_len;
+        if (max_len > MAX_MAC_LEN)
+            max_len = MAX_MAC_LEN;
+        hash = fnv1a32(dest->mac, max_len, hash);
+    }
+    octets[0] = (uint8_t) (process_id & 0xFF);
+    octets[1] = (uint8_t) ((process_id >> 8) & 0xFF);
+    octets[2] = (uint8_t) ((process_id >> 16) & 0xFF);
+    octets[3] = (uint8_t) ((process_id >> 24) & 0xFF);
+    hash = fnv1a32(octets, 4, hash);
+
+    return (unsigned) ((hash ^ cov_object_hash(object_type,
+                object_instance)) % COV_HASH_SIZE);
+}
+
+/* the valid subscription of a subscriber process to an object, or NULL */
+static BACNET_COV_SUBSCRIPTION *cov_subscription_find(
+    BACNET_ADDRESS * src,
+    BACNET_SUBSCRIBE_COV_DATA * cov_data)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+
+    cov_subscription =
+        COV_Key_Hash[cov_key_hash(src, cov_data->subscriberProcessIdentifier,
+            (BACNET_OBJECT_TYPE) cov_data->monitoredObjectIdentifier.type,
+            cov_data->monitoredObjectIdentifier.instance)];
+    while (cov_subscription) {
+        if ((cov_subscription->subscriberProcessIdentifier ==
+                cov_data->subscriberProcessIdentifier) &&
+            (cov_subscription->monitoredObjectIdentifier.type ==
+                cov_data->monitoredObjectIdentifier.type) &&
+            (cov_subscription->monitoredObjectIdentifier.instance ==
+                cov_data->monitoredObjectIdentifier.instance) &&
+            bacnet_address_same(&cov_subscription->dest, src)) {
+            break;
+        }
+        cov_subscription = cov_subscription->next_key;
+    }
+
+    return cov_subscription;
+}
+
+/* add a subscription to the pending list, if it is not there already */
+static void cov_pending_add(
+    BACNET_COV_SUBSCRIPTION * cov_subscription)
+{
+    if (!cov_subscription->flag.pending) {
+        cov_subscription->flag.pending = true;
+        cov_subscription->next_pending = COV_Pending;
+        COV_Pending = cov_subscription;
+    }
+}
+
+/* request a notification for each subscriber of a changed object */
+static void cov_object_changed(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+
+    cov_subscription =
+        COV_Object_Hash[cov_object_hash(object_type, object_instance)];
+    while (cov_subscription) {
+        if ((cov_subscription->monitoredObjectIdentifier.type ==
+                object_type) &&
+            (cov_subscription->monitoredObjectIdentifier.instance ==
+                object_instance)) {
+            cov_subscription->flag.send_requested = true;
+            cov_pending_add(cov_subscription);
+            COV_Requested = true;
+#if PRINT_ENABLED
+            fprintf(stderr, "COVtask: Marking...\n");
+#endif
+        }
+        cov_subscription = cov_subscription->next_object;
+    }
+}
+
+/* seconds remaining in the subscription lifetime, or 0 if indefinite */
+static uint32_t cov_time_remaining(
+    BACNET_COV_SUBSCRIPTION * cov_subscription)
+{
+    uint32_t seconds = 0;
+
+    if (cov_subscription->lifetime) {
+        seconds =
+            deadline_remaining(&COV_Timers,
+            &cov_subscription->lifetime_timer);
+    }
+
+    return seconds;
+}
 
 /*
 BACnetCOVSubscription ::= SEQUENCE {
@@ -173,7 +358,7 @@ static int cov_encode_subscription(
     /* TimeRemaining [3] Unsigned, */
     len =
         encode_context_unsigned(&apdu[apdu_len], 3,
-        cov_subscription->lifetime);
+        cov_time_remaining(cov_subscription));
     apdu_len += len;
 
     return apdu_len;
@@ -197,13 +382,15 @@ int handler_cov_encode_subscriptions(
     int len = 0;
     int apdu_len = 0;
     unsigned index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
 
     if (apdu) {
-        for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-            if (COV_Subscriptions[index].flag.valid) {
+        for (index = 0; index < COV_Slots; index++) {
+            cov_subscription = cov_slot(index);
+            if (cov_subscription->flag.valid) {
                 len =
                     cov_encode_subscription(&apdu[apdu_len],
-                    max_apdu - apdu_len, &COV_Subscriptions[index]);
+                    max_apdu - apdu_len, cov_subscription);
                 apdu_len += len;
                 /* TODO: too late here to notice that we overran the buffer */
                 if (apdu_len > max_apdu) {
@@ -216,6 +403,144 @@ int handler_cov_encode_subscriptions(
     return apdu_len;
 }
 
+/* remove a subscription from the indexes and put it on the free list */
+static void cov_subscription_free(
+    BACNET_COV_SUBSCRIPTION * cov_subscription)
+{
+    BACNET_COV_SUBSCRIPTION **link = NULL;
+
+    link =
+        &COV_Key_Hash[cov_key_hash(&cov_subscription->dest,
+            cov_subscription->subscriberProcessIdentifier,
+            (BACNET_OBJECT_TYPE) cov_subscription->monitoredObjectIdentifier.
+            type, cov_subscription->monitoredObjectIdentifier.instance)];
+    while (*link) {
+        if (*link == cov_subscription) {
+            *link = cov_subscription->next_key;
+            break;
+        }
+        link = &(*link)->next_key;
+    }
+    link =
+        &COV_Object_Hash[cov_object_hash((BACNET_OBJECT_TYPE)
+            cov_subscription->monitoredObjectIdentifier.type,
+            cov_subscription->monitoredObjectIdentifier.instance)];
+    while (*link) {
+        if (*link == cov_subscription) {
+            *link = cov_subscription->next_object;
+            break;
+        }
+        link = &(*link)->next_object;
+    }
+    cov_subscription->next_object = NULL;
+    deadline_stop(&COV_Timers, &cov_subscription->lifetime_timer);
+    if (cov_subscription->invokeID) {
+        tsm_free_invoke_id(cov_subscription->invokeID);
+        cov_subscription->invokeID = 0;
+    }
+    cov_subscription->flag.valid = false;
+    cov_subscription->flag.send_requested = false;
+    cov_subscription->next_key = COV_Free;
+    COV_Free = cov_subscription;
+}
+
+/* a subscription reached the end of its lifetime */
+static void cov_lifetime_expired(
+    BACNET_DEADLINE * deadline)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription =
+        (BACNET_COV_SUBSCRIPTION *) deadline->context;
+
+    if (cov_subscription->flag.valid) {
+        /* expire the subscription */
+#if PRINT_ENABLED
+        fprintf(stderr, "COVtimer: PID=%u ",
+            cov_subscription->subscriberProcessIdentifier);
+        fprintf(stderr, "%s %u ",
+            bactext_object_type_name(cov_subscription->
+                monitoredObjectIdentifier.type),
+            cov_subscription->monitoredObjectIdentifier.instance);
+        fprintf(stderr, "\n");
+#endif
+        cov_subscription_free(cov_subscription);
+    }
+}
+
+/* (re)start the lifetime of a subscription - 0 is indefinite.
+   Returns false if the lifetime could not be timed. */
+static bool cov_lifetime_start(
+    BACNET_COV_SUBSCRIPTION * cov_subscription,
+    uint32_t lifetime)
+{
+    cov_subscription->lifetime = lifetime;
+    if (lifetime) {
+        return deadline_start(&COV_Timers, &cov_subscription->lifetime_timer,
+            lifetime);
+    }
+    deadline_stop(&COV_Timers, &cov_subscription->lifetime_timer);
+
+    return true;
+}
+
+/* a new valid subscription, added to the indexes: a freed one, or a new
+   one if the store can still grow.  Returns NULL if the store is full. */
+static BACNET_COV_SUBSCRIPTION *cov_subscription_new(
+    BACNET_ADDRESS * src,
+    BACNET_SUBSCRIBE_COV_DATA * cov_data)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+    unsigned block = 0;
+    unsigned hash = 0;
+
+    if (COV_Free) {
+        cov_subscription = COV_Free;
+        COV_Free = cov_subscription->next_key;
+    } else if (COV_Slots < MAX_COV_SUBCRIPTIONS) {
+        block = COV_Slots / COV_SUBSCRIPTION_BLOCK;
+        if (COV_Block[block] == NULL) {
+            COV_Block[block] =
+                calloc(COV_SUBSCRIPTION_BLOCK,
+                sizeof(BACNET_COV_SUBSCRIPTION));
+        }
+        if (COV_Block[block] == NULL) {
+            return NULL;
+        }
+        COV_Slots++;
+        cov_subscription = cov_slot(COV_Slots - 1);
+        deadline_init(&cov_subscription->lifetime_timer, cov_lifetime_expired,
+            cov_subscription);
+    } else {
+        return NULL;
+    }
+    /* the pending flag and link are kept, since a freed subscription
+       can still be in the pending list */
+    cov_subscription->flag.valid = true;
+    cov_subscription->flag.send_requested = false;
+    bacnet_address_copy(&cov_subscription->dest, src);
+    cov_subscription->subscriberProcessIdentifier =
+        cov_data->subscriberProcessIdentifier;
+    cov_subscription->monitoredObjectIdentifier.type =
+        cov_data->monitoredObjectIdentifier.type;
+    cov_subscription->monitoredObjectIdentifier.instance =
+        cov_data->monitoredObjectIdentifier.instance;
+    cov_subscription->invokeID = 0;
+    cov_subscription->lifetime = 0;
+    hash =
+        cov_key_hash(src, cov_data->subscriberProcessIdentifier,
+        (BACNET_OBJECT_TYPE) cov_data->monitoredObjectIdentifier.type,
+        cov_data->monitoredObjectIdentifier.instance);
+    cov_subscription->next_key = COV_Key_Hash[hash];
+    COV_Key_Hash[hash] = cov_subscription;
+    hash =
+        cov_object_hash((BACNET_OBJECT_TYPE) cov_data->
+        monitoredObjectIdentifier.type,
+        cov_data->monitoredObjectIdentifier.instance);
+    cov_subscription->next_object = COV_Object_Hash[hash];
+    COV_Object_Hash[hash] = cov_subscription;
+
+    return cov_subscription;
+}
+
 /** Handler to initialize the COV list, clearing and disabling each entry.
  * @ingroup DSCOV
  */
@@ -223,19 +548,18 @@ void handler_cov_init(
     void)
 {
     unsigned index = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
 
-    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-        COV_Subscriptions[index].flag.valid = false;
-        COV_Subscriptions[index].dest.mac_len = 0;
-        COV_Subscriptions[index].subscriberProcessIdentifier = 0;
-        COV_Subscriptions[index].monitoredObjectIdentifier.type =
-            OBJECT_ANALOG_INPUT;
-        COV_Subscriptions[index].monitoredObjectIdentifier.instance = 0;
-        COV_Subscriptions[index].flag.issueConfirmedNotifications = false;
-        COV_Subscriptions[index].invokeID = 0;
-        COV_Subscriptions[index].lifetime = 0;
-        COV_Subscriptions[index].flag.send_requested = false;
+    for (index = 0; index < COV_Slots; index++) {
+        cov_subscription = cov_slot(index);
+        if (cov_subscription->flag.valid) {
+            cov_subscription_free(cov_subscription);
+        }
+        cov_subscription->flag.pending = false;
+        cov_subscription->next_pending = NULL;
     }
+    COV_Pending = NULL;
+    COV_Requested = false;
 }
 
 static bool cov_list_subscribe(
@@ -244,79 +568,48 @@ static bool cov_list_subscribe(
     BACNET_ERROR_CLASS * error_class,
     BACNET_ERROR_CODE * error_code)
 {
-    bool existing_entry = false;
-    int index;
-    int first_invalid_index = -1;
-    bool found = true;
-
-    /* unable to subscribe - resources? */
-    /* unable to cancel subscription - other? */
-
-    /* existing? - match Object ID and Process ID */
-    for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-        if (COV_Subscriptions[index].flag.valid) {
-            if ((COV_Subscriptions[index].monitoredObjectIdentifier.type ==
-                    cov_data->monitoredObjectIdentifier.type) &&
-                (COV_Subscriptions[index].monitoredObjectIdentifier.instance ==
-                    cov_data->monitoredObjectIdentifier.instance) &&
-                (COV_Subscriptions[index].subscriberProcessIdentifier ==
-                    cov_data->subscriberProcessIdentifier)) {
-                existing_entry = true;
-                if (cov_data->cancellationRequest) {
-                    COV_Subscriptions[index].flag.valid = false;
-                } else {
-                    bacnet_address_copy(&COV_Subscriptions[index].dest, src);
-                    COV_Subscriptions[index].flag.issueConfirmedNotifications =
-                        cov_data->issueConfirmedNotifications;
-                    COV_Subscriptions[index].lifetime = cov_data->lifetime;
-                    COV_Subscriptions[index].flag.send_requested = true;
-                }
-                if (COV_Subscriptions[index].invokeID) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
-                break;
-            }
-        } else {
-            if (first_invalid_index < 0) {
-                first_invalid_index = index;
-            }
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+
+    /* existing? - match the subscriber, Process ID and Object ID */
+    cov_subscription = cov_subscription_find(src, cov_data);
+    if (cov_data->cancellationRequest) {
+        if (cov_subscription) {
+            cov_subscription_free(cov_subscription);
         }
+        /* From BACnet Standard 135-2010-13.14.2
+           ...Cancellations that are issued for which no matching COV
+           context can be found shall succeed as if a context had
+           existed, returning 'Result(+)'. */
+        return true;
     }
-    if (!existing_entry && (first_invalid_index >= 0) &&
-        (!cov_data->cancellationRequest)) {
-        index = first_invalid_index;
-        found = true;
-        COV_Subscriptions[index].flag.valid = true;
-        bacnet_address_copy(&COV_Subscriptions[index].dest, src);
-        COV_Subscriptions[index].monitoredObjectIdentifier.type =
-            cov_data->monitoredObjectIdentifier.type;
-        COV_Subscriptions[index].monitoredObjectIdentifier.instance =
-            cov_data->monitoredObjectIdentifier.instance;
-        COV_Subscriptions[index].subscriberProcessIdentifier =
-            cov_data->subscriberProcessIdentifier;
-        COV_Subscriptions[index].flag.issueConfirmedNotifications =
-            cov_data->issueConfirmedNotifications;
-        COV_Subscriptions[index].invokeID = 0;
-        COV_Subscriptions[index].lifetime = cov_data->lifetime;
-        COV_Subscriptions[index].flag.send_requested = true;
-    } else if (!existing_entry) {
-        if (first_invalid_index < 0) {
+    if (cov_subscription) {
+        if (cov_subscription->invokeID) {
+            tsm_free_invoke_id(cov_subscription->invokeID);
+            cov_subscription->invokeID = 0;
+        }
+    } else {
+        cov_subscription = cov_subscription_new(src, cov_data);
+        if (!cov_subscription) {
             /* Out of resources */
             *error_class = ERROR_CLASS_RESOURCES;
             *error_code = ERROR_CODE_NO_SPACE_TO_ADD_LIST_ELEMENT;
-            found = false;
-        } else {
-            /* cancellationRequest - valid object not subscribed */
-            /* From BACnet Standard 135-2010-13.14.2
-               ...Cancellations that are issued for which no matching COV
-               context can be found shall succeed as if a context had
-               existed, returning 'Result(+)'. */
-            found = true;
+            return false;
         }
     }
+    cov_subscription->flag.issueConfirmedNotifications =
+        cov_data->issueConfirmedNotifications;
+    if (!cov_lifetime_start(cov_subscription, cov_data->lifetime)) {
+        /* it would never expire, and hold its slot forever */
+        cov_subscription_free(cov_subscription);
+        *error_class = ERROR_CLASS_RESOURCES;
+        *error_code = ERROR_CODE_NO_SPACE_TO_ADD_LIST_ELEMENT;
+        return false;
+    }
+    cov_subscription->flag.send_requested = true;
+    cov_pending_add(cov_subscription);
+    COV_Requested = true;
 
-    return found;
+    return true;
 }
 
 static bool cov_send_request(
@@ -351,7 +644,7 @@ static bool cov_send_request(
         cov_subscription->monitoredObjectIdentifier.type;
     cov_data.monitoredObjectIdentifier.instance =
         cov_subscription->monitoredObjectIdentifier.instance;
-    cov_data.timeRemaining = cov_subscription->lifetime;
+    cov_data.timeRemaining = cov_time_remaining(cov_subscription);
     cov_data.listOfValues = value_list;
     if (cov_subscription->flag.issueConfirmedNotifications) {
         invoke_id = tsm_next_free_invokeID();
@@ -386,221 +679,167 @@ static bool cov_send_request(
     return status;
 }
 
-static void cov_lifetime_expiration_handler(
-    unsigned index,
-    uint32_t elapsed_seconds,
-    uint32_t lifetime_seconds)
-{
-    if (index < MAX_COV_SUBCRIPTIONS) {
-        /* handle lifetime expiration */
-        if (lifetime_seconds >= elapsed_seconds) {
-            COV_Subscriptions[index].lifetime -= elapsed_seconds;
-#if 0
-            fprintf(stderr, "COVtimer: subscription[%d].lifetime=%lu\n", index,
-                (unsigned long) COV_Subscriptions[index].lifetime);
-#endif
-        } else {
-            COV_Subscriptions[index].lifetime = 0;
-        }
-        if (COV_Subscriptions[index].lifetime == 0) {
-            /* expire the subscription */
-#if PRINT_ENABLED
-            fprintf(stderr, "COVtimer: PID=%u ",
-                COV_Subscriptions[index].subscriberProcessIdentifier);
-            fprintf(stderr, "%s %u ",
-                bactext_object_type_name(COV_Subscriptions[index].
-                    monitoredObjectIdentifier.type),
-                COV_Subscriptions[index].monitoredObjectIdentifier.instance);
-            fprintf(stderr, "time remaining=%u seconds ",
-                COV_Subscriptions[index].lifetime);
-            fprintf(stderr, "\n");
-#endif
-            COV_Subscriptions[index].flag.valid = false;
-            if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                if (COV_Subscriptions[index].invokeID) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
-            }
-        }
-    }
-}
-
-/** Handler to check the list of subscribed objects for any that have changed
- *  and so need to have notifications sent.
+/** Handler to count down the lifetimes of the COV subscriptions.
  * @ingroup DSCOV
- * This handler will be invoked by the main program every second or so.
- * This example only handles Binary Inputs, but can be easily extended to
- * support other types.
- * For each subscribed object,
- *  - See if the subscription has timed out
- *    - Remove it if it has timed out.
- *  - See if the subscribed object instance has changed
- *    (eg, check with Binary_Input_Change_Of_Value() )
- *  - If changed,
- *    - Clear the COV (eg, Binary_Input_Change_Of_Value_Clear() )
- *    - Send the notice with cov_send_request()
- *      - Will be confirmed or unconfirmed, as per the subscription.
- *
- * @note worst case tasking: MS/TP with the ability to send only
- *        one notification per task cycle.
+ * Subscriptions that reach the end of their lifetime are removed.
  *
  * @param elapsed_seconds [in] How many seconds have elapsed since last called.
  */
 void handler_cov_timer_seconds(
     uint32_t elapsed_seconds)
 {
-    unsigned index = 0;
-    uint32_t lifetime_seconds = 0;
-
     if (elapsed_seconds) {
-        /* handle the subscription timeouts */
-        for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-            if (COV_Subscriptions[index].flag.valid) {
-                lifetime_seconds = COV_Subscriptions[index].lifetime;
-                if (lifetime_seconds) {
-                    /* only expire COV with definite lifetimes */
-                    cov_lifetime_expiration_handler(index, elapsed_seconds,
-                        lifetime_seconds);
-                }
-            }
-        }
+        /* handle the subscription timeouts - only subscriptions
+           with definite lifetimes are in the queue */
+        (void) deadline_queue_timer(&COV_Timers, elapsed_seconds);
     }
 }
 
-void handler_cov_task(
+/** Get the time until the next COV subscription lifetime expires.
+ * @ingroup DSCOV
+ * @return seconds until the next expiration, or DEADLINE_NONE if
+ *         no subscription has a definite lifetime.
+ */
+uint32_t handler_cov_timer_next_seconds(
     void)
 {
-    static int index = 0;
+    return deadline_queue_next(&COV_Timers);
+}
+
+/* send the requested notifications, and look after the confirmed ones,
+   keeping the subscriptions that are still waiting in the pending list */
+static void cov_send_pending(
+    void)
+{
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+    BACNET_COV_SUBSCRIPTION *pending = COV_Pending;
+    bool send = false;
+    bool status = false;
     BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
     uint32_t object_instance = 0;
-    bool status = false;
-    bool send = false;
     BACNET_PROPERTY_VALUE value_list[2];
-    /* states for transmitting */
-    static enum {
-        COV_STATE_IDLE = 0,
-        COV_STATE_MARK,
-        COV_STATE_CLEAR,
-        COV_STATE_FREE,
-        COV_STATE_SEND
-    } cov_task_state = COV_STATE_IDLE;
-
-    switch (cov_task_state) {
-        case COV_STATE_IDLE:
-            index = 0;
-            cov_task_state = COV_STATE_MARK;
-            break;
-        case COV_STATE_MARK:
-            /* mark any subscriptions where the value has changed */
-            if (COV_Subscriptions[index].flag.valid) {
+
+    COV_Pending = NULL;
+    COV_Requested = false;
+    while (pending) {
+        cov_subscription = pending;
+        pending = cov_subscription->next_pending;
+        cov_subscription->flag.pending = false;
+        cov_subscription->next_pending = NULL;
+        if (!cov_subscription->flag.valid) {
+            continue;
+        }
+        /* confirmed notification house keeping */
+        if ((cov_subscription->flag.issueConfirmedNotifications) &&
+            (cov_subscription->invokeID)) {
+            if (tsm_invoke_id_free(cov_subscription->invokeID)) {
+                cov_subscription->invokeID = 0;
+            } else if (tsm_invoke_id_failed(cov_subscription->invokeID)) {
+                tsm_free_invoke_id(cov_subscription->invokeID);
+                cov_subscription->invokeID = 0;
+            }
+        }
+        /* send any COVs that are requested */
+        if (cov_subscription->flag.send_requested) {
+            send = true;
+            if (cov_subscription->flag.issueConfirmedNotifications) {
+                if (cov_subscription->invokeID != 0) {
+                    /* already sending */
+                    send = false;
+                }
+                if (!tsm_transaction_available()) {
+                    /* no transactions available - can't send now */
+                    send = false;
+                }
+            }
+            if (send) {
                 object_type = (BACNET_OBJECT_TYPE)
-                    COV_Subscriptions[index].monitoredObjectIdentifier.type;
+                    cov_subscription->monitoredObjectIdentifier.type;
                 object_instance =
-                    COV_Subscriptions[index].
-                    monitoredObjectIdentifier.instance;
-                status = Device_COV(object_type, object_instance);
-                if (status) {
-                    COV_Subscriptions[index].flag.send_requested = true;
+                    cov_subscription->monitoredObjectIdentifier.instance;
 #if PRINT_ENABLED
-                    fprintf(stderr, "COVtask: Marking...\n");
+                fprintf(stderr, "COVtask: Sending...\n");
 #endif
+                /* configure the linked list for the two properties */
+                value_list[0].next = &value_list[1];
+                value_list[1].next = NULL;
+                (void) Device_Encode_Value_List(object_type,
+                    object_instance, &value_list[0]);
+                status = cov_send_request(cov_subscription, &value_list[0]);
+                if (status) {
+                    cov_subscription->flag.send_requested = false;
                 }
             }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_CLEAR;
-            }
-            break;
-        case COV_STATE_CLEAR:
-            /* clear the COV flag after checking all subscriptions */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
+        }
+        if ((cov_subscription->flag.send_requested) ||
+            (cov_subscription->invokeID)) {
+            cov_pending_add(cov_subscription);
+        }
+    }
+}
+
+/** Handler to send the notifications for the objects that changed.
+ * @ingroup DSCOV
+ * This handler will be invoked by the main program each time around its
+ * loop.  The objects queue themselves on the COV queue when their
+ * Change_Of_Value flag is set (eg, in Binary_Input_Present_Value_Set()).
+ * For each object on the queue,
+ *  - Request a notification for each of its subscribers.
+ *  - Clear the COV (eg, Binary_Input_Change_Of_Value_Clear() )
+ * Then the requested notices are sent with cov_send_request()
+ *  - Will be confirmed or unconfirmed, as per the subscription.
+ * A notice that cannot be sent now, such as when the datalink or the
+ * transaction state machine is busy, is sent on a later call.
+ */
+void handler_cov_task(
+    void)
+{
+    BACNET_OBJECT_ID object_id;
+    BACNET_OBJECT_TYPE object_type = MAX_BACNET_OBJECT_TYPE;
+    uint32_t object_instance = 0;
+    BACNET_COV_SUBSCRIPTION *cov_subscription = NULL;
+    unsigned index = 0;
+
+    while (cov_queue_pop(&object_id)) {
+        object_type = (BACNET_OBJECT_TYPE) object_id.type;
+        cov_object_changed(object_type, object_id.instance);
+        Device_COV_Clear(object_type, object_id.instance);
+    }
+    if (cov_queue_overflow()) {
+        /* some objects did not fit in the queue,
+           so check all of the subscribed objects */
+        for (index = 0; index < COV_Slots; index++) {
+            cov_subscription = cov_slot(index);
+            if (cov_subscription->flag.valid) {
                 object_type = (BACNET_OBJECT_TYPE)
-                    COV_Subscriptions[index].monitoredObjectIdentifier.type;
+                    cov_subscription->monitoredObjectIdentifier.type;
                 object_instance =
-                    COV_Subscriptions[index].
-                    monitoredObjectIdentifier.instance;
-                Device_COV_Clear(object_type, object_instance);
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_FREE;
-            }
-            break;
-        case COV_STATE_FREE:
-            /* confirmed notification house keeping */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.issueConfirmedNotifications) &&
-                (COV_Subscriptions[index].invokeID)) {
-                if (tsm_invoke_id_free(COV_Subscriptions[index].invokeID)) {
-                    COV_Subscriptions[index].invokeID = 0;
-                } else
-                    if (tsm_invoke_id_failed(COV_Subscriptions
-                        [index].invokeID)) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
+                    cov_subscription->monitoredObjectIdentifier.instance;
+                if (Device_COV(object_type, object_instance)) {
+                    cov_object_changed(object_type, object_instance);
+                    Device_COV_Clear(object_type, object_instance);
                 }
             }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_SEND;
-            }
-            break;
-        case COV_STATE_SEND:
-            /* send any COVs that are requested */
-            if ((COV_Subscriptions[index].flag.valid) &&
-                (COV_Subscriptions[index].flag.send_requested)) {
-                send = true;
-                if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                    if (COV_Subscriptions[index].invokeID != 0) {
-                        /* already sending */
-                        send = false;
-                    }
-                    if (!tsm_transaction_available()) {
-                        /* no transactions available - can't send now */
-                        send = false;
-                    }
-                }
-                if (send) {
-                    object_type = (BACNET_OBJECT_TYPE)
-                        COV_Subscriptions[index].
-                        monitoredObjectIdentifier.type;
-                    object_instance =
-                        COV_Subscriptions[index].
-                        monitoredObjectIdentifier.instance;
-#if PRINT_ENABLED
-                    fprintf(stderr, "COVtask: Sending...\n");
-#endif
-                    /* configure the linked list for the two properties */
-                    value_list[0].next = &value_list[1];
-                    value_list[1].next = NULL;
-                    (void) Device_Encode_Value_List(object_type,
-                        object_instance, &value_list[0]);
-                    status =
-                        cov_send_request(&COV_Subscriptions[index],
-                        &value_list[0]);
-                    if (status) {
-                        COV_Subscriptions[index].flag.send_requested = false;
-                    }
-                }
-            }
-            index++;
-            if (index >= MAX_COV_SUBCRIPTIONS) {
-                index = 0;
-                cov_task_state = COV_STATE_IDLE;
-            }
-            break;
-        default:
-            index = 0;
-            cov_task_state = COV_STATE_IDLE;
-            break;
+        }
+    }
+    if (COV_Pending) {
+        cov_send_pending();
     }
 }
 
+/** Tell if handler_cov_task() has work to do now: changed objects to
+ * look at, or notifications newly requested.  Until then the main loop
+ * can wait for a packet or a timer.
+ * @ingroup DSCOV
+ * @return true if handler_cov_task() should be called without waiting.
+ */
+bool handler_cov_task_pending(
+    void)
+{
+    /* an overflow leaves the queue full, so it is not empty either */
+    return (cov_queue_count() != 0) || COV_Requested;
+}
+
 static bool cov_subscribe(
     BACNET_ADDRESS * src,
     BACNET_SUBSCRIBE_COV_DATA * cov_data,
@@ -620,6 +859,11 @@ static bool cov_subscribe(
         if (status) {
             status =
                 cov_list_subscribe(src, cov_data, error_class, error_code);
+            if (status && !cov_data->cancellationRequest) {
+                /* the first notification reports the current value, and
+                   clearing the flag lets the next change be queued */
+                Device_COV_Clear(object_type, object_instance);
+            }
         } else {
             *error_class = ERROR_CLASS_OBJECT;
             *error_code = ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
@@ -35,6 +35,7 @@
 #include "bacdevobjpropref.h"
 #include "apdu.h"
 #include "npdu.h"
+#include "tsm.h"
 #include "abort.h"
 #include "reject.h"
 #include "rp.h"
@@ -54,7 +55,9 @@
  *   - the message is segmented
  *   - if decoding fails
  *   - if the response would be too large
- * - the result from Device_Read_Property(), if it succeeds
+ * - the result from Device_Read_Property(), if it succeeds,
+ *   which the TSM sends in segments if it is too big for one APDU
+ *   and the client accepts a segmented response
  * - an Error if Device_Read_Property() fails
  *   or there isn't enough room in the APDU to fit the data.
  *
@@ -79,6 +82,8 @@ void handler_read_property(
     bool error = true;  /* assume that there is an error */
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *apdu = NULL;
+    uint16_t max_apdu = 0;
 
     /* configure default error code as an abort since it is common */
     rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -116,36 +121,78 @@ void handler_read_property(
         rpdata.object_instance = Device_Object_Instance_Number();
     }
 
+    /* a reply that could be sent in segments is built apart from
+       the NPDU, since it may be bigger than one */
+    max_apdu = tsm_segmented_response_max(service_data);
+    apdu = &Handler_Transmit_Buffer[npdu_len];
+#if (MAX_SEGMENTED_RESPONSES)
+    if (max_apdu > MAX_APDU) {
+        apdu = &Handler_Segment_Buffer[0];
+    }
+#endif
     apdu_len =
-        rp_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
-        service_data->invoke_id, &rpdata);
-    /* configure our storage */
-    rpdata.application_data = &Handler_Transmit_Buffer[npdu_len + apdu_len];
-    rpdata.application_data_len =
-        sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+        rp_ack_encode_apdu_init(&apdu[0], service_data->invoke_id, &rpdata);
+    /* configure our storage, leaving room for the closing tag */
+    rpdata.application_data = &apdu[apdu_len];
+    if (apdu == &Handler_Transmit_Buffer[npdu_len]) {
+        rpdata.application_data_len =
+            sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+    } else {
+        rpdata.application_data_len = max_apdu - (apdu_len + 1);
+    }
     len = Device_Read_Property(&rpdata);
     if (len >= 0) {
         apdu_len += len;
-        len =
-            rp_ack_encode_apdu_object_property_end(&Handler_Transmit_Buffer
-            [npdu_len + apdu_len]);
+        len = rp_ack_encode_apdu_object_property_end(&apdu[apdu_len]);
         apdu_len += len;
-        if (apdu_len > service_data->max_resp) {
+        if (apdu_len > max_apdu) {
             /* too big for the sender - send an abort
              * Setting of error code needed here as read property processing may
              * have overriden the default set at start */
-            rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            if (service_data->segmented_response_accepted) {
+                rpdata.error_code = ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+            } else {
+                rpdata.error_code =
+                    ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            }
             len = BACNET_STATUS_ABORT;
 #if PRINT_ENABLED
             fprintf(stderr, "RP: Message too large.\n");
 #endif
+        } else if ((apdu_len > service_data->max_resp) ||
+            (apdu_len > MAX_APDU)) {
+            /* too big for one APDU, so the TSM sends it in segments */
+            if (tsm_set_segmented_complex_ack(src, &npdu_data, service_data,
+                    &apdu[0], (uint16_t) apdu_len)) {
+#if PRINT_ENABLED
+                fprintf(stderr, "RP: Sending Segmented Ack!\n");
+#endif
+                return;
+            }
+            if (service_data->segmented_response_accepted) {
+                rpdata.error_code = ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+            } else {
+                rpdata.error_code =
+                    ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            }
+            len = BACNET_STATUS_ABORT;
         } else {
+            if (apdu != &Handler_Transmit_Buffer[npdu_len]) {
+                memmove(&Handler_Transmit_Buffer[npdu_len], &apdu[0],
+                    apdu_len);
+            }
 #if PRINT_ENABLED
             fprintf(stderr, "RP: Sending Ack!\n");
 #endif
             error = false;
         }
     } else {
+        if ((len == BACNET_STATUS_ABORT) &&
+            (rpdata.error_code == ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED)
+            && service_data->segmented_response_accepted) {
+            /* the value does not fit, e.g. the whole Object_List */
+            rpdata.error_code = ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+        }
 #if PRINT_ENABLED
         fprintf(stderr, "RP: Device_Read_Property: ");
         if (len == BACNET_STATUS_ABORT) {
@@ -36,6 +36,7 @@
 #include "bacdcode.h"
 #include "apdu.h"
 #include "npdu.h"
+#include "tsm.h"
 #include "abort.h"
 #include "reject.h"
 #include "bacerror.h"
@@ -46,7 +47,8 @@
 
 /** @file h_rpm.c  Handles Read Property Multiple requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+/* big enough for a property value that is sent in segments */
+static uint8_t Temp_Buf[MAX_SEGMENTED_APDU] = { 0 };
 
 static BACNET_PROPERTY_ID RPM_Object_Property(
     struct special_property_list_t *pPropertyList,
@@ -101,13 +103,26 @@ static unsigned RPM_Object_Property_Count(
     return count;
 }
 
+/* The abort for a reply too big to send, as ReadProperty gives it:
+   a client that takes a segmented response would need more segments. */
+static BACNET_ERROR_CODE RPM_Abort_Too_Big(
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+{
+    if (service_data->segmented_response_accepted) {
+        return ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+    }
+
+    return ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+}
+
 /** Encode the RPM property returning the length of the encoding,
    or 0 if there is no room to fit the encoding.  */
 static int RPM_Encode_Property(
     uint8_t * apdu,
     uint16_t offset,
     uint16_t max_apdu,
-    BACNET_RPM_DATA * rpmdata)
+    BACNET_RPM_DATA * rpmdata,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
 {
     int len = 0;
     size_t copy_len = 0;
@@ -119,7 +134,7 @@ static int RPM_Encode_Property(
         rpmdata->object_property, rpmdata->array_index);
     copy_len = memcopy(&apdu[0], &Temp_Buf[0], offset, len, max_apdu);
     if (copy_len == 0) {
-        rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+        rpmdata->error_code = RPM_Abort_Too_Big(service_data);
         return BACNET_STATUS_ABORT;
     }
     apdu_len += len;
@@ -136,6 +151,12 @@ static int RPM_Encode_Property(
     if (len < 0) {
         if ((len == BACNET_STATUS_ABORT) || (len == BACNET_STATUS_REJECT)) {
             rpmdata->error_code = rpdata.error_code;
+            if ((len == BACNET_STATUS_ABORT) &&
+                (rpdata.error_code ==
+                    ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED)) {
+                /* the value does not fit, e.g. the whole Object_List */
+                rpmdata->error_code = RPM_Abort_Too_Big(service_data);
+            }
             /* pass along aborts and rejects for now */
             return len; /* Ie, Abort */
         }
@@ -147,7 +168,7 @@ static int RPM_Encode_Property(
             memcopy(&apdu[0], &Temp_Buf[0], offset + apdu_len, len, max_apdu);
 
         if (copy_len == 0) {
-            rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            rpmdata->error_code = RPM_Abort_Too_Big(service_data);
             return BACNET_STATUS_ABORT;
         }
     } else if ((offset + apdu_len + 1 + len + 1) < max_apdu) {
@@ -157,7 +178,7 @@ static int RPM_Encode_Property(
             &Temp_Buf[0], len);
     } else {
         /* not enough room - abort! */
-        rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+        rpmdata->error_code = RPM_Abort_Too_Big(service_data);
         return BACNET_STATUS_ABORT;
     }
     apdu_len += len;
@@ -174,7 +195,9 @@ static int RPM_Encode_Property(
  *   - the message is segmented
  *   - if decoding fails
  *   - if the response would be too large
- * - the result from each included read request, if it succeeds
+ * - the result from each included read request, if it succeeds,
+ *   which the TSM sends in segments if it is too big for one APDU
+ *   and the client accepts a segmented response
  * - an Error if processing fails for all, or individual errors if only some fail,
  *   or there isn't enough room in the APDU to fit the data.
  *
@@ -201,6 +224,8 @@ void handler_read_property_multiple(
     int apdu_len = 0;
     int npdu_len = 0;
     int error = 0;
+    uint8_t *apdu = NULL;
+    uint16_t max_apdu = 0;
 
     /* jps_debug - see if we are utilizing all the buffer */
     /* memset(&Handler_Transmit_Buffer[0], 0xff, sizeof(Handler_Transmit_Buffer)); */
@@ -218,11 +243,19 @@ void handler_read_property_multiple(
 #endif
         goto RPM_FAILURE;
     }
+    /* a reply that could be sent in segments is built apart from
+       the NPDU, since it may be bigger than one */
+    max_apdu = tsm_segmented_response_max(service_data);
+    apdu = &Handler_Transmit_Buffer[npdu_len];
+#if (MAX_SEGMENTED_RESPONSES)
+    if (max_apdu > MAX_APDU) {
+        apdu = &Handler_Segment_Buffer[0];
+    }
+#endif
     /* decode apdu request & encode apdu reply
        encode complex ack, invoke id, service choice */
     apdu_len =
-        rpm_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
-        service_data->invoke_id);
+        rpm_ack_encode_apdu_init(&apdu[0], service_data->invoke_id);
     for (;;) {
         /* Start by looking for an object ID */
         len =
@@ -249,13 +282,12 @@ void handler_read_property_multiple(
         /* Stick this object id into the reply - if it will fit */
         len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
         copy_len =
-            memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0], apdu_len,
-            len, MAX_APDU);
+            memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len, max_apdu);
         if (copy_len == 0) {
 #if PRINT_ENABLED
             fprintf(stderr, "RPM: Response too big!\r\n");
 #endif
-            rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            rpmdata.error_code = RPM_Abort_Too_Big(service_data);
             error = BACNET_STATUS_ABORT;
             goto RPM_FAILURE;
         }
@@ -292,15 +324,15 @@ void handler_read_property_multiple(
                         rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
                         rpmdata.object_property, rpmdata.array_index);
                     copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                        memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len,
+                        max_apdu);
                     if (copy_len == 0) {
 #if PRINT_ENABLED
                         fprintf(stderr,
                             "RPM: Too full to encode property!\r\n");
 #endif
                         rpmdata.error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                            RPM_Abort_Too_Big(service_data);
                         error = BACNET_STATUS_ABORT;
                         goto RPM_FAILURE;
                     }
@@ -310,14 +342,14 @@ void handler_read_property_multiple(
                         ERROR_CLASS_PROPERTY,
                         ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
                     copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
+                        memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len,
+                        max_apdu);
                     if (copy_len == 0) {
 #if PRINT_ENABLED
                         fprintf(stderr, "RPM: Too full to encode error!\r\n");
 #endif
                         rpmdata.error_code =
-                            ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                            RPM_Abort_Too_Big(service_data);
                         error = BACNET_STATUS_ABORT;
                         goto RPM_FAILURE;
                     }
@@ -332,9 +364,8 @@ void handler_read_property_multiple(
                     if (property_count == 0) {
                         /* handle the error code - but use the special property */
                         len =
-                            RPM_Encode_Property(&Handler_Transmit_Buffer
-                            [npdu_len], (uint16_t) apdu_len, MAX_APDU,
-                            &rpmdata);
+                            RPM_Encode_Property(&apdu[0], (uint16_t) apdu_len,
+                            max_apdu, &rpmdata, service_data);
                         if (len > 0) {
                             apdu_len += len;
                         } else {
@@ -351,9 +382,9 @@ void handler_read_property_multiple(
                                 RPM_Object_Property(&property_list,
                                 special_object_property, index);
                             len =
-                                RPM_Encode_Property(&Handler_Transmit_Buffer
-                                [npdu_len], (uint16_t) apdu_len, MAX_APDU,
-                                &rpmdata);
+                                RPM_Encode_Property(&apdu[0],
+                                (uint16_t) apdu_len, max_apdu, &rpmdata,
+                                service_data);
                             if (len > 0) {
                                 apdu_len += len;
                             } else {
@@ -370,8 +401,8 @@ void handler_read_property_multiple(
             } else {
                 /* handle an individual property */
                 len =
-                    RPM_Encode_Property(&Handler_Transmit_Buffer[npdu_len],
-                    (uint16_t) apdu_len, MAX_APDU, &rpmdata);
+                    RPM_Encode_Property(&apdu[0], (uint16_t) apdu_len,
+                    max_apdu, &rpmdata, service_data);
                 if (len > 0) {
                     apdu_len += len;
                 } else {
@@ -388,14 +419,14 @@ void handler_read_property_multiple(
                 decode_len++;
                 len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
                 copy_len =
-                    memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0],
-                    apdu_len, len, MAX_APDU);
+                    memcopy(&apdu[0], &Temp_Buf[0], apdu_len, len,
+                    max_apdu);
                 if (copy_len == 0) {
 #if PRINT_ENABLED
                     fprintf(stderr, "RPM: Too full to encode object end!\r\n");
 #endif
                     rpmdata.error_code =
-                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                        RPM_Abort_Too_Big(service_data);
                     error = BACNET_STATUS_ABORT;
                     goto RPM_FAILURE;
                 } else {
@@ -410,15 +441,31 @@ void handler_read_property_multiple(
         }
     }
 
-    if (apdu_len > service_data->max_resp) {
+    if (apdu_len > max_apdu) {
         /* too big for the sender - send an abort */
-        rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+        rpmdata.error_code = RPM_Abort_Too_Big(service_data);
         error = BACNET_STATUS_ABORT;
 #if PRINT_ENABLED
         fprintf(stderr, "RPM: Message too large.  Sending Abort!\n");
 #endif
         goto RPM_FAILURE;
     }
+    if ((apdu_len > service_data->max_resp) || (apdu_len > MAX_APDU)) {
+        /* too big for one APDU, so the TSM sends it in segments */
+        if (tsm_set_segmented_complex_ack(src, &npdu_data, service_data,
+                &apdu[0], (uint16_t) apdu_len)) {
+#if PRINT_ENABLED
+            fprintf(stderr, "RPM: Sending Segmented Ack!\n");
+#endif
+            return;
+        }
+        rpmdata.error_code = RPM_Abort_Too_Big(service_data);
+        error = BACNET_STATUS_ABORT;
+        goto RPM_FAILURE;
+    }
+    if (apdu != &Handler_Transmit_Buffer[npdu_len]) {
+        memmove(&Handler_Transmit_Buffer[npdu_len], &apdu[0], apdu_len);
+    }
 
   RPM_FAILURE:
     if (error) {
@@ -34,6 +34,7 @@
 #include "bacerror.h"
 #include "apdu.h"
 #include "npdu.h"
+#include "tsm.h"
 #include "abort.h"
 #include "readrange.h"
 #include "device.h"
@@ -41,7 +42,8 @@
 
 /** @file h_rr.c  Handles Read Range requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
+/* big enough for a range that is sent in segments */
+static uint8_t Temp_Buf[MAX_SEGMENTED_APDU] = { 0 };
 
 /* Encodes the property APDU and returns the length,
    or sets the error, and returns -1 */
@@ -100,6 +102,8 @@ void handler_read_range(
     bool error = false;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *apdu = NULL;
+    uint16_t max_apdu = 0;
 
     data.error_class = ERROR_CLASS_OBJECT;
     data.error_code = ERROR_CODE_UNKNOWN_OBJECT;
@@ -137,21 +141,48 @@ void handler_read_range(
         goto RR_ABORT;
     }
 
+    /* a reply that could be sent in segments is built apart from
+       the NPDU, since it may be bigger than one */
+    max_apdu = tsm_segmented_response_max(service_data);
+    apdu = &Handler_Transmit_Buffer[pdu_len];
+#if (MAX_SEGMENTED_RESPONSES)
+    if (max_apdu > MAX_APDU) {
+        apdu = &Handler_Segment_Buffer[0];
+    }
+#endif
     /* assume that there is an error */
     error = true;
-    len = Encode_RR_payload(&Temp_Buf[0], &data);
+    /* the items are limited to what fits in the reply, less the Overhead */
+    data.application_data_len = max_apdu;
+    if (data.application_data_len > data.Overhead) {
+        len = Encode_RR_payload(&Temp_Buf[0], &data);
+    } else {
+        len = -2;
+    }
     if (len >= 0) {
         /* encode the APDU portion of the packet */
         data.application_data = &Temp_Buf[0];
         data.application_data_len = len;
-        /* FIXME: probably need a length limitation sent with encode */
-        len =
-            rr_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            service_data->invoke_id, &data);
+        len = rr_ack_encode_apdu(&apdu[0], service_data->invoke_id, &data);
+        if ((len > service_data->max_resp) || (len > MAX_APDU)) {
+            /* too big for one APDU, so the TSM sends it in segments */
+            if (tsm_set_segmented_complex_ack(src, &npdu_data, service_data,
+                    &apdu[0], (uint16_t) len)) {
 #if PRINT_ENABLED
-        fprintf(stderr, "RR: Sending Ack!\n");
+                fprintf(stderr, "RR: Sending Segmented Ack!\n");
 #endif
-        error = false;
+                return;
+            }
+            len = -2;
+        } else {
+            if (apdu != &Handler_Transmit_Buffer[pdu_len]) {
+                memmove(&Handler_Transmit_Buffer[pdu_len], &apdu[0], len);
+            }
+#if PRINT_ENABLED
+            fprintf(stderr, "RR: Sending Ack!\n");
+#endif
+            error = false;
+        }
     }
     if (error) {
         if (len == -2) {
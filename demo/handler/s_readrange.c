@@ -85,7 +85,7 @@ uint8_t Send_ReadRange_Request(
         if (len <= 0) {
             return 0;
         }
-
+        tsm_segmented_ack_accept(&Handler_Transmit_Buffer[pdu_len]);
         pdu_len += len;
         /* is it small enough for the the destination to receive?
            note: if there is a bottleneck router in between
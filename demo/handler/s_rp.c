@@ -98,6 +98,8 @@ uint8_t Send_Read_Property_Request_Address(
         len =
             rp_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
             &data);
+        /* long arrays such as the Object_List can come back in segments */
+        tsm_segmented_ack_accept(&Handler_Transmit_Buffer[pdu_len]);
         pdu_len += len;
         /* will it fit in the sender?
            note: if there is a bottleneck router in between
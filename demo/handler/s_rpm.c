@@ -91,6 +91,7 @@ uint8_t Send_Read_Property_Multiple_Request(
         if (len <= 0) {
             return 0;
         }
+        tsm_segmented_ack_accept(&pdu[pdu_len]);
         pdu_len += len;
         /* is it small enough for the the destination to receive?
            note: if there is a bottleneck router in between
@@ -30,3 +30,8 @@
 /** @file txbuf.c  Declare the global Transmit Buffer for handler functions. */
 
 uint8_t Handler_Transmit_Buffer[MAX_PDU] = { 0 };
+#if (MAX_SEGMENTED_RESPONSES)
+/* Complex ACKs that may be too big for one APDU are built here,
+   and sent in segments by the TSM if they are */
+uint8_t Handler_Segment_Buffer[MAX_SEGMENTED_APDU] = { 0 };
+#endif
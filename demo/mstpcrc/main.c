@@ -248,11 +248,13 @@ int main(
         if (MSTP_Cap) {
             Write_Pcap(CRC_Buffer, CRC_Buffer_Len);
         } else {
+            if (CRC_Size == 16) {
+                crc16 =
+                    CRC_Calc_Data_Buffer(CRC_Buffer, CRC_Buffer_Len, crc16);
+            }
             for (i = 0; i < CRC_Buffer_Len; i++) {
                 if (CRC_Size == 8) {
                     crc8 = CRC_Calc_Header(CRC_Buffer[i], crc8);
-                } else if (CRC_Size == 16) {
-                    crc16 = CRC_Calc_Data(CRC_Buffer[i], crc16);
                 }
                 if (ASCII_Decimal) {
                     printf("%u\r\n", (unsigned) CRC_Buffer[i]);
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -43,6 +44,8 @@
 #include "handlers.h"
 #include "ai.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_ANALOG_INPUTS
@@ -60,6 +63,8 @@ unsigned max_analog_inputs_int = 0;
 #define ANALOG_LEVEL_NULL 255
 
 ANALOG_INPUT_DESCR AI_Descr[MAX_ANALOG_INPUTS];
+/* instance number to AI_Descr index */
+static BACNET_OBJECT_INDEX AI_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Analog_Input_Properties_Required[] = {
@@ -233,6 +238,8 @@ void Analog_Input_Init(
         ucimin_value_default = ucix_get_option(ctx, sec, "default",
             "min_value");
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&AI_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -246,6 +253,7 @@ void Analog_Input_Init(
                     AI_Descr[i].Priority_Array[j] = ANALOG_LEVEL_NULL;
                 }
                 AI_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&AI_Index, AI_Descr[i].Instance, i);
                 AI_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(AI_Descr[i].Object_Name,
@@ -295,6 +303,7 @@ void Analog_Input_Init(
                 }
                 AI_Descr[i].Priority_Array[15] = strtof(ucivalue,
                     (char **) NULL);
+                AI_Descr[i].Prior_Value = AI_Descr[i].Priority_Array[15];
 
                 AI_Descr[i].Relinquish_Default = 0; //TODO read uci
 
@@ -429,17 +438,11 @@ void Analog_Input_Init(
 unsigned Analog_Input_Instance_To_Index(
     uint32_t object_instance)
 {
-    ANALOG_INPUT_DESCR *CurrentAI;
-    int index,instance,i;
-    index = max_analog_inputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentAI = &AI_Descr[i];
-    	instance = CurrentAI->Instance;
-    	if (CurrentAI->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_ANALOG_INPUTS;
+    unsigned index = MAX_ANALOG_INPUTS;
+
+    (void) object_index_find(&AI_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -485,6 +488,17 @@ bool Analog_Input_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Analog_Input_Change_Of_Value_Set(
+    ANALOG_INPUT_DESCR * CurrentAI,
+    uint32_t object_instance)
+{
+    if (!CurrentAI->Change_Of_Value) {
+        CurrentAI->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_ANALOG_INPUT, object_instance);
+    }
+}
+
 bool Analog_Input_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -615,6 +629,7 @@ bool Analog_Input_Present_Value_Set(
     ANALOG_INPUT_DESCR *CurrentAI;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    float present_value = 0.0;
 
     if (Analog_Input_Valid_Instance(object_instance)) {
         index = Analog_Input_Instance_To_Index(object_instance);
@@ -632,6 +647,17 @@ bool Analog_Input_Present_Value_Set(
             if (priority == 8) {
                 CurrentAI->Priority_Array[15] = value;
             }
+            /* a change by at least the COV increment is reported */
+            present_value = Analog_Input_Present_Value(object_instance);
+            if ((present_value != CurrentAI->Prior_Value) &&
+                (fabs(present_value - CurrentAI->Prior_Value) >=
+                    CurrentAI->COV_Increment)) {
+                CurrentAI->Prior_Value = present_value;
+                Analog_Input_Change_Of_Value_Set(CurrentAI, object_instance);
+            }
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_ANALOG_INPUT, object_instance);
+#endif
             status = true;
         }
     }
@@ -664,6 +690,9 @@ void Analog_Input_Out_Of_Service_Set(
     if (Analog_Input_Valid_Instance(object_instance)) {
         index = Analog_Input_Instance_To_Index(object_instance);
         CurrentAI = &AI_Descr[index];
+        if (CurrentAI->Out_Of_Service != value) {
+            Analog_Input_Change_Of_Value_Set(CurrentAI, object_instance);
+        }
         CurrentAI->Out_Of_Service = value;
     }
 
@@ -680,6 +709,9 @@ void Analog_Input_Reliability_Set(
     if (Analog_Input_Valid_Instance(object_instance)) {
         index = Analog_Input_Instance_To_Index(object_instance);
         CurrentAI = &AI_Descr[index];
+        if (CurrentAI->Reliability != value) {
+            Analog_Input_Change_Of_Value_Set(CurrentAI, object_instance);
+        }
         CurrentAI->Reliability = value;
     }
 
@@ -840,10 +872,13 @@ static bool Analog_Input_Object_Name_Write(
         if (length <= sizeof(CurrentAI->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_ANALOG_INPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentAI->Object_Name,
                     sizeof(CurrentAI->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_ANALOG_INPUT, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1848,6 +1883,11 @@ void Analog_Input_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentAI->Remaining_Time_Delay != CurrentAI->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_ANALOG_INPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -2024,6 +2064,8 @@ int Analog_Input_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentAI->Ack_notify_data.bSendAckNotify = true;
     CurrentAI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_ANALOG_INPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
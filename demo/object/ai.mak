@@ -17,6 +17,8 @@ SRCS = ai.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/indtext.c \
 	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/objindex.c \
+	$(SRC_DIR)/covqueue.c \
 	$(TEST_DIR)/ctest.c
 
 TARGET = analog_input
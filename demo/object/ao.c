@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -43,6 +44,8 @@
 #include "handlers.h"
 #include "ao.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_ANALOG_OUTPUTS
@@ -60,6 +63,8 @@ unsigned max_analog_outputs_int = 0;
 #define ANALOG_LEVEL_NULL 255
 
 ANALOG_OUTPUT_DESCR AO_Descr[MAX_ANALOG_OUTPUTS];
+/* instance number to AO_Descr index */
+static BACNET_OBJECT_INDEX AO_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Analog_Output_Properties_Required[] = {
@@ -233,6 +238,8 @@ void Analog_Output_Init(
         ucimin_value_default = ucix_get_option(ctx, sec, "default",
             "min_value");
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&AO_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -246,6 +253,7 @@ void Analog_Output_Init(
                     AO_Descr[i].Priority_Array[j] = ANALOG_LEVEL_NULL;
                 }
                 AO_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&AO_Index, AO_Descr[i].Instance, i);
                 AO_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(AO_Descr[i].Object_Name,
@@ -295,6 +303,7 @@ void Analog_Output_Init(
                 }
                 AO_Descr[i].Priority_Array[15] = strtof(ucivalue,
                     (char **) NULL);
+                AO_Descr[i].Prior_Value = AO_Descr[i].Priority_Array[15];
 
                 AO_Descr[i].Relinquish_Default = 0; //TODO read uci
 
@@ -429,17 +438,11 @@ void Analog_Output_Init(
 unsigned Analog_Output_Instance_To_Index(
     uint32_t object_instance)
 {
-    ANALOG_OUTPUT_DESCR *CurrentAO;
-    int index,instance,i;
-    index = max_analog_outputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentAO = &AO_Descr[i];
-    	instance = CurrentAO->Instance;
-    	if (CurrentAO->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_ANALOG_OUTPUTS;
+    unsigned index = MAX_ANALOG_OUTPUTS;
+
+    (void) object_index_find(&AO_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -485,6 +488,34 @@ bool Analog_Output_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Analog_Output_Change_Of_Value_Set(
+    ANALOG_OUTPUT_DESCR * CurrentAO,
+    uint32_t object_instance)
+{
+    if (!CurrentAO->Change_Of_Value) {
+        CurrentAO->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_ANALOG_OUTPUT, object_instance);
+    }
+}
+
+/* flag a change of value when the Present_Value has moved by at least
+   the COV increment since the last one */
+static void Analog_Output_Present_Value_COV_Detect(
+    ANALOG_OUTPUT_DESCR * CurrentAO,
+    uint32_t object_instance)
+{
+    float present_value = 0.0;
+
+    present_value = Analog_Output_Present_Value(object_instance);
+    if ((present_value != CurrentAO->Prior_Value) &&
+        (fabs(present_value - CurrentAO->Prior_Value) >=
+            CurrentAO->COV_Increment)) {
+        CurrentAO->Prior_Value = present_value;
+        Analog_Output_Change_Of_Value_Set(CurrentAO, object_instance);
+    }
+}
+
 bool Analog_Output_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -632,6 +663,10 @@ bool Analog_Output_Present_Value_Set(
             if (priority == 8) {
                 CurrentAO->Priority_Array[15] = value;
             }
+            Analog_Output_Present_Value_COV_Detect(CurrentAO, object_instance);
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_ANALOG_OUTPUT, object_instance);
+#endif
             status = true;
         }
     }
@@ -652,6 +687,11 @@ bool Analog_Output_Present_Value_Relinquish(
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */ )) {
             CurrentAO->Priority_Array[priority - 1] = ANALOG_LEVEL_NULL;
+            Analog_Output_Present_Value_COV_Detect(CurrentAO,
+                object_instance);
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_ANALOG_OUTPUT, object_instance);
+#endif
             /* Note: you could set the physical output here to the next
                highest priority, or to the relinquish default if no
                priorities are set.
@@ -691,6 +731,9 @@ void Analog_Output_Out_Of_Service_Set(
     if (Analog_Output_Valid_Instance(object_instance)) {
         index = Analog_Output_Instance_To_Index(object_instance);
         CurrentAO = &AO_Descr[index];
+        if (CurrentAO->Out_Of_Service != value) {
+            Analog_Output_Change_Of_Value_Set(CurrentAO, object_instance);
+        }
         CurrentAO->Out_Of_Service = value;
     }
 
@@ -707,6 +750,9 @@ void Analog_Output_Reliability_Set(
     if (Analog_Output_Valid_Instance(object_instance)) {
         index = Analog_Output_Instance_To_Index(object_instance);
         CurrentAO = &AO_Descr[index];
+        if (CurrentAO->Reliability != value) {
+            Analog_Output_Change_Of_Value_Set(CurrentAO, object_instance);
+        }
         CurrentAO->Reliability = value;
     }
 
@@ -867,10 +913,13 @@ static bool Analog_Output_Object_Name_Write(
         if (length <= sizeof(CurrentAO->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_ANALOG_OUTPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentAO->Object_Name,
                     sizeof(CurrentAO->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_ANALOG_OUTPUT, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1337,6 +1386,8 @@ bool Analog_Output_Write_Property(
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
                         CurrentAO->Priority_Array[priority] = level;
+                        Analog_Output_Present_Value_COV_Detect(CurrentAO,
+                            wp_data->object_instance);
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1875,6 +1926,11 @@ void Analog_Output_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentAO->Remaining_Time_Delay != CurrentAO->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_ANALOG_OUTPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -2051,6 +2107,8 @@ int Analog_Output_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentAO->Ack_notify_data.bSendAckNotify = true;
     CurrentAO->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_ANALOG_OUTPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
@@ -2109,14 +2167,163 @@ bool WPValidateArgType(
     BACNET_ERROR_CLASS * pErrorClass,
     BACNET_ERROR_CODE * pErrorCode)
 {
-    pValue = pValue;
-    ucExpectedTag = ucExpectedTag;
-    pErrorClass = pErrorClass;
-    pErrorCode = pErrorCode;
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
+
+    return true;
+}
+
+bool Device_Valid_Object_Name(
+    BACNET_CHARACTER_STRING * object_name,
+    int *object_type,
+    uint32_t * object_instance)
+{
+    (void) object_name;
+    (void) object_type;
+    (void) object_instance;
 
     return false;
 }
 
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+/* UCI stubs: the config has one analog output, in section 1, with a
+   COV increment of 1 */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    (void) ctx;
+    (void) p;
+    (void) t;
+    cb("1", priv);
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) ctx;
+    (void) p;
+
+    if (!s || (strcmp(s, "1") != 0)) {
+        return NULL;
+    }
+    if (strcmp(o, "name") == 0) {
+        return "AO 1";
+    }
+    if (strcmp(o, "value") == 0) {
+        return "0";
+    }
+    if (strcmp(o, "cov_increment") == 0) {
+        return "1";
+    }
+
+    return NULL;
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+
+    return def;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i - 1);
+    dest[i - 1] = 0;
+
+    return true;
+}
+
 void testAnalog_Output(
     Test * pTest)
 {
@@ -2146,6 +2353,97 @@ void testAnalog_Output(
     return;
 }
 
+/* write the Present_Value at a priority: a REAL, or NULL to relinquish */
+static bool testAnalog_Output_Write(
+    uint32_t object_instance,
+    uint8_t priority,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+
+    memset(&wp_data, 0, sizeof(wp_data));
+    wp_data.object_type = OBJECT_ANALOG_OUTPUT;
+    wp_data.object_instance = object_instance;
+    wp_data.object_property = PROP_PRESENT_VALUE;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = priority;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(&wp_data.application_data[0], value);
+
+    return Analog_Output_Write_Property(&wp_data);
+}
+
+/* a change of value is flagged, and queued once, when it happened */
+static bool testAnalog_Output_COV_Take(
+    uint32_t object_instance)
+{
+    BACNET_OBJECT_ID object_id;
+    bool changed = false;
+
+    changed = Analog_Output_Change_Of_Value(object_instance);
+    Analog_Output_Change_Of_Value_Clear(object_instance);
+    if (changed) {
+        changed = cov_queue_pop(&object_id) &&
+            (object_id.type == OBJECT_ANALOG_OUTPUT) &&
+            (object_id.instance == object_instance);
+    }
+    if (cov_queue_count() != 0) {
+        changed = false;
+    }
+
+    return changed;
+}
+
+void testAnalog_Output_COV(
+    Test * pTest)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    BACNET_APPLICATION_DATA_VALUE null_value;
+    uint32_t object_instance = 1;
+
+    Analog_Output_Init();
+    cov_queue_init();
+    Analog_Output_Change_Of_Value_Clear(object_instance);
+    memset(&value, 0, sizeof(value));
+    value.tag = BACNET_APPLICATION_TAG_REAL;
+    memset(&null_value, 0, sizeof(null_value));
+    null_value.tag = BACNET_APPLICATION_TAG_NULL;
+
+    /* a write, then its relinquish back to the Relinquish_Default */
+    value.type.Real = 10.0f;
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 9, &value));
+    ct_test(pTest, Analog_Output_Present_Value(object_instance) == 10.0f);
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 9, &null_value));
+    ct_test(pTest, Analog_Output_Present_Value(object_instance) == 0.0f);
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    /* relinquishing a level below the one in control changes nothing */
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 9, &value));
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    value.type.Real = 20.0f;
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 10, &value));
+    ct_test(pTest, !testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 10, &null_value));
+    ct_test(pTest, !testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, testAnalog_Output_Write(object_instance, 9, &null_value));
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    /* the same, directly: by less than the COV increment is no change */
+    ct_test(pTest, Analog_Output_Present_Value_Set(object_instance, 5.0f,
+            1));
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, Analog_Output_Present_Value_Relinquish(object_instance,
+            1));
+    ct_test(pTest, testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, Analog_Output_Present_Value_Set(object_instance, 0.5f,
+            1));
+    ct_test(pTest, !testAnalog_Output_COV_Take(object_instance));
+    ct_test(pTest, Analog_Output_Present_Value_Relinquish(object_instance,
+            1));
+    ct_test(pTest, !testAnalog_Output_COV_Take(object_instance));
+
+    return;
+}
+
 #ifdef TEST_ANALOG_OUTPUT
 int main(
     void)
@@ -2157,6 +2455,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testAnalog_Output);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testAnalog_Output_COV);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
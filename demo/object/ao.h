@@ -55,6 +55,8 @@ extern "C" {
         bool Change_Of_Value;
         uint8_t Reliability;
         float COV_Increment;
+        /* present value last reported by COV */
+        float Prior_Value;
         bool Disable;
         uint8_t Units;
         /* Here is our Priority Array.  They are supposed to be Real, but */
@@ -13,6 +13,8 @@ SRCS = ao.c \
 	$(SRC_DIR)/bacstr.c \
 	$(SRC_DIR)/bacreal.c \
 	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/objindex.c \
+	$(SRC_DIR)/covqueue.c \
 	$(SRC_DIR)/bacapp.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/indtext.c \
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -43,6 +44,8 @@
 #include "handlers.h"
 #include "av.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_ANALOG_VALUES
@@ -60,6 +63,8 @@ unsigned max_analog_values_int = 0;
 #define ANALOG_LEVEL_NULL 255
 
 ANALOG_VALUE_DESCR AV_Descr[MAX_ANALOG_VALUES];
+/* instance number to AV_Descr index */
+static BACNET_OBJECT_INDEX AV_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Analog_Value_Properties_Required[] = {
@@ -221,6 +226,8 @@ void Analog_Value_Init(
         ucicov_increment_default = ucix_get_option(ctx, sec, "default",
             "cov_increment");
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&AV_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -234,6 +241,7 @@ void Analog_Value_Init(
                     AV_Descr[i].Priority_Array[j] = ANALOG_LEVEL_NULL;
                 }
                 AV_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&AV_Index, AV_Descr[i].Instance, i);
                 AV_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(AV_Descr[i].Object_Name,
@@ -283,6 +291,7 @@ void Analog_Value_Init(
                 }
                 AV_Descr[i].Priority_Array[15] = strtof(ucivalue,
                     (char **) NULL);
+                AV_Descr[i].Prior_Value = AV_Descr[i].Priority_Array[15];
 
                 AV_Descr[i].Relinquish_Default = 0; //TODO read uci
 
@@ -391,17 +400,11 @@ void Analog_Value_Init(
 unsigned Analog_Value_Instance_To_Index(
     uint32_t object_instance)
 {
-    ANALOG_VALUE_DESCR *CurrentAV;
-    int index,instance,i;
-    index = max_analog_values_int;
-    for (i = 0; i < index; i++) {
-    	CurrentAV = &AV_Descr[i];
-    	instance = CurrentAV->Instance;
-    	if (CurrentAV->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_ANALOG_VALUES;
+    unsigned index = MAX_ANALOG_VALUES;
+
+    (void) object_index_find(&AV_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -447,6 +450,34 @@ bool Analog_Value_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Analog_Value_Change_Of_Value_Set(
+    ANALOG_VALUE_DESCR * CurrentAV,
+    uint32_t object_instance)
+{
+    if (!CurrentAV->Change_Of_Value) {
+        CurrentAV->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_ANALOG_VALUE, object_instance);
+    }
+}
+
+/* flag a change of value when the Present_Value has moved by at least
+   the COV increment since the last one */
+static void Analog_Value_Present_Value_COV_Detect(
+    ANALOG_VALUE_DESCR * CurrentAV,
+    uint32_t object_instance)
+{
+    float present_value = 0.0;
+
+    present_value = Analog_Value_Present_Value(object_instance);
+    if ((present_value != CurrentAV->Prior_Value) &&
+        (fabs(present_value - CurrentAV->Prior_Value) >=
+            CurrentAV->COV_Increment)) {
+        CurrentAV->Prior_Value = present_value;
+        Analog_Value_Change_Of_Value_Set(CurrentAV, object_instance);
+    }
+}
+
 bool Analog_Value_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -594,6 +625,10 @@ bool Analog_Value_Present_Value_Set(
             if (priority == 8) {
                 CurrentAV->Priority_Array[15] = value;
             }
+            Analog_Value_Present_Value_COV_Detect(CurrentAV, object_instance);
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_ANALOG_VALUE, object_instance);
+#endif
             status = true;
         }
     }
@@ -626,6 +661,9 @@ void Analog_Value_Out_Of_Service_Set(
     if (Analog_Value_Valid_Instance(object_instance)) {
         index = Analog_Value_Instance_To_Index(object_instance);
         CurrentAV = &AV_Descr[index];
+        if (CurrentAV->Out_Of_Service != value) {
+            Analog_Value_Change_Of_Value_Set(CurrentAV, object_instance);
+        }
         CurrentAV->Out_Of_Service = value;
     }
 
@@ -642,6 +680,9 @@ void Analog_Value_Reliability_Set(
     if (Analog_Value_Valid_Instance(object_instance)) {
         index = Analog_Value_Instance_To_Index(object_instance);
         CurrentAV = &AV_Descr[index];
+        if (CurrentAV->Reliability != value) {
+            Analog_Value_Change_Of_Value_Set(CurrentAV, object_instance);
+        }
         CurrentAV->Reliability = value;
     }
 
@@ -802,10 +843,13 @@ static bool Analog_Value_Object_Name_Write(
         if (length <= sizeof(CurrentAV->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_ANALOG_VALUE,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentAV->Object_Name,
                     sizeof(CurrentAV->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_ANALOG_VALUE, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1262,6 +1306,8 @@ bool Analog_Value_Write_Property(
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
                         CurrentAV->Priority_Array[priority] = level;
+                        Analog_Value_Present_Value_COV_Detect(CurrentAV,
+                            wp_data->object_instance);
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1776,6 +1822,11 @@ void Analog_Value_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentAV->Remaining_Time_Delay != CurrentAV->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_ANALOG_VALUE, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1952,6 +2003,8 @@ int Analog_Value_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentAV->Ack_notify_data.bSendAckNotify = true;
     CurrentAV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_ANALOG_VALUE,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "bi.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_BINARY_INPUTS
@@ -60,6 +62,8 @@ unsigned max_binary_inputs_int = 0;
 #define BINARY_LEVEL_NULL 255
 
 BINARY_INPUT_DESCR BI_Descr[MAX_BINARY_INPUTS];
+/* instance number to BI_Descr index */
+static BACNET_OBJECT_INDEX BI_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Input_Properties_Required[] = {
@@ -212,6 +216,8 @@ void Binary_Input_Init(
         ucipolarity_default = ucix_get_option_int(ctx, sec, "default",
             "polarity", 0);
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&BI_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -225,6 +231,7 @@ void Binary_Input_Init(
                     BI_Descr[i].Priority_Array[j] = BINARY_LEVEL_NULL;
                 }
                 BI_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&BI_Index, BI_Descr[i].Instance, i);
                 BI_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(BI_Descr[i].Object_Name,
@@ -331,16 +338,11 @@ void Binary_Input_Init(
 unsigned Binary_Input_Instance_To_Index(
     uint32_t object_instance)
 {
-    BINARY_INPUT_DESCR *CurrentBI;
-    int index,i;
-    index = max_binary_inputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentBI = &BI_Descr[i];
-    	if (CurrentBI->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_BINARY_INPUTS;
+    unsigned index = MAX_BINARY_INPUTS;
+
+    (void) object_index_find(&BI_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -452,6 +454,17 @@ bool Binary_Input_Out_Of_Service(
     return value;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Binary_Input_Change_Of_Value_Set(
+    BINARY_INPUT_DESCR * CurrentBI,
+    uint32_t object_instance)
+{
+    if (!CurrentBI->Change_Of_Value) {
+        CurrentBI->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_BINARY_INPUT, object_instance);
+    }
+}
+
 void Binary_Input_Out_Of_Service_Set(
     uint32_t object_instance,
     bool value)
@@ -463,7 +476,7 @@ void Binary_Input_Out_Of_Service_Set(
         index = Binary_Input_Instance_To_Index(object_instance);
         CurrentBI = &BI_Descr[index];
         if (CurrentBI->Out_Of_Service != value) {
-            CurrentBI->Change_Of_Value = true;
+            Binary_Input_Change_Of_Value_Set(CurrentBI, object_instance);
         }
         CurrentBI->Out_Of_Service = value;
     }
@@ -497,6 +510,9 @@ void Binary_Input_Reliability_Set(
     if (Binary_Input_Valid_Instance(object_instance)) {
         index = Binary_Input_Instance_To_Index(object_instance);
         CurrentBI = &BI_Descr[index];
+        if (CurrentBI->Reliability != value) {
+            Binary_Input_Change_Of_Value_Set(CurrentBI, object_instance);
+        }
         CurrentBI->Reliability = value;
     }
 
@@ -635,6 +651,7 @@ bool Binary_Input_Name_Set(
         index = Binary_Input_Instance_To_Index(object_instance);
         CurrentBI = &BI_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_BINARY_INPUT, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentBI->Object_Name); i++) {
@@ -648,6 +665,7 @@ bool Binary_Input_Name_Set(
                 CurrentBI->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_BINARY_INPUT, object_instance);
     }
 
     return status;
@@ -674,10 +692,13 @@ static bool Binary_Input_Object_Name_Write(
         if (length <= sizeof(CurrentBI->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_BINARY_INPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentBI->Object_Name,
                     sizeof(CurrentBI->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_BINARY_INPUT, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -789,14 +810,22 @@ bool Binary_Input_Present_Value_Set(
     BINARY_INPUT_DESCR *CurrentBI;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     if (value > 1)
         value = BINARY_LEVEL_NULL;
     
     if (Binary_Input_Valid_Instance(object_instance)) {
         index = Binary_Input_Instance_To_Index(object_instance);
         CurrentBI = &BI_Descr[index];
+        present_value = Binary_Input_Present_Value(object_instance);
         CurrentBI->Present_Value = (uint8_t) value;
         CurrentBI->Priority_Array[priority - 1] = (uint8_t) value;
+        if (Binary_Input_Present_Value(object_instance) != present_value) {
+            Binary_Input_Change_Of_Value_Set(CurrentBI, object_instance);
+        }
+#if defined(INTRINSIC_REPORTING)
+        Device_Reporting_Schedule(OBJECT_BINARY_INPUT, object_instance);
+#endif
         status = true;
     }
     return status;
@@ -1802,6 +1831,11 @@ void Binary_Input_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentBI->Remaining_Time_Delay != CurrentBI->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_BINARY_INPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1975,6 +2009,8 @@ int Binary_Input_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentBI->Ack_notify_data.bSendAckNotify = true;
     CurrentBI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_BINARY_INPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
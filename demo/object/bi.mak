@@ -16,6 +16,8 @@ SRCS = bi.c \
 	$(SRC_DIR)/bactext.c \
 	$(SRC_DIR)/indtext.c \
 	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/objindex.c \
+	$(SRC_DIR)/covqueue.c \
 	$(TEST_DIR)/ctest.c
 
 TARGET = binary_input
@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "bo.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_BINARY_OUTPUTS
@@ -60,6 +62,8 @@ unsigned max_binary_outputs_int = 0;
 #define BINARY_LEVEL_NULL 255
 
 BINARY_OUTPUT_DESCR BO_Descr[MAX_BINARY_OUTPUTS];
+/* instance number to BO_Descr index */
+static BACNET_OBJECT_INDEX BO_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Output_Properties_Required[] = {
@@ -212,6 +216,8 @@ void Binary_Output_Init(
         ucipolarity_default = ucix_get_option_int(ctx, sec, "default",
             "polarity", 0);
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&BO_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -225,6 +231,7 @@ void Binary_Output_Init(
                     BO_Descr[i].Priority_Array[j] = BINARY_LEVEL_NULL;
                 }
                 BO_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&BO_Index, BO_Descr[i].Instance, i);
                 BO_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(BO_Descr[i].Object_Name,
@@ -333,16 +340,11 @@ void Binary_Output_Init(
 unsigned Binary_Output_Instance_To_Index(
     uint32_t object_instance)
 {
-    BINARY_OUTPUT_DESCR *CurrentBO;
-    int index,i;
-    index = max_binary_outputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentBO = &BO_Descr[i];
-    	if (CurrentBO->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_BINARY_OUTPUTS;
+    unsigned index = MAX_BINARY_OUTPUTS;
+
+    (void) object_index_find(&BO_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -454,6 +456,17 @@ bool Binary_Output_Out_Of_Service(
     return value;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Binary_Output_Change_Of_Value_Set(
+    BINARY_OUTPUT_DESCR * CurrentBO,
+    uint32_t object_instance)
+{
+    if (!CurrentBO->Change_Of_Value) {
+        CurrentBO->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_BINARY_OUTPUT, object_instance);
+    }
+}
+
 void Binary_Output_Out_Of_Service_Set(
     uint32_t object_instance,
     bool value)
@@ -465,7 +478,7 @@ void Binary_Output_Out_Of_Service_Set(
         index = Binary_Output_Instance_To_Index(object_instance);
         CurrentBO = &BO_Descr[index];
         if (CurrentBO->Out_Of_Service != value) {
-            CurrentBO->Change_Of_Value = true;
+            Binary_Output_Change_Of_Value_Set(CurrentBO, object_instance);
         }
         CurrentBO->Out_Of_Service = value;
     }
@@ -499,6 +512,9 @@ void Binary_Output_Reliability_Set(
     if (Binary_Output_Valid_Instance(object_instance)) {
         index = Binary_Output_Instance_To_Index(object_instance);
         CurrentBO = &BO_Descr[index];
+        if (CurrentBO->Reliability != value) {
+            Binary_Output_Change_Of_Value_Set(CurrentBO, object_instance);
+        }
         CurrentBO->Reliability = value;
     }
 
@@ -637,6 +653,7 @@ bool Binary_Output_Name_Set(
         index = Binary_Output_Instance_To_Index(object_instance);
         CurrentBO = &BO_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_BINARY_OUTPUT, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentBO->Object_Name); i++) {
@@ -650,6 +667,7 @@ bool Binary_Output_Name_Set(
                 CurrentBO->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_BINARY_OUTPUT, object_instance);
     }
 
     return status;
@@ -676,10 +694,13 @@ static bool Binary_Output_Object_Name_Write(
         if (length <= sizeof(CurrentBO->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_BINARY_OUTPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentBO->Object_Name,
                     sizeof(CurrentBO->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_BINARY_OUTPUT, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -791,12 +812,14 @@ bool Binary_Output_Present_Value_Set(
     BINARY_OUTPUT_DESCR *CurrentBO;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     if (value > 1)
         value = BINARY_LEVEL_NULL;
     
     if (Binary_Output_Valid_Instance(object_instance)) {
         index = Binary_Output_Instance_To_Index(object_instance);
         CurrentBO = &BO_Descr[index];
+        present_value = Binary_Output_Present_Value(object_instance);
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */ ) && (value > 0)) {
             CurrentBO->Feedback_Value = (uint8_t) value;
@@ -804,6 +827,12 @@ bool Binary_Output_Present_Value_Set(
             if (priority == 8) {
                 CurrentBO->Priority_Array[15] = (uint8_t) value;
             }
+            if (Binary_Output_Present_Value(object_instance) != present_value) {
+                Binary_Output_Change_Of_Value_Set(CurrentBO, object_instance);
+            }
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_BINARY_OUTPUT, object_instance);
+#endif
             status = true;
         }
     }
@@ -1266,6 +1295,7 @@ bool Binary_Output_Write_Property(
     unsigned int priority = 0;
     uint8_t level = BINARY_LEVEL_NULL;
     int len = 0;
+    BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     BACNET_APPLICATION_DATA_VALUE value;
     ctx = ucix_init("bacnet_bo");
     const char index_c[32] = "";
@@ -1379,7 +1409,14 @@ bool Binary_Output_Write_Property(
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
+                        present_value =
+                            Binary_Output_Present_Value(wp_data->object_instance);
                         CurrentBO->Priority_Array[priority] = level;
+                        if (Binary_Output_Present_Value(wp_data->object_instance) !=
+                            present_value) {
+                            Binary_Output_Change_Of_Value_Set(CurrentBO,
+                                wp_data->object_instance);
+                        }
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1808,6 +1845,11 @@ void Binary_Output_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentBO->Remaining_Time_Delay != CurrentBO->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_BINARY_OUTPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1981,6 +2023,8 @@ int Binary_Output_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentBO->Ack_notify_data.bSendAckNotify = true;
     CurrentBO->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_BINARY_OUTPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
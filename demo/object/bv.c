@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "bv.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_BINARY_VALUES
@@ -60,6 +62,8 @@ unsigned max_binary_values_int = 0;
 #define BINARY_LEVEL_NULL 255
 
 BINARY_VALUE_DESCR BV_Descr[MAX_BINARY_VALUES];
+/* instance number to BV_Descr index */
+static BACNET_OBJECT_INDEX BV_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Binary_Value_Properties_Required[] = {
@@ -212,6 +216,8 @@ void Binary_Value_Init(
         ucipolarity_default = ucix_get_option_int(ctx, sec, "default",
             "polarity", 0);
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&BV_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -225,6 +231,7 @@ void Binary_Value_Init(
                     BV_Descr[i].Priority_Array[j] = BINARY_LEVEL_NULL;
                 }
                 BV_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&BV_Index, BV_Descr[i].Instance, i);
                 BV_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(BV_Descr[i].Object_Name,
@@ -331,16 +338,11 @@ void Binary_Value_Init(
 unsigned Binary_Value_Instance_To_Index(
     uint32_t object_instance)
 {
-    BINARY_VALUE_DESCR *CurrentBV;
-    int index,i;
-    index = max_binary_values_int;
-    for (i = 0; i < index; i++) {
-    	CurrentBV = &BV_Descr[i];
-    	if (CurrentBV->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_BINARY_VALUES;
+    unsigned index = MAX_BINARY_VALUES;
+
+    (void) object_index_find(&BV_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -452,6 +454,17 @@ bool Binary_Value_Out_Of_Service(
     return value;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Binary_Value_Change_Of_Value_Set(
+    BINARY_VALUE_DESCR * CurrentBV,
+    uint32_t object_instance)
+{
+    if (!CurrentBV->Change_Of_Value) {
+        CurrentBV->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_BINARY_VALUE, object_instance);
+    }
+}
+
 void Binary_Value_Out_Of_Service_Set(
     uint32_t object_instance,
     bool value)
@@ -463,7 +476,7 @@ void Binary_Value_Out_Of_Service_Set(
         index = Binary_Value_Instance_To_Index(object_instance);
         CurrentBV = &BV_Descr[index];
         if (CurrentBV->Out_Of_Service != value) {
-            CurrentBV->Change_Of_Value = true;
+            Binary_Value_Change_Of_Value_Set(CurrentBV, object_instance);
         }
         CurrentBV->Out_Of_Service = value;
     }
@@ -497,6 +510,9 @@ void Binary_Value_Reliability_Set(
     if (Binary_Value_Valid_Instance(object_instance)) {
         index = Binary_Value_Instance_To_Index(object_instance);
         CurrentBV = &BV_Descr[index];
+        if (CurrentBV->Reliability != value) {
+            Binary_Value_Change_Of_Value_Set(CurrentBV, object_instance);
+        }
         CurrentBV->Reliability = value;
     }
 
@@ -635,6 +651,7 @@ bool Binary_Value_Name_Set(
         index = Binary_Value_Instance_To_Index(object_instance);
         CurrentBV = &BV_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_BINARY_VALUE, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentBV->Object_Name); i++) {
@@ -648,6 +665,7 @@ bool Binary_Value_Name_Set(
                 CurrentBV->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_BINARY_VALUE, object_instance);
     }
 
     return status;
@@ -674,10 +692,13 @@ static bool Binary_Value_Object_Name_Write(
         if (length <= sizeof(CurrentBV->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_BINARY_VALUE,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentBV->Object_Name,
                     sizeof(CurrentBV->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_BINARY_VALUE, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -789,14 +810,22 @@ bool Binary_Value_Present_Value_Set(
     BINARY_VALUE_DESCR *CurrentBV;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     if (value > 1)
         value = BINARY_LEVEL_NULL;
     
     if (Binary_Value_Valid_Instance(object_instance)) {
         index = Binary_Value_Instance_To_Index(object_instance);
         CurrentBV = &BV_Descr[index];
+        present_value = Binary_Value_Present_Value(object_instance);
         CurrentBV->Present_Value = (uint8_t) value;
         CurrentBV->Priority_Array[priority - 1] = (uint8_t) value;
+        if (Binary_Value_Present_Value(object_instance) != present_value) {
+            Binary_Value_Change_Of_Value_Set(CurrentBV, object_instance);
+        }
+#if defined(INTRINSIC_REPORTING)
+        Device_Reporting_Schedule(OBJECT_BINARY_VALUE, object_instance);
+#endif
         status = true;
     }
     return status;
@@ -1258,6 +1287,7 @@ bool Binary_Value_Write_Property(
     unsigned int priority = 0;
     uint8_t level = BINARY_LEVEL_NULL;
     int len = 0;
+    BACNET_BINARY_PV present_value = BINARY_INACTIVE;
     BACNET_APPLICATION_DATA_VALUE value;
     ctx = ucix_init("bacnet_bv");
     const char index_c[32] = "";
@@ -1371,7 +1401,14 @@ bool Binary_Value_Write_Property(
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
+                        present_value =
+                            Binary_Value_Present_Value(wp_data->object_instance);
                         CurrentBV->Priority_Array[priority] = level;
+                        if (Binary_Value_Present_Value(wp_data->object_instance) !=
+                            present_value) {
+                            Binary_Value_Change_Of_Value_Set(CurrentBV,
+                                wp_data->object_instance);
+                        }
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1802,6 +1839,11 @@ void Binary_Value_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentBV->Remaining_Time_Delay != CurrentBV->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_BINARY_VALUE, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1975,6 +2017,8 @@ int Binary_Value_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentBV->Ack_notify_data.bSendAckNotify = true;
     CurrentBV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_BINARY_VALUE,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
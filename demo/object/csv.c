@@ -36,6 +36,7 @@
 #include "rp.h"
 #include "wp.h"
 #include "csv.h"
+#include "device.h"
 #include "handlers.h"
 
 /* number of demo objects */
@@ -270,6 +271,8 @@ bool CharacterString_Value_Name_Set(
     index = CharacterString_Value_Instance_To_Index(object_instance);
     if (index < MAX_CHARACTERSTRING_VALUES) {
         status = true;
+        Device_Object_Name_Remove(OBJECT_CHARACTERSTRING_VALUE,
+            object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(Object_Name[index]); i++) {
@@ -283,6 +286,8 @@ bool CharacterString_Value_Name_Set(
                 Object_Name[index][i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_CHARACTERSTRING_VALUE,
+            object_instance);
     }
 
     return status;
@@ -461,6 +466,50 @@ bool WPValidateArgType(
     return false;
 }
 
+/* the object names as they were taken out of, and put back into, the
+   name index of the device */
+static char Removed_Name[64];
+static char Added_Name[64];
+
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING object_name;
+
+    if (object_type == OBJECT_CHARACTERSTRING_VALUE) {
+        CharacterString_Value_Object_Name(object_instance, &object_name);
+        characterstring_ansi_copy(Removed_Name, sizeof(Removed_Name),
+            &object_name);
+    }
+}
+
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING object_name;
+
+    if (object_type == OBJECT_CHARACTERSTRING_VALUE) {
+        CharacterString_Value_Object_Name(object_instance, &object_name);
+        characterstring_ansi_copy(Added_Name, sizeof(Added_Name),
+            &object_name);
+    }
+}
+
+void testCharacterStringValue_Name(
+    Test * pTest)
+{
+    CharacterString_Value_Init();
+    ct_test(pTest, CharacterString_Value_Name_Set(0, "CSV A"));
+    ct_test(pTest, CharacterString_Value_Name_Set(0, "CSV B"));
+    /* the old name leaves the index and the new one goes in */
+    ct_test(pTest, strcmp(Removed_Name, "CSV A") == 0);
+    ct_test(pTest, strcmp(Added_Name, "CSV B") == 0);
+
+    return;
+}
+
 void testCharacterStringValue(
     Test * pTest)
 {
@@ -501,6 +550,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testCharacterStringValue);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testCharacterStringValue_Name);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
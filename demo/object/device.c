@@ -28,6 +28,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>     /* for memmove */
 #include <time.h>       /* for timezone, localtime */
 #include "bacdef.h"
@@ -44,6 +45,8 @@
 #include "handlers.h"
 #include "datalink.h"
 #include "address.h"
+#include "objname.h"
+#include "keylist.h"
 /* os specfic includes */
 #include "timer.h"
 /* include the device object */
@@ -196,7 +199,7 @@ static object_functions_t My_Object_Table[] = {
             Binary_Value_Encode_Value_List,
             Binary_Value_Change_Of_Value,
             Binary_Value_Change_Of_Value_Clear,
-        Binary_Input_Intrinsic_Reporting},
+        Binary_Value_Intrinsic_Reporting},
 #if 0
         {OBJECT_CHARACTERSTRING_VALUE,
             CharacterString_Value_Init,
@@ -551,6 +554,10 @@ static const int Device_Properties_Required[] = {
     PROP_SEGMENTATION_SUPPORTED,
     PROP_APDU_TIMEOUT,
     PROP_NUMBER_OF_APDU_RETRIES,
+#if (MAX_SEGMENTED_RESPONSES)
+    PROP_MAX_SEGMENTS_ACCEPTED,
+    PROP_APDU_SEGMENT_TIMEOUT,
+#endif
     PROP_DEVICE_ADDRESS_BINDING,
     PROP_DATABASE_REVISION,
     -1
@@ -609,8 +616,8 @@ static char Description[MAX_DEV_DESC_LEN + 1] = "server";
 /* Protocol_Services_Supported - dynamically generated */
 /* Protocol_Object_Types_Supported - in RP encoding */
 /* Object_List - dynamically generated */
-/* static BACNET_SEGMENTATION Segmentation_Supported = SEGMENTATION_NONE; */
-/* static uint8_t Max_Segments_Accepted = 0; */
+/* Segmentation_Supported - from the TSM configuration */
+/* Max_Segments_Accepted - from the TSM configuration */
 /* VT_Classes_Supported */
 /* Active_VT_Sessions */
 static BACNET_TIME Local_Time;  /* rely on OS, if there is one */
@@ -950,7 +957,12 @@ uint8_t Device_Protocol_Revision(
 BACNET_SEGMENTATION Device_Segmentation_Supported(
     void)
 {
+#if (MAX_SEGMENTED_RESPONSES)
+    /* the TSM sends segmented responses, but not segmented requests */
+    return SEGMENTATION_TRANSMIT;
+#else
     return SEGMENTATION_NONE;
+#endif
 }
 
 uint32_t Device_Database_Revision(
@@ -963,6 +975,7 @@ void Device_Set_Database_Revision(
     uint32_t revision)
 {
     Database_Revision = revision;
+    Device_Object_List_Reset();
 }
 
 /*
@@ -974,14 +987,11 @@ void Device_Inc_Database_Revision(
     void)
 {
     Database_Revision++;
+    Device_Object_List_Reset();
 }
 
-/** Get the total count of objects supported by this Device Object.
- * @note Since many network clients depend on the object list
- *       for discovery, it must be consistent!
- * @return The count of objects, for all supported Object types.
- */
-unsigned Device_Object_List_Count(
+/* count of the objects of all the types in the object table */
+static unsigned Device_Object_Table_Count(
     void)
 {
     unsigned count = 0; /* number of objects */
@@ -999,17 +1009,10 @@ unsigned Device_Object_List_Count(
     return count;
 }
 
-/** Lookup the Object at the given array index in the Device's Object List.
- * Even though we don't keep a single linear array of objects in the Device,
- * this method acts as though we do and works through a virtual, concatenated
- * array of all of our object type arrays.
- *
- * @param array_index [in] The desired array index (1 to N)
- * @param object_type [out] The object's type, if found.
- * @param instance [out] The object's instance number, if found.
- * @return True if found, else false.
- */
-bool Device_Object_List_Identifier(
+/* Lookup the Object at the given array index in the object table,
+   working through a virtual, concatenated array of all of our object
+   type arrays.  Used when there is no memory for the Object_List. */
+static bool Device_Object_Table_Identifier(
     unsigned array_index,
     int *object_type,
     uint32_t * instance)
@@ -1060,6 +1063,309 @@ bool Device_Object_List_Identifier(
     return status;
 }
 
+/* The Object_List, as one array of the object identifiers of all our
+   object types.  It is built when it is first used, and built again
+   after the database revision changes or objects are created or
+   deleted, so that an element of it is found without walking the
+   object table and the object iterators. */
+static BACNET_OBJECT_ID *Object_List;
+static unsigned Object_List_Length;
+static unsigned Object_List_Size;
+static bool Object_List_Valid;
+
+/* fill in the Object_List from the object table */
+static bool Device_Object_List_Build(
+    void)
+{
+    BACNET_OBJECT_ID *list = NULL;
+    struct object_functions *pObject = NULL;
+    unsigned count = 0;
+    unsigned length = 0;
+    unsigned index = 0;
+    unsigned i = 0;
+
+    count = Device_Object_Table_Count();
+    if (count > Object_List_Size) {
+        list = realloc(Object_List, count * sizeof(BACNET_OBJECT_ID));
+        if (!list) {
+            return false;
+        }
+        Object_List = list;
+        Object_List_Size = count;
+    }
+    pObject = Object_Table;
+    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        if (pObject->Object_Count && pObject->Object_Index_To_Instance) {
+            count = pObject->Object_Count();
+            if (pObject->Object_Iterator) {
+                index = pObject->Object_Iterator(~(unsigned) 0);
+            } else {
+                index = 0;
+            }
+            for (i = 0; (i < count) && (length < Object_List_Size); i++) {
+                Object_List[length].type = (uint16_t) pObject->Object_Type;
+                Object_List[length].instance =
+                    pObject->Object_Index_To_Instance(index);
+                length++;
+                if (pObject->Object_Iterator) {
+                    index = pObject->Object_Iterator(index);
+                } else {
+                    index++;
+                }
+            }
+        }
+        pObject++;
+    }
+    Object_List_Length = length;
+
+    return true;
+}
+
+/* build the Object_List if it is out of date */
+static bool Device_Object_List_Ready(
+    void)
+{
+    if (!Object_List_Valid) {
+        Object_List_Valid = Device_Object_List_Build();
+    }
+
+    return Object_List_Valid;
+}
+
+/** Mark the Object_List, and the object name index with it, out of
+ * date, when objects are created or deleted.  They are built again when
+ * they are next used.
+ */
+void Device_Object_List_Reset(
+    void)
+{
+    Object_List_Valid = false;
+    Device_Object_Name_Index_Reset();
+#if defined(INTRINSIC_REPORTING)
+    Device_Reporting_Reset();
+#endif
+}
+
+/** Get the total count of objects supported by this Device Object.
+ * @note Since many network clients depend on the object list
+ *       for discovery, it must be consistent!
+ * @return The count of objects, for all supported Object types.
+ */
+unsigned Device_Object_List_Count(
+    void)
+{
+    if (Device_Object_List_Ready()) {
+        return Object_List_Length;
+    }
+
+    return Device_Object_Table_Count();
+}
+
+/** Lookup the Object at the given array index in the Device's Object List.
+ *
+ * @param array_index [in] The desired array index (1 to N)
+ * @param object_type [out] The object's type, if found.
+ * @param instance [out] The object's instance number, if found.
+ * @return True if found, else false.
+ */
+bool Device_Object_List_Identifier(
+    unsigned array_index,
+    int *object_type,
+    uint32_t * instance)
+{
+    if (!Device_Object_List_Ready()) {
+        return Device_Object_Table_Identifier(array_index, object_type,
+            instance);
+    }
+    /* array index zero is length - so invalid */
+    if ((array_index == 0) || (array_index > Object_List_Length)) {
+        return false;
+    }
+    *object_type = Object_List[array_index - 1].type;
+    *instance = Object_List[array_index - 1].instance;
+#ifdef BAC_ROUTING
+    /* a gateway answers for each of its routed devices in turn */
+    if (*object_type == OBJECT_DEVICE) {
+        *instance = Device_Object_Instance_Number();
+    }
+#endif
+
+    return true;
+}
+
+/* Encode the whole Object_List, returning the length, or
+   BACNET_STATUS_ABORT if it does not fit in max_apdu octets. */
+static int Device_Object_List_Encode(
+    uint8_t * apdu,
+    int max_apdu)
+{
+    int apdu_len = 0;
+    int len = 0;
+    unsigned count = 0;
+    unsigned i = 0;
+    int object_type = 0;
+    uint32_t instance = 0;
+
+    count = Device_Object_List_Count();
+    for (i = 1; i <= count; i++) {
+        if (!Device_Object_List_Identifier(i, &object_type, &instance)) {
+            return BACNET_STATUS_ERROR;
+        }
+        /* an object identifier is a tag and four octets */
+        if ((apdu_len + 5) > max_apdu) {
+            return BACNET_STATUS_ABORT;
+        }
+        len = encode_application_object_id(&apdu[apdu_len], object_type,
+            instance);
+        apdu_len += len;
+    }
+
+    return apdu_len;
+}
+
+/* The names of the objects other than the Device object, indexed by
+   their hash.  The index is built when a name is first looked up, and
+   kept up to date by the object name writes after that.  The Device
+   object is left out since a gateway gives it the name of each routed
+   device in turn. */
+static BACNET_OBJECT_NAME_INDEX Object_Name_Index;
+static bool Object_Name_Index_Valid;
+
+/* add the names of all the objects of the Object_List to the index */
+static bool Device_Object_Name_Index_Build(
+    void)
+{
+    BACNET_CHARACTER_STRING object_name;
+    unsigned count = 0;
+    unsigned i = 0;
+    int type = 0;
+    uint32_t instance = 0;
+
+    object_name_index_cleanup(&Object_Name_Index);
+    count = Device_Object_List_Count();
+    for (i = 1; i <= count; i++) {
+        if (Device_Object_List_Identifier(i, &type, &instance) &&
+            (type != OBJECT_DEVICE) &&
+            Device_Object_Name_Copy((BACNET_OBJECT_TYPE) type, instance,
+                &object_name) &&
+            !object_name_index_add(&Object_Name_Index, &object_name,
+                (uint16_t) type, instance)) {
+            object_name_index_cleanup(&Object_Name_Index);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Take an object out of the object name index.
+ * Called by an object with its current name, before the name changes.
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object.
+ * @param object_instance [in] The object instance number of the object.
+ */
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING object_name;
+
+    if (Object_Name_Index_Valid && (object_type != OBJECT_DEVICE) &&
+        Device_Object_Name_Copy(object_type, object_instance, &object_name)) {
+        object_name_index_remove(&Object_Name_Index, &object_name,
+            (uint16_t) object_type, object_instance);
+    }
+}
+
+/** Put an object into the object name index.
+ * Called by an object with its new name, after the name changes.
+ * @param object_type [in] The BACNET_OBJECT_TYPE of the object.
+ * @param object_instance [in] The object instance number of the object.
+ */
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_CHARACTER_STRING object_name;
+
+    if (Object_Name_Index_Valid && (object_type != OBJECT_DEVICE) &&
+        Device_Object_Name_Copy(object_type, object_instance, &object_name) &&
+        !object_name_index_add(&Object_Name_Index, &object_name,
+            (uint16_t) object_type, object_instance)) {
+        /* out of memory: build it again when it is next used */
+        Device_Object_Name_Index_Reset();
+    }
+}
+
+/** Forget the object name index, when many objects are added, removed,
+ * or renamed at once.  It is built again when a name is next looked up.
+ */
+void Device_Object_Name_Index_Reset(
+    void)
+{
+    object_name_index_cleanup(&Object_Name_Index);
+    Object_Name_Index_Valid = false;
+}
+
+/* look for the name in the Device object, then in the index or,
+   if there is no memory for the index, in every object */
+static bool Device_Object_Name_Find(
+    BACNET_CHARACTER_STRING * object_name1,
+    int *object_type,
+    uint32_t * object_instance)
+{
+    BACNET_CHARACTER_STRING object_name2;
+    struct object_functions *pObject = NULL;
+    unsigned max_objects = 0, i = 0;
+    unsigned cursor = 0;
+    uint16_t found_type = 0;
+    uint32_t instance = 0;
+    int type = 0;
+
+    pObject = Device_Objects_Find_Functions(OBJECT_DEVICE);
+    if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+        pObject->Object_Index_To_Instance) {
+        instance = pObject->Object_Index_To_Instance(0);
+        if (pObject->Object_Name(instance, &object_name2) &&
+            characterstring_same(object_name1, &object_name2)) {
+            *object_type = OBJECT_DEVICE;
+            *object_instance = instance;
+            return true;
+        }
+    }
+    if (!Object_Name_Index_Valid) {
+        Object_Name_Index_Valid = Device_Object_Name_Index_Build();
+    }
+    if (Object_Name_Index_Valid) {
+        while (object_name_index_find(&Object_Name_Index, object_name1,
+                &cursor, &found_type, &instance)) {
+            if (Device_Object_Name_Copy((BACNET_OBJECT_TYPE) found_type,
+                    instance, &object_name2) &&
+                characterstring_same(object_name1, &object_name2)) {
+                *object_type = found_type;
+                *object_instance = instance;
+                return true;
+            }
+        }
+        return false;
+    }
+    max_objects = Device_Object_List_Count();
+    for (i = 1; i <= max_objects; i++) {
+        if (Device_Object_List_Identifier(i, &type, &instance) &&
+            (type != OBJECT_DEVICE)) {
+            pObject = Device_Objects_Find_Functions(type);
+            if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
+                (pObject->Object_Name(instance, &object_name2) &&
+                    characterstring_same(object_name1, &object_name2))) {
+                *object_type = type;
+                *object_instance = instance;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 /** Determine if we have an object with the given object_name.
  * If the object_type and object_instance pointers are not null,
  * and the lookup succeeds, they will be given the resulting values.
@@ -1075,29 +1381,15 @@ bool Device_Valid_Object_Name(
 {
     bool found = false;
     int type = 0;
-    uint32_t instance;
-    unsigned max_objects = 0, i = 0;
-    bool check_id = false;
-    BACNET_CHARACTER_STRING object_name2;
-    struct object_functions *pObject = NULL;
+    uint32_t instance = 0;
 
-    max_objects = Device_Object_List_Count();
-    for (i = 1; i <= max_objects; i++) {
-        check_id = Device_Object_List_Identifier(i, &type, &instance);
-        if (check_id) {
-            pObject = Device_Objects_Find_Functions(type);
-            if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
-                (pObject->Object_Name(instance, &object_name2) &&
-                    characterstring_same(object_name1, &object_name2))) {
-                found = true;
-                if (object_type) {
-                    *object_type = type;
-                }
-                if (object_instance) {
-                    *object_instance = instance;
-                }
-                break;
-            }
+    found = Device_Object_Name_Find(object_name1, &type, &instance);
+    if (found) {
+        if (object_type) {
+            *object_type = type;
+        }
+        if (object_instance) {
+            *object_instance = instance;
         }
     }
 
@@ -1217,7 +1509,6 @@ int Device_Read_Property_Local(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
     int apdu_len = 0;   /* return value */
-    int len = 0;        /* apdu len intermediate value */
     BACNET_BIT_STRING bit_string = { 0 };
     BACNET_CHARACTER_STRING char_string = { 0 };
     unsigned i = 0;
@@ -1350,31 +1641,19 @@ int Device_Read_Property_Local(
             /* to return an error if the number of encoded objects exceeds */
             /* your maximum APDU size. */
             else if (rpdata->array_index == BACNET_ARRAY_ALL) {
-                for (i = 1; i <= count; i++) {
-                    found =
-                        Device_Object_List_Identifier(i, &object_type,
-                        &instance);
-                    if (found) {
-                        len =
-                            encode_application_object_id(&apdu[apdu_len],
-                            object_type, instance);
-                        apdu_len += len;
-                        /* assume next one is the same size as this one */
-                        /* can we all fit into the APDU? Don't check for last entry */
-                        if ((i != count) && (apdu_len + len) >= MAX_APDU) {
-                            /* Abort response */
-                            rpdata->error_code =
-                                ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                            apdu_len = BACNET_STATUS_ABORT;
-                            break;
-                        }
-                    } else {
-                        /* error: internal error? */
-                        rpdata->error_class = ERROR_CLASS_SERVICES;
-                        rpdata->error_code = ERROR_CODE_OTHER;
-                        apdu_len = BACNET_STATUS_ERROR;
-                        break;
-                    }
+                apdu_len =
+                    Device_Object_List_Encode(&apdu[0],
+                    rpdata->application_data_len);
+                if (apdu_len == BACNET_STATUS_ABORT) {
+                    /* too big for the reply; the ReadProperty handlers,
+                       which know if the client takes it in segments,
+                       make this a buffer overflow if it does */
+                    rpdata->error_code =
+                        ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+                } else if (apdu_len == BACNET_STATUS_ERROR) {
+                    /* error: internal error? */
+                    rpdata->error_class = ERROR_CLASS_SERVICES;
+                    rpdata->error_code = ERROR_CODE_OTHER;
                 }
             } else {
                 found =
@@ -1405,6 +1684,15 @@ int Device_Read_Property_Local(
         case PROP_NUMBER_OF_APDU_RETRIES:
             apdu_len = encode_application_unsigned(&apdu[0], apdu_retries());
             break;
+#if (MAX_SEGMENTED_RESPONSES)
+        case PROP_MAX_SEGMENTS_ACCEPTED:
+            apdu_len = encode_application_unsigned(&apdu[0], MAX_SEGMENTS);
+            break;
+        case PROP_APDU_SEGMENT_TIMEOUT:
+            apdu_len =
+                encode_application_unsigned(&apdu[0], apdu_segment_timeout());
+            break;
+#endif
         case PROP_DEVICE_ADDRESS_BINDING:
             /* FIXME: the real max apdu remaining should be passed into function */
             apdu_len = address_list_encode(&apdu[0], MAX_APDU);
@@ -1539,6 +1827,24 @@ bool Device_Write_Property_Local(
                 apdu_timeout_set((uint16_t) value.type.Unsigned_Int);
             }
             break;
+#if (MAX_SEGMENTED_RESPONSES)
+        case PROP_APDU_SEGMENT_TIMEOUT:
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status) {
+                if ((value.type.Unsigned_Int > 0) &&
+                    (value.type.Unsigned_Int <= UINT16_MAX)) {
+                    apdu_segment_timeout_set((uint16_t) value.
+                        type.Unsigned_Int);
+                } else {
+                    status = false;
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+                }
+            }
+            break;
+#endif
         case PROP_VENDOR_IDENTIFIER:
             status =
                 WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
@@ -1672,6 +1978,9 @@ bool Device_Write_Property_Local(
         case PROP_OBJECT_LIST:
         case PROP_MAX_APDU_LENGTH_ACCEPTED:
         case PROP_SEGMENTATION_SUPPORTED:
+#if (MAX_SEGMENTED_RESPONSES)
+        case PROP_MAX_SEGMENTS_ACCEPTED:
+#endif
         case PROP_DEVICE_ADDRESS_BINDING:
         case PROP_DATABASE_REVISION:
         case PROP_ACTIVE_COV_SUBSCRIPTIONS:
@@ -1711,6 +2020,12 @@ bool Device_Write_Property(
             pObject->Object_Valid_Instance(wp_data->object_instance)) {
             if (pObject->Object_Write_Property) {
                 status = pObject->Object_Write_Property(wp_data);
+#if defined(INTRINSIC_REPORTING)
+                if (status) {
+                    Device_Reporting_Schedule(wp_data->object_type,
+                        wp_data->object_instance);
+                }
+#endif
             } else {
                 wp_data->error_class = ERROR_CLASS_PROPERTY;
                 wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
@@ -1806,6 +2121,64 @@ void Device_COV_Clear(
 }
 
 #if defined(INTRINSIC_REPORTING)
+/* The objects whose intrinsic reporting is looked at on the next pass,
+   keyed by their object identifier, with their object functions.
+   Objects are put on the list when a value or a property that reporting
+   depends on is changed, when an alarm is acknowledged, and while their
+   time delay is running; all the others have nothing to report.  The
+   list of the pass being done is the other one, so that an object
+   put back on while it is looked at waits for the next pass. */
+static OS_Keylist Reporting_List[2];
+static unsigned Reporting_Next;
+/* look at every object on the next pass, at start up, after objects are
+   created or deleted, or when the list could not grow */
+static bool Reporting_Sweep = true;
+
+/** Look at the intrinsic reporting of an object on the next pass of
+ * Device_local_reporting(), only once however often it is asked for.
+ *
+ * @param object_type [in] The type of the object.
+ * @param object_instance [in] The instance number of the object.
+ */
+void Device_Reporting_Schedule(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    struct object_functions *pObject = NULL;
+    OS_Keylist list = NULL;
+    KEY key = KEY_ENCODE(object_type, object_instance);
+
+    if (Reporting_Sweep) {
+        return;
+    }
+    pObject = Device_Objects_Find_Functions(object_type);
+    if (!pObject || !pObject->Object_Intrinsic_Reporting) {
+        return;
+    }
+    list = Reporting_List[Reporting_Next];
+    if (!list) {
+        list = Reporting_List[Reporting_Next] = Keylist_Create();
+    }
+    if (!list) {
+        Reporting_Sweep = true;
+    } else if (!Keylist_Data(list, key)) {
+        if (Keylist_Data_Add(list, key, pObject) < 0) {
+            Reporting_Sweep = true;
+        }
+    }
+}
+
+/** Look at every object on the next pass of Device_local_reporting(). */
+void Device_Reporting_Reset(
+    void)
+{
+    Reporting_Sweep = true;
+}
+
+/** Evaluate the intrinsic reporting of the objects that were scheduled
+ * since the last pass, or of all the objects after a reset.
+ * Called once a second.
+ */
 void Device_local_reporting(
     void)
 {
@@ -1814,23 +2187,44 @@ void Device_local_reporting(
     uint32_t object_instance;
     int object_type;
     uint32_t idx;
-
-    objects_count = Device_Object_List_Count();
-
-    /* loop for all objects */
-    for (idx = 1; idx < objects_count; idx++) {
-        Device_Object_List_Identifier(idx, &object_type, &object_instance);
-
-        pObject = Device_Objects_Find_Functions(object_type);
-        if (pObject != NULL) {
-            if (pObject->Object_Valid_Instance &&
-                pObject->Object_Valid_Instance(object_instance)) {
-                if (pObject->Object_Intrinsic_Reporting) {
-                    pObject->Object_Intrinsic_Reporting(object_instance);
+    OS_Keylist list;
+    bool sweep = Reporting_Sweep;
+    KEY key;
+
+    list = Reporting_List[Reporting_Next];
+    Reporting_Next ^= 1;
+    Reporting_Sweep = false;
+    if (sweep) {
+        objects_count = Device_Object_List_Count();
+        for (idx = 1; idx <= objects_count; idx++) {
+            if (!Device_Object_List_Identifier(idx, &object_type,
+                    &object_instance)) {
+                continue;
+            }
+            pObject = Device_Objects_Find_Functions(object_type);
+            if (pObject != NULL) {
+                if (pObject->Object_Valid_Instance &&
+                    pObject->Object_Valid_Instance(object_instance)) {
+                    if (pObject->Object_Intrinsic_Reporting) {
+                        pObject->Object_Intrinsic_Reporting(object_instance);
+                    }
                 }
             }
         }
     }
+    while (list && (Keylist_Count(list) > 0)) {
+        key = Keylist_Key(list, Keylist_Count(list) - 1);
+        pObject = Keylist_Data_Delete_By_Index(list,
+            Keylist_Count(list) - 1);
+        if (sweep) {
+            continue;
+        }
+        object_instance = KEY_DECODE_ID(key);
+        if (pObject->Object_Valid_Instance &&
+            pObject->Object_Valid_Instance(object_instance)) {
+            pObject->Object_Intrinsic_Reporting(object_instance);
+        }
+    }
 }
 #endif
 
@@ -1920,6 +2314,7 @@ void Device_Init(
         }
         pObject++;
     }
+    Device_Object_List_Reset();
 }
 
 bool DeviceGetRRInfo(
@@ -2010,12 +2405,13 @@ bool WPValidateArgType(
     BACNET_ERROR_CLASS * pErrorClass,
     BACNET_ERROR_CODE * pErrorCode)
 {
-    pValue = pValue;
-    ucExpectedTag = ucExpectedTag;
-    pErrorClass = pErrorClass;
-    pErrorCode = pErrorCode;
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
 
-    return false;
+    return true;
 }
 
 bool WPValidateString(
@@ -2044,11 +2440,314 @@ int handler_cov_encode_subscriptions(
     return 0;
 }
 
+void handler_alarm_ack_set(
+    BACNET_OBJECT_TYPE object_type,
+    alarm_ack_function pFunction)
+{
+    (void) object_type;
+    (void) pFunction;
+}
+
+void handler_get_event_information_set(
+    BACNET_OBJECT_TYPE object_type,
+    get_event_info_function pFunction)
+{
+    (void) object_type;
+    (void) pFunction;
+}
+
+void handler_get_alarm_summary_set(
+    BACNET_OBJECT_TYPE object_type,
+    get_alarm_summary_function pFunction)
+{
+    (void) object_type;
+    (void) pFunction;
+}
+
+/* UCI stubs: the config has two analog inputs, 1 and 2, that report
+   going over 100 or under -100, the first at once and the second after
+   a Time_Delay of 3 seconds.  There are no other objects. */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    (void) ctx;
+    (void) t;
+    if (strcmp(p, "bacnet_ai") == 0) {
+        cb("2", priv);
+        cb("1", priv);
+    }
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) ctx;
+
+    if ((strcmp(p, "bacnet_ai") != 0) || !s || (strcmp(s, "default") == 0)) {
+        return NULL;
+    }
+    if (strcmp(o, "name") == 0) {
+        return (strcmp(s, "1") == 0) ? "AI1" : "AI2";
+    }
+    if (strcmp(o, "value") == 0) {
+        return "0";
+    }
+    if (strcmp(o, "high_limit") == 0) {
+        return "100";
+    }
+    if (strcmp(o, "low_limit") == 0) {
+        return "-100";
+    }
+    if (strcmp(o, "dead_limit") == 0) {
+        return "1";
+    }
+
+    return NULL;
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+
+    if ((strcmp(p, "bacnet_ai") != 0) || !s || (strcmp(s, "default") == 0)) {
+        return def;
+    }
+    if (strcmp(o, "nc") == 0) {
+        return 1;
+    }
+    if (strcmp(o, "event") == 0) {
+        return EVENT_ENABLE_TO_OFFNORMAL | EVENT_ENABLE_TO_FAULT |
+            EVENT_ENABLE_TO_NORMAL;
+    }
+    if (strcmp(o, "limit") == 0) {
+        return EVENT_HIGH_LIMIT_ENABLE | EVENT_LOW_LIMIT_ENABLE;
+    }
+    if (strcmp(o, "time_delay") == 0) {
+        return (strcmp(s, "1") == 0) ? 0 : 3;
+    }
+
+    return def;
+}
+
+int ucix_get_list(
+    char *value[254],
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) value;
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+
+    return 0;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_set_list(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    char value[254][64],
+    int l)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) value;
+    (void) l;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i);
+
+    return true;
+}
+
+/* Notification Class stubs: there are none, but the event notifications
+   the objects ask for are counted, and always need an acknowledgment */
+static unsigned Test_Event_Notifications;
+static unsigned Test_Ack_Notifications;
+static BACNET_DATE_TIME Test_Event_Time;
+
+void Notification_Class_Init(
+    void)
+{
+}
+
+unsigned Notification_Class_Count(
+    void)
+{
+    return 0;
+}
+
+uint32_t Notification_Class_Index_To_Instance(
+    unsigned index)
+{
+    return index;
+}
+
+bool Notification_Class_Valid_Instance(
+    uint32_t object_instance)
+{
+    (void) object_instance;
+
+    return false;
+}
+
+bool Notification_Class_Object_Name(
+    uint32_t object_instance,
+    BACNET_CHARACTER_STRING * object_name)
+{
+    (void) object_instance;
+    (void) object_name;
+
+    return false;
+}
+
+int Notification_Class_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    (void) rpdata;
+
+    return BACNET_STATUS_ERROR;
+}
+
+bool Notification_Class_Write_Property(
+    BACNET_WRITE_PROPERTY_DATA * wp_data)
+{
+    (void) wp_data;
+
+    return false;
+}
+
+void Notification_Class_Property_Lists(
+    const int **pRequired,
+    const int **pOptional,
+    const int **pProprietary)
+{
+    static const int Properties[] = { -1 };
+
+    if (pRequired) {
+        *pRequired = Properties;
+    }
+    if (pOptional) {
+        *pOptional = Properties;
+    }
+    if (pProprietary) {
+        *pProprietary = Properties;
+    }
+}
+
+void Notification_Class_Get_Priorities(
+    uint32_t Object_Instance,
+    uint32_t * pPriorityArray)
+{
+    (void) Object_Instance;
+    (void) pPriorityArray;
+}
+
+void Notification_Class_common_reporting_function(
+    BACNET_EVENT_NOTIFICATION_DATA * event_data)
+{
+    if (event_data->notifyType == NOTIFY_ACK_NOTIFICATION) {
+        Test_Ack_Notifications++;
+    } else {
+        Test_Event_Notifications++;
+        Test_Event_Time = event_data->timeStamp.value.dateTime;
+        event_data->ackRequired = true;
+    }
+}
+
 void testDevice(
     Test * pTest)
 {
     bool status = false;
     const char *name = "Patricia";
+    uint8_t apdu[MAX_APDU] = { 0 };
+    uint8_t element[8] = { 0 };
+    int len = 0;
+    int apdu_len = 0;
+    int element_len = 0;
+    unsigned count = 0;
+    unsigned i = 0;
+    int object_type = 0;
+    uint32_t instance = 0;
+    int table_type = 0;
+    uint32_t table_instance = 0;
 
     status = Device_Set_Object_Instance_Number(0);
     ct_test(pTest, Device_Object_Instance_Number() == 0);
@@ -2074,6 +2773,155 @@ void testDevice(
     Device_Set_Model_Name(name, strlen(name));
     ct_test(pTest, strcmp(Device_Model_Name(), name) == 0);
 
+    /* the Object_List holds the same objects, in the same order, as the
+       object table it is built from */
+    Device_Init(NULL);
+    count = Device_Object_List_Count();
+    ct_test(pTest, count == Device_Object_Table_Count());
+    ct_test(pTest, count > 1);
+    for (i = 1; i <= count; i++) {
+        ct_test(pTest, Device_Object_List_Identifier(i, &object_type,
+                &instance));
+        ct_test(pTest, Device_Object_Table_Identifier(i, &table_type,
+                &table_instance));
+        ct_test(pTest, object_type == table_type);
+        ct_test(pTest, instance == table_instance);
+    }
+    ct_test(pTest, !Device_Object_List_Identifier(0, &object_type,
+            &instance));
+    ct_test(pTest, !Device_Object_List_Identifier(count + 1, &object_type,
+            &instance));
+    /* a new database revision rebuilds it */
+    Device_Inc_Database_Revision();
+    ct_test(pTest, !Object_List_Valid);
+    ct_test(pTest, Device_Object_List_Count() == count);
+    ct_test(pTest, Object_List_Valid);
+    /* and the whole array encodes as its elements do, one by one */
+    len = Device_Object_List_Encode(&apdu[0], sizeof(apdu));
+    ct_test(pTest, len == (int) (count * 5));
+    for (i = 1; i <= count; i++) {
+        ct_test(pTest, Device_Object_List_Identifier(i, &object_type,
+                &instance));
+        element_len = encode_application_object_id(&element[0],
+            object_type, instance);
+        ct_test(pTest, element_len == 5);
+        ct_test(pTest, (apdu_len + element_len) <= len);
+        ct_test(pTest, memcmp(&apdu[apdu_len], &element[0],
+                element_len) == 0);
+        apdu_len += element_len;
+    }
+    ct_test(pTest, apdu_len == len);
+    /* one octet short of the whole array is too long */
+    ct_test(pTest, Device_Object_List_Encode(&apdu[0],
+            len - 1) == BACNET_STATUS_ABORT);
+
+    return;
+}
+
+/* the Event_State of an analog input, as read from it */
+static uint32_t testDevice_Event_State(
+    uint32_t object_instance)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_APPLICATION_DATA_VALUE value;
+    uint8_t apdu[MAX_APDU] = { 0 };
+    int len = 0;
+
+    memset(&rpdata, 0, sizeof(rpdata));
+    rpdata.application_data = &apdu[0];
+    rpdata.application_data_len = sizeof(apdu);
+    rpdata.object_type = OBJECT_ANALOG_INPUT;
+    rpdata.object_instance = object_instance;
+    rpdata.object_property = PROP_EVENT_STATE;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    len = Device_Read_Property(&rpdata);
+    if ((len <= 0) ||
+        (bacapp_decode_application_data(&apdu[0], len, &value) <= 0)) {
+        return UINT32_MAX;
+    }
+
+    return value.type.Enumerated;
+}
+
+/* write the High_Limit of an analog input to the object itself, so that
+   it is not scheduled for reporting as a WriteProperty would be */
+static bool testDevice_High_Limit(
+    uint32_t object_instance,
+    float limit)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+
+    memset(&wp_data, 0, sizeof(wp_data));
+    wp_data.object_type = OBJECT_ANALOG_INPUT;
+    wp_data.object_instance = object_instance;
+    wp_data.object_property = PROP_HIGH_LIMIT;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = BACNET_MAX_PRIORITY;
+    wp_data.application_data_len =
+        encode_application_real(&wp_data.application_data[0], limit);
+
+    return Analog_Input_Write_Property(&wp_data);
+}
+
+void testDevice_Reporting(
+    Test * pTest)
+{
+    BACNET_ALARM_ACK_DATA ack_data;
+    BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
+    unsigned count = 0;
+    unsigned i = 0;
+
+    Device_Init(NULL);
+    ct_test(pTest, Analog_Input_Count() == 2);
+    /* the first pass looks at every object */
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(1) == EVENT_STATE_NORMAL);
+    ct_test(pTest, testDevice_Event_State(2) == EVENT_STATE_NORMAL);
+    /* with no Time_Delay, a value over the High_Limit is reported on the
+       next pass */
+    count = Test_Event_Notifications;
+    ct_test(pTest, Analog_Input_Present_Value_Set(1, 150.0f, 8));
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(1) == EVENT_STATE_HIGH_LIMIT);
+    ct_test(pTest, Test_Event_Notifications == (count + 1));
+    /* acknowledging it sends one AckNotification, on the next pass */
+    memset(&ack_data, 0, sizeof(ack_data));
+    ack_data.eventObjectIdentifier.type = OBJECT_ANALOG_INPUT;
+    ack_data.eventObjectIdentifier.instance = 1;
+    ack_data.eventStateAcked = EVENT_STATE_HIGH_LIMIT;
+    ack_data.eventTimeStamp.tag = TIME_STAMP_DATETIME;
+    ack_data.eventTimeStamp.value.dateTime = Test_Event_Time;
+    count = Test_Ack_Notifications;
+    ct_test(pTest, Analog_Input_Alarm_Ack(&ack_data, &error_code) == 1);
+    ct_test(pTest, Test_Ack_Notifications == count);
+    Device_local_reporting();
+    ct_test(pTest, Test_Ack_Notifications == (count + 1));
+    Device_local_reporting();
+    ct_test(pTest, Test_Ack_Notifications == (count + 1));
+    /* with a Time_Delay of 3, the object is looked at again on each pass
+       until the delay has run out, then it is reported */
+    count = Test_Event_Notifications;
+    ct_test(pTest, Analog_Input_Present_Value_Set(2, 150.0f, 8));
+    for (i = 0; i < 3; i++) {
+        Device_local_reporting();
+        ct_test(pTest, testDevice_Event_State(2) == EVENT_STATE_NORMAL);
+    }
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(2) == EVENT_STATE_HIGH_LIMIT);
+    ct_test(pTest, Test_Event_Notifications == (count + 1));
+    /* an object that was not scheduled is not looked at */
+    Device_local_reporting();
+    ct_test(pTest, testDevice_High_Limit(1, 200.0f));
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(1) == EVENT_STATE_HIGH_LIMIT);
+    /* until the Object_List is reset, which looks at every object, once */
+    Device_Object_List_Reset();
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(1) == EVENT_STATE_NORMAL);
+    ct_test(pTest, testDevice_High_Limit(1, 100.0f));
+    Device_local_reporting();
+    ct_test(pTest, testDevice_Event_State(1) == EVENT_STATE_NORMAL);
+
     return;
 }
 
@@ -2088,6 +2936,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testDevice);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testDevice_Reporting);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -269,6 +269,8 @@ extern "C" {
         unsigned array_index,
         int *object_type,
         uint32_t * instance);
+    void Device_Object_List_Reset(
+        void);
 
     unsigned Device_Count(
         void);
@@ -346,6 +348,14 @@ extern "C" {
         BACNET_CHARACTER_STRING * object_name,
         int *object_type,
         uint32_t * object_instance);
+    void Device_Object_Name_Remove(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    void Device_Object_Name_Add(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    void Device_Object_Name_Index_Reset(
+        void);
     bool Device_Valid_Object_Id(
         int object_type,
         uint32_t object_instance);
@@ -367,6 +377,11 @@ extern "C" {
 #if defined(INTRINSIC_REPORTING)
     void Device_local_reporting(
         void);
+    void Device_Reporting_Schedule(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    void Device_Reporting_Reset(
+        void);
 #endif
 
 /* Prototypes for Routing functionality in the Device Object.
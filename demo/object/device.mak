@@ -5,14 +5,19 @@ TEST_DIR = ../../test
 PORTS_DIR = ../../ports/linux
 INCLUDES = -I../../include -I$(TEST_DIR) -I$(PORTS_DIR) -I.
 DEFINES = -DBIG_ENDIAN=0
-DEFINES += -DTEST -DBACDL_TEST
+DEFINES += -DBACDL_TEST
 DEFINES += -DBACAPP_ALL
 DEFINES += -DMAX_TSM_TRANSACTIONS=0
-DEFINES += -DTEST_DEVICE
+DEFINES += -DINTRINSIC_REPORTING
+# only the device is tested, the objects are built as they are
+TEST_DEFINES = -DTEST -DTEST_DEVICE
 
-CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+# the objects each declare their own uci context
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -fcommon
 
 SRCS = device.c \
+	ai.c ao.c av.c bi.c bo.c bv.c msi.c mso.c msv.c \
+	trendlog.c \
 	$(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacint.c \
 	$(SRC_DIR)/bacstr.c \
@@ -23,9 +28,16 @@ SRCS = device.c \
 	$(SRC_DIR)/indtext.c \
 	$(SRC_DIR)/apdu.c \
 	$(SRC_DIR)/address.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
 	$(SRC_DIR)/bacaddr.c \
 	$(SRC_DIR)/dcc.c \
 	$(SRC_DIR)/version.c \
+	$(SRC_DIR)/keylist.c \
+	$(SRC_DIR)/covqueue.c \
+	$(SRC_DIR)/objindex.c \
+	$(SRC_DIR)/objname.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
 	$(TEST_DIR)/ctest.c
 
 TARGET = device
@@ -35,7 +47,10 @@ all: ${TARGET}
 OBJS = ${SRCS:.c=.o}
 
 ${TARGET}: ${OBJS}
-	${CC} -o $@ ${OBJS}
+	${CC} -o $@ ${OBJS} -lm
+
+device.o: device.c
+	${CC} -c ${CFLAGS} ${TEST_DEFINES} device.c -o $@
 
 .c.o:
 	${CC} -c ${CFLAGS} $*.c -o $@
@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "msi.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_MULTI_STATE_INPUTS
@@ -60,6 +62,8 @@ unsigned max_multi_state_inputs_int = 0;
 #define MULTI_STATE_LEVEL_NULL 255
 
 MULTI_STATE_INPUT_DESCR MSI_Descr[MAX_MULTI_STATE_INPUTS];
+/* instance number to MSI_Descr index */
+static BACNET_OBJECT_INDEX MSI_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Multistate_Input_Properties_Required[] = {
@@ -200,6 +204,8 @@ void Multistate_Input_Init(
             "time_delay", -1);
 
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&MSI_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -221,6 +227,7 @@ void Multistate_Input_Init(
                     MSI_Descr[i].Priority_Array[j] = MULTI_STATE_LEVEL_NULL;
                 }
                 MSI_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&MSI_Index, MSI_Descr[i].Instance, i);
                 MSI_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(MSI_Descr[i].Object_Name,
@@ -341,17 +348,11 @@ void Multistate_Input_Init(
 unsigned Multistate_Input_Instance_To_Index(
     uint32_t object_instance)
 {
-    MULTI_STATE_INPUT_DESCR *CurrentMSI;
-    int index,instance,i;
-    index = max_multi_state_inputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentMSI = &MSI_Descr[i];
-    	instance = CurrentMSI->Instance;
-    	if (CurrentMSI->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_MULTI_STATE_INPUTS;
+    unsigned index = MAX_MULTI_STATE_INPUTS;
+
+    (void) object_index_find(&MSI_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -397,6 +398,17 @@ bool Multistate_Input_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Multistate_Input_Change_Of_Value_Set(
+    MULTI_STATE_INPUT_DESCR * CurrentMSI,
+    uint32_t object_instance)
+{
+    if (!CurrentMSI->Change_Of_Value) {
+        CurrentMSI->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_MULTI_STATE_INPUT, object_instance);
+    }
+}
+
 bool Multistate_Input_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -505,10 +517,12 @@ bool Multistate_Input_Present_Value_Set(
     MULTI_STATE_INPUT_DESCR *CurrentMSI;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    uint32_t present_value = 0;
 
     if (Multistate_Input_Valid_Instance(object_instance)) {
         index = Multistate_Input_Instance_To_Index(object_instance);
         CurrentMSI = &MSI_Descr[index];
+        present_value = Multistate_Input_Present_Value(object_instance);
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */ ) && (value > 0) &&
             (value <= CurrentMSI->number_of_states)) {
@@ -522,6 +536,13 @@ bool Multistate_Input_Present_Value_Set(
             if (priority == 8) {
                 CurrentMSI->Priority_Array[15] = (uint8_t) value;
             }
+            if (Multistate_Input_Present_Value(object_instance) != present_value) {
+                Multistate_Input_Change_Of_Value_Set(CurrentMSI, object_instance);
+            }
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_MULTI_STATE_INPUT,
+                object_instance);
+#endif
             status = true;
         }
     }
@@ -554,6 +575,9 @@ void Multistate_Input_Out_Of_Service_Set(
     if (Multistate_Input_Valid_Instance(object_instance)) {
         index = Multistate_Input_Instance_To_Index(object_instance);
         CurrentMSI = &MSI_Descr[index];
+        if (CurrentMSI->Out_Of_Service != value) {
+            Multistate_Input_Change_Of_Value_Set(CurrentMSI, object_instance);
+        }
         CurrentMSI->Out_Of_Service = value;
     }
 
@@ -570,6 +594,9 @@ void Multistate_Input_Reliability_Set(
     if (Multistate_Input_Valid_Instance(object_instance)) {
         index = Multistate_Input_Instance_To_Index(object_instance);
         CurrentMSI = &MSI_Descr[index];
+        if (CurrentMSI->Reliability != value) {
+            Multistate_Input_Change_Of_Value_Set(CurrentMSI, object_instance);
+        }
         CurrentMSI->Reliability = value;
     }
 
@@ -724,6 +751,7 @@ bool Multistate_Input_Name_Set(
         index = Multistate_Input_Instance_To_Index(object_instance);
         CurrentMSI = &MSI_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_MULTI_STATE_INPUT, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentMSI->Object_Name); i++) {
@@ -737,6 +765,7 @@ bool Multistate_Input_Name_Set(
                 CurrentMSI->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_MULTI_STATE_INPUT, object_instance);
     }
 
     return status;
@@ -763,10 +792,14 @@ static bool Multistate_Input_Object_Name_Write(
         if (length <= sizeof(CurrentMSI->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_MULTI_STATE_INPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentMSI->Object_Name,
                     sizeof(CurrentMSI->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_MULTI_STATE_INPUT,
+                    object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1819,6 +1852,11 @@ void Multistate_Input_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentMSI->Remaining_Time_Delay != CurrentMSI->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_MULTI_STATE_INPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1993,6 +2031,8 @@ int Multistate_Input_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentMSI->Ack_notify_data.bSendAckNotify = true;
     CurrentMSI->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_MULTI_STATE_INPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "mso.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_MULTI_STATE_OUTPUTS
@@ -60,6 +62,8 @@ unsigned max_multi_state_outputs_int = 0;
 #define MULTI_STATE_LEVEL_NULL 255
 
 MULTI_STATE_OUTPUT_DESCR MSO_Descr[MAX_MULTI_STATE_OUTPUTS];
+/* instance number to MSO_Descr index */
+static BACNET_OBJECT_INDEX MSO_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Multistate_Output_Properties_Required[] = {
@@ -204,6 +208,8 @@ void Multistate_Output_Init(
             "fb_value", -1);
 
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&MSO_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -225,6 +231,7 @@ void Multistate_Output_Init(
                     MSO_Descr[i].Priority_Array[j] = MULTI_STATE_LEVEL_NULL;
                 }
                 MSO_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&MSO_Index, MSO_Descr[i].Instance, i);
                 MSO_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(MSO_Descr[i].Object_Name,
@@ -343,17 +350,11 @@ void Multistate_Output_Init(
 unsigned Multistate_Output_Instance_To_Index(
     uint32_t object_instance)
 {
-    MULTI_STATE_OUTPUT_DESCR *CurrentMSO;
-    int index,instance,i;
-    index = max_multi_state_outputs_int;
-    for (i = 0; i < index; i++) {
-    	CurrentMSO = &MSO_Descr[i];
-    	instance = CurrentMSO->Instance;
-    	if (CurrentMSO->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_MULTI_STATE_OUTPUTS;
+    unsigned index = MAX_MULTI_STATE_OUTPUTS;
+
+    (void) object_index_find(&MSO_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -399,6 +400,17 @@ bool Multistate_Output_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Multistate_Output_Change_Of_Value_Set(
+    MULTI_STATE_OUTPUT_DESCR * CurrentMSO,
+    uint32_t object_instance)
+{
+    if (!CurrentMSO->Change_Of_Value) {
+        CurrentMSO->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_MULTI_STATE_OUTPUT, object_instance);
+    }
+}
+
 bool Multistate_Output_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -507,10 +519,12 @@ bool Multistate_Output_Present_Value_Set(
     MULTI_STATE_OUTPUT_DESCR *CurrentMSO;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    uint32_t present_value = 0;
 
     if (Multistate_Output_Valid_Instance(object_instance)) {
         index = Multistate_Output_Instance_To_Index(object_instance);
         CurrentMSO = &MSO_Descr[index];
+        present_value = Multistate_Output_Present_Value(object_instance);
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */ ) && (value > 0) &&
             (value <= CurrentMSO->number_of_states)) {
@@ -525,6 +539,13 @@ bool Multistate_Output_Present_Value_Set(
             if (priority == 8) {
                 CurrentMSO->Priority_Array[15] = (uint8_t) value;
             }
+            if (Multistate_Output_Present_Value(object_instance) != present_value) {
+                Multistate_Output_Change_Of_Value_Set(CurrentMSO, object_instance);
+            }
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_MULTI_STATE_OUTPUT,
+                object_instance);
+#endif
             status = true;
         }
     }
@@ -557,6 +578,9 @@ void Multistate_Output_Out_Of_Service_Set(
     if (Multistate_Output_Valid_Instance(object_instance)) {
         index = Multistate_Output_Instance_To_Index(object_instance);
         CurrentMSO = &MSO_Descr[index];
+        if (CurrentMSO->Out_Of_Service != value) {
+            Multistate_Output_Change_Of_Value_Set(CurrentMSO, object_instance);
+        }
         CurrentMSO->Out_Of_Service = value;
     }
 
@@ -573,6 +597,9 @@ void Multistate_Output_Reliability_Set(
     if (Multistate_Output_Valid_Instance(object_instance)) {
         index = Multistate_Output_Instance_To_Index(object_instance);
         CurrentMSO = &MSO_Descr[index];
+        if (CurrentMSO->Reliability != value) {
+            Multistate_Output_Change_Of_Value_Set(CurrentMSO, object_instance);
+        }
         CurrentMSO->Reliability = value;
     }
 
@@ -727,6 +754,7 @@ bool Multistate_Output_Name_Set(
         index = Multistate_Output_Instance_To_Index(object_instance);
         CurrentMSO = &MSO_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_MULTI_STATE_OUTPUT, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentMSO->Object_Name); i++) {
@@ -740,6 +768,7 @@ bool Multistate_Output_Name_Set(
                 CurrentMSO->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_MULTI_STATE_OUTPUT, object_instance);
     }
 
     return status;
@@ -766,10 +795,14 @@ static bool Multistate_Output_Object_Name_Write(
         if (length <= sizeof(CurrentMSO->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_MULTI_STATE_OUTPUT,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentMSO->Object_Name,
                     sizeof(CurrentMSO->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_MULTI_STATE_OUTPUT,
+                    object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1250,6 +1283,7 @@ bool Multistate_Output_Write_Property(
     uint8_t level = MULTI_STATE_LEVEL_NULL;
     int len = 0;
     int element_len = 0;
+    uint32_t present_value = 0;
     BACNET_APPLICATION_DATA_VALUE value;
     uint32_t max_states = 0;
     uint32_t array_index = 0;
@@ -1357,7 +1391,14 @@ bool Multistate_Output_Write_Property(
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
+                        present_value =
+                            Multistate_Output_Present_Value(wp_data->object_instance);
                         CurrentMSO->Priority_Array[priority] = level;
+                        if (Multistate_Output_Present_Value(wp_data->object_instance) !=
+                            present_value) {
+                            Multistate_Output_Change_Of_Value_Set(CurrentMSO,
+                                wp_data->object_instance);
+                        }
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1778,6 +1819,11 @@ void Multistate_Output_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentMSO->Remaining_Time_Delay != CurrentMSO->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_MULTI_STATE_OUTPUT, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1952,6 +1998,8 @@ int Multistate_Output_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentMSO->Ack_notify_data.bSendAckNotify = true;
     CurrentMSO->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_MULTI_STATE_OUTPUT,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
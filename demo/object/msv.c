@@ -43,6 +43,8 @@
 #include "handlers.h"
 #include "msv.h"
 #include "ucix.h"
+#include "objindex.h"
+#include "covqueue.h"
 
 /* number of demo objects */
 #ifndef MAX_MULTI_STATE_VALUES
@@ -60,6 +62,8 @@ unsigned max_multi_state_values_int = 0;
 #define MULTI_STATE_LEVEL_NULL 255
 
 MULTI_STATE_VALUE_DESCR MSV_Descr[MAX_MULTI_STATE_VALUES];
+/* instance number to MSV_Descr index */
+static BACNET_OBJECT_INDEX MSV_Index;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Multistate_Value_Properties_Required[] = {
@@ -200,6 +204,8 @@ void Multistate_Value_Init(
             "time_delay", -1);
 
         i = 0;
+        /* the instances are indexed again from scratch */
+        object_index_cleanup(&MSV_Index);
 		for( cur = itr_m.list; cur; cur = cur->next ) {
 			strncpy(idx_cc, cur->idx, sizeof(idx_cc));
             idx_c = idx_cc;
@@ -221,6 +227,7 @@ void Multistate_Value_Init(
                     MSV_Descr[i].Priority_Array[j] = MULTI_STATE_LEVEL_NULL;
                 }
                 MSV_Descr[i].Instance=atoi(idx_cc);
+                object_index_add(&MSV_Index, MSV_Descr[i].Instance, i);
                 MSV_Descr[i].Disable=false;
                 sprintf(name, "%s", uciname);
                 ucix_string_copy(MSV_Descr[i].Object_Name,
@@ -341,17 +348,11 @@ void Multistate_Value_Init(
 unsigned Multistate_Value_Instance_To_Index(
     uint32_t object_instance)
 {
-    MULTI_STATE_VALUE_DESCR *CurrentMSV;
-    int index,instance,i;
-    index = max_multi_state_values_int;
-    for (i = 0; i < index; i++) {
-    	CurrentMSV = &MSV_Descr[i];
-    	instance = CurrentMSV->Instance;
-    	if (CurrentMSV->Instance == object_instance) {
-    		return i;
-    	}
-    }
-    return MAX_MULTI_STATE_VALUES;
+    unsigned index = MAX_MULTI_STATE_VALUES;
+
+    (void) object_index_find(&MSV_Index, object_instance, &index);
+
+    return index;
 }
 
 /* we simply have 0-n object instances.  Yours might be */
@@ -397,6 +398,17 @@ bool Multistate_Value_Valid_Instance(
     return false;
 }
 
+/* flag a change of value, and queue the object for the COV handler */
+static void Multistate_Value_Change_Of_Value_Set(
+    MULTI_STATE_VALUE_DESCR * CurrentMSV,
+    uint32_t object_instance)
+{
+    if (!CurrentMSV->Change_Of_Value) {
+        CurrentMSV->Change_Of_Value = true;
+        (void) cov_queue_push(OBJECT_MULTI_STATE_VALUE, object_instance);
+    }
+}
+
 bool Multistate_Value_Change_Of_Value(
     uint32_t object_instance)
 {
@@ -505,10 +517,12 @@ bool Multistate_Value_Present_Value_Set(
     MULTI_STATE_VALUE_DESCR *CurrentMSV;
     unsigned index = 0; /* offset from instance lookup */
     bool status = false;
+    uint32_t present_value = 0;
 
     if (Multistate_Value_Valid_Instance(object_instance)) {
         index = Multistate_Value_Instance_To_Index(object_instance);
         CurrentMSV = &MSV_Descr[index];
+        present_value = Multistate_Value_Present_Value(object_instance);
         if (priority && (priority <= BACNET_MAX_PRIORITY) &&
             (priority != 6 /* reserved */ ) && (value > 0) &&
             (value <= CurrentMSV->number_of_states)) {
@@ -522,6 +536,13 @@ bool Multistate_Value_Present_Value_Set(
             if (priority == 8) {
                 CurrentMSV->Priority_Array[15] = (uint8_t) value;
             }
+            if (Multistate_Value_Present_Value(object_instance) != present_value) {
+                Multistate_Value_Change_Of_Value_Set(CurrentMSV, object_instance);
+            }
+#if defined(INTRINSIC_REPORTING)
+            Device_Reporting_Schedule(OBJECT_MULTI_STATE_VALUE,
+                object_instance);
+#endif
             status = true;
         }
     }
@@ -554,6 +575,9 @@ void Multistate_Value_Out_Of_Service_Set(
     if (Multistate_Value_Valid_Instance(object_instance)) {
         index = Multistate_Value_Instance_To_Index(object_instance);
         CurrentMSV = &MSV_Descr[index];
+        if (CurrentMSV->Out_Of_Service != value) {
+            Multistate_Value_Change_Of_Value_Set(CurrentMSV, object_instance);
+        }
         CurrentMSV->Out_Of_Service = value;
     }
 
@@ -570,6 +594,9 @@ void Multistate_Value_Reliability_Set(
     if (Multistate_Value_Valid_Instance(object_instance)) {
         index = Multistate_Value_Instance_To_Index(object_instance);
         CurrentMSV = &MSV_Descr[index];
+        if (CurrentMSV->Reliability != value) {
+            Multistate_Value_Change_Of_Value_Set(CurrentMSV, object_instance);
+        }
         CurrentMSV->Reliability = value;
     }
 
@@ -724,6 +751,7 @@ bool Multistate_Value_Name_Set(
         index = Multistate_Value_Instance_To_Index(object_instance);
         CurrentMSV = &MSV_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_MULTI_STATE_VALUE, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentMSV->Object_Name); i++) {
@@ -737,6 +765,7 @@ bool Multistate_Value_Name_Set(
                 CurrentMSV->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_MULTI_STATE_VALUE, object_instance);
     }
 
     return status;
@@ -763,10 +792,14 @@ static bool Multistate_Value_Object_Name_Write(
         if (length <= sizeof(CurrentMSV->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_MULTI_STATE_VALUE,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentMSV->Object_Name,
                     sizeof(CurrentMSV->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_MULTI_STATE_VALUE,
+                    object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -1263,6 +1296,7 @@ bool Multistate_Value_Write_Property(
     uint8_t level = MULTI_STATE_LEVEL_NULL;
     int len = 0;
     int element_len = 0;
+    uint32_t present_value = 0;
     BACNET_APPLICATION_DATA_VALUE value;
     uint32_t max_states = 0;
     uint32_t array_index = 0;
@@ -1368,7 +1402,14 @@ bool Multistate_Value_Write_Property(
                     priority = wp_data->priority;
                     if (priority && (priority <= BACNET_MAX_PRIORITY)) {
                         priority--;
+                        present_value =
+                            Multistate_Value_Present_Value(wp_data->object_instance);
                         CurrentMSV->Priority_Array[priority] = level;
+                        if (Multistate_Value_Present_Value(wp_data->object_instance) !=
+                            present_value) {
+                            Multistate_Value_Change_Of_Value_Set(CurrentMSV,
+                                wp_data->object_instance);
+                        }
                         /* Note: you could set the physical output here to the next
                            highest priority, or to the relinquish default if no
                            priorities are set.
@@ -1819,6 +1860,11 @@ void Multistate_Value_Intrinsic_Reporting(
             }
         }
     }
+
+    /* while the time delay is running, look again on the next pass */
+    if (CurrentMSV->Remaining_Time_Delay != CurrentMSV->Time_Delay) {
+        Device_Reporting_Schedule(OBJECT_MULTI_STATE_VALUE, object_instance);
+    }
 #endif /* defined(INTRINSIC_REPORTING) */
 }
 
@@ -1993,6 +2039,8 @@ int Multistate_Value_Alarm_Ack(
     /* Need to send AckNotification. */
     CurrentMSV->Ack_notify_data.bSendAckNotify = true;
     CurrentMSV->Ack_notify_data.EventState = alarmack_data->eventStateAcked;
+    Device_Reporting_Schedule(OBJECT_MULTI_STATE_VALUE,
+        alarmack_data->eventObjectIdentifier.instance);
 
     /* Return OK */
     return 1;
@@ -489,6 +489,7 @@ bool Notification_Class_Name_Set(
         index = Notification_Class_Instance_To_Index(object_instance);
         CurrentNC = &NC_Descr[index];
         status = true;
+        Device_Object_Name_Remove(OBJECT_NOTIFICATION_CLASS, object_instance);
         /* FIXME: check to see if there is a matching name */
         if (new_name) {
             for (i = 0; i < sizeof(CurrentNC->Object_Name); i++) {
@@ -502,6 +503,7 @@ bool Notification_Class_Name_Set(
                 CurrentNC->Object_Name[i] = 0;
             }
         }
+        Device_Object_Name_Add(OBJECT_NOTIFICATION_CLASS, object_instance);
     }
 
     return status;
@@ -528,10 +530,14 @@ static bool Notification_Class_Object_Name_Write(
         if (length <= sizeof(CurrentNC->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_NOTIFICATION_CLASS,
+                    object_instance);
                 status = characterstring_ansi_copy(
                     CurrentNC->Object_Name,
                     sizeof(CurrentNC->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_NOTIFICATION_CLASS,
+                    object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -29,7 +29,15 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>     /* for calloc */
 #include <string.h>     /* for memmove */
+#include <stddef.h>     /* for offsetof */
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -45,6 +53,7 @@
 #include "address.h"
 #include "bacdevobjpropref.h"
 #include "trendlog.h"
+#include "hashtab.h"
 #if defined(BACFILE)
 #include "bacfile.h"    /* object list dependency */
 #endif
@@ -57,8 +66,62 @@
 #endif
 unsigned max_trend_logs_int = 0;
 
-TL_DATA_REC Logs[MAX_TREND_LOGS][TL_MAX_ENTRIES];
-static TREND_LOG_DESCR TL_Descr[MAX_TREND_LOGS];
+/* The log buffers all come out of a pool of this many bytes */
+#ifndef TL_POOL_SIZE
+#define TL_POOL_SIZE (16UL * 1024UL * 1024UL)
+#endif
+/* Bytes of the pool taken by the Buffer_Size of the logs */
+static size_t TL_Pool_Used;
+
+/* One for each configured log */
+static TREND_LOG_DESCR *TL_Descr;
+
+/* The logs waiting for their next reading, in seconds */
+static BACNET_DEADLINE_QUEUE TL_Timers;
+/* The clock, read once for each tick of the timer */
+static struct timespec TL_Tick_Time;
+/* A reading later than ever, and by more than this, is reported */
+#ifndef TL_JITTER_REPORT_MS
+#define TL_JITTER_REPORT_MS 1000
+#endif
+static void TL_Schedule(
+    int i,
+    time_t tNow);
+static void TL_Timer_Expired(
+    BACNET_DEADLINE * deadline);
+
+/* A log with an archive keeps its buffer in a file mapped into memory.
+ * The file starts with two copies of the header, one in each half of the
+ * first page, written alternately so that one is always whole. The one
+ * with the later generation holds. The records follow, in the same ring
+ * as a buffer in memory. The records are synced to the file before the
+ * header that counts them, and the header leaves out the oldest records
+ * that may be written over before the next one, so a restart picks up
+ * every record that was committed. A header is written every
+ * TL_ARCHIVE_SYNC_RECORDS records, or TL_ARCHIVE_SYNC_SECONDS after the
+ * last one, to keep down the number of syncs. */
+#define TL_ARCHIVE_MAGIC 0x544C4F47     /* "TLOG" */
+#define TL_ARCHIVE_VERSION 1
+#define TL_ARCHIVE_HEADER_SIZE 4096
+#ifndef TL_ARCHIVE_SYNC_RECORDS
+#define TL_ARCHIVE_SYNC_RECORDS 32
+#endif
+#ifndef TL_ARCHIVE_SYNC_SECONDS
+#define TL_ARCHIVE_SYNC_SECONDS 300
+#endif
+
+typedef struct tl_archive_header {
+    uint32_t ulMagic;
+    uint16_t usVersion;
+    uint16_t usRecordSize;      /* sizeof(TL_LOG_REC) */
+    uint32_t ulGeneration;
+    uint32_t ulBufferSize;
+    int64_t llBase;     /* tBase */
+    uint32_t ulIndex;   /* iIndex */
+    uint32_t ulRecordCount;
+    uint32_t ulTotalRecordCount;
+    uint32_t ulCheck;   /* FNV-1a of the fields above */
+} TL_ARCHIVE_HEADER;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 static const int Trend_Log_Properties_Required[] = {
@@ -169,10 +232,18 @@ void Trend_Log_Init(
     int uciobject_instance;
     int uciinterval;
     int uciinterval_default;
+    int ucibuffer_size;
+    int ucibuffer_size_default;
+    size_t left;
+    const char *uciarchive;
+    const char *uciarchive_default;
+    char archive[256];
+    unsigned count;
     char i_instance_string[64];
 #if 0
     struct tm TempTime;
     time_t tClock;
+    TL_DATA_REC TempRec;
 #endif
     const char *sec = "bacnet_tl";
 
@@ -208,11 +279,26 @@ void Trend_Log_Init(
             "default", "device_type", OBJECT_DEVICE);
         uciobject_type_default = ucix_get_option_int(ctx, sec,
             "default", "object_type", 255);
+        ucibuffer_size_default = ucix_get_option_int(ctx, sec,
+            "default", "buffer_size", TL_MAX_ENTRIES);
+        uciarchive_default = ucix_get_option(ctx, sec, "default",
+            "archive");
+
+        /* only as many logs as are configured */
+        count = 0;
+        for (cur = itr_m.list; cur && (count < MAX_TREND_LOGS);
+            cur = cur->next) {
+            count++;
+        }
+        TL_Descr = calloc(count, sizeof(TREND_LOG_DESCR));
+        if (!TL_Descr) {
+            count = 0;
+        }
 
         /* initialize all the values */
 
         i = 0;
-		for( cur = itr_m.list; cur; cur = cur->next ) {
+		for( cur = itr_m.list; cur && (i < count); cur = cur->next ) {
             /*
              * Do we need to do anything here?
              * Trend logs are usually assumed to survive over resets
@@ -293,6 +379,35 @@ void Trend_Log_Init(
                     sizeof(TL_Descr[i].Object_Description), description);
                 uciinterval = ucix_get_option_int(ctx, sec,
                     idx_c, "interval", uciinterval_default);
+                ucibuffer_size = ucix_get_option_int(ctx, sec,
+                    idx_c, "buffer_size", ucibuffer_size_default);
+                uciarchive = ucix_get_option(ctx, sec, idx_c, "archive");
+                if (uciarchive == 0)
+                    uciarchive = uciarchive_default;
+                if ((uciarchive != 0) && (ucibuffer_size > 0)) {
+                    /* The archive is a file for each log in the directory */
+                    snprintf(archive, sizeof(archive), "%s/tl%s.log",
+                        uciarchive, idx_c);
+                    if (TL_Archive_Open(i, archive, ucibuffer_size) &&
+                        (TL_Descr[i].ulRecordCount != 0)) {
+                        /* Readings were missed while we were down */
+                        TL_Insert_Status_Rec(i,
+                            LOG_STATUS_LOG_INTERRUPTED, true);
+                    }
+                }
+                if (TL_Descr[i].pArchive) {
+                    /* Not taken from the pool */
+                } else if ((ucibuffer_size <= 0) ||
+                    !TL_Buffer_Size_Set(i, ucibuffer_size)) {
+                    /* the default size, or what is left of the pool */
+                    left = (TL_POOL_SIZE - TL_Pool_Used) / sizeof(TL_LOG_REC);
+                    TL_Buffer_Size_Set(i,
+                        (left < TL_MAX_ENTRIES) ? left : TL_MAX_ENTRIES);
+#if PRINT_ENABLED
+                    fprintf(stderr, "TL%u: Buffer_Size %lu\n", i,
+                        (unsigned long) TL_Descr[i].ulBufferSize);
+#endif
+                }
 
 #if 0
                 /* We will just fill the logs with some entries for testing
@@ -306,15 +421,16 @@ void Trend_Log_Init(
                 TempTime.tm_sec = 0;
                 tClock = mktime(&TempTime);
                 for (iEntry = 0; iEntry < TL_INIT_ENTRIES; iEntry++) {
-                    Logs[i][iEntry].tTimeStamp = tClock;
-                    Logs[i][iEntry].ucRecType = TL_TYPE_REAL;
-                    Logs[i][iEntry].Datum.fReal = 0;
+                    TempRec.tTimeStamp = tClock;
+                    TempRec.ucRecType = TL_TYPE_REAL;
+                    TempRec.Datum.fReal = 0;
                     //    (float) (iEntry + (i * TL_MAX_ENTRIES));
                     /* Put status flags with every second log */
                     if ((i & 1) == 0)
-                        Logs[i][iEntry].ucStatus = 128;
+                        TempRec.ucStatus = 128;
                     else
-                        Logs[i][iEntry].ucStatus = 0;
+                        TempRec.ucStatus = 0;
+                    TL_Buffer_Put(i, &TempRec);
                     tClock += 900;  /* advance 15 minutes */
                 }
                 TL_Descr[i].tLastDataTime = tClock - 900;
@@ -327,10 +443,7 @@ void Trend_Log_Init(
                 TL_Descr[i].Source.arrayIndex = 0;
 //                TL_Descr[i].ucTimeFlags = 0;
                 TL_Descr[i].ulIntervalOffset = 0;
-                TL_Descr[i].iIndex = 0;
                 TL_Descr[i].ulLogInterval = uciinterval;
-                TL_Descr[i].ulRecordCount = TL_INIT_ENTRIES;
-                TL_Descr[i].ulTotalRecordCount = TL_INIT_ENTRIES;
 
                 TL_Descr[i].Source.deviceIndentifier.instance =
                     Device_Object_Instance_Number();
@@ -343,6 +456,9 @@ void Trend_Log_Init(
                 datetime_set_values(&TL_Descr[i].StartTime, 2000, 1, 1, 0, 0, 0,
                     0);
                 TL_Descr[i].ucTimeFlags |= TL_T_STOP_WILD;
+                deadline_init(&TL_Descr[i].Timer, TL_Timer_Expired,
+                    &TL_Descr[i]);
+                TL_Schedule(i, time(NULL));
                 i++;
                 max_trend_logs_int = i;
             }
@@ -383,6 +499,8 @@ uint32_t Trend_Log_Index_To_Instance(
 {
     TREND_LOG_DESCR *CurrentTL;
     uint32_t instance;
+	if (index >= max_trend_logs_int)
+		return BACNET_MAX_INSTANCE;
 	CurrentTL = &TL_Descr[index];
 	instance = CurrentTL->Instance;
 	return instance;
@@ -404,7 +522,7 @@ bool Trend_Log_Valid_Instance(
 {
     TREND_LOG_DESCR *CurrentTL;
     unsigned index = 0; /* offset from instance lookup */
-    index = Trend_Log_Index_To_Instance(object_instance);
+    index = Trend_Log_Instance_To_Index(object_instance);
     if (index == MAX_TREND_LOGS) {
 #if PRINT_ENABLED
         fprintf(stderr, "Trend_Log_Valid_Instance %i invalid\n",object_instance);
@@ -559,10 +677,12 @@ static bool Trend_Log_Object_Name_Write(
         if (length <= sizeof(CurrentTL->Object_Name)) {
             encoding = characterstring_encoding(char_string);
             if (encoding == CHARACTER_UTF8) {
+                Device_Object_Name_Remove(OBJECT_TRENDLOG, object_instance);
                 status = characterstring_ansi_copy(
                     CurrentTL->Object_Name,
                     sizeof(CurrentTL->Object_Name),
                     char_string);
+                Device_Object_Name_Add(OBJECT_TRENDLOG, object_instance);
                 if (!status) {
                     *error_class = ERROR_CLASS_PROPERTY;
                     *error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
@@ -658,7 +778,9 @@ int Trend_Log_Read_Property(
             break;
 
         case PROP_BUFFER_SIZE:
-            apdu_len = encode_application_unsigned(&apdu[0], TL_MAX_ENTRIES);
+            apdu_len =
+                encode_application_unsigned(&apdu[0],
+                CurrentTL->ulBufferSize);
             break;
 
         case PROP_LOG_BUFFER:
@@ -873,7 +995,7 @@ bool Trend_Log_Write_Property(
                 /* Section 12.25.5 can't enable a full log with stop when full set */
                 if ((CurrentTL->bEnable == false) &&
                     (CurrentTL->bStopWhenFull == true) &&
-                    (CurrentTL->ulRecordCount == TL_MAX_ENTRIES) &&
+                    (CurrentTL->ulRecordCount == CurrentTL->ulBufferSize) &&
                     (value.type.Boolean == true)) {
                     status = false;
                     wp_data->error_class = ERROR_CLASS_OBJECT;
@@ -916,7 +1038,7 @@ bool Trend_Log_Write_Property(
                     CurrentTL->bStopWhenFull = value.type.Boolean;
 
                     if ((value.type.Boolean == true) &&
-                        (CurrentTL->ulRecordCount == TL_MAX_ENTRIES) &&
+                        (CurrentTL->ulRecordCount == CurrentTL->ulBufferSize) &&
                         (CurrentTL->bEnable == true)) {
 
                         /* When full log is switched from normal to stop when full
@@ -931,12 +1053,38 @@ bool Trend_Log_Write_Property(
             break;
 
         case PROP_BUFFER_SIZE:
-            /* Fixed size buffer so deny write. If buffer size was writable
-             * we would probably erase the current log, resize, re-initalise
-             * and carry on - however write is not allowed if enable is true.
+            /* Erase the current log, resize and carry on - however
+             * write is not allowed if enable is true.
              */
-            wp_data->error_class = ERROR_CLASS_PROPERTY;
-            wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+            if (CurrentTL->bEnable) {
+                wp_data->error_class = ERROR_CLASS_PROPERTY;
+                wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+                break;
+            }
+            status =
+                WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+            if (status && (value.type.Unsigned_Int != CurrentTL->ulBufferSize)) {
+                if (value.type.Unsigned_Int == 0) {
+                    status = false;
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+                } else if (!TL_Buffer_Size_Set(index,
+                        value.type.Unsigned_Int)) {
+                    /* more than is left in the pool */
+                    status = false;
+                    wp_data->error_class = ERROR_CLASS_RESOURCES;
+                    wp_data->error_code =
+                        ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY;
+                } else {
+                    TL_Insert_Status_Rec(index, LOG_STATUS_BUFFER_PURGED,
+                        true);
+                    if (ctx) {
+                        ucix_add_option_int(ctx, "bacnet_tl", idx_c,
+                            "buffer_size", CurrentTL->ulBufferSize);
+                    }
+                }
+            }
             break;
 
         case PROP_RECORD_COUNT:
@@ -1261,6 +1409,11 @@ bool Trend_Log_Write_Property(
             wp_data->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
             break;
     }
+    if (status) {
+        /* The interval, alignment, logging type or trigger may have
+         * changed when the log is next due */
+        TL_Schedule(index, time(NULL));
+    }
 
     if(ctx) {
         ucix_commit(ctx, "bacnet_tl");
@@ -1291,238 +1444,815 @@ bool TrendLogGetRRInfo(
 }
 
 /*****************************************************************************
- * Insert a status record into a trend log - does not check for enable/log   *
- * full, time slots and so on as these type of entries have to go in         *
- * irrespective of such things which means that valid readings may get       *
- * pushed out of the log to make room.                                       *
+ * FNV-1a hash of an archive header, up to the check field.                  *
  *****************************************************************************/
 
-void TL_Insert_Status_Rec(
-    int i,
-    BACNET_LOG_STATUS eStatus,
-    bool bState)
+static uint32_t TL_Archive_Check(
+    const TL_ARCHIVE_HEADER * pHeader)
 {
-    TREND_LOG_DESCR *CurrentTL;
-    TL_DATA_REC TempRec;
-
-    CurrentTL = &TL_Descr[i];
+    return fnv1a32(pHeader, offsetof(TL_ARCHIVE_HEADER, ulCheck),
+        FNV1A32_SEED);
+}
 
-    TempRec.tTimeStamp = time(NULL);
-    TempRec.ucRecType = TL_TYPE_STATUS;
-    TempRec.ucStatus = 0;
-    TempRec.Datum.ucLogStatus = 0;
-    /* Note we set the bits in correct order so that we can place them directly
-     * into the bitstring structure later on when we have to encode them */
-    switch (eStatus) {
-        case LOG_STATUS_LOG_DISABLED:
-            if (bState)
-                TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_LOG_DISABLED;
-            break;
-        case LOG_STATUS_BUFFER_PURGED:
-            if (bState)
-                TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_BUFFER_PURGED;
-            break;
-        case LOG_STATUS_LOG_INTERRUPTED:
-            TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_LOG_INTERRUPTED;
-            break;
-        default:
-            break;
-    }
+/*****************************************************************************
+ * How many records go into the archive of a log between its headers - at    *
+ * most a quarter of the buffer, as the header leaves that many out.         *
+ *****************************************************************************/
 
-    Logs[i][CurrentTL->iIndex++] = TempRec;
-    if (CurrentTL->iIndex >= TL_MAX_ENTRIES)
-        CurrentTL->iIndex = 0;
+static uint32_t TL_Archive_Batch(
+    TREND_LOG_DESCR * CurrentTL)
+{
+    uint32_t ulBatch = CurrentTL->ulBufferSize / 4;
 
-    CurrentTL->ulTotalRecordCount++;
+    if (ulBatch > TL_ARCHIVE_SYNC_RECORDS)
+        ulBatch = TL_ARCHIVE_SYNC_RECORDS;
 
-    if (CurrentTL->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentTL->ulRecordCount++;
+    return (ulBatch != 0) ? ulBatch : 1;
 }
 
 /*****************************************************************************
- * Use the combination of the enable flag and the enable times to determine  *
- * if the log is really enabled now. See 135-2008 sections 12.25.5 - 12.25.7 *
+ * Write part of the mapping of an archive out to its file and wait for it.  *
  *****************************************************************************/
 
-bool TL_Is_Enabled(
-    int i)
+static void TL_Archive_Sync(
+    TREND_LOG_DESCR * CurrentTL,
+    size_t ulOffset,
+    size_t ulLength)
 {
-    TREND_LOG_DESCR *CurrentTL;
-    time_t tNow;
-    bool bStatus;
+    size_t ulPage = (size_t) sysconf(_SC_PAGESIZE);
+    size_t ulStart = ulOffset - (ulOffset % ulPage);
 
-    bStatus = true;
-    CurrentTL = &TL_Descr[i];
-    if (CurrentTL->bEnable == false) {
-        /* Not enabled so time is irrelevant */
-        bStatus = false;
-    } else if ((CurrentTL->ucTimeFlags == 0) &&
-        (CurrentTL->tStopTime < CurrentTL->tStartTime)) {
-        /* Start time was after stop time as per 12.25.6 and 12.25.7 */
-        bStatus = false;
-    } else if (CurrentTL->ucTimeFlags != (TL_T_START_WILD | TL_T_STOP_WILD)) {
-        /* enabled and either 1 wild card or none */
-        tNow = time(NULL);
-        if ((CurrentTL->ucTimeFlags & TL_T_START_WILD) != 0) {
-            /* wild card start time */
-            if (tNow > CurrentTL->tStopTime) {
-                bStatus = false;
-            }
-        } else if ((CurrentTL->ucTimeFlags & TL_T_STOP_WILD) != 0) {
-            /* wild card stop time */
-            if (tNow < CurrentTL->tStartTime) {
-                bStatus = false;
-            }
-        } else {
-            /* No wildcards so use both times */
-            if ((tNow < CurrentTL->tStartTime) ||
-                (tNow > CurrentTL->tStopTime)) {
-                bStatus = false;
-                }
+    (void) msync(CurrentTL->pArchive + ulStart, (ulOffset - ulStart) +
+        ulLength, MS_SYNC);
+}
+
+/*****************************************************************************
+ * Sync the records put in the buffer of a log since the last header, then   *
+ * write the state of the buffer to the older of the two headers of its      *
+ * archive and sync that, if it has one. The header leaves out the oldest    *
+ * records that ulRoom records put in after it would write over.             *
+ *****************************************************************************/
+
+static void TL_Archive_Commit(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulRoom)
+{
+    TL_ARCHIVE_HEADER Header;
+    uint32_t ulDirty;
+    uint32_t ulSlot;
+
+    if (CurrentTL->pArchive == NULL)
+        return;
+
+    ulDirty = CurrentTL->ulArchiveDirty;
+    if (ulDirty > CurrentTL->ulBufferSize)
+        ulDirty = CurrentTL->ulBufferSize;
+    if (ulDirty != 0) {
+        ulSlot = (CurrentTL->iIndex + (CurrentTL->ulBufferSize - ulDirty)) %
+            CurrentTL->ulBufferSize;
+        if ((ulSlot + ulDirty) > CurrentTL->ulBufferSize) {
+            /* the part that wrapped round to the start */
+            TL_Archive_Sync(CurrentTL, TL_ARCHIVE_HEADER_SIZE,
+                (ulSlot + ulDirty - CurrentTL->ulBufferSize) *
+                sizeof(TL_LOG_REC));
+            ulDirty = CurrentTL->ulBufferSize - ulSlot;
         }
+        TL_Archive_Sync(CurrentTL, TL_ARCHIVE_HEADER_SIZE +
+            (ulSlot * sizeof(TL_LOG_REC)), ulDirty * sizeof(TL_LOG_REC));
     }
+    CurrentTL->ulArchiveDirty = 0;
+
+    memset(&Header, 0, sizeof(Header));
+    Header.ulMagic = TL_ARCHIVE_MAGIC;
+    Header.usVersion = TL_ARCHIVE_VERSION;
+    Header.usRecordSize = sizeof(TL_LOG_REC);
+    Header.ulGeneration = ++CurrentTL->ulArchiveGeneration;
+    Header.ulBufferSize = CurrentTL->ulBufferSize;
+    Header.llBase = CurrentTL->tBase;
+    Header.ulIndex = CurrentTL->iIndex;
+    Header.ulRecordCount = CurrentTL->ulRecordCount;
+    if (Header.ulRecordCount > (CurrentTL->ulBufferSize - ulRoom))
+        Header.ulRecordCount = CurrentTL->ulBufferSize - ulRoom;
+    Header.ulTotalRecordCount = CurrentTL->ulTotalRecordCount;
+    Header.ulCheck = TL_Archive_Check(&Header);
+    memcpy(CurrentTL->pArchive +
+        ((Header.ulGeneration & 1) * (TL_ARCHIVE_HEADER_SIZE / 2)), &Header,
+        sizeof(Header));
+    TL_Archive_Sync(CurrentTL, 0, TL_ARCHIVE_HEADER_SIZE);
+}
 
-    return (bStatus);
+/*****************************************************************************
+ * Unmap and close the archive of a log, leaving it with no buffer.          *
+ *****************************************************************************/
+
+static void TL_Archive_Close(
+    TREND_LOG_DESCR * CurrentTL)
+{
+    if (CurrentTL->pArchive) {
+        /* nothing goes in after this header, so it counts every record */
+        TL_Archive_Commit(CurrentTL, 0);
+        munmap(CurrentTL->pArchive, CurrentTL->ulArchiveSize);
+        close(CurrentTL->iArchiveFd);
+    }
+    CurrentTL->pArchive = NULL;
+    CurrentTL->ulArchiveSize = 0;
+    CurrentTL->pBuffer = NULL;
+    CurrentTL->ulBufferSize = 0;
+    CurrentTL->ulRecordCount = 0;
+    CurrentTL->iIndex = 0;
 }
 
 /*****************************************************************************
- * Convert a BACnet time into a local time in seconds since the local epoch  *
+ * Size the archive file of a log for a buffer of records and map it in. If  *
+ * that fails the archive is closed, leaving the log without a buffer.       *
  *****************************************************************************/
 
-time_t TL_BAC_Time_To_Local(
-    BACNET_DATE_TIME * SourceTime)
+static bool TL_Archive_Map(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulBufferSize)
 {
-    struct tm LocalTime;
-    int iTemp;
+    size_t ulSize;
+    void *pMap;
 
-    LocalTime.tm_year = SourceTime->date.year - 1900;   /* We store BACnet year in full format */
-    /* Some clients send a date of all 0s to indicate start of epoch
-     * even though this is not a valid date. Pick this up here and
-     * correct the day and month for the local time functions.
-     */
-    iTemp =
-        SourceTime->date.year + SourceTime->date.month + SourceTime->date.day;
-    if (iTemp == 1900) {
-        LocalTime.tm_mon = 0;
-        LocalTime.tm_mday = 1;
-    } else {
-        LocalTime.tm_mon = SourceTime->date.month - 1;
-        LocalTime.tm_mday = SourceTime->date.day;
+    if (CurrentTL->pArchive) {
+        munmap(CurrentTL->pArchive, CurrentTL->ulArchiveSize);
+        CurrentTL->pArchive = NULL;
+        CurrentTL->pBuffer = NULL;
+    }
+    pMap = MAP_FAILED;
+    if (ulBufferSize <= ((SIZE_MAX - TL_ARCHIVE_HEADER_SIZE) /
+            sizeof(TL_LOG_REC))) {
+        ulSize = TL_ARCHIVE_HEADER_SIZE + (ulBufferSize * sizeof(TL_LOG_REC));
+        if (ftruncate(CurrentTL->iArchiveFd, ulSize) == 0) {
+            pMap =
+                mmap(NULL, ulSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                CurrentTL->iArchiveFd, 0);
+        }
+    }
+    if (pMap == MAP_FAILED) {
+        close(CurrentTL->iArchiveFd);
+        TL_Archive_Close(CurrentTL);
+        return false;
     }
 
-    LocalTime.tm_hour = SourceTime->time.hour;
-    LocalTime.tm_min = SourceTime->time.min;
-    LocalTime.tm_sec = SourceTime->time.sec;
+    CurrentTL->pArchive = pMap;
+    CurrentTL->ulArchiveSize = ulSize;
+    CurrentTL->pBuffer =
+        (TL_LOG_REC *) (CurrentTL->pArchive + TL_ARCHIVE_HEADER_SIZE);
 
-    return (mktime(&LocalTime));
+    return true;
 }
 
 /*****************************************************************************
- * Convert a local time in seconds since the local epoch into a BACnet time  *
+ * The later of the two headers of an archive that checks out for a buffer   *
+ * of the given size, or NULL if neither does.                               *
  *****************************************************************************/
 
-void TL_Local_Time_To_BAC(
-    BACNET_DATE_TIME * DestTime,
-    time_t SourceTime)
+static const TL_ARCHIVE_HEADER *TL_Archive_Header(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulBufferSize)
 {
-    struct tm *TempTime;
-
-    TempTime = localtime(&SourceTime);
+    const TL_ARCHIVE_HEADER *pHeader = NULL;
+    TL_ARCHIVE_HEADER Header;
+    unsigned iCopy;
+
+    for (iCopy = 0; iCopy < 2; iCopy++) {
+        memcpy(&Header,
+            CurrentTL->pArchive + (iCopy * (TL_ARCHIVE_HEADER_SIZE / 2)),
+            sizeof(Header));
+        if ((Header.ulMagic != TL_ARCHIVE_MAGIC) ||
+            (Header.usVersion != TL_ARCHIVE_VERSION) ||
+            (Header.usRecordSize != sizeof(TL_LOG_REC)) ||
+            (Header.ulBufferSize != ulBufferSize) ||
+            (Header.ulIndex >= ulBufferSize) ||
+            (Header.ulRecordCount > ulBufferSize) ||
+            (Header.ulCheck != TL_Archive_Check(&Header)))
+            continue;
+        if ((pHeader == NULL) ||
+            ((int32_t) (Header.ulGeneration - pHeader->ulGeneration) > 0)) {
+            pHeader = (const TL_ARCHIVE_HEADER *) (CurrentTL->pArchive +
+                (iCopy * (TL_ARCHIVE_HEADER_SIZE / 2)));
+        }
+    }
 
-    DestTime->date.year = (uint16_t) (TempTime->tm_year + 1900);
-    DestTime->date.month = (uint8_t) (TempTime->tm_mon + 1);
-    DestTime->date.day = (uint8_t) TempTime->tm_mday;
-    /* BACnet is 1 to 7 = Monday to Sunday
-     * Windows is days from Sunday 0 - 6 so we
-     * have to adjust */
-    if (TempTime->tm_wday == 0)
-        DestTime->date.wday = 7;
-    else
-        DestTime->date.wday = (uint8_t) TempTime->tm_wday;
-    DestTime->time.hour = (uint8_t) TempTime->tm_hour;
-    DestTime->time.min = (uint8_t) TempTime->tm_min;
-    DestTime->time.sec = (uint8_t) TempTime->tm_sec;
-    DestTime->time.hundredths = 0;
+    return pHeader;
 }
 
-/****************************************************************************
- * Build a list of Trend Log entries from the Log Buffer property as        *
- * required for the ReadsRange functionality.                               *
- *                                                                          *
- * We have to support By Position, By Sequence and By Time requests.        *
- *                                                                          *
- * We do assume the list cannot change whilst we are accessing it so would  *
- * not be multithread safe if there are other tasks that write to the log.  *
- *                                                                          *
- * We take the simple approach here to filling the buffer by taking a max   *
- * size for a single entry and then stopping if there is less than that     *
- * left in the buffer. You could build each entry in a seperate buffer and  *
- * determine the exact length before copying but this is time consuming,    *
- * requires more memory and would probably only let you sqeeeze one more    *
- * entry in on occasion. The value is calculated as 10 bytes for the time   *
- * stamp + 6 bytes for our largest data item (bit string capped at 32 bits) *
- * + 3 bytes for the status flags + 4 for the context tags to give 23.      *
- ****************************************************************************/
-
-#define TL_MAX_ENC 23   /* Maximum size of encoded log entry, see above */
+/*****************************************************************************
+ * True if neither header of an archive was ever written, as when it was     *
+ * sized but the first header did not make it to the file.                   *
+ *****************************************************************************/
 
-int rr_trend_log_encode(
-    uint8_t * apdu,
-    BACNET_READ_RANGE_DATA * pRequest)
+static bool TL_Archive_Blank(
+    TREND_LOG_DESCR * CurrentTL)
 {
-    unsigned index = 0;
-    /* Initialise result flags to all false */
-    bitstring_init(&pRequest->ResultFlags);
-    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_FIRST_ITEM, false);
-    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_LAST_ITEM, false);
-    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
-    pRequest->ItemCount = 0;    /* Start out with nothing */
+    size_t i;
 
-    /* Bail out now if nowt - should never happen for a Trend Log but ... */
-    if (Trend_Log_Valid_Instance(pRequest->object_instance)) {
-        index = Trend_Log_Instance_To_Index(pRequest->object_instance);
-        if (TL_Descr[index].ulRecordCount == 0)
-            return (0);
+    for (i = 0; i < TL_ARCHIVE_HEADER_SIZE; i++) {
+        if (CurrentTL->pArchive[i] != 0)
+            return false;
     }
 
-    if ((pRequest->RequestType == RR_BY_POSITION) ||
-        (pRequest->RequestType == RR_READ_ALL)) {
-        return (TL_encode_by_position(apdu, pRequest));
-    } else if (pRequest->RequestType == RR_BY_SEQUENCE) {
-        return (TL_encode_by_sequence(apdu, pRequest));
-    }
+    return true;
+}
 
-    return (TL_encode_by_time(apdu, pRequest));
+/*****************************************************************************
+ * Move the archive of a log to a buffer of another size, keeping as many of *
+ * the latest records as fit. Returns false, leaving the archive closed, if  *
+ * that cannot be done.                                                      *
+ *****************************************************************************/
+
+static bool TL_Archive_Resize(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulBufferSize)
+{
+    TL_LOG_REC *pKeep = NULL;
+    uint32_t ulKeep;
+    uint32_t ulSlot;
+    uint32_t ulEntry;
+
+    ulKeep = CurrentTL->ulRecordCount;
+    if (ulKeep > ulBufferSize)
+        ulKeep = ulBufferSize;
+    if (ulKeep != 0) {
+        pKeep = malloc(ulKeep * sizeof(TL_LOG_REC));
+        if (pKeep == NULL) {
+            TL_Archive_Close(CurrentTL);
+            return false;
+        }
+        /* the oldest of those kept, counting back from the insertion point */
+        ulSlot = (CurrentTL->iIndex + (CurrentTL->ulBufferSize - ulKeep)) %
+            CurrentTL->ulBufferSize;
+        for (ulEntry = 0; ulEntry < ulKeep; ulEntry++) {
+            pKeep[ulEntry] = CurrentTL->pBuffer[ulSlot++];
+            if (ulSlot >= CurrentTL->ulBufferSize)
+                ulSlot = 0;
+        }
+    }
+    if (!TL_Archive_Map(CurrentTL, ulBufferSize)) {
+        free(pKeep);
+        return false;
+    }
+    if (ulKeep != 0)
+        memcpy(CurrentTL->pBuffer, pKeep, ulKeep * sizeof(TL_LOG_REC));
+    free(pKeep);
+    CurrentTL->ulBufferSize = ulBufferSize;
+    CurrentTL->ulRecordCount = ulKeep;
+    CurrentTL->iIndex = ulKeep % ulBufferSize;
+    CurrentTL->ulArchiveDirty = ulKeep;
+
+    return true;
 }
 
-/****************************************************************************
- * Handle encoding for the By Position and All options.                     *
- * Does All option by converting to a By Position request starting at index *
- * 1 and of maximum log size length.                                        *
- ****************************************************************************/
+/*****************************************************************************
+ * Keep the buffer of a log in an archive file. If the file holds a buffer   *
+ * the log carries on from it, keeping as many of the latest records as fit  *
+ * when it is of another size. Only the headers are read, the records are    *
+ * used where they are. For a log that has no buffer yet. Returns false if   *
+ * the file cannot be used, leaving a file that does not check out as it is. *
+ *****************************************************************************/
 
-int TL_encode_by_position(
-    uint8_t * apdu,
-    BACNET_READ_RANGE_DATA * pRequest)
+bool TL_Archive_Open(
+    int i,
+    const char *pPath,
+    uint32_t ulBufferSize)
 {
-    unsigned index = 0;
-    int iLen = 0;
-    int32_t iTemp = 0;
-    TREND_LOG_DESCR *CurrentTL = NULL;
+    TREND_LOG_DESCR *CurrentTL;
+    const TL_ARCHIVE_HEADER *pHeader = NULL;
+    struct stat Stat;
+    uint32_t ulFileSize = 0;
+    int fd;
 
-    uint32_t uiIndex = 0;       /* Current entry number */
-    uint32_t uiFirst = 0;       /* Entry number we started encoding from */
-    uint32_t uiLast = 0;        /* Entry number we finished encoding on */
-    uint32_t uiTarget = 0;      /* Last entry we are required to encode */
-    uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
+    CurrentTL = &TL_Descr[i];
+    if (ulBufferSize == 0)
+        return false;
 
-    if (!Trend_Log_Valid_Instance(pRequest->object_instance))
-            return (iLen);
-    /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
-    index = Trend_Log_Instance_To_Index(pRequest->object_instance);
-    CurrentTL = &TL_Descr[index];
-    if (pRequest->RequestType == RR_READ_ALL) {
+    fd = open(pPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+#if PRINT_ENABLED
+        fprintf(stderr, "TL%d: archive %s: %s\n", i, pPath, strerror(errno));
+#endif
+        return false;
+    }
+    if (fstat(fd, &Stat) < 0) {
+        close(fd);
+        return false;
+    }
+    CurrentTL->iArchiveFd = fd;
+    CurrentTL->ulArchiveGeneration = 0;
+    CurrentTL->ulArchiveDirty = 0;
+    CurrentTL->tArchiveSync = 0;
+    CurrentTL->iIndex = 0;
+    CurrentTL->ulRecordCount = 0;
+    if (Stat.st_size == 0) {
+        /* A new archive */
+        if (!TL_Archive_Map(CurrentTL, ulBufferSize))
+            return false;
+        CurrentTL->ulBufferSize = ulBufferSize;
+        TL_Archive_Commit(CurrentTL, TL_Archive_Batch(CurrentTL));
+        return true;
+    }
+
+    /* The size of the buffer the file holds */
+    if ((Stat.st_size > TL_ARCHIVE_HEADER_SIZE) &&
+        (((Stat.st_size - TL_ARCHIVE_HEADER_SIZE) % sizeof(TL_LOG_REC)) ==
+            0) &&
+        (((Stat.st_size - TL_ARCHIVE_HEADER_SIZE) / sizeof(TL_LOG_REC)) <=
+            UINT32_MAX)) {
+        ulFileSize = (uint32_t) ((Stat.st_size - TL_ARCHIVE_HEADER_SIZE) /
+            sizeof(TL_LOG_REC));
+    }
+    if (ulFileSize == 0) {
+        close(fd);
+    } else if (TL_Archive_Map(CurrentTL, ulFileSize)) {
+        pHeader = TL_Archive_Header(CurrentTL, ulFileSize);
+        if ((pHeader == NULL) && !TL_Archive_Blank(CurrentTL)) {
+            TL_Archive_Close(CurrentTL);
+        }
+    }
+    if (CurrentTL->pArchive == NULL) {
+        /* Someone has to look at it before it can be used again */
+#if PRINT_ENABLED
+        fprintf(stderr, "TL%d: archive %s does not check out, not used\n", i,
+            pPath);
+#endif
+        return false;
+    }
+
+    CurrentTL->ulBufferSize = ulFileSize;
+    if (pHeader) {
+        CurrentTL->ulArchiveGeneration = pHeader->ulGeneration;
+        CurrentTL->tBase = (time_t) pHeader->llBase;
+        CurrentTL->iIndex = pHeader->ulIndex;
+        CurrentTL->ulRecordCount = pHeader->ulRecordCount;
+        CurrentTL->ulTotalRecordCount = pHeader->ulTotalRecordCount;
+    }
+    if ((ulFileSize != ulBufferSize) &&
+        !TL_Archive_Resize(CurrentTL, ulBufferSize)) {
+#if PRINT_ENABLED
+        fprintf(stderr, "TL%d: archive %s cannot be resized, not used\n", i,
+            pPath);
+#endif
+        return false;
+    }
+    /* Before any record goes over the oldest that the header counts */
+    TL_Archive_Commit(CurrentTL, TL_Archive_Batch(CurrentTL));
+
+    return true;
+}
+
+/*****************************************************************************
+ * Resize the buffer of a log, which empties it. The buffer is taken from    *
+ * the pool the next time a record goes in. Fails if the pool is too small.  *
+ *****************************************************************************/
+
+bool TL_Buffer_Size_Set(
+    int i,
+    uint32_t ulBufferSize)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    size_t used;
+
+    CurrentTL = &TL_Descr[i];
+    if (ulBufferSize == 0)
+        return false;
+
+    if (CurrentTL->pArchive) {
+        /* On failure this carries on in memory without the archive */
+        TL_Archive_Map(CurrentTL, ulBufferSize);
+    }
+    if (CurrentTL->pArchive == NULL) {
+        used = TL_Pool_Used - (CurrentTL->ulBufferSize * sizeof(TL_LOG_REC));
+        if (ulBufferSize > ((TL_POOL_SIZE - used) / sizeof(TL_LOG_REC)))
+            return false;
+
+        TL_Pool_Used = used + (ulBufferSize * sizeof(TL_LOG_REC));
+        free(CurrentTL->pBuffer);
+        CurrentTL->pBuffer = NULL;
+    }
+    CurrentTL->ulBufferSize = ulBufferSize;
+    CurrentTL->ulRecordCount = 0;
+    CurrentTL->iIndex = 0;
+    CurrentTL->ulArchiveDirty = 0;
+    TL_Archive_Commit(CurrentTL, TL_Archive_Batch(CurrentTL));
+
+    return true;
+}
+
+/*****************************************************************************
+ * Where a record is in the buffer of a log, counting from 0 for the oldest. *
+ *****************************************************************************/
+
+static uint32_t TL_Buffer_Slot(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulEntry)
+{
+    /* The oldest record is the count back from the insertion point */
+    return (CurrentTL->iIndex + (CurrentTL->ulBufferSize -
+            CurrentTL->ulRecordCount) +
+        ulEntry) % CurrentTL->ulBufferSize;
+}
+
+static time_t TL_Buffer_Time(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulSlot)
+{
+    return CurrentTL->tBase + CurrentTL->pBuffer[ulSlot].lTime;
+}
+
+/*****************************************************************************
+ * Binary search of a log for the number of records, counting from the       *
+ * oldest, that are before the given time - or at it as well if bAfter is    *
+ * true. Records go in with the time they were taken so they are in order.   *
+ *****************************************************************************/
+
+static uint32_t TL_Buffer_Search(
+    TREND_LOG_DESCR * CurrentTL,
+    time_t tRefTime,
+    bool bAfter)
+{
+    uint32_t ulLow = 0;
+    uint32_t ulHigh = CurrentTL->ulRecordCount;
+    uint32_t ulMid = 0;
+    time_t tTime = 0;
+
+    while (ulLow < ulHigh) {
+        ulMid = ulLow + ((ulHigh - ulLow) / 2);
+        tTime = TL_Buffer_Time(CurrentTL, TL_Buffer_Slot(CurrentTL, ulMid));
+        if ((tTime < tRefTime) || (bAfter && (tTime == tRefTime)))
+            ulLow = ulMid + 1;
+        else
+            ulHigh = ulMid;
+    }
+
+    return ulLow;
+}
+
+/*****************************************************************************
+ * Unpack a record from the buffer of a log.                                 *
+ *****************************************************************************/
+
+static void TL_Buffer_Get(
+    TREND_LOG_DESCR * CurrentTL,
+    uint32_t ulSlot,
+    TL_DATA_REC * pRec)
+{
+    TL_LOG_REC *pSource;
+
+    pSource = &CurrentTL->pBuffer[ulSlot];
+    memset(&pRec->Datum, 0, sizeof(pRec->Datum));
+    pRec->tTimeStamp = CurrentTL->tBase + pSource->lTime;
+    pRec->ucRecType = pSource->ucRecType;
+    pRec->ucStatus = pSource->ucStatus;
+    switch (pSource->ucRecType) {
+        case TL_TYPE_STATUS:
+            pRec->Datum.ucLogStatus = pSource->Datum.ucValue;
+            break;
+        case TL_TYPE_BOOL:
+            pRec->Datum.ucBoolean = pSource->Datum.ucValue;
+            break;
+        case TL_TYPE_REAL:
+            pRec->Datum.fReal = pSource->Datum.fReal;
+            break;
+        case TL_TYPE_ENUM:
+            pRec->Datum.ulEnum = pSource->Datum.ulValue;
+            break;
+        case TL_TYPE_UNSIGN:
+            pRec->Datum.ulUValue = pSource->Datum.ulValue;
+            break;
+        case TL_TYPE_SIGN:
+            pRec->Datum.lSValue = pSource->Datum.lValue;
+            break;
+        case TL_TYPE_BITS:
+            pRec->Datum.Bits.ucLen = pSource->ucBitsLen;
+            memcpy(pRec->Datum.Bits.ucStore, pSource->Datum.ucStore,
+                sizeof(pRec->Datum.Bits.ucStore));
+            break;
+        case TL_TYPE_ERROR:
+            pRec->Datum.Error.usClass = pSource->Datum.usError[0];
+            pRec->Datum.Error.usCode = pSource->Datum.usError[1];
+            break;
+        case TL_TYPE_DELTA:
+            pRec->Datum.fTime = pSource->Datum.fReal;
+            break;
+        default:
+            break;
+    }
+}
+
+/*****************************************************************************
+ * Pack a record into the buffer of a log, taking the buffer from the pool   *
+ * if this is the first record since it was sized.                           *
+ *****************************************************************************/
+
+static void TL_Buffer_Put(
+    int i,
+    TL_DATA_REC * pRec)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    TL_LOG_REC *pDest;
+
+    CurrentTL = &TL_Descr[i];
+    if (CurrentTL->pBuffer == NULL) {
+        if (CurrentTL->ulBufferSize == 0)
+            return;
+        CurrentTL->pBuffer =
+            calloc(CurrentTL->ulBufferSize, sizeof(TL_LOG_REC));
+        if (CurrentTL->pBuffer == NULL)
+            return;
+    }
+    if (CurrentTL->ulRecordCount == 0) {
+        /* Record times are kept relative to the first one */
+        CurrentTL->tBase = pRec->tTimeStamp;
+    }
+
+    pDest = &CurrentTL->pBuffer[CurrentTL->iIndex++];
+    pDest->lTime = (int32_t) (pRec->tTimeStamp - CurrentTL->tBase);
+    pDest->ucRecType = pRec->ucRecType;
+    pDest->ucStatus = pRec->ucStatus;
+    pDest->ucBitsLen = 0;
+    pDest->Datum.ulValue = 0;
+    switch (pRec->ucRecType) {
+        case TL_TYPE_STATUS:
+            pDest->Datum.ucValue = pRec->Datum.ucLogStatus;
+            break;
+        case TL_TYPE_BOOL:
+            pDest->Datum.ucValue = pRec->Datum.ucBoolean;
+            break;
+        case TL_TYPE_REAL:
+            pDest->Datum.fReal = pRec->Datum.fReal;
+            break;
+        case TL_TYPE_ENUM:
+            pDest->Datum.ulValue = pRec->Datum.ulEnum;
+            break;
+        case TL_TYPE_UNSIGN:
+            pDest->Datum.ulValue = pRec->Datum.ulUValue;
+            break;
+        case TL_TYPE_SIGN:
+            pDest->Datum.lValue = pRec->Datum.lSValue;
+            break;
+        case TL_TYPE_BITS:
+            pDest->ucBitsLen = pRec->Datum.Bits.ucLen;
+            memcpy(pDest->Datum.ucStore, pRec->Datum.Bits.ucStore,
+                sizeof(pDest->Datum.ucStore));
+            break;
+        case TL_TYPE_ERROR:
+            pDest->Datum.usError[0] = pRec->Datum.Error.usClass;
+            pDest->Datum.usError[1] = pRec->Datum.Error.usCode;
+            break;
+        case TL_TYPE_DELTA:
+            pDest->Datum.fReal = pRec->Datum.fTime;
+            break;
+        default:
+            break;
+    }
+    if (CurrentTL->iIndex >= (int) CurrentTL->ulBufferSize)
+        CurrentTL->iIndex = 0;
+
+    CurrentTL->ulTotalRecordCount++;
+
+    if (CurrentTL->ulRecordCount < CurrentTL->ulBufferSize)
+        CurrentTL->ulRecordCount++;
+
+    if (CurrentTL->pArchive) {
+        /* The last header left room for a batch of records */
+        CurrentTL->ulArchiveDirty++;
+        if ((CurrentTL->ulArchiveDirty >= TL_Archive_Batch(CurrentTL)) ||
+            ((pRec->tTimeStamp - CurrentTL->tArchiveSync) >=
+                TL_ARCHIVE_SYNC_SECONDS)) {
+            CurrentTL->tArchiveSync = pRec->tTimeStamp;
+            TL_Archive_Commit(CurrentTL, TL_Archive_Batch(CurrentTL));
+        }
+    }
+}
+
+/*****************************************************************************
+ * Insert a status record into a trend log - does not check for enable/log   *
+ * full, time slots and so on as these type of entries have to go in         *
+ * irrespective of such things which means that valid readings may get       *
+ * pushed out of the log to make room.                                       *
+ *****************************************************************************/
+
+void TL_Insert_Status_Rec(
+    int i,
+    BACNET_LOG_STATUS eStatus,
+    bool bState)
+{
+    TL_DATA_REC TempRec;
+
+    TempRec.tTimeStamp = time(NULL);
+    TempRec.ucRecType = TL_TYPE_STATUS;
+    TempRec.ucStatus = 0;
+    TempRec.Datum.ucLogStatus = 0;
+    /* Note we set the bits in correct order so that we can place them directly
+     * into the bitstring structure later on when we have to encode them */
+    switch (eStatus) {
+        case LOG_STATUS_LOG_DISABLED:
+            if (bState)
+                TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_LOG_DISABLED;
+            break;
+        case LOG_STATUS_BUFFER_PURGED:
+            if (bState)
+                TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_BUFFER_PURGED;
+            break;
+        case LOG_STATUS_LOG_INTERRUPTED:
+            TempRec.Datum.ucLogStatus = 1 << LOG_STATUS_LOG_INTERRUPTED;
+            break;
+        default:
+            break;
+    }
+
+    TL_Buffer_Put(i, &TempRec);
+}
+
+/*****************************************************************************
+ * Use the combination of the enable flag and the enable times to determine  *
+ * if the log is really enabled now. See 135-2008 sections 12.25.5 - 12.25.7 *
+ *****************************************************************************/
+
+bool TL_Is_Enabled(
+    int i)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    time_t tNow;
+    bool bStatus;
+
+    bStatus = true;
+    CurrentTL = &TL_Descr[i];
+    if (CurrentTL->bEnable == false) {
+        /* Not enabled so time is irrelevant */
+        bStatus = false;
+    } else if ((CurrentTL->ucTimeFlags == 0) &&
+        (CurrentTL->tStopTime < CurrentTL->tStartTime)) {
+        /* Start time was after stop time as per 12.25.6 and 12.25.7 */
+        bStatus = false;
+    } else if (CurrentTL->ucTimeFlags != (TL_T_START_WILD | TL_T_STOP_WILD)) {
+        /* enabled and either 1 wild card or none */
+        tNow = time(NULL);
+        if ((CurrentTL->ucTimeFlags & TL_T_START_WILD) != 0) {
+            /* wild card start time */
+            if (tNow > CurrentTL->tStopTime) {
+                bStatus = false;
+            }
+        } else if ((CurrentTL->ucTimeFlags & TL_T_STOP_WILD) != 0) {
+            /* wild card stop time */
+            if (tNow < CurrentTL->tStartTime) {
+                bStatus = false;
+            }
+        } else {
+            /* No wildcards so use both times */
+            if ((tNow < CurrentTL->tStartTime) ||
+                (tNow > CurrentTL->tStopTime)) {
+                bStatus = false;
+                }
+        }
+    }
+
+    return (bStatus);
+}
+
+/*****************************************************************************
+ * Convert a BACnet time into a local time in seconds since the local epoch  *
+ *****************************************************************************/
+
+time_t TL_BAC_Time_To_Local(
+    BACNET_DATE_TIME * SourceTime)
+{
+    struct tm LocalTime;
+    int iTemp;
+
+    LocalTime.tm_year = SourceTime->date.year - 1900;   /* We store BACnet year in full format */
+    /* Some clients send a date of all 0s to indicate start of epoch
+     * even though this is not a valid date. Pick this up here and
+     * correct the day and month for the local time functions.
+     */
+    iTemp =
+        SourceTime->date.year + SourceTime->date.month + SourceTime->date.day;
+    if (iTemp == 1900) {
+        LocalTime.tm_mon = 0;
+        LocalTime.tm_mday = 1;
+    } else {
+        LocalTime.tm_mon = SourceTime->date.month - 1;
+        LocalTime.tm_mday = SourceTime->date.day;
+    }
+
+    LocalTime.tm_hour = SourceTime->time.hour;
+    LocalTime.tm_min = SourceTime->time.min;
+    LocalTime.tm_sec = SourceTime->time.sec;
+    /* Let mktime work out if daylight saving applies */
+    LocalTime.tm_isdst = -1;
+
+    return (mktime(&LocalTime));
+}
+
+/*****************************************************************************
+ * Convert a local time in seconds since the local epoch into a BACnet time  *
+ *****************************************************************************/
+
+void TL_Local_Time_To_BAC(
+    BACNET_DATE_TIME * DestTime,
+    time_t SourceTime)
+{
+    struct tm Converted;
+    struct tm *TempTime;
+
+    /* The reentrant form does not check the time zone every call */
+    TempTime = localtime_r(&SourceTime, &Converted);
+
+    DestTime->date.year = (uint16_t) (TempTime->tm_year + 1900);
+    DestTime->date.month = (uint8_t) (TempTime->tm_mon + 1);
+    DestTime->date.day = (uint8_t) TempTime->tm_mday;
+    /* BACnet is 1 to 7 = Monday to Sunday
+     * Windows is days from Sunday 0 - 6 so we
+     * have to adjust */
+    if (TempTime->tm_wday == 0)
+        DestTime->date.wday = 7;
+    else
+        DestTime->date.wday = (uint8_t) TempTime->tm_wday;
+    DestTime->time.hour = (uint8_t) TempTime->tm_hour;
+    DestTime->time.min = (uint8_t) TempTime->tm_min;
+    DestTime->time.sec = (uint8_t) TempTime->tm_sec;
+    DestTime->time.hundredths = 0;
+}
+
+/****************************************************************************
+ * Build a list of Trend Log entries from the Log Buffer property as        *
+ * required for the ReadsRange functionality.                               *
+ *                                                                          *
+ * We have to support By Position, By Sequence and By Time requests.        *
+ *                                                                          *
+ * We do assume the list cannot change whilst we are accessing it so would  *
+ * not be multithread safe if there are other tasks that write to the log.  *
+ *                                                                          *
+ * We take the simple approach here to filling the buffer by taking a max   *
+ * size for a single entry and then stopping if there is less than that     *
+ * left in the buffer. You could build each entry in a seperate buffer and  *
+ * determine the exact length before copying but this is time consuming,    *
+ * requires more memory and would probably only let you sqeeeze one more    *
+ * entry in on occasion. The value is calculated as 10 bytes for the time   *
+ * stamp + 6 bytes for our largest data item (bit string capped at 32 bits) *
+ * + 3 bytes for the status flags + 4 for the context tags to give 23.      *
+ ****************************************************************************/
+
+#define TL_MAX_ENC 23   /* Maximum size of encoded log entry, see above */
+
+int rr_trend_log_encode(
+    uint8_t * apdu,
+    BACNET_READ_RANGE_DATA * pRequest)
+{
+    unsigned index = 0;
+    /* Initialise result flags to all false */
+    bitstring_init(&pRequest->ResultFlags);
+    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_FIRST_ITEM, false);
+    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_LAST_ITEM, false);
+    bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
+    pRequest->ItemCount = 0;    /* Start out with nothing */
+
+    /* Bail out now if nowt - should never happen for a Trend Log but ... */
+    if (Trend_Log_Valid_Instance(pRequest->object_instance)) {
+        index = Trend_Log_Instance_To_Index(pRequest->object_instance);
+        if (TL_Descr[index].ulRecordCount == 0)
+            return (0);
+    }
+
+    if ((pRequest->RequestType == RR_BY_POSITION) ||
+        (pRequest->RequestType == RR_READ_ALL)) {
+        return (TL_encode_by_position(apdu, pRequest));
+    } else if (pRequest->RequestType == RR_BY_SEQUENCE) {
+        return (TL_encode_by_sequence(apdu, pRequest));
+    }
+
+    return (TL_encode_by_time(apdu, pRequest));
+}
+
+/****************************************************************************
+ * Handle encoding for the By Position and All options.                     *
+ * Does All option by converting to a By Position request starting at index *
+ * 1 and of maximum log size length.                                        *
+ ****************************************************************************/
+
+int TL_encode_by_position(
+    uint8_t * apdu,
+    BACNET_READ_RANGE_DATA * pRequest)
+{
+    unsigned index = 0;
+    int iLen = 0;
+    int32_t iTemp = 0;
+    TREND_LOG_DESCR *CurrentTL = NULL;
+
+    uint32_t uiIndex = 0;       /* Current entry number */
+    uint32_t uiFirst = 0;       /* Entry number we started encoding from */
+    uint32_t uiLast = 0;        /* Entry number we finished encoding on */
+    uint32_t uiTarget = 0;      /* Last entry we are required to encode */
+    uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
+
+    if (!Trend_Log_Valid_Instance(pRequest->object_instance))
+            return (iLen);
+    /* See how much space we have */
+    uiRemaining = pRequest->application_data_len - pRequest->Overhead;
+    index = Trend_Log_Instance_To_Index(pRequest->object_instance);
+    CurrentTL = &TL_Descr[index];
+    if (pRequest->RequestType == RR_READ_ALL) {
         /*
          * Read all the list or as much as will fit in the buffer by selecting
          * a range that covers the whole list and falling through to the next
@@ -1632,9 +2362,11 @@ int TL_encode_by_sequence(
             return (iLen);
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->application_data_len - pRequest->Overhead;
     index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentTL = &TL_Descr[index];
+    if (CurrentTL->ulRecordCount == 0)
+        return (0);
     /* Figure out the sequence number for the first record, last is ulTotalRecordCount */
     uiFirstSeq =
         CurrentTL->ulTotalRecordCount - (CurrentTL->ulRecordCount - 1);
@@ -1767,34 +2499,23 @@ int TL_encode_by_time(
             return (iLen);
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->application_data_len - pRequest->Overhead;
     index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentTL = &TL_Descr[index];
+    if (CurrentTL->ulRecordCount == 0)
+        return (0);
 
     tRefTime = TL_BAC_Time_To_Local(&pRequest->Range.RefTime);
-    /* Find correct position for oldest entry in log */
-    if (CurrentTL->ulRecordCount < TL_MAX_ENTRIES)
-        uiIndex = 0;
-    else
-        uiIndex = CurrentTL->iIndex;
-
     if (pRequest->Count < 0) {
         /* Start at end of log and look for record which has
          * timestamp greater than or equal to the reference.
          */
-        iCount = CurrentTL->ulRecordCount - 1;
-        /* Start out with the sequence number for the last record */
-        uiFirstSeq = CurrentTL->ulTotalRecordCount;
-        for (;;) {
-            if (Logs[index][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp < tRefTime)
-                break;
-
-            uiFirstSeq--;
-            iCount--;
-            if (iCount < 0)
-                return (0);
-        }
+        iCount = TL_Buffer_Search(CurrentTL, tRefTime, false) - 1;
+        if (iCount < 0)
+            return (0);
+        /* Count back from the sequence number for the last record */
+        uiFirstSeq = CurrentTL->ulTotalRecordCount -
+            (CurrentTL->ulRecordCount - 1 - iCount);
 
         /* We have an and point for our request,
          * now work backwards to find where we should start from
@@ -1819,20 +2540,13 @@ int TL_encode_by_time(
         /* Start at beginning of log and look for 1st record which has
          * timestamp greater than the reference time.
          */
-        iCount = 0;
+        iCount = TL_Buffer_Search(CurrentTL, tRefTime, true);
+        if ((uint32_t) iCount == CurrentTL->ulRecordCount)
+            return (0);
         /* Figure out the sequence number for the first record, last is ulTotalRecordCount */
         uiFirstSeq =
-            CurrentTL->ulTotalRecordCount - (CurrentTL->ulRecordCount - 1);
-        for (;;) {
-            if (Logs[index][(uiIndex +
-                        iCount) % TL_MAX_ENTRIES].tTimeStamp > tRefTime)
-                break;
-
-            uiFirstSeq++;
-            iCount++;
-            if ((uint32_t) iCount == CurrentTL->ulRecordCount)
-                return (0);
-        }
+            CurrentTL->ulTotalRecordCount - (CurrentTL->ulRecordCount - 1) +
+            iCount;
     }
 
     /* We now have a starting point for the operation and a +ve count */
@@ -1884,19 +2598,16 @@ int TL_encode_entry(
     int iEntry)
 {
     int iLen = 0;
-    TL_DATA_REC *pSource = NULL;
+    TL_DATA_REC Entry;
+    TL_DATA_REC *pSource = &Entry;
     BACNET_BIT_STRING TempBits;
     uint8_t ucCount = 0;
     BACNET_DATE_TIME TempTime;
 
     /* Convert from BACnet 1 based to 0 based array index and then
      * handle wrap around of the circular buffer */
-
-    if (TL_Descr[i].ulRecordCount < TL_MAX_ENTRIES)
-        pSource = &Logs[i][(iEntry - 1) % TL_MAX_ENTRIES];
-    else
-        pSource =
-            &Logs[i][(TL_Descr[i].iIndex + iEntry - 1) % TL_MAX_ENTRIES];
+    TL_Buffer_Get(&TL_Descr[i], TL_Buffer_Slot(&TL_Descr[i], iEntry - 1),
+        pSource);
 
     iLen = 0;
     /* First stick the time stamp in with tag [0] */
@@ -2159,82 +2870,860 @@ void TL_fetch_property(
         TempRec.ucStatus = 128 | bitstring_octet(&TempBits, 0);
     }
 
-    Logs[i][CurrentTL->iIndex++] = TempRec;
-    if (CurrentTL->iIndex >= TL_MAX_ENTRIES)
-        CurrentTL->iIndex = 0;
+    TL_Buffer_Put(i, &TempRec);
+}
 
-    CurrentTL->ulTotalRecordCount++;
+/****************************************************************************
+ * Work out when a log is next due and put it in the queue. Polled logs     *
+ * are due on the interval, aligned to the clock if asked, or straight away *
+ * if an enabled log has missed a whole interval. A trigger wakes a log up  *
+ * on the next tick. Triggered logs are otherwise left out of the queue.    *
+ ****************************************************************************/
 
-    if (CurrentTL->ulRecordCount < TL_MAX_ENTRIES)
-        CurrentTL->ulRecordCount++;
+static void TL_Schedule(
+    int i,
+    time_t tNow)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    time_t tDue;
+
+    CurrentTL = &TL_Descr[i];
+    if ((CurrentTL->LoggingType == LOGGING_TYPE_POLLED) &&
+        (CurrentTL->ulLogInterval != 0)) {
+        if (CurrentTL->bAlignIntervals == true) {
+            tDue =
+                tNow - (tNow % CurrentTL->ulLogInterval) +
+                (CurrentTL->ulIntervalOffset % CurrentTL->ulLogInterval);
+            if (tDue <= tNow)
+                tDue += CurrentTL->ulLogInterval;
+            if (((tNow - CurrentTL->tLastDataTime) >
+                    CurrentTL->ulLogInterval) && TL_Is_Enabled(i)) {
+                /* Take a reading as soon as possible after a power down
+                 * or being enabled if we have been off for more than a
+                 * single period. */
+                tDue = tNow;
+            }
+        } else {
+            tDue = CurrentTL->tLastDataTime + CurrentTL->ulLogInterval;
+            if (tDue < tNow)
+                tDue = tNow;
+        }
+        CurrentTL->tNextDue = tDue;
+        if ((CurrentTL->bTrigger == true) &&
+            (CurrentTL->bAlignIntervals == false))
+            tDue = tNow;
+    } else if ((CurrentTL->LoggingType == LOGGING_TYPE_TRIGGERED) &&
+        (CurrentTL->bTrigger == true)) {
+        tDue = tNow;
+    } else {
+        deadline_stop(&TL_Timers, &CurrentTL->Timer);
+        return;
+    }
+
+    (void) deadline_start(&TL_Timers, &CurrentTL->Timer,
+        (uint32_t) (tDue - tNow));
+}
+
+/****************************************************************************
+ * Record how late a polled reading is, in milliseconds, from the time of   *
+ * the tick it is taken in.                                                 *
+ ****************************************************************************/
+
+static void TL_Jitter(
+    TREND_LOG_DESCR * CurrentTL,
+    const struct timespec *pNow)
+{
+    int64_t llLate;
+
+    llLate = ((int64_t) (pNow->tv_sec - CurrentTL->tNextDue) * 1000) +
+        (pNow->tv_nsec / 1000000);
+    if (llLate < 0)
+        llLate = 0;
+    if (llLate > UINT32_MAX)
+        llLate = UINT32_MAX;
+    CurrentTL->ulJitterLast = (uint32_t) llLate;
+    if (CurrentTL->ulJitterLast > CurrentTL->ulJitterMax) {
+        CurrentTL->ulJitterMax = CurrentTL->ulJitterLast;
+#if PRINT_ENABLED
+        if (CurrentTL->ulJitterMax > TL_JITTER_REPORT_MS) {
+            fprintf(stderr, "TL%d: reading %lu ms late\n",
+                (int) (CurrentTL - TL_Descr),
+                (unsigned long) CurrentTL->ulJitterMax);
+        }
+#endif
+    }
+}
+
+/****************************************************************************
+ * A log in the queue is due, or has been triggered.                        *
+ ****************************************************************************/
+
+static void TL_Timer_Expired(
+    BACNET_DEADLINE * deadline)
+{
+    TREND_LOG_DESCR *CurrentTL = deadline->context;
+    int iCount = CurrentTL - TL_Descr;
+    time_t tNow = 0;
+
+    /* the time of this tick */
+    tNow = TL_Tick_Time.tv_sec;
+    if (TL_Is_Enabled(iCount)) {
+        if (CurrentTL->LoggingType == LOGGING_TYPE_POLLED) {
+            if (tNow >= CurrentTL->tNextDue) {
+                TL_Jitter(CurrentTL, &TL_Tick_Time);
+                TL_fetch_property(iCount);
+            } else if ((CurrentTL->bAlignIntervals == false) &&
+                (CurrentTL->bTrigger == true)) {
+                /* If not aligned take a reading when a trigger is set */
+                TL_fetch_property(iCount);
+            }
+            CurrentTL->bTrigger = false;        /* Clear this every time */
+        } else if (CurrentTL->LoggingType == LOGGING_TYPE_TRIGGERED) {
+            /* Triggered logs take a reading when the trigger is set and
+             * then reset the trigger to wait for the next event
+             */
+            if (CurrentTL->bTrigger == true) {
+                TL_fetch_property(iCount);
+                CurrentTL->bTrigger = false;
+            }
+        }
+    }
+    TL_Schedule(iCount, tNow);
 }
 
 /****************************************************************************
- * Check each log to see if any data needs to be recorded.                  *
+ * Take the readings of the logs that are due. Only the logs whose time has *
+ * come are looked at, all by the one time the clock is read at.            *
  ****************************************************************************/
 
 void trend_log_timer(
     uint16_t uSeconds)
 {
-    TREND_LOG_DESCR *CurrentTL = NULL;
-    int iCount = 0;
-    time_t tNow = 0;
+    clock_gettime(CLOCK_REALTIME, &TL_Tick_Time);
+    (void) deadline_queue_timer(&TL_Timers, uSeconds);
+}
 
-    /* unused parameter */
-    //uSeconds = uSeconds;
-    /* use OS to get the current time */
-    tNow = time(NULL);
-    for (iCount = 0; iCount < max_trend_logs_int; iCount++) {
-        CurrentTL = &TL_Descr[iCount];
-        if (TL_Is_Enabled(iCount)) {
-            if (CurrentTL->LoggingType == LOGGING_TYPE_POLLED) {
-                /* For polled logs we first need to see if they are clock
-                 * aligned or not.
-                 */
-                if (CurrentTL->bAlignIntervals == true) {
-                    /* Aligned logging so use the combination of the interval
-                     * and the offset to decide when to log. Also log a reading if
-                     * more than interval time has elapsed since last reading to ensure
-                     * we don't miss a reading if we aren't called at the precise second
-                     * when the match occurrs.
-                     */
-/*                if(((tNow % CurrentTL->ulLogInterval) >= (CurrentTL->ulIntervalOffset % CurrentTL->ulLogInterval)) && */
-/*                   ((tNow - CurrentTL->tLastDataTime) >= CurrentTL->ulLogInterval)) { */
-                    if ((tNow % CurrentTL->ulLogInterval) ==
-                        (CurrentTL->ulIntervalOffset %
-                            CurrentTL->ulLogInterval)) {
-                        /* Record value if time synchronised trigger condition is met
-                         * and at least one period has elapsed.
-                         */
-                        TL_fetch_property(iCount);
-                    } else if ((tNow - CurrentTL->tLastDataTime) >
-                        CurrentTL->ulLogInterval) {
-                        /* Also record value if we have waited more than a period
-                         * since the last reading. This ensures we take a reading as
-                         * soon as possible after a power down if we have been off for
-                         * more than a single period.
-                         */
-                        TL_fetch_property(iCount);
-                    }
-                } else if (((tNow - CurrentTL->tLastDataTime) >=
-                        CurrentTL->ulLogInterval) ||
-                    (CurrentTL->bTrigger == true)) {
-                    /* If not aligned take a reading when we have either waited long
-                     * enough or a trigger is set.
-                     */
-                    TL_fetch_property(iCount);
-                }
+uint32_t trend_log_timer_next_seconds(
+    void)
+{
+    return deadline_queue_next(&TL_Timers);
+}
 
-                CurrentTL->bTrigger = false;   /* Clear this every time */
-            } else if (CurrentTL->LoggingType == LOGGING_TYPE_TRIGGERED) {
-                /* Triggered logs take a reading when the trigger is set and
-                 * then reset the trigger to wait for the next event
-                 */
-                if (CurrentTL->bTrigger == true) {
-                    TL_fetch_property(iCount);
-                    CurrentTL->bTrigger = false;
-                }
-            }
+/****************************************************************************
+ * How late the polled readings of a log have been, in milliseconds. With   *
+ * PRINT_ENABLED a reading later than any before, by more than a second, is *
+ * also reported on stderr.                                                 *
+ ****************************************************************************/
+
+bool Trend_Log_Sampling_Jitter(
+    uint32_t object_instance,
+    uint32_t * pulLast,
+    uint32_t * pulMax)
+{
+    unsigned index;
+
+    index = Trend_Log_Instance_To_Index(object_instance);
+    if (index >= max_trend_logs_int)
+        return false;
+
+    if (pulLast)
+        *pulLast = TL_Descr[index].ulJitterLast;
+    if (pulMax)
+        *pulMax = TL_Descr[index].ulJitterMax;
+
+    return true;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+/* the clock of the trend logs */
+static time_t Test_Time = 1000000000L;
+static long Test_Nanoseconds;
+
+time_t time(
+    time_t * tloc)
+{
+    if (tloc) {
+        *tloc = Test_Time;
+    }
+
+    return Test_Time;
+}
+
+int clock_gettime(
+    clockid_t clk_id,
+    struct timespec *tp)
+{
+    (void) clk_id;
+    tp->tv_sec = Test_Time;
+    tp->tv_nsec = Test_Nanoseconds;
+
+    return 0;
+}
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 260001;
+}
+
+bool Device_Valid_Object_Name(
+    BACNET_CHARACTER_STRING * object_name,
+    int *object_type,
+    uint32_t * object_instance)
+{
+    (void) object_name;
+    (void) object_type;
+    (void) object_instance;
+
+    return false;
+}
+
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+/* the logged property is a REAL that counts the readings */
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    static float value;
+    BACNET_BIT_STRING bit_string;
+
+    if (rpdata->object_property == PROP_STATUS_FLAGS) {
+        bitstring_init(&bit_string);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+        return encode_application_bitstring(rpdata->application_data,
+            &bit_string);
+    }
+    value += 1.0f;
+
+    return encode_application_real(rpdata->application_data, value);
+}
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedTag,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    if (pValue->tag != ucExpectedTag) {
+        *pErrorClass = ERROR_CLASS_PROPERTY;
+        *pErrorCode = ERROR_CODE_INVALID_DATA_TYPE;
+        return false;
+    }
+
+    return true;
+}
+
+/* the directory of the archive of log 4 */
+#define TEST_ARCHIVE_DIR "/tmp"
+#define TEST_ARCHIVE_PATH TEST_ARCHIVE_DIR "/tl4.log"
+
+/* UCI stubs: the config has four trend logs, in sections 1 to 4. The
+   first asks for a buffer that fits the pool, the second for one that
+   is not valid and the third for more than is left. The fourth keeps a
+   buffer of 10 records in an archive. */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    (void) ctx;
+    (void) p;
+    (void) t;
+    /* the list is built backwards, so log 1 comes first */
+    cb("4", priv);
+    cb("3", priv);
+    cb("2", priv);
+    cb("1", priv);
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) ctx;
+    (void) p;
+
+    if (strcmp(o, "name") == 0) {
+        return "TL";
+    }
+    if (s && (strcmp(s, "4") == 0) && (strcmp(o, "archive") == 0)) {
+        return TEST_ARCHIVE_DIR;
+    }
+
+    return NULL;
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+    (void) p;
+
+    if (s && (strcmp(o, "buffer_size") == 0)) {
+        if (strcmp(s, "1") == 0) {
+            return 500;
+        }
+        if (strcmp(s, "2") == 0) {
+            return -1;
+        }
+        if (strcmp(s, "3") == 0) {
+            return 1000000;
         }
+        if (strcmp(s, "4") == 0) {
+            return 10;
+        }
+    }
+
+    return def;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i - 1);
+    dest[i - 1] = 0;
+
+    return true;
+}
+
+/* write a property of a trend log */
+static bool testTrend_Log_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * value,
+    BACNET_ERROR_CLASS * error_class,
+    BACNET_ERROR_CODE * error_code)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+    bool status = false;
+
+    memset(&wp_data, 0, sizeof(wp_data));
+    wp_data.object_type = OBJECT_TRENDLOG;
+    wp_data.object_instance = object_instance;
+    wp_data.object_property = object_property;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = BACNET_NO_PRIORITY;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(&wp_data.application_data[0], value);
+    status = Trend_Log_Write_Property(&wp_data);
+    *error_class = wp_data.error_class;
+    *error_code = wp_data.error_code;
+
+    return status;
+}
+
+/* write the Buffer_Size of a trend log */
+static bool testTrend_Log_Buffer_Size_Write(
+    uint32_t object_instance,
+    uint32_t buffer_size,
+    BACNET_ERROR_CLASS * error_class,
+    BACNET_ERROR_CODE * error_code)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    memset(&value, 0, sizeof(value));
+    value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+    value.type.Unsigned_Int = buffer_size;
+
+    return testTrend_Log_Write(object_instance, PROP_BUFFER_SIZE, &value,
+        error_class, error_code);
+}
+
+/* the records of the pool not taken by any log */
+static uint32_t testTrend_Log_Pool_Left(
+    void)
+{
+    return (TL_POOL_SIZE - TL_Pool_Used) / sizeof(TL_LOG_REC);
+}
+
+void testTrend_Log_Pool(
+    Test * pTest)
+{
+    uint32_t pool = TL_POOL_SIZE / sizeof(TL_LOG_REC);
+
+    /* the test pool holds the first log and two defaults, but not all
+       of the third */
+    assert(pool > (500 + TL_MAX_ENTRIES));
+    assert(pool < (500 + (2 * TL_MAX_ENTRIES)));
+    Trend_Log_Init();
+    ct_test(pTest, Trend_Log_Count() == 4);
+    ct_test(pTest, TL_Descr[0].ulBufferSize == 500);
+    /* a size that is not valid gets the default */
+    ct_test(pTest, TL_Descr[1].ulBufferSize == TL_MAX_ENTRIES);
+    /* one that does not fit gets what is left */
+    ct_test(pTest,
+        TL_Descr[2].ulBufferSize == (pool - 500 - TL_MAX_ENTRIES));
+    ct_test(pTest, testTrend_Log_Pool_Left() == 0);
+    ct_test(pTest, TL_Pool_Used == ((TL_Descr[0].ulBufferSize +
+                TL_Descr[1].ulBufferSize +
+                TL_Descr[2].ulBufferSize) * sizeof(TL_LOG_REC)));
+    /* an archive is not taken from the pool */
+    ct_test(pTest, TL_Descr[3].pArchive != NULL);
+    ct_test(pTest, TL_Descr[3].ulBufferSize == 10);
+
+    return;
+}
+
+void testTrend_Log_Buffer_Size(
+    Test * pTest)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    BACNET_ERROR_CLASS error_class = ERROR_CLASS_DEVICE;
+    BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
+    uint32_t buffer_size = 0;
+    uint32_t object_instance = 0;
+
+    Trend_Log_Init();
+    object_instance = Trend_Log_Index_To_Instance(0);
+    /* not while the log is enabled */
+    ct_test(pTest, !testTrend_Log_Buffer_Size_Write(object_instance, 100,
+            &error_class, &error_code));
+    ct_test(pTest, error_class == ERROR_CLASS_PROPERTY);
+    ct_test(pTest, error_code == ERROR_CODE_WRITE_ACCESS_DENIED);
+    memset(&value, 0, sizeof(value));
+    value.tag = BACNET_APPLICATION_TAG_BOOLEAN;
+    value.type.Boolean = false;
+    ct_test(pTest, testTrend_Log_Write(object_instance, PROP_ENABLE, &value,
+            &error_class, &error_code));
+    ct_test(pTest, TL_Descr[0].ulRecordCount == 1);
+    ct_test(pTest, TL_Descr[0].pBuffer != NULL);
+    ct_test(pTest, testTrend_Log_Write(Trend_Log_Index_To_Instance(2),
+            PROP_ENABLE, &value, &error_class, &error_code));
+    /* a buffer of no records is out of range */
+    ct_test(pTest, !testTrend_Log_Buffer_Size_Write(object_instance, 0,
+            &error_class, &error_code));
+    ct_test(pTest, error_class == ERROR_CLASS_PROPERTY);
+    ct_test(pTest, error_code == ERROR_CODE_VALUE_OUT_OF_RANGE);
+    ct_test(pTest, TL_Descr[0].ulBufferSize == 500);
+    /* a buffer bigger than the pool has room for is refused, and the log
+       keeps its records */
+    ct_test(pTest, !testTrend_Log_Buffer_Size_Write(object_instance, 501,
+            &error_class, &error_code));
+    ct_test(pTest, error_class == ERROR_CLASS_RESOURCES);
+    ct_test(pTest, error_code == ERROR_CODE_NO_SPACE_TO_WRITE_PROPERTY);
+    ct_test(pTest, TL_Descr[0].ulBufferSize == 500);
+    ct_test(pTest, TL_Descr[0].ulRecordCount == 1);
+    /* a smaller buffer gives back the rest to the pool */
+    ct_test(pTest, testTrend_Log_Buffer_Size_Write(object_instance, 100,
+            &error_class, &error_code));
+    ct_test(pTest, TL_Descr[0].ulBufferSize == 100);
+    /* emptied, but for the record of the purge */
+    ct_test(pTest, TL_Descr[0].ulRecordCount == 1);
+    ct_test(pTest, testTrend_Log_Pool_Left() == 400);
+    /* which another log can then take, but no more */
+    object_instance = Trend_Log_Index_To_Instance(2);
+    buffer_size = TL_Descr[2].ulBufferSize + 400;
+    ct_test(pTest, !testTrend_Log_Buffer_Size_Write(object_instance,
+            buffer_size + 1, &error_class, &error_code));
+    ct_test(pTest, error_class == ERROR_CLASS_RESOURCES);
+    ct_test(pTest, testTrend_Log_Buffer_Size_Write(object_instance,
+            buffer_size, &error_class, &error_code));
+    ct_test(pTest, TL_Descr[2].ulBufferSize == buffer_size);
+    ct_test(pTest, testTrend_Log_Pool_Left() == 0);
+    /* the records of a log stay within its new buffer */
+    TL_Insert_Status_Rec(0, LOG_STATUS_BUFFER_PURGED, true);
+    for (buffer_size = 0; buffer_size < 250; buffer_size++) {
+        TL_fetch_property(0);
+    }
+    ct_test(pTest, TL_Descr[0].ulRecordCount == 100);
+    ct_test(pTest, TL_Descr[0].ulTotalRecordCount == 253);
+
+    return;
+}
+
+/* close the archive of log 4 and open it again, as after a restart */
+static bool testTrend_Log_Archive_Reopen(
+    uint32_t buffer_size)
+{
+    TL_Archive_Close(&TL_Descr[3]);
+
+    return TL_Archive_Open(3, TEST_ARCHIVE_PATH, buffer_size);
+}
+
+/* write over part of the archive file of log 4 while it is closed */
+static bool testTrend_Log_Archive_Poke(
+    off_t offset,
+    uint32_t value)
+{
+    bool status = false;
+    int fd;
+
+    fd = open(TEST_ARCHIVE_PATH, O_WRONLY);
+    if (fd >= 0) {
+        status =
+            (pwrite(fd, &value, sizeof(value), offset) == sizeof(value));
+        close(fd);
+    }
+
+    return status;
+}
+
+/* drop the archive of log 4 without writing a header, as in a crash */
+static void testTrend_Log_Archive_Crash(
+    void)
+{
+    munmap(TL_Descr[3].pArchive, TL_Descr[3].ulArchiveSize);
+    close(TL_Descr[3].iArchiveFd);
+    TL_Descr[3].pArchive = NULL;
+    TL_Archive_Close(&TL_Descr[3]);
+}
+
+/* put readings in log 4 */
+static void testTrend_Log_Archive_Fill(
+    unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        TL_fetch_property(3);
+        Test_Time += 60;
+    }
+}
+
+void testTrend_Log_Archive(
+    Test * pTest)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    TL_LOG_REC Records[10];
+    struct stat Stat;
+    uint32_t ulGeneration = 0;
+    uint32_t ulTotal = 0;
+
+    Trend_Log_Init();
+    CurrentTL = &TL_Descr[3];
+    /* from an empty file */
+    TL_Archive_Close(CurrentTL);
+    unlink(TEST_ARCHIVE_PATH);
+    ct_test(pTest, TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, CurrentTL->ulRecordCount == 0);
+    /* the records written are all there after a restart */
+    testTrend_Log_Archive_Fill(4);
+    memcpy(Records, CurrentTL->pBuffer, sizeof(Records));
+    ct_test(pTest, testTrend_Log_Archive_Reopen(10));
+    ct_test(pTest, CurrentTL->ulRecordCount == 4);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == 4);
+    ct_test(pTest, CurrentTL->iIndex == 4);
+    ct_test(pTest, memcmp(Records, CurrentTL->pBuffer,
+            4 * sizeof(TL_LOG_REC)) == 0);
+    /* and so is the ring, once it has wrapped */
+    testTrend_Log_Archive_Fill(11);
+    memcpy(Records, CurrentTL->pBuffer, sizeof(Records));
+    ct_test(pTest, testTrend_Log_Archive_Reopen(10));
+    ct_test(pTest, CurrentTL->ulRecordCount == 10);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == 15);
+    ct_test(pTest, CurrentTL->iIndex == 5);
+    ct_test(pTest, memcmp(Records, CurrentTL->pBuffer,
+            sizeof(Records)) == 0);
+    /* a torn write of the later header falls back to the earlier one,
+       which left room for a batch of records to go over the oldest */
+    TL_Archive_Close(CurrentTL);
+    ulGeneration = CurrentTL->ulArchiveGeneration;
+    ct_test(pTest, testTrend_Log_Archive_Poke(((ulGeneration & 1) *
+                (TL_ARCHIVE_HEADER_SIZE / 2)) +
+            offsetof(TL_ARCHIVE_HEADER, ulRecordCount), 3));
+    ct_test(pTest, TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, CurrentTL->ulArchiveGeneration == ulGeneration);
+    ct_test(pTest, CurrentTL->ulRecordCount == 8);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == 15);
+    ct_test(pTest, CurrentTL->iIndex == 5);
+    ct_test(pTest, memcmp(Records, CurrentTL->pBuffer,
+            sizeof(Records)) == 0);
+    /* a record put after the last header is not counted after a crash */
+    testTrend_Log_Archive_Fill(4);
+    testTrend_Log_Archive_Crash();
+    ct_test(pTest, TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, CurrentTL->ulRecordCount == 8);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == 18);
+    ct_test(pTest, CurrentTL->iIndex == 8);
+    /* with neither header whole the file is refused, and left as it is */
+    TL_Archive_Close(CurrentTL);
+    ct_test(pTest, testTrend_Log_Archive_Poke(0, 0));
+    ct_test(pTest, testTrend_Log_Archive_Poke(TL_ARCHIVE_HEADER_SIZE / 2,
+            0));
+    ct_test(pTest, !TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, CurrentTL->pArchive == NULL);
+    ct_test(pTest, stat(TEST_ARCHIVE_PATH, &Stat) == 0);
+    ct_test(pTest, Stat.st_size ==
+        (off_t) (TL_ARCHIVE_HEADER_SIZE + (10 * sizeof(TL_LOG_REC))));
+    /* as it is when it has been cut short */
+    unlink(TEST_ARCHIVE_PATH);
+    ct_test(pTest, TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    testTrend_Log_Archive_Fill(3);
+    TL_Archive_Close(CurrentTL);
+    ct_test(pTest, truncate(TEST_ARCHIVE_PATH,
+            TL_ARCHIVE_HEADER_SIZE + (2 * sizeof(TL_LOG_REC))) == 0);
+    ct_test(pTest, !TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, stat(TEST_ARCHIVE_PATH, &Stat) == 0);
+    ct_test(pTest, Stat.st_size ==
+        (off_t) (TL_ARCHIVE_HEADER_SIZE + (2 * sizeof(TL_LOG_REC))));
+    /* one that was sized but never had a header written is a new one */
+    ct_test(pTest, truncate(TEST_ARCHIVE_PATH, 0) == 0);
+    ct_test(pTest, truncate(TEST_ARCHIVE_PATH,
+            TL_ARCHIVE_HEADER_SIZE + (10 * sizeof(TL_LOG_REC))) == 0);
+    ct_test(pTest, TL_Archive_Open(3, TEST_ARCHIVE_PATH, 10));
+    ct_test(pTest, CurrentTL->ulRecordCount == 0);
+    /* a buffer of another size keeps as many of the latest records as fit */
+    testTrend_Log_Archive_Fill(5);
+    memcpy(Records, CurrentTL->pBuffer, sizeof(Records));
+    ulTotal = CurrentTL->ulTotalRecordCount;
+    ct_test(pTest, testTrend_Log_Archive_Reopen(8));
+    ct_test(pTest, CurrentTL->ulBufferSize == 8);
+    ct_test(pTest, CurrentTL->ulRecordCount == 5);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == ulTotal);
+    ct_test(pTest, CurrentTL->iIndex == 5);
+    ct_test(pTest, memcmp(Records, CurrentTL->pBuffer,
+            5 * sizeof(TL_LOG_REC)) == 0);
+    ct_test(pTest, testTrend_Log_Archive_Reopen(3));
+    ct_test(pTest, CurrentTL->ulRecordCount == 3);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == ulTotal);
+    ct_test(pTest, CurrentTL->iIndex == 0);
+    ct_test(pTest, memcmp(&Records[2], CurrentTL->pBuffer,
+            3 * sizeof(TL_LOG_REC)) == 0);
+    ct_test(pTest, testTrend_Log_Archive_Reopen(3));
+    ct_test(pTest, CurrentTL->ulRecordCount == 3);
+    ct_test(pTest, stat(TEST_ARCHIVE_PATH, &Stat) == 0);
+    ct_test(pTest, Stat.st_size ==
+        (off_t) (TL_ARCHIVE_HEADER_SIZE + (3 * sizeof(TL_LOG_REC))));
+    /* a file that cannot be opened is refused, as is an empty buffer */
+    TL_Archive_Close(CurrentTL);
+    ct_test(pTest, !TL_Archive_Open(3, TEST_ARCHIVE_DIR "/none/tl4.log",
+            10));
+    ct_test(pTest, !TL_Archive_Open(3, TEST_ARCHIVE_PATH, 0));
+    ct_test(pTest, CurrentTL->pArchive == NULL);
+    ct_test(pTest, CurrentTL->ulBufferSize == 0);
+    unlink(TEST_ARCHIVE_PATH);
+
+    return;
+}
+
+/* let the clock of the trend logs run on, ticking their timer */
+static void testTrend_Log_Tick(
+    uint16_t seconds)
+{
+    Test_Time += seconds;
+    trend_log_timer(seconds);
+}
+
+/* write the Enable or the Log_Interval, in seconds, of a trend log */
+static bool testTrend_Log_Schedule_Write(
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t value)
+{
+    BACNET_APPLICATION_DATA_VALUE data;
+    BACNET_ERROR_CLASS error_class = ERROR_CLASS_DEVICE;
+    BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER;
+
+    memset(&data, 0, sizeof(data));
+    if (object_property == PROP_ENABLE) {
+        data.tag = BACNET_APPLICATION_TAG_BOOLEAN;
+        data.type.Boolean = (value != 0);
+    } else {
+        /* in hundredths of a second */
+        data.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+        data.type.Unsigned_Int = value * 100;
+    }
+
+    return testTrend_Log_Write(object_instance, object_property, &data,
+        &error_class, &error_code);
+}
+
+void testTrend_Log_Schedule(
+    Test * pTest)
+{
+    TREND_LOG_DESCR *CurrentTL;
+    uint32_t object_instance = 0;
+    uint32_t count = 0;
+    uint32_t jitter = 0;
+    uint32_t jitter_max = 0;
+    unsigned i;
+
+    Trend_Log_Init();
+    CurrentTL = &TL_Descr[0];
+    object_instance = Trend_Log_Index_To_Instance(0);
+    /* start on the hour, so that every interval is aligned */
+    Test_Time += 3600 - (Test_Time % 3600);
+    testTrend_Log_Tick(0);
+    ct_test(pTest, testTrend_Log_Schedule_Write(object_instance,
+            PROP_LOG_INTERVAL, 60));
+    /* an enabled log that has missed an interval is due at the next tick */
+    ct_test(pTest, testTrend_Log_Schedule_Write(object_instance,
+            PROP_ENABLE, 1));
+    ct_test(pTest, deadline_remaining(&TL_Timers, &CurrentTL->Timer) == 1);
+    ct_test(pTest, trend_log_timer_next_seconds() == 1);
+    count = CurrentTL->ulTotalRecordCount;
+    testTrend_Log_Tick(1);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 1));
+    ct_test(pTest, CurrentTL->tLastDataTime == Test_Time);
+    /* then on the minute */
+    ct_test(pTest, trend_log_timer_next_seconds() == 59);
+    testTrend_Log_Tick(58);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 1));
+    testTrend_Log_Tick(1);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 2));
+    ct_test(pTest, CurrentTL->tLastDataTime == Test_Time);
+    for (i = 0; i < 600; i++) {
+        testTrend_Log_Tick(1);
     }
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 12));
+    /* each reading was taken in the second it was due */
+    ct_test(pTest, Trend_Log_Sampling_Jitter(object_instance, &jitter,
+            &jitter_max));
+    ct_test(pTest, jitter == 0);
+    /* but the first, due when the log was enabled, came with the tick */
+    ct_test(pTest, jitter_max == 1000);
+    ct_test(pTest, !Trend_Log_Sampling_Jitter(0, &jitter, &jitter_max));
+    /* a tick that comes late takes the reading late, to the millisecond
+       of the tick, then the log is back on the minute */
+    Test_Nanoseconds = 250000000L;
+    testTrend_Log_Tick(90);
+    Test_Nanoseconds = 0;
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 13));
+    ct_test(pTest, Trend_Log_Sampling_Jitter(object_instance, &jitter,
+            &jitter_max));
+    ct_test(pTest, jitter == 30250);
+    ct_test(pTest, jitter_max == jitter);
+    ct_test(pTest, deadline_remaining(&TL_Timers, &CurrentTL->Timer) == 30);
+    testTrend_Log_Tick(30);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 14));
+    /* a new interval takes effect from the write */
+    ct_test(pTest, testTrend_Log_Schedule_Write(object_instance,
+            PROP_LOG_INTERVAL, 300));
+    ct_test(pTest, deadline_remaining(&TL_Timers, &CurrentTL->Timer) ==
+        (uint32_t) (300 - (Test_Time % 300)));
+    for (i = 0; i < 1200; i++) {
+        testTrend_Log_Tick(1);
+    }
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 18));
+    /* a disabled log takes no readings, */
+    ct_test(pTest, testTrend_Log_Schedule_Write(object_instance,
+            PROP_ENABLE, 0));
+    count = CurrentTL->ulTotalRecordCount;
+    for (i = 0; i < 1200; i++) {
+        testTrend_Log_Tick(1);
+    }
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == count);
+    /* and enabled again takes one at the next tick */
+    ct_test(pTest, testTrend_Log_Schedule_Write(object_instance,
+            PROP_ENABLE, 1));
+    ct_test(pTest, deadline_remaining(&TL_Timers, &CurrentTL->Timer) == 1);
+    count = CurrentTL->ulTotalRecordCount;
+    testTrend_Log_Tick(1);
+    ct_test(pTest, CurrentTL->ulTotalRecordCount == (count + 1));
+    ct_test(pTest, deadline_remaining(&TL_Timers, &CurrentTL->Timer) ==
+        (uint32_t) (300 - (Test_Time % 300)));
+
+    return;
+}
+
+#ifdef TEST_TREND_LOG
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Trend Log", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTrend_Log_Pool);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrend_Log_Buffer_Size);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrend_Log_Archive);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTrend_Log_Schedule);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
 }
+#endif /* TEST_TREND_LOG */
+#endif /* TEST */
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <time.h>       /* for time_t */
 #include "bacdef.h"
+#include "deadline.h"
 #include "cov.h"
 #include "rp.h"
 #include "wp.h"
@@ -77,10 +78,30 @@ extern "C" {
         } Datum;
     } TL_DATA_REC;
 
+/* How a record is kept in the log buffer: the same information as
+ * TL_DATA_REC in half the space. The time is seconds after the time base
+ * of the log, and the datum is stored according to ucRecType.
+ */
+
+    typedef struct tl_log_rec {
+        int32_t lTime;  /* Seconds after the log time base */
+        uint8_t ucRecType;      /* What type of Event */
+        uint8_t ucStatus;       /* As in TL_DATA_REC */
+        uint8_t ucBitsLen;      /* TL_TYPE_BITS only, as TL_BITS ucLen */
+        union {
+            uint8_t ucValue;    /* Log status or boolean */
+            float fReal;        /* Real or change of time interval */
+            uint32_t ulValue;   /* Enumerated or unsigned */
+            int32_t lValue;     /* Signed */
+            uint8_t ucStore[4]; /* Bitstring octets */
+            uint16_t usError[2];        /* Error class and code */
+        } Datum;
+    } TL_LOG_REC;
+
 #define TL_T_START_WILD 1       /* Start time is wild carded */
 #define TL_T_STOP_WILD  2       /* Stop Time is wild carded */
 
-#define TL_MAX_ENTRIES 1000     /* Entries per datalog */
+#define TL_MAX_ENTRIES 1000     /* Default Buffer_Size of a datalog */
 #define TL_INIT_ENTRIES 0       /* Entries per datalog */
 
 /* Structure containing config and status info for a Trend Log */
@@ -101,6 +122,15 @@ extern "C" {
         BACNET_DEVICE_OBJECT_PROPERTY_REFERENCE Source; /* Where the data comes from */
         uint32_t ulLogInterval; /* Time between entries in seconds */
         bool bStopWhenFull;     /* Log halts when full if true */
+        uint32_t ulBufferSize;  /* Number of records the buffer can hold */
+        TL_LOG_REC *pBuffer;    /* The records, allocated on first use */
+        uint8_t *pArchive;      /* Mapped archive file holding pBuffer, or NULL */
+        size_t ulArchiveSize;   /* Length of the archive mapping */
+        int iArchiveFd; /* The archive file while pArchive is set */
+        uint32_t ulArchiveGeneration;   /* Of the archive header last written */
+        uint32_t ulArchiveDirty;        /* Records put since that header */
+        time_t tArchiveSync;    /* Time of the record that header was for */
+        time_t tBase;   /* Time base of the record times in the buffer */
         uint32_t ulRecordCount; /* Count of items currently in the buffer */
         uint32_t ulTotalRecordCount;    /* Count of all items that have ever been inserted into the buffer */
         BACNET_LOGGING_TYPE LoggingType;        /* Polled/cov/triggered */
@@ -109,6 +139,10 @@ extern "C" {
         bool bTrigger;  /* Set to 1 to cause a reading to be taken */
         int iIndex;     /* Current insertion point */
         time_t tLastDataTime;
+        BACNET_DEADLINE Timer;  /* When the log next needs looking at */
+        time_t tNextDue;        /* Time of the next polled reading */
+        uint32_t ulJitterLast;  /* Milliseconds late of the last polled reading */
+        uint32_t ulJitterMax;   /* and the most late of any */
     } TREND_LOG_DESCR;
 
 /*
@@ -184,6 +218,15 @@ struct tl_inst_itr_ctx {
     bool Trend_Log_Write_Property(
         BACNET_WRITE_PROPERTY_DATA * wp_data);
 
+    bool TL_Buffer_Size_Set(
+        int iLog,
+        uint32_t ulBufferSize);
+
+    bool TL_Archive_Open(
+        int iLog,
+        const char *pPath,
+        uint32_t ulBufferSize);
+
     void Trend_Log_Init(
         void);
 
@@ -232,6 +275,14 @@ struct tl_inst_itr_ctx {
 
     void trend_log_timer(
         uint16_t uSeconds);
+/* seconds until the next log is due, or DEADLINE_NONE */
+    uint32_t trend_log_timer_next_seconds(
+        void);
+
+    bool Trend_Log_Sampling_Jitter(
+        uint32_t object_instance,
+        uint32_t * pulLast,
+        uint32_t * pulMax);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,44 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../../src
+TEST_DIR = ../../test
+INCLUDES = -I../../include -I$(TEST_DIR) -I.
+DEFINES = -DBIG_ENDIAN=0 -DBACDL_TEST -DTEST -DBACAPP_ALL -DTEST_TREND_LOG \
+	-DTL_POOL_SIZE=24000
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = trendlog.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(TEST_DIR)/ctest.c
+
+TARGET = trend_log
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf core ${TARGET} $(OBJS)
+
+include: .depend
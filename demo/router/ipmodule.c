@@ -17,6 +17,8 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/epoll.h>
 #include "ipmodule.h"
 #include "bacint.h"
 
@@ -41,6 +43,8 @@ void *dl_ip_thread(
     ROUTER_PORT *port = (ROUTER_PORT *) pArgs;
     IP_DATA ip_data;    /* port specific parameters */
     BACNET_ADDRESS address = { 0 };
+    struct epoll_event event;
+    int epoll_fd;
     int status;
     uint8_t shutdown = 0;
 
@@ -66,15 +70,33 @@ void *dl_ip_thread(
         return NULL;
     }
 
+    /* sleep until a datagram or a message arrives */
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        PRINT(ERROR, "Error: Failed to create epoll instance");
+        del_msgbox(msgboxid);
+        port->state = INIT_FAILED;
+        return NULL;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = ip_data.socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ip_data.socket, &event);
+    event.data.fd = msgbox_fd(msgboxid);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+
     port->port_id = msgboxid;
     port->state = RUNNING;
 
     while (!shutdown) {
+        if ((epoll_wait(epoll_fd, &event, 1, -1) < 0) && (errno != EINTR)) {
+            break;
+        }
 
         /* check for incoming messages */
-        bacmsg = recv_from_msgbox(port->port_id, &msg_storage);
-
-        if (bacmsg) {
+        msgbox_clear(port->port_id);
+        while (!shutdown &&
+            (bacmsg = recv_from_msgbox(port->port_id, &msg_storage))) {
             switch (bacmsg->type) {
                 case DATA:{
                         msg_data = (MSG_DATA *) bacmsg->data;
@@ -106,8 +128,11 @@ void *dl_ip_thread(
                 default:
                     break;
             }
-        } else {
-            status = dl_ip_recv(&ip_data, &msg_data, &address, 1000);
+        }
+
+        /* take every datagram that is waiting */
+        while (!shutdown &&
+            ((status = dl_ip_recv(&ip_data, &msg_data, &address, 0)) >= 0)) {
             if (status > 0) {
                 memmove(&msg_data->src.len, &address.mac_len, 1);
                 memmove(&msg_data->src.adr[0], &address.mac[0], MAX_MAC_LEN);
@@ -123,6 +148,7 @@ void *dl_ip_thread(
     }
 
     /* cleanup procedure */
+    close(epoll_fd);
     dl_ip_cleanup(&ip_data);
     port->state = FINISHED;
     return NULL;
@@ -268,19 +294,7 @@ int dl_ip_recv(
 
     /* make sure the socket is open */
     if (data->socket < 0)
-        return 0;
-
-    if (timeout >= 1000) {
-        select_timeout.tv_sec = timeout / 1000;
-        select_timeout.tv_usec =
-            1000 * (timeout - select_timeout.tv_sec * 1000);
-    } else {
-        select_timeout.tv_sec = 0;
-        select_timeout.tv_usec = 1000 * timeout;
-    }
-
-    FD_ZERO(&read_fds);
-    FD_SET(data->socket, &read_fds);
+        return -1;
 
 #ifdef TEST_PACKET
     received_bytes = sizeof(test_packet);
@@ -288,21 +302,38 @@ int dl_ip_recv(
     sin.sin_addr.s_addr = 0x7E1D40A;
     sin.sin_port = 0xC0BA;
 #else
-    int ret = select(data->socket + 1, &read_fds, NULL, NULL, &select_timeout);
-    /* see if there is a packet for us */
-    if (ret > 0)
-        received_bytes =
-            recvfrom(data->socket, (char *) &data->buff[0], data->max_buff, 0,
-            (struct sockaddr *) &sin, &sin_len);
-    else
-        return 0;
+    /* with no timeout, the caller knows from epoll that a datagram
+       is waiting, and reads until there are none */
+    if (timeout) {
+        if (timeout >= 1000) {
+            select_timeout.tv_sec = timeout / 1000;
+            select_timeout.tv_usec =
+                1000 * (timeout - select_timeout.tv_sec * 1000);
+        } else {
+            select_timeout.tv_sec = 0;
+            select_timeout.tv_usec = 1000 * timeout;
+        }
+
+        FD_ZERO(&read_fds);
+        FD_SET(data->socket, &read_fds);
+
+        /* see if there is a packet for us */
+        if (select(data->socket + 1, &read_fds, NULL, NULL,
+                &select_timeout) <= 0)
+            return -1;
+    }
+    received_bytes =
+        recvfrom(data->socket, (char *) &data->buff[0], data->max_buff,
+        MSG_DONTWAIT, (struct sockaddr *) &sin, &sin_len);
 #endif
-    PRINT(DEBUG, "received from %s\n", inet_ntoa(sin.sin_addr));
 
     /* check for errors */
-    if (received_bytes <= 0) {
+    if (received_bytes < 0) {
+        return -1;
+    } else if (received_bytes == 0) {
         return 0;
     }
+    PRINT(DEBUG, "received from %s\n", inet_ntoa(sin.sin_addr));
 
     /* the signature of a BACnet/IP packet */
     if (data->buff[0] != BVLL_TYPE_BACNET_IP)
@@ -325,12 +356,9 @@ int dl_ip_recv(
                     (void) decode_unsigned16(&data->buff[2], &buff_len);
                     /* subtract off the BVLC header */
                     buff_len -= 4;
-                    if (buff_len < data->max_buff) {
-                        /* allocate data message stucture */
-                        (*msg_data) = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+                    if ((buff_len <= MSG_DATA_PDU_SIZE) &&
+                        ((*msg_data) = alloc_data())) {
                         (*msg_data)->pdu_len = buff_len;
-                        (*msg_data)->pdu =
-                            (uint8_t *) malloc((*msg_data)->pdu_len);
                         /* fill up data message structure */
                         memmove(&(*msg_data)->pdu[0], &data->buff[4],
                             (*msg_data)->pdu_len);
@@ -362,14 +390,11 @@ int dl_ip_recv(
                     (void) decode_unsigned16(&data->buff[2], &buff_len);
                     /* subtract off the BVLC header */
                     buff_len -= 10;
-                    if (buff_len < data->max_buff) {
-                        /* allocate data message stucture */
-                        (*msg_data) = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+                    if ((buff_len <= MSG_DATA_PDU_SIZE) &&
+                        ((*msg_data) = alloc_data())) {
                         (*msg_data)->pdu_len = buff_len;
-                        (*msg_data)->pdu =
-                            (uint8_t *) malloc((*msg_data)->pdu_len);
                         /* fill up data message structure */
-                        memmove(&(*msg_data)->pdu, &data->buff[4 + 6],
+                        memmove(&(*msg_data)->pdu[0], &data->buff[4 + 6],
                             (*msg_data)->pdu_len);
                         memmove(&(*msg_data)->src, src,
                             sizeof(BACNET_ADDRESS));
@@ -49,6 +49,8 @@ int dl_ip_send(
     uint8_t * pdu,
     unsigned pdu_len);
 
+/* returns the PDU length, 0 if a datagram was discarded, or -1 if none
+   arrived in time (a timeout of 0 does not wait) */
 int dl_ip_recv(
     IP_DATA * data,
     MSG_DATA ** msg,    /* on recieve fill up message */
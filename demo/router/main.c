@@ -29,6 +29,7 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <termios.h>    /* used in kbhit() */
 #include <getopt.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
 #include <net/if.h>
 #include <pthread.h>
 #include <termios.h>
@@ -41,6 +42,8 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include "dlmstp.h"
 
 #define KEY_ESC 27
+/* seconds between looking for learned networks that are too old */
+#define DNET_AGE_INTERVAL 60
 
 ROUTER_PORT *head = NULL;       /* pointer to list of router ports */
 
@@ -90,9 +93,15 @@ int main(
 
     ROUTER_PORT *port;
     BACMSG msg_storage, *bacmsg = NULL;
+    BACMSG out_msg;
     MSG_DATA *msg_data = NULL;
+    MSG_DATA *in_data = NULL;
     uint8_t *buff = NULL;
     int16_t buff_len = 0;
+    struct epoll_event event;
+    int epoll_fd;
+    bool network_msg;
+    time_t aged = time(NULL);
 
     atexit(cleanup);
 
@@ -106,41 +115,78 @@ int main(
         return -1;
     }
 
+    /* sleep until a port sends a message, or a key is pressed */
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        PRINT(ERROR, "Error: Failed to create epoll instance\n");
+        return -1;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = msgbox_fd(head->main_id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+    (void) kbhit();
+    event.data.fd = STDIN_FILENO;
+    /* fails when stdin is a regular file, leaving only the ports */
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event);
 
     send_network_message(NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, msg_data,
         &buff, NULL);
 
     while (true) {
-        if (kbhit()) {
-            char ch = getchar();
-            if (ch == KEY_ESC) {
-                PRINT(INFO, "Received shutdown. Exiting...\n");
-                break;
+        int ready = epoll_wait(epoll_fd, &event, 1, DNET_AGE_INTERVAL * 1000);
+
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if ((time(NULL) - aged) >= DNET_AGE_INTERVAL) {
+            aged = time(NULL);
+            if (age_dnets(aged))
+                PRINT(INFO, "Forgot networks not announced again\n");
+        }
+        if (ready == 0)
+            continue;
+        if (event.data.fd == STDIN_FILENO) {
+            if (event.events & (EPOLLHUP | EPOLLERR)) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+            }
+            if (kbhit()) {
+                char ch = getchar();
+                if (ch == KEY_ESC) {
+                    PRINT(INFO, "Received shutdown. Exiting...\n");
+                    break;
+                }
             }
         }
 
-        bacmsg = recv_from_msgbox(head->main_id, &msg_storage);
-        if (bacmsg) {
+        msgbox_clear(head->main_id);
+        while ((bacmsg = recv_from_msgbox(head->main_id, &msg_storage))) {
             switch (bacmsg->type) {
                 case DATA:
                     {
                         MSGBOX_ID msg_src = bacmsg->origin;
 
-                        /* allocate message structure */
-                        msg_data = malloc(sizeof(MSG_DATA));
+                        in_data = (MSG_DATA *) bacmsg->data;
+                        /* the message to send is built in a new buffer */
+                        msg_data = alloc_data();
                         if (!msg_data) {
                             PRINT(ERROR, "Error: Could not allocate memory\n");
+                            check_data(in_data);
                             break;
                         }
 
                         print_msg(bacmsg);
 
-                        if (is_network_msg(bacmsg)) {
+                        network_msg = is_network_msg(bacmsg);
+                        if (network_msg) {
                             buff_len =
                                 process_network_message(bacmsg, msg_data,
                                 &buff);
                             if (buff_len == 0) {
-                                free_data(bacmsg->data);
+                                check_data(in_data);
+                                free_data(msg_data);
                                 break;
                             }
                         } else {
@@ -154,37 +200,41 @@ int main(
 
                         if (buff_len > 0) {
                             /* form new message */
-                            msg_data->pdu = buff;
                             msg_data->pdu_len = buff_len;
-                            msg_storage.origin = head->main_id;
-                            msg_storage.type = DATA;
-                            msg_storage.data = msg_data;
+                            out_msg.origin = head->main_id;
+                            out_msg.type = DATA;
+                            out_msg.data = msg_data;
 
-                            print_msg(bacmsg);
+                            print_msg(&out_msg);
 
-                            if (is_network_msg(bacmsg)) {
-                                msg_data->ref_count = 1;
-                                send_to_msgbox(msg_src, &msg_storage);
+                            if (network_msg) {
+                                if (!send_to_msgbox(msg_src, &out_msg))
+                                    free_data(msg_data);
                             } else if (msg_data->dest.net !=
                                 BACNET_BROADCAST_NETWORK) {
-                                msg_data->ref_count = 1;
                                 port =
                                     find_dnet(msg_data->dest.net,
                                     &msg_data->dest);
-                                send_to_msgbox(port->port_id, &msg_storage);
+                                if (!send_to_msgbox(port->port_id, &out_msg))
+                                    free_data(msg_data);
                             } else {
+                                /* each port gets a reference, and the one
+                                   held here is dropped once they all
+                                   have it */
                                 port = head;
-                                msg_data->ref_count = port_count - 1;
                                 while (port != NULL) {
                                     if (port->port_id == msg_src ||
                                         port->state == FINISHED) {
                                         port = port->next;
                                         continue;
                                     }
-                                    send_to_msgbox(port->port_id,
-                                        &msg_storage);
+                                    hold_data(msg_data);
+                                    if (!send_to_msgbox(port->port_id,
+                                            &out_msg))
+                                        check_data(msg_data);
                                     port = port->next;
                                 }
+                                check_data(msg_data);
                             }
                         } else if (buff_len == -1) {
                             uint16_t net = msg_data->dest.net;  /* NET to find */
@@ -197,6 +247,8 @@ int main(
                             PRINT(ERROR, "Error: Invalid message\n");
                             free_data(msg_data);
                         }
+                        /* done with the received message */
+                        check_data(in_data);
                     }
                     break;
                 case SERVICE:
@@ -206,6 +258,8 @@ int main(
         }
     }
 
+    close(epoll_fd);
+
     return 0;
 
 }
@@ -732,8 +786,6 @@ void cleanup(
     msg.type = SERVICE;
     msg.subtype = SHUTDOWN;
 
-    del_msgbox(head->main_id);  /* close routers message box */
-
     /* send shutdown message to all router ports */
     port = head;
     while (port != NULL) {
@@ -745,7 +797,6 @@ void cleanup(
     port = head;
     while (port != NULL) {
         if (port->state == FINISHED) {
-            cleanup_dnets(port->route_info.dnets);
             port = port->next;
             free(head->iface);
             free(head);
@@ -753,6 +804,10 @@ void cleanup(
         }
     }
 
+    cleanup_dnets();
+
+    del_msgbox(msg.origin);     /* close routers message box */
+
     pthread_mutex_destroy(&msg_lock);
 }
 
@@ -778,6 +833,7 @@ uint16_t process_msg(
     uint8_t ** buff)
 {
 
+    MSG_DATA *in_data = (MSG_DATA *) msg->data;
     BACNET_ADDRESS addr;
     BACNET_NPDU_DATA npdu_data;
     ROUTER_PORT *srcport;
@@ -788,10 +844,11 @@ uint16_t process_msg(
     int apdu_len;
     int npdu_len;
 
-    memmove(data, msg->data, sizeof(MSG_DATA));
+    /* the message to send is built in data, from the received message */
+    memmove(&data->src, &in_data->src, sizeof(BACNET_ADDRESS));
 
-    apdu_offset = npdu_decode(data->pdu, &data->dest, &addr, &npdu_data);
-    apdu_len = data->pdu_len - apdu_offset;
+    apdu_offset = npdu_decode(in_data->pdu, &data->dest, &addr, &npdu_data);
+    apdu_len = in_data->pdu_len - apdu_offset;
 
     srcport = find_snet(msg->origin);
     destport = find_dnet(data->dest.net, NULL);
@@ -814,20 +871,21 @@ uint16_t process_msg(
             npdu_len = npdu_encode_pdu(npdu, NULL, &data->src, &npdu_data);
         }
 
-        buff_len = npdu_len + data->pdu_len - apdu_offset;
+        buff_len = npdu_len + apdu_len;
+        if (buff_len > (int) sizeof(data->buffer)) {
+            /* discard */
+            return -2;
+        }
 
-        *buff = (uint8_t *) malloc(buff_len);
+        *buff = data->pdu;
         memmove(*buff, npdu, npdu_len); /* copy newly formed NPDU */
-        memmove(*buff + npdu_len, &data->pdu[apdu_offset], apdu_len);   /* copy APDU */
+        memmove(*buff + npdu_len, &in_data->pdu[apdu_offset], apdu_len);        /* copy APDU */
 
     } else {
         /* request net search */
         return -1;
     }
 
-    /* delete received message */
-    free_data((MSG_DATA *) msg->data);
-
     return buff_len;
 }
 
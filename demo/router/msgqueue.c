@@ -18,20 +18,66 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <pthread.h>
+#include <sys/eventfd.h>
 #include "msgqueue.h"
 
+/* the ring from one sender to one box. head is written only by the
+   box owner, tail only by the sender, on their own cache lines */
+typedef struct _msg_ring {
+    unsigned head __attribute__ ((aligned(64)));
+    unsigned tail __attribute__ ((aligned(64)));
+    BACMSG msg[MSGBOX_RING_SIZE] __attribute__ ((aligned(64)));
+} MSG_RING;
+
+typedef struct _msgbox {
+    bool in_use;
+    int fd;     /* eventfd for waking the owner */
+    int signaled;       /* set while a wakeup is pending on fd */
+    unsigned next;      /* ring to read first, so that no sender starves */
+    MSG_RING *ring[MAX_MSGBOXES];       /* indexed by sender */
+} MSGBOX;
+
 pthread_mutex_t msg_lock = PTHREAD_MUTEX_INITIALIZER;
 
+static MSGBOX Msgbox[MAX_MSGBOXES];
+/* message data that is free for reuse */
+static MSG_DATA *Free_Data;
+
 MSGBOX_ID create_msgbox(
     )
 {
     MSGBOX_ID msgboxid;
+    MSG_RING *ring;
+    unsigned i;
 
-    msgboxid = msgget(IPC_PRIVATE, 0666 | IPC_CREAT);
-    if (msgboxid == INVALID_MSGBOX_ID) {
+    pthread_mutex_lock(&msg_lock);
+    for (msgboxid = 0; msgboxid < MAX_MSGBOXES; msgboxid++) {
+        if (!Msgbox[msgboxid].in_use) {
+            break;
+        }
+    }
+    if (msgboxid == MAX_MSGBOXES) {
+        pthread_mutex_unlock(&msg_lock);
         return INVALID_MSGBOX_ID;
     }
+    Msgbox[msgboxid].fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (Msgbox[msgboxid].fd < 0) {
+        pthread_mutex_unlock(&msg_lock);
+        return INVALID_MSGBOX_ID;
+    }
+    /* the rings stay with the box: drop what was left for the last owner */
+    for (i = 0; i < MAX_MSGBOXES; i++) {
+        ring = Msgbox[msgboxid].ring[i];
+        if (ring) {
+            ring->head = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    Msgbox[msgboxid].signaled = 0;
+    Msgbox[msgboxid].next = 0;
+    __atomic_store_n(&Msgbox[msgboxid].in_use, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&msg_lock);
 
     return msgboxid;
 }
@@ -40,13 +86,40 @@ bool send_to_msgbox(
     MSGBOX_ID dest,
     BACMSG * msg)
 {
+    MSGBOX *box;
+    MSG_RING *ring;
+    unsigned tail;
 
-    int err;
-
-    err = msgsnd(dest, msg, sizeof(BACMSG), 0);
-    if (err) {
+    if ((dest < 0) || (dest >= MAX_MSGBOXES) || (msg->origin < 0) ||
+        (msg->origin >= MAX_MSGBOXES)) {
+        return false;
+    }
+    box = &Msgbox[dest];
+    if (!__atomic_load_n(&box->in_use, __ATOMIC_ACQUIRE)) {
         return false;
     }
+    ring = __atomic_load_n(&box->ring[msg->origin], __ATOMIC_ACQUIRE);
+    if (!ring) {
+        /* only this sender ever sets its own ring */
+        ring = (MSG_RING *) calloc(1, sizeof(MSG_RING));
+        if (!ring) {
+            return false;
+        }
+        __atomic_store_n(&box->ring[msg->origin], ring, __ATOMIC_RELEASE);
+    }
+    tail = ring->tail;
+    if ((tail - __atomic_load_n(&ring->head,
+                __ATOMIC_ACQUIRE)) >= MSGBOX_RING_SIZE) {
+        return false;
+    }
+    ring->msg[tail & (MSGBOX_RING_SIZE - 1)] = *msg;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    /* only the first message since the owner last cleared the box
+       costs a system call */
+    if (__atomic_exchange_n(&box->signaled, 1, __ATOMIC_SEQ_CST) == 0) {
+        eventfd_write(box->fd, 1);
+    }
+
     return true;
 }
 
@@ -54,38 +127,113 @@ BACMSG *recv_from_msgbox(
     MSGBOX_ID src,
     BACMSG * msg)
 {
+    MSGBOX *box;
+    MSG_RING *ring;
+    unsigned head;
+    unsigned i;
+    unsigned n;
 
-    int recv_bytes;
-
-    recv_bytes = msgrcv(src, msg, sizeof(BACMSG), 0, IPC_NOWAIT);
-    if (recv_bytes > 0) {
-        return msg;
-    } else {
+    if ((src < 0) || (src >= MAX_MSGBOXES)) {
         return NULL;
     }
+    box = &Msgbox[src];
+    for (i = 0; i < MAX_MSGBOXES; i++) {
+        n = (box->next + i) % MAX_MSGBOXES;
+        ring = __atomic_load_n(&box->ring[n], __ATOMIC_ACQUIRE);
+        if (!ring) {
+            continue;
+        }
+        head = ring->head;
+        if (head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+            *msg = ring->msg[head & (MSGBOX_RING_SIZE - 1)];
+            __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+            box->next = n + 1;
+            return msg;
+        }
+    }
+
+    return NULL;
 }
 
 void del_msgbox(
     MSGBOX_ID msgboxid)
 {
 
-    if (msgboxid == INVALID_MSGBOX_ID)
+    if ((msgboxid < 0) || (msgboxid >= MAX_MSGBOXES))
         return;
-    else
-        msgctl(msgboxid, IPC_RMID, NULL);
+    pthread_mutex_lock(&msg_lock);
+    if (Msgbox[msgboxid].in_use) {
+        __atomic_store_n(&Msgbox[msgboxid].in_use, false, __ATOMIC_RELEASE);
+        close(Msgbox[msgboxid].fd);
+        Msgbox[msgboxid].fd = -1;
+    }
+    pthread_mutex_unlock(&msg_lock);
+}
+
+int msgbox_fd(
+    MSGBOX_ID msgboxid)
+{
+    if ((msgboxid < 0) || (msgboxid >= MAX_MSGBOXES))
+        return -1;
+
+    return Msgbox[msgboxid].fd;
+}
+
+void msgbox_clear(
+    MSGBOX_ID msgboxid)
+{
+    eventfd_t value;
+
+    if ((msgboxid < 0) || (msgboxid >= MAX_MSGBOXES))
+        return;
+    eventfd_read(Msgbox[msgboxid].fd, &value);
+    /* a sender that still sees the flag set has already queued its
+       message where the receive after this will find it */
+    __atomic_exchange_n(&Msgbox[msgboxid].signaled, 0, __ATOMIC_SEQ_CST);
+}
+
+MSG_DATA *alloc_data(
+    void)
+{
+    MSG_DATA *data;
+
+    pthread_mutex_lock(&msg_lock);
+    data = Free_Data;
+    if (data) {
+        Free_Data = data->next;
+    }
+    pthread_mutex_unlock(&msg_lock);
+    if (!data) {
+        data = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+        if (!data) {
+            return NULL;
+        }
+    }
+    memset(&data->dest, 0, sizeof(data->dest));
+    memset(&data->src, 0, sizeof(data->src));
+    data->pdu = data->buffer;
+    data->pdu_len = 0;
+    data->ref_count = 1;
+    data->next = NULL;
+
+    return data;
+}
+
+void hold_data(
+    MSG_DATA * data)
+{
+    __atomic_add_fetch(&data->ref_count, 1, __ATOMIC_RELAXED);
 }
 
 void free_data(
     MSG_DATA * data)
 {
 
-    if (data->pdu) {
-        free(data->pdu);
-        data->pdu = NULL;
-    }
     if (data) {
-        free(data);
-        data = NULL;
+        pthread_mutex_lock(&msg_lock);
+        data->next = Free_Data;
+        Free_Data = data;
+        pthread_mutex_unlock(&msg_lock);
     }
 }
 
@@ -93,10 +241,8 @@ void check_data(
     MSG_DATA * data)
 {
 
-    /* lock and decrement messages reference count */
-    pthread_mutex_lock(&msg_lock);
-    if (--data->ref_count == 0) {
+    /* decrement messages reference count */
+    if (__atomic_sub_fetch(&data->ref_count, 1, __ATOMIC_ACQ_REL) == 0) {
         free_data(data);
     }
-    pthread_mutex_unlock(&msg_lock);
 }
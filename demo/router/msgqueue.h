@@ -19,9 +19,7 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
+#include <pthread.h>
 #include "bacdef.h"
 #include "npdu.h"
 
@@ -29,6 +27,13 @@ extern pthread_mutex_t msg_lock;
 
 #define INVALID_MSGBOX_ID -1
 
+/* the most message boxes: the router and each of its ports */
+#define MAX_MSGBOXES 16
+/* messages each sender can have waiting in a box (a power of 2) */
+#define MSGBOX_RING_SIZE 64
+/* the largest NPDU carried in a message, from BACnet/IP */
+#define MSG_DATA_PDU_SIZE (MAX_NPDU + 1476)
+
 typedef int MSGBOX_ID;
 
 typedef enum {
@@ -51,23 +56,30 @@ typedef struct _message {
 } BACMSG;
 
 /* specific message type data structures */
+/* these come from a pool, and go back to it with the last reference */
 typedef struct _msg_data {
     BACNET_ADDRESS dest;
     BACNET_ADDRESS src;
-    uint8_t *pdu;
+    uint8_t *pdu;       /* points at buffer */
     uint16_t pdu_len;
     uint8_t ref_count;
+    struct _msg_data *next;     /* while in the pool */
+    uint8_t buffer[MSG_DATA_PDU_SIZE];
 } MSG_DATA;
 
+/* Each box holds a single-producer, single-consumer ring for each box
+   that sends to it, so that sending and receiving take no locks.
+   Only the thread that owns msg->origin may send from it, and only
+   the thread that owns a box may receive from it. */
 MSGBOX_ID create_msgbox(
     );
 
-/* returns sent byte count */
+/* returns false if the box is gone or the sender's ring is full */
 bool send_to_msgbox(
     MSGBOX_ID dest,
     BACMSG * msg);
 
-/* returns received message */
+/* returns received message, or NULL at once if there is none */
 BACMSG *recv_from_msgbox(
     MSGBOX_ID src,
     BACMSG * msg);
@@ -75,7 +87,25 @@ BACMSG *recv_from_msgbox(
 void del_msgbox(
     MSGBOX_ID msgboxid);
 
-/* free message data structure */
+/* a file descriptor that is readable when messages may be waiting */
+int msgbox_fd(
+    MSGBOX_ID msgboxid);
+
+/* after waking on msgbox_fd(), clear it before receiving all of the
+   messages, so that another send wakes the owner again */
+void msgbox_clear(
+    MSGBOX_ID msgboxid);
+
+/* message data from the pool, with pdu pointing at its buffer and one
+   reference held by the caller, or NULL */
+MSG_DATA *alloc_data(
+    void);
+
+/* take another reference to message data, for sending it to a box */
+void hold_data(
+    MSG_DATA * data);
+
+/* free message data structure, back to the pool */
 void free_data(
     MSG_DATA * data);
 
@@ -17,6 +17,10 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include "mstpmodule.h"
 #include "bacint.h"
 #include "dlmstp_linux.h"
@@ -37,6 +41,11 @@ void *dl_mstp_thread(
     struct mstp_port_struct_t mstp_port = { (MSTP_RECEIVE_STATE) 0 };
     volatile SHARED_MSTP_DATA shared_port_data = { 0 };
     uint16_t pdu_len;
+    DLMSTP_PACKET *pkt;
+    BACNET_ADDRESS dest;
+    struct epoll_event event;
+    eventfd_t value;
+    int epoll_fd;
     uint8_t shutdown = 0;
 
     shared_port_data.Treply_timeout = 260;
@@ -81,8 +90,11 @@ void *dl_mstp_thread(
     dlmstp_set_max_info_frames(&mstp_port,
         port->params.mstp_params.max_frames);
     dlmstp_set_max_master(&mstp_port, port->params.mstp_params.max_master);
-    if (!dlmstp_init(&mstp_port, port->iface))
+    if (!dlmstp_init(&mstp_port, port->iface)) {
         printf("MSTP %s init failed. Stop.\n", port->iface);
+        port->state = INIT_FAILED;
+        return NULL;
+    }
 
     port->port_id = create_msgbox();
     if (port->port_id == INVALID_MSGBOX_ID) {
@@ -90,6 +102,20 @@ void *dl_mstp_thread(
         return NULL;
     }
 
+    /* sleep until a packet is received or a message arrives */
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        del_msgbox(port->port_id);
+        port->state = INIT_FAILED;
+        return NULL;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = dlmstp_receive_fd(&mstp_port);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+    event.data.fd = msgbox_fd(port->port_id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+
     port->state = RUNNING;
 
     while (!shutdown) {
@@ -97,22 +123,28 @@ void *dl_mstp_thread(
         BACMSG msg_storage, *bacmsg;
         MSG_DATA *msg_data;
 
-        bacmsg = recv_from_msgbox(port->port_id, &msg_storage);
+        if ((epoll_wait(epoll_fd, &event, 1, -1) < 0) && (errno != EINTR)) {
+            break;
+        }
 
-        if (bacmsg) {
+        msgbox_clear(port->port_id);
+        while (!shutdown &&
+            (bacmsg = recv_from_msgbox(port->port_id, &msg_storage))) {
             switch (bacmsg->type) {
                 case DATA:
                     msg_data = (MSG_DATA *) bacmsg->data;
 
-                    if (msg_data->dest.net == BACNET_BROADCAST_NETWORK) {
-                        dlmstp_get_broadcast_address(&(msg_data->dest));
+                    /* the message data may be shared with other ports */
+                    memcpy(&dest, &msg_data->dest, sizeof(dest));
+                    if (dest.net == BACNET_BROADCAST_NETWORK) {
+                        dlmstp_get_broadcast_address(&dest);
                     } else {
-                        msg_data->dest.mac[0] = msg_data->dest.adr[0];
-                        msg_data->dest.mac_len = 1;
+                        dest.mac[0] = dest.adr[0];
+                        dest.mac_len = 1;
                     }
 
-                    dlmstp_send_pdu(&mstp_port, &(msg_data->dest),
-                        msg_data->pdu, msg_data->pdu_len);
+                    dlmstp_send_pdu(&mstp_port, &dest, msg_data->pdu,
+                        msg_data->pdu_len);
 
                     check_data(msg_data);
 
@@ -121,6 +153,7 @@ void *dl_mstp_thread(
                 case SERVICE:
                     switch (bacmsg->subtype) {
                         case SHUTDOWN:
+                            del_msgbox(port->port_id);
                             shutdown = 1;
                             break;
                         default:
@@ -128,23 +161,21 @@ void *dl_mstp_thread(
                     }
                     break;
                 default:
-                    continue;
                     break;
             }
-        } else {
-            pdu_len = dlmstp_receive(&mstp_port, NULL, NULL, 0, 1000);
-
-            if (pdu_len > 0) {
-                msg_data = (MSG_DATA *) malloc(sizeof(MSG_DATA));
-                memmove(&(msg_data->src),
-                    (const void *) &(shared_port_data.Receive_Packet.address),
-                    sizeof(shared_port_data.Receive_Packet.address));
+        }
+
+        /* take every packet that is waiting */
+        eventfd_read(dlmstp_receive_fd(&mstp_port), &value);
+        while (!shutdown && (pkt = dlmstp_receive_packet(&mstp_port, 0))) {
+            pdu_len = pkt->pdu_len;
+
+            if ((pdu_len > 0) && (msg_data = alloc_data())) {
+                memcpy(&(msg_data->src), &pkt->address,
+                    sizeof(pkt->address));
                 msg_data->src.adr[0] = msg_data->src.mac[0];
                 msg_data->src.len = 1;
-                msg_data->pdu = (uint8_t *) malloc(pdu_len);
-                memmove(msg_data->pdu,
-                    (const void *) &(shared_port_data.Receive_Packet.pdu),
-                    pdu_len);
+                memcpy(msg_data->pdu, pkt->pdu, pdu_len);
                 msg_data->pdu_len = pdu_len;
 
                 msg_storage.type = DATA;
@@ -156,9 +187,11 @@ void *dl_mstp_thread(
                     free_data(msg_data);
                 }
             }
+            dlmstp_packet_release(&mstp_port, pkt);
         }
     }
 
+    close(epoll_fd);
     dlmstp_cleanup(&mstp_port);
     port->state = FINISHED;
 
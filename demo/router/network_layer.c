@@ -26,6 +26,7 @@ uint16_t process_network_message(
     uint8_t ** buff)
 {
 
+    MSG_DATA *in_data = (MSG_DATA *) msg->data;
     BACNET_NPDU_DATA npdu_data;
     ROUTER_PORT *srcport;
     ROUTER_PORT *destport;
@@ -35,10 +36,11 @@ uint16_t process_network_message(
     int apdu_offset;
     int apdu_len;
 
-    memmove(data, msg->data, sizeof(MSG_DATA));
+    /* the reply is built in data, from the received message */
+    memmove(&data->src, &in_data->src, sizeof(BACNET_ADDRESS));
 
-    apdu_offset = npdu_decode(data->pdu, &data->dest, NULL, &npdu_data);
-    apdu_len = data->pdu_len - apdu_offset;
+    apdu_offset = npdu_decode(in_data->pdu, &data->dest, NULL, &npdu_data);
+    apdu_len = in_data->pdu_len - apdu_offset;
 
     srcport = find_snet(msg->origin);
     data->src.net = srcport->route_info.net;
@@ -49,7 +51,7 @@ uint16_t process_network_message(
             PRINT(INFO, "Recieved Who-Is-Router-To-Network message\n");
             if (apdu_len) {
                 /* if NET specified */
-                decode_unsigned16(&data->pdu[apdu_offset], &net);
+                decode_unsigned16(&in_data->pdu[apdu_offset], &net);
                 if (srcport->route_info.net == net) {
                     PRINT(INFO, "Message discarded: NET directly connected\n");
                     return -2;
@@ -83,8 +85,8 @@ uint16_t process_network_message(
                 int net_count = apdu_len / 2;
                 int i;
                 for (i = 0; i < net_count; i++) {
-                    decode_unsigned16(&data->pdu[apdu_offset + 2 * i], &net);   /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
+                    decode_unsigned16(&in_data->pdu[apdu_offset + 2 * i], &net);   /* decode received NET values */
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
                 }
                 break;
             }
@@ -92,13 +94,19 @@ uint16_t process_network_message(
             {
                 /* first octet of the message contains rejection reason */
                 /* next two octets contain NET (can be decoded for additional info on error) */
-                error_code = data->pdu[apdu_offset];
+                error_code = in_data->pdu[apdu_offset];
                 switch (error_code) {
                     case 0:
                         PRINT(ERROR, "Error!\n");
                         break;
                     case 1:
                         PRINT(ERROR, "Error: Network unreachable\n");
+                        /* search for the network again when it is next used */
+                        if (apdu_len >= 3) {
+                            decode_unsigned16(&in_data->pdu[apdu_offset + 1],
+                                &net);
+                            del_dnet(net);
+                        }
                         break;
                     case 2:
                         PRINT(ERROR, "Error: Network is busy\n");
@@ -114,14 +122,14 @@ uint16_t process_network_message(
             }
         case NETWORK_MESSAGE_INIT_RT_TABLE:
             PRINT(INFO, "Recieved Initialize-Routing-Table message\n");
-            if (data->pdu[apdu_offset] > 0) {
-                int net_count = data->pdu[apdu_offset];
+            if (in_data->pdu[apdu_offset] > 0) {
+                int net_count = in_data->pdu[apdu_offset];
                 while (net_count--) {
                     int i = 1;
-                    decode_unsigned16(&data->pdu[apdu_offset + i], &net);       /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
-                    if (data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
-                        i = data->pdu[apdu_offset + i + 3] + 4;
+                    decode_unsigned16(&in_data->pdu[apdu_offset + i], &net);       /* decode received NET values */
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
+                    if (in_data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
+                        i = in_data->pdu[apdu_offset + i + 3] + 4;
                     else
                         i = i + 4;
                 }
@@ -136,24 +144,43 @@ uint16_t process_network_message(
 
         case NETWORK_MESSAGE_INIT_RT_TABLE_ACK:
             PRINT(INFO, "Recieved Initialize-Routing-Table-Ack message\n");
-            if (data->pdu[apdu_offset] > 0) {
-                int net_count = data->pdu[apdu_offset];
+            if (in_data->pdu[apdu_offset] > 0) {
+                int net_count = in_data->pdu[apdu_offset];
                 while (net_count--) {
                     int i = 1;
-                    decode_unsigned16(&data->pdu[apdu_offset + i], &net);       /* decode received NET values */
-                    add_dnet(&srcport->route_info, net, data->src);     /* and update routing table */
-                    if (data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
-                        i = data->pdu[apdu_offset + i + 3] + 4;
+                    decode_unsigned16(&in_data->pdu[apdu_offset + i], &net);       /* decode received NET values */
+                    add_dnet(srcport, net, data->src);  /* and update routing table */
+                    if (in_data->pdu[apdu_offset + i + 3] > 0)     /* find next NET value */
+                        i = in_data->pdu[apdu_offset + i + 3] + 4;
                     else
                         i = i + 4;
                 }
             }
             break;
 
-        case NETWORK_MESSAGE_INVALID:
-        case NETWORK_MESSAGE_I_COULD_BE_ROUTER_TO_NETWORK:
         case NETWORK_MESSAGE_ROUTER_BUSY_TO_NETWORK:
         case NETWORK_MESSAGE_ROUTER_AVAILABLE_TO_NETWORK:
+            {
+                bool available =
+                    (npdu_data.network_message_type ==
+                    NETWORK_MESSAGE_ROUTER_AVAILABLE_TO_NETWORK);
+                int net_count = apdu_len / 2;
+                int i;
+                PRINT(INFO, "Recieved Router-%s-To-Network message\n",
+                    available ? "Available" : "Busy");
+                /* without a list, it is about all of that router's
+                   networks */
+                if (net_count == 0)
+                    set_router_dnets_state(srcport, data->src, available);
+                for (i = 0; i < net_count; i++) {
+                    decode_unsigned16(&in_data->pdu[apdu_offset + 2 * i], &net);
+                    set_dnet_state(net, available);
+                }
+                break;
+            }
+
+        case NETWORK_MESSAGE_INVALID:
+        case NETWORK_MESSAGE_I_COULD_BE_ROUTER_TO_NETWORK:
         case NETWORK_MESSAGE_ESTABLISH_CONNECTION_TO_NETWORK:
         case NETWORK_MESSAGE_DISCONNECT_CONNECTION_TO_NETWORK:
             /* hell if I know what to do with these messages */
@@ -167,6 +194,23 @@ uint16_t process_network_message(
     return buff_len;
 }
 
+/* the largest NPDU every router port can carry, since a network message
+   is sent out of all of them: an MS/TP frame holds 501 octets */
+static int16_t min_port_npdu(
+    void)
+{
+    ROUTER_PORT *port = head;
+    int16_t npdu_max = MSG_DATA_PDU_SIZE;
+
+    while (port != NULL) {
+        if ((port->type == MSTP) && (npdu_max > MSTP_NPDU_MAX))
+            npdu_max = MSTP_NPDU_MAX;
+        port = port->next;
+    }
+
+    return npdu_max;
+}
+
 uint16_t create_network_message(
     BACNET_NETWORK_MESSAGE_TYPE network_message_type,
     MSG_DATA * data,
@@ -182,7 +226,7 @@ uint16_t create_network_message(
         data_expecting_reply = true;
     init_npdu(&npdu_data, network_message_type, data_expecting_reply);
 
-    *buff = (uint8_t *) malloc(128);    /* resolve different length */
+    *buff = data->pdu;
 
     /* manual destination setup for Init-RT-Table-Ack message */
     data->dest.net = BACNET_BROADCAST_NETWORK;
@@ -206,27 +250,24 @@ uint16_t create_network_message(
             } else {
                 ROUTER_PORT *port = head;
                 DNET *dnet;
-                while (port != NULL) {
+                /* as many networks as fit on the smallest port; the
+                   rest can still be asked for one by one */
+                int16_t npdu_max = min_port_npdu();
+                while ((port != NULL) && ((buff_len + 2) <= npdu_max)) {
                     if (port->route_info.net != data->src.net) {
                         buff_len +=
                             encode_unsigned16(*buff + buff_len,
                             port->route_info.net);
-                        dnet = port->route_info.dnets;
-                        while (dnet != NULL) {
-                            buff_len +=
-                                encode_unsigned16(*buff + buff_len, dnet->net);
-                            dnet = dnet->next;
-                        }
-                        port = port->next;
-                    } else {
-                        dnet = port->route_info.dnets;
-                        while (dnet != NULL) {
-                            buff_len +=
-                                encode_unsigned16(*buff + buff_len, dnet->net);
-                            dnet = dnet->next;
-                        }
-                        port = port->next;
                     }
+                    port = port->next;
+                }
+                dnet = next_dnet(NULL);
+                while ((dnet != NULL) && ((buff_len + 2) <= npdu_max)) {
+                    if (dnet->state) {
+                        buff_len +=
+                            encode_unsigned16(*buff + buff_len, dnet->net);
+                    }
+                    dnet = next_dnet(dnet);
                 }
             }
             break;
@@ -285,28 +326,35 @@ void send_network_message(
     int16_t buff_len;
 
     if (!data) {
-        data = (MSG_DATA *) malloc(sizeof(MSG_DATA));
+        data = alloc_data();
+        if (!data) {
+            return;
+        }
         data->dest.net = BACNET_BROADCAST_NETWORK;
     }
 
     buff_len = create_network_message(network_message_type, data, buff, val);
 
     /* form network message */
-    data->pdu = *buff;
     data->pdu_len = buff_len;
     msg.origin = head->main_id;
     msg.type = DATA;
     msg.data = data;
 
-    data->ref_count = port_count;
+    /* each port gets a reference, and the one held here is dropped
+       once they all have it */
     while (port != NULL) {
         if (port->state == FINISHED) {
             port = port->next;
             continue;
         }
-        send_to_msgbox(port->port_id, &msg);
+        hold_data(data);
+        if (!send_to_msgbox(port->port_id, &msg)) {
+            check_data(data);
+        }
         port = port->next;
     }
+    check_data(data);
 }
 
 void init_npdu(
@@ -28,6 +28,9 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include "net.h"
 #include "portthread.h"
 
+/* the most data octets an MS/TP frame holds */
+#define MSTP_NPDU_MAX 501
+
 uint16_t process_network_message(
     BACMSG * msg,
     MSG_DATA * data,
@@ -17,6 +17,7 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "hashtab.h"
 #include "portthread.h"
 
 ROUTER_PORT *find_snet(
@@ -34,6 +35,69 @@ ROUTER_PORT *find_snet(
     return NULL;
 }
 
+/* the routing table: a power of 2 entries, at most half of them used */
+static DNET *Dnet_Table;
+static unsigned Dnet_Bits;
+static unsigned Dnet_Count;
+
+#define DNET_MIN_BITS 6
+#define DNET_MAX_BITS 17
+
+/* the entry for a network, or NULL */
+static DNET *dnet_lookup(
+    uint16_t net)
+{
+    unsigned i;
+
+    if (!Dnet_Table || (net == 0))
+        return NULL;
+
+    for (i = hash_table_home(net, Dnet_Bits); Dnet_Table[i].net;
+        i = hash_table_next(i, Dnet_Bits)) {
+        if (Dnet_Table[i].net == net)
+            return &Dnet_Table[i];
+    }
+
+    return NULL;
+}
+
+/* the free entry to put a network in, after making room for it */
+static DNET *dnet_insert_slot(
+    uint16_t net)
+{
+    DNET *old_table = Dnet_Table;
+    unsigned old_size = old_table ? (1u << Dnet_Bits) : 0;
+    unsigned bits = hash_table_bits(Dnet_Count, old_table ? Dnet_Bits : 0,
+        DNET_MIN_BITS, DNET_MAX_BITS);
+    unsigned i;
+
+    if (bits == 0)
+        return NULL;
+    if (!old_table || (bits != Dnet_Bits)) {
+        Dnet_Table = (DNET *) calloc(1u << bits, sizeof(DNET));
+        if (!Dnet_Table) {
+            Dnet_Table = old_table;
+            return NULL;
+        }
+        Dnet_Bits = bits;
+        for (i = 0; i < old_size; i++) {
+            if (old_table[i].net) {
+                unsigned j = hash_table_home(old_table[i].net, Dnet_Bits);
+
+                while (Dnet_Table[j].net)
+                    j = hash_table_next(j, Dnet_Bits);
+                Dnet_Table[j] = old_table[i];
+            }
+        }
+        free(old_table);
+    }
+
+    for (i = hash_table_home(net, Dnet_Bits); Dnet_Table[i].net;
+        i = hash_table_next(i, Dnet_Bits));
+
+    return &Dnet_Table[i];
+}
+
 ROUTER_PORT *find_dnet(
     uint16_t net,
     BACNET_ADDRESS * addr)
@@ -46,75 +110,161 @@ ROUTER_PORT *find_dnet(
     if (net == BACNET_BROADCAST_NETWORK)
         return port;
 
+    /* check if DNET is directly connected to the router */
     while (port != NULL) {
-
-        /* check if DNET is directly connected to the router */
         if (net == port->route_info.net)
             return port;
+        port = port->next;
+    }
 
-        /* else search router ports DNET list */
-        else if (port->route_info.dnets) {
-            dnet = port->route_info.dnets;
-            while (dnet != NULL) {
-                if (net == dnet->net) {
-                    if (addr) {
-                        memmove(&addr->len, &dnet->mac_len, 1);
-                        memmove(&addr->adr[0], &dnet->mac[0], MAX_MAC_LEN);
-                    }
-                    return port;
-                }
-                dnet = dnet->next;
-            }
+    /* else look it up in the routing table */
+    dnet = dnet_lookup(net);
+    if (dnet && dnet->state) {
+        if (addr) {
+            memmove(&addr->len, &dnet->mac_len, 1);
+            memmove(&addr->adr[0], &dnet->mac[0], MAX_MAC_LEN);
         }
-        port = port->next;
+        return dnet->port;
     }
 
     return NULL;
 }
 
 void add_dnet(
-    RT_ENTRY * route_info,
+    ROUTER_PORT * port,
     uint16_t net,
     BACNET_ADDRESS addr)
 {
 
-    DNET *dnet = route_info->dnets;
-    DNET *tmp;
+    ROUTER_PORT *local = head;
+    DNET *dnet;
+
+    if ((net == 0) || (net == BACNET_BROADCAST_NETWORK))
+        return;
+    /* directly connected networks are not learned */
+    while (local != NULL) {
+        if (local->route_info.net == net)
+            return;
+        local = local->next;
+    }
 
+    dnet = dnet_lookup(net);
     if (dnet == NULL) {
-        route_info->dnets = (DNET *) malloc(sizeof(DNET));
-        memmove(&route_info->dnets->mac_len, &addr.len, 1);
-        memmove(&route_info->dnets->mac[0], &addr.adr[0], MAX_MAC_LEN);
-        route_info->dnets->net = net;
-        route_info->dnets->state = true;
-        route_info->dnets->next = NULL;
-    } else {
-
-        while (dnet != NULL) {
-            if (dnet->net == net)       /* make sure NETs are not repeated */
-                return;
-            tmp = dnet;
-            dnet = dnet->next;
+        dnet = dnet_insert_slot(net);
+        if (dnet == NULL)
+            return;
+        dnet->net = net;
+        Dnet_Count++;
+    }
+    /* the latest router to announce the network is the route to it */
+    dnet->port = port;
+    memmove(&dnet->mac_len, &addr.len, 1);
+    memmove(&dnet->mac[0], &addr.adr[0], MAX_MAC_LEN);
+    dnet->state = true;
+    dnet->updated = time(NULL);
+}
+
+bool set_dnet_state(
+    uint16_t net,
+    bool state)
+{
+    DNET *dnet = dnet_lookup(net);
+
+    if (dnet == NULL)
+        return false;
+    dnet->state = state;
+
+    return true;
+}
+
+void set_router_dnets_state(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS addr,
+    bool state)
+{
+    unsigned i;
+
+    if (!Dnet_Table)
+        return;
+    for (i = 0; i < (1u << Dnet_Bits); i++) {
+        if (Dnet_Table[i].net && (Dnet_Table[i].port == port) &&
+            (Dnet_Table[i].mac_len == addr.len) &&
+            (memcmp(Dnet_Table[i].mac, addr.adr, addr.len) == 0))
+            Dnet_Table[i].state = state;
+    }
+}
+
+void del_dnet(
+    uint16_t net)
+{
+    DNET *dnet = dnet_lookup(net);
+    unsigned i;
+    unsigned j;
+
+    if (dnet == NULL)
+        return;
+
+    /* shift back the entries after it that probed past it, so that
+       lookups never need to skip over deleted entries */
+    i = (unsigned) (dnet - Dnet_Table);
+    for (j = hash_table_next(i, Dnet_Bits); Dnet_Table[j].net;
+        j = hash_table_next(j, Dnet_Bits)) {
+        if (hash_table_shift(hash_table_home(Dnet_Table[j].net, Dnet_Bits),
+                i, j, Dnet_Bits)) {
+            Dnet_Table[i] = Dnet_Table[j];
+            i = j;
+        }
+    }
+    memset(&Dnet_Table[i], 0, sizeof(DNET));
+    Dnet_Count--;
+}
+
+unsigned age_dnets(
+    time_t now)
+{
+    unsigned count = 0;
+    unsigned i = 0;
+
+    if (!Dnet_Table)
+        return 0;
+
+    /* deleting shifts a later entry back into i, so look at i again */
+    while (i < (1u << Dnet_Bits)) {
+        if (Dnet_Table[i].net &&
+            ((now - Dnet_Table[i].updated) > DNET_MAX_AGE)) {
+            del_dnet(Dnet_Table[i].net);
+            count++;
+        } else {
+            i++;
         }
+    }
 
-        dnet = (DNET *) malloc(sizeof(DNET));
-        memmove(&dnet->mac_len, &addr.len, 1);
-        memmove(&dnet->mac[0], &addr.adr[0], MAX_MAC_LEN);
-        dnet->net = net;
-        dnet->state = true;
-        dnet->next = NULL;
-        tmp->next = dnet;
+    return count;
+}
+
+DNET *next_dnet(
+    DNET * dnet)
+{
+    unsigned i;
+
+    if (!Dnet_Table)
+        return NULL;
+
+    i = dnet ? (unsigned) (dnet - Dnet_Table) + 1 : 0;
+    for (; i < (1u << Dnet_Bits); i++) {
+        if (Dnet_Table[i].net)
+            return &Dnet_Table[i];
     }
+
+    return NULL;
 }
 
 void cleanup_dnets(
-    DNET * dnets)
+    void)
 {
 
-    DNET *dnet = dnets;
-    while (dnet != NULL) {
-        dnet = dnet->next;
-        free(dnets);
-        dnets = dnet;
-    }
+    free(Dnet_Table);
+    Dnet_Table = NULL;
+    Dnet_Bits = 0;
+    Dnet_Count = 0;
 }
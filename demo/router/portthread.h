@@ -20,6 +20,7 @@ Copyright (C) 2012  Andriy Sukhynyuk, Vasyl Tkhir, Andriy Ivasiv
 #include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <time.h>
 #include "msgqueue.h"
 #include "bacdef.h"
 #include "npdu.h"
@@ -73,13 +74,20 @@ typedef union _port_params {
     } mstp_params;
 } PORT_PARAMS;
 
-/* list node for reacheble networks */
+/* networks reached through other routers are kept in one table, open
+   addressed by network number, so that routing a PDU or learning a
+   network takes a probe or two however many networks there are */
+/* seconds a learned network is kept without being announced again */
+#define DNET_MAX_AGE 1800
+
+/* routing table entry for a reacheble network */
 typedef struct _dnet {
-    uint8_t mac[MAX_MAC_LEN];
+    struct _port *port; /* the router port it is reached through */
+    uint8_t mac[MAX_MAC_LEN];   /* of the next router on that port */
     uint8_t mac_len;
-    uint16_t net;
-    bool state; /* enabled or disabled */
-    struct _dnet *next;
+    uint16_t net;       /* zero while the entry is free */
+    bool state; /* enabled or disabled, e.g. while the router is busy */
+    time_t updated;     /* when last learned, for aging */
 } DNET;
 
 /* information for routing table */
@@ -87,7 +95,6 @@ typedef struct _routing_table_entry {
     uint8_t mac[MAX_MAC_LEN];
     uint8_t mac_len;
     uint16_t net;
-    DNET *dnets;
 } RT_ENTRY;
 
 typedef struct _port {
@@ -114,13 +121,39 @@ ROUTER_PORT *find_dnet(
     uint16_t net,
     BACNET_ADDRESS * addr);
 
-/* add reacheble network for specified router port */
+/* add reacheble network for specified router port, or refresh it */
 void add_dnet(
-    RT_ENTRY * route_info,
+    ROUTER_PORT * port,
     uint16_t net,
     BACNET_ADDRESS addr);
 
+/* enable or disable a reacheble network, returns false if unknown */
+bool set_dnet_state(
+    uint16_t net,
+    bool state);
+
+/* enable or disable every network learned from the router at addr on
+   port */
+void set_router_dnets_state(
+    ROUTER_PORT * port,
+    BACNET_ADDRESS addr,
+    bool state);
+
+/* forget a reacheble network */
+void del_dnet(
+    uint16_t net);
+
+/* forget the networks not learned again since DNET_MAX_AGE before now,
+   returns how many */
+unsigned age_dnets(
+    time_t now);
+
+/* walk the reacheble networks: the first with NULL, then the next one
+   after dnet, or NULL at the end. The table must not change meanwhile. */
+DNET *next_dnet(
+    DNET * dnet);
+
 void cleanup_dnets(
-    DNET * dnets);
+    void);
 
 #endif /* end of PORTTHREAD_H */
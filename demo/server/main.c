@@ -26,8 +26,10 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <time.h>
+#include <poll.h>
 
 #include "config.h"
 #include "server.h"
@@ -60,6 +62,7 @@
 #include "bacfile.h"
 #endif /* defined(BACFILE) */
 #include "ucix.h"
+#include "keylist.h"
 #include "ai.h"
 #include "ao.h"
 #include "av.h"
@@ -77,292 +80,485 @@
 /** @addtogroup ServerDemo */
 /*@{*/
 
+#if defined(BACDL_BIP) && !(defined(BBMD_ENABLED) && BBMD_ENABLED)
+/* receive a batch of packets at a time, and decode them in place */
+#define SERVER_RECEIVE_BATCH 1
+#else
 /** Buffer used for receiving */
 static uint8_t Rx_Buf[MAX_MPDU] = { 0 };
+#endif
+
+/* the values of a section when it was last applied */
+typedef struct uci_Snapshot {
+	char value[16];
+	int Out_Of_Service;
+} uci_snapshot_t;
+
+/* the uci configs of the objects that are updated from uci */
+static struct uci_Config {
+	char *section;
+	char *type;
+	BACNET_OBJECT_TYPE object_type;
+	/* modification time, when checking instead of watching */
+	time_t mtime;
+	/* uci_snapshot_t of the sections applied, by object instance */
+	OS_Keylist snapshot;
+} uci_Configs[] = {
+	{"bacnet_ai", "ai", OBJECT_ANALOG_INPUT, 0, NULL},
+	{"bacnet_ao", "ao", OBJECT_ANALOG_OUTPUT, 0, NULL},
+	{"bacnet_av", "av", OBJECT_ANALOG_VALUE, 0, NULL},
+	{"bacnet_bi", "bi", OBJECT_BINARY_INPUT, 0, NULL},
+	{"bacnet_bo", "bo", OBJECT_BINARY_OUTPUT, 0, NULL},
+	{"bacnet_bv", "bv", OBJECT_BINARY_VALUE, 0, NULL},
+	{"bacnet_mi", "mi", OBJECT_MULTI_STATE_INPUT, 0, NULL},
+	{"bacnet_mo", "mo", OBJECT_MULTI_STATE_OUTPUT, 0, NULL},
+	{"bacnet_mv", "mv", OBJECT_MULTI_STATE_VALUE, 0, NULL}
+};
+#define UCI_CONFIGS (sizeof(uci_Configs)/sizeof(uci_Configs[0]))
+
+/* inotify descriptor of the uci config watch, or -1 */
+static int uci_Watch_fd = -1;
+
+/* compare a section with the snapshot of when it was last applied,
+ * and take a new snapshot if it differs, returns true if it differs */
+static bool uci_Snapshot_Changed(
+	struct uci_Config *config,
+	uint32_t instance,
+	value_tuple_t *cur
+	)
+{
+	uci_snapshot_t *snapshot;
+
+	if (!config->snapshot) {
+		config->snapshot = Keylist_Create();
+		if (!config->snapshot)
+			return true;
+	}
+	snapshot = Keylist_Data(config->snapshot, instance);
+	if (snapshot) {
+		if ((memcmp(snapshot->value, cur->value,
+			sizeof(snapshot->value)) == 0) &&
+			(snapshot->Out_Of_Service == cur->Out_Of_Service))
+			return false;
+	} else {
+		snapshot = calloc(1, sizeof(uci_snapshot_t));
+		if (!snapshot)
+			return true;
+		if (Keylist_Data_Add(config->snapshot, instance, snapshot) < 0) {
+			free(snapshot);
+			return true;
+		}
+	}
+	memcpy(snapshot->value, cur->value, sizeof(snapshot->value));
+	snapshot->Out_Of_Service = cur->Out_Of_Service;
+	return true;
+}
 
-static time_t uci_Update(
-	time_t ucimodtime,
-	BACNET_OBJECT_TYPE update_object_type,
-	int ucirewrite
+/* reload the values of one object type from its uci config, only the
+ * sections that changed are applied, and the object setters flag the
+ * objects that changed for COV */
+static void uci_Update(
+	struct uci_Config *config
 	)
 {
 	float val_f, pval_f;
 	int val_i, pval_i;
 	char *section;
 	char *type;
-	time_t chk_mtime = 0;
 	struct uci_context *ctx;
 	int uci_idx = 0;
+	BACNET_OBJECT_TYPE update_object_type;
+	struct uci_itr_ctx itr;
+	value_tuple_t *cur;
 	/* update Value from uci */
-	section = NULL;
-	type = NULL;
-	if (update_object_type == OBJECT_ANALOG_INPUT) {
-		section = "bacnet_ai";
-		type = "ai";
-	} else if (update_object_type == OBJECT_ANALOG_OUTPUT) {
-		section = "bacnet_ao";
-		type = "ao";
-	} else if (update_object_type == OBJECT_ANALOG_VALUE) {
-		section = "bacnet_av";
-		type = "av";
-	} else if (update_object_type == OBJECT_BINARY_INPUT) {
-		section = "bacnet_bi";
-		type = "bi";
-	} else if (update_object_type == OBJECT_BINARY_OUTPUT) {
-		section = "bacnet_bo";
-		type = "bo";
-	} else if (update_object_type == OBJECT_BINARY_VALUE) {
-		section = "bacnet_bv";
-		type = "bv";
-	} else if (update_object_type == OBJECT_MULTI_STATE_INPUT) {
-		section = "bacnet_mi";
-		type = "mi";
-	} else if (update_object_type == OBJECT_MULTI_STATE_OUTPUT) {
-		section = "bacnet_mo";
-		type = "mo";
-	} else if (update_object_type == OBJECT_MULTI_STATE_VALUE) {
-		section = "bacnet_mv";
-		type = "mv";
-	} else {
-		return 0;
-	}
-	if ( ucirewrite == 0) {
-		chk_mtime = ucimodtime;
-#if PRINT_ENABLED
-		printf("rewrite %s\n", type);
-#endif
-	} else {
-		chk_mtime = check_uci_update(section, ucimodtime);
-	}
-	if(chk_mtime != 0) {
-		sleep(1);
-		ucimodtime = chk_mtime;
+	section = config->section;
+	type = config->type;
+	update_object_type = config->object_type;
 #if PRINT_ENABLED
-		printf("Config changed, reloading %s\n",section);
+	printf("Config changed, reloading %s\n",section);
 #endif
-		ctx = ucix_init(section);
-		struct uci_itr_ctx itr;
-		value_tuple_t *cur;
-		itr.list = NULL;
-		itr.section = section;
-		itr.ctx = ctx;
-		ucix_for_each_section_type(ctx, section, type,
-			(void *)load_value, &itr);
-		for( cur = itr.list; cur; cur = cur->next ) {
+	ctx = ucix_init(section);
+	if (!ctx)
+		return;
+	itr.list = NULL;
+	itr.section = section;
+	itr.ctx = ctx;
+	ucix_for_each_section_type(ctx, section, type,
+		(void *)load_value, &itr);
+	for( cur = itr.list; cur; cur = cur->next ) {
 #if PRINT_ENABLED
-			printf("section %s idx %s \n", section, cur->idx);
+		printf("section %s idx %s \n", section, cur->idx);
 #endif
-			uci_idx = atoi(cur->idx);
+		uci_idx = atoi(cur->idx);
+		if (!uci_Snapshot_Changed(config, uci_idx, cur))
+			continue;
 #if PRINT_ENABLED
-			printf("idx %s ",cur->idx);
-			printf("value %s\n",cur->value);
+		printf("idx %s ",cur->idx);
+		printf("value %s\n",cur->value);
 #endif
 /* update Analog Input from uci */
-			if (update_object_type == OBJECT_ANALOG_INPUT) {
-				val_f = strtof(cur->value,NULL);
-				pval_f = Analog_Input_Present_Value(uci_idx);
-				if ( val_f != pval_f ) {
-					Analog_Input_Present_Value_Set(uci_idx,val_f,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Analog_Input_Out_Of_Service(uci_idx))
-						Analog_Input_Out_Of_Service_Set(uci_idx,0);
-					if (Analog_Input_Reliability(uci_idx))
-						Analog_Input_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		if (update_object_type == OBJECT_ANALOG_INPUT) {
+			val_f = strtof(cur->value,NULL);
+			pval_f = Analog_Input_Present_Value(uci_idx);
+			if ( val_f != pval_f ) {
+				Analog_Input_Present_Value_Set(uci_idx,val_f,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Analog_Input_Out_Of_Service(uci_idx))
+					Analog_Input_Out_Of_Service_Set(uci_idx,0);
+				if (Analog_Input_Reliability(uci_idx))
+					Analog_Input_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Analog_Input_Out_Of_Service_Set(uci_idx,1);
-					Analog_Input_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Analog_Input_Out_Of_Service_Set(uci_idx,1);
+				Analog_Input_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Analog Output from uci */
-			} else if (update_object_type == OBJECT_ANALOG_OUTPUT) {
-				val_f = strtof(cur->value,NULL);
-				pval_f = Analog_Output_Present_Value(uci_idx);
-				if ( val_f != pval_f ) {
-					Analog_Output_Present_Value_Set(uci_idx,val_f,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Analog_Output_Out_Of_Service(uci_idx))
-						Analog_Output_Out_Of_Service_Set(uci_idx,0);
-					if (Analog_Output_Reliability(uci_idx))
-						Analog_Output_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_ANALOG_OUTPUT) {
+			val_f = strtof(cur->value,NULL);
+			pval_f = Analog_Output_Present_Value(uci_idx);
+			if ( val_f != pval_f ) {
+				Analog_Output_Present_Value_Set(uci_idx,val_f,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Analog_Output_Out_Of_Service(uci_idx))
+					Analog_Output_Out_Of_Service_Set(uci_idx,0);
+				if (Analog_Output_Reliability(uci_idx))
+					Analog_Output_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Analog_Output_Out_Of_Service_Set(uci_idx,1);
-					Analog_Output_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Analog_Output_Out_Of_Service_Set(uci_idx,1);
+				Analog_Output_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Analog Value from uci */
-			} else if (update_object_type == OBJECT_ANALOG_VALUE) {
-				val_f = strtof(cur->value,NULL);
-				pval_f = Analog_Value_Present_Value(uci_idx);
-				if ( val_f != pval_f ) {
-					Analog_Value_Present_Value_Set(uci_idx,val_f,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Analog_Value_Out_Of_Service(uci_idx))
-						Analog_Value_Out_Of_Service_Set(uci_idx,0);
-					if (Analog_Value_Reliability(uci_idx))
-						Analog_Value_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_ANALOG_VALUE) {
+			val_f = strtof(cur->value,NULL);
+			pval_f = Analog_Value_Present_Value(uci_idx);
+			if ( val_f != pval_f ) {
+				Analog_Value_Present_Value_Set(uci_idx,val_f,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Analog_Value_Out_Of_Service(uci_idx))
+					Analog_Value_Out_Of_Service_Set(uci_idx,0);
+				if (Analog_Value_Reliability(uci_idx))
+					Analog_Value_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Analog_Value_Out_Of_Service_Set(uci_idx,1);
-					Analog_Value_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Analog_Value_Out_Of_Service_Set(uci_idx,1);
+				Analog_Value_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Binary Input from uci */
-			} else if (update_object_type == OBJECT_BINARY_INPUT) {
-				val_i = atoi(cur->value);
-				pval_i = Binary_Input_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Binary_Input_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Binary_Input_Out_Of_Service(uci_idx))
-						Binary_Input_Out_Of_Service_Set(uci_idx,0);
-					if (Binary_Input_Reliability(uci_idx))
-						Binary_Input_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_BINARY_INPUT) {
+			val_i = atoi(cur->value);
+			pval_i = Binary_Input_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Binary_Input_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Binary_Input_Out_Of_Service(uci_idx))
+					Binary_Input_Out_Of_Service_Set(uci_idx,0);
+				if (Binary_Input_Reliability(uci_idx))
+					Binary_Input_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Binary_Input_Out_Of_Service_Set(uci_idx,1);
-					Binary_Input_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Binary_Input_Out_Of_Service_Set(uci_idx,1);
+				Binary_Input_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Binary Output from uci */
-			} else if (update_object_type == OBJECT_BINARY_OUTPUT) {
-				val_i = atoi(cur->value);
-				pval_i = Binary_Output_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Binary_Output_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Binary_Output_Out_Of_Service(uci_idx))
-						Binary_Output_Out_Of_Service_Set(uci_idx,0);
-					if (Binary_Output_Reliability(uci_idx))
-						Binary_Output_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_BINARY_OUTPUT) {
+			val_i = atoi(cur->value);
+			pval_i = Binary_Output_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Binary_Output_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Binary_Output_Out_Of_Service(uci_idx))
+					Binary_Output_Out_Of_Service_Set(uci_idx,0);
+				if (Binary_Output_Reliability(uci_idx))
+					Binary_Output_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Binary_Output_Out_Of_Service_Set(uci_idx,1);
-					Binary_Output_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Binary_Output_Out_Of_Service_Set(uci_idx,1);
+				Binary_Output_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Binary Value from uci */
-			} else if (update_object_type == OBJECT_BINARY_VALUE) {
-				val_i = atoi(cur->value);
-				pval_i = Binary_Value_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Binary_Value_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Binary_Value_Out_Of_Service(uci_idx))
-						Binary_Value_Out_Of_Service_Set(uci_idx,0);
-					if (Binary_Value_Reliability(uci_idx))
-						Binary_Value_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_BINARY_VALUE) {
+			val_i = atoi(cur->value);
+			pval_i = Binary_Value_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Binary_Value_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Binary_Value_Out_Of_Service(uci_idx))
+					Binary_Value_Out_Of_Service_Set(uci_idx,0);
+				if (Binary_Value_Reliability(uci_idx))
+					Binary_Value_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Binary_Value_Out_Of_Service_Set(uci_idx,1);
-					Binary_Value_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Binary_Value_Out_Of_Service_Set(uci_idx,1);
+				Binary_Value_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Multistate Input from uci */
-			} else if (update_object_type == OBJECT_MULTI_STATE_INPUT) {
-				val_i = atoi(cur->value);
-				pval_i = Multistate_Input_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Multistate_Input_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Multistate_Input_Out_Of_Service(uci_idx))
-						Multistate_Input_Out_Of_Service_Set(uci_idx,0);
-					if (Multistate_Input_Reliability(uci_idx))
-						Multistate_Input_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_MULTI_STATE_INPUT) {
+			val_i = atoi(cur->value);
+			pval_i = Multistate_Input_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Multistate_Input_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Multistate_Input_Out_Of_Service(uci_idx))
+					Multistate_Input_Out_Of_Service_Set(uci_idx,0);
+				if (Multistate_Input_Reliability(uci_idx))
+					Multistate_Input_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Multistate_Input_Out_Of_Service_Set(uci_idx,1);
-					Multistate_Input_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Multistate_Input_Out_Of_Service_Set(uci_idx,1);
+				Multistate_Input_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Multistate Output from uci */
-			} else if (update_object_type == OBJECT_MULTI_STATE_OUTPUT) {
-				val_i = atoi(cur->value);
-				pval_i = Multistate_Output_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Multistate_Output_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Multistate_Output_Out_Of_Service(uci_idx))
-						Multistate_Output_Out_Of_Service_Set(uci_idx,0);
-					if (Multistate_Output_Reliability(uci_idx))
-						Multistate_Output_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_MULTI_STATE_OUTPUT) {
+			val_i = atoi(cur->value);
+			pval_i = Multistate_Output_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Multistate_Output_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Multistate_Output_Out_Of_Service(uci_idx))
+					Multistate_Output_Out_Of_Service_Set(uci_idx,0);
+				if (Multistate_Output_Reliability(uci_idx))
+					Multistate_Output_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Multistate_Output_Out_Of_Service_Set(uci_idx,1);
-					Multistate_Output_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Multistate_Output_Out_Of_Service_Set(uci_idx,1);
+				Multistate_Output_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
+			}
 /* update Multistate Value from uci */
-			} else if (update_object_type == OBJECT_MULTI_STATE_VALUE) {
-				val_i = atoi(cur->value);
-				pval_i = Multistate_Value_Present_Value(uci_idx);
-				if ( val_i != pval_i ) {
-					Multistate_Value_Present_Value_Set(uci_idx,val_i,16);
-				}
-				if (cur->Out_Of_Service == 0) {
-					if (Multistate_Value_Out_Of_Service(uci_idx))
-						Multistate_Value_Out_Of_Service_Set(uci_idx,0);
-					if (Multistate_Value_Reliability(uci_idx))
-						Multistate_Value_Reliability_Set(uci_idx,
-							RELIABILITY_NO_FAULT_DETECTED);
-				} else {
+		} else if (update_object_type == OBJECT_MULTI_STATE_VALUE) {
+			val_i = atoi(cur->value);
+			pval_i = Multistate_Value_Present_Value(uci_idx);
+			if ( val_i != pval_i ) {
+				Multistate_Value_Present_Value_Set(uci_idx,val_i,16);
+			}
+			if (cur->Out_Of_Service == 0) {
+				if (Multistate_Value_Out_Of_Service(uci_idx))
+					Multistate_Value_Out_Of_Service_Set(uci_idx,0);
+				if (Multistate_Value_Reliability(uci_idx))
+					Multistate_Value_Reliability_Set(uci_idx,
+						RELIABILITY_NO_FAULT_DETECTED);
+			} else {
 #if PRINT_ENABLED
-					printf("idx %s ",cur->idx);
-					printf("Out_Of_Service\n");
+				printf("idx %s ",cur->idx);
+				printf("Out_Of_Service\n");
 #endif
-					Multistate_Value_Out_Of_Service_Set(uci_idx,1);
-					Multistate_Value_Reliability_Set(uci_idx,
-						RELIABILITY_COMMUNICATION_FAILURE);
-				}
+				Multistate_Value_Out_Of_Service_Set(uci_idx,1);
+				Multistate_Value_Reliability_Set(uci_idx,
+					RELIABILITY_COMMUNICATION_FAILURE);
 			}
 		}
-		ucix_cleanup(ctx);
 	}
+	while (itr.list) {
+		cur = itr.list;
+		itr.list = cur->next;
+		free(cur);
+	}
+	ucix_cleanup(ctx);
 	/* update end */
-	return ucimodtime;
 }
 
+/* a uci config file was written */
+static void uci_Changed(
+	const char *config,
+	void *priv
+	)
+{
+	unsigned i;
+
+	(void) priv;
+	for (i = 0; i < UCI_CONFIGS; i++) {
+		if (strcmp(config, uci_Configs[i].section) == 0) {
+			uci_Update(&uci_Configs[i]);
+			break;
+		}
+	}
+}
+
+/* check the modification times, if the configs can not be watched */
+static void uci_Check(
+	void
+	)
+{
+	unsigned i;
+	time_t mtime;
+
+	for (i = 0; i < UCI_CONFIGS; i++) {
+		mtime = check_uci_update(uci_Configs[i].section,
+			uci_Configs[i].mtime);
+		if (mtime != 0) {
+			uci_Configs[i].mtime = mtime;
+			uci_Update(&uci_Configs[i]);
+		}
+	}
+}
+
+
+/** Wait for a packet, handling any changed uci configs meanwhile.
+ * @param src [out] Source of the packet.
+ * @param npdu [out] The NPDU of the packet.
+ * @param timeout [in] Milliseconds to wait, from server_timeout(), so an
+ *  idle server only wakes up when a timer is due.
+ * @return number of bytes received, or 0 on timeout.
+ */
+static uint16_t server_receive(
+    BACNET_ADDRESS * src,
+    uint8_t ** npdu,
+    unsigned timeout)
+{
+#if defined(SERVER_RECEIVE_BATCH)
+    uint16_t pdu_len = 0;
+
+    /* the rest of the last batch comes first */
+    pdu_len = bip_receive_batch_next(src, npdu);
+    if (pdu_len) {
+        return pdu_len;
+    }
+#endif
+#if defined(BACDL_BIP)
+    struct pollfd fds[2];
+
+    if (uci_Watch_fd >= 0) {
+        /* wait on both, so a config change is handled right away */
+        fds[0].fd = bip_socket();
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = uci_Watch_fd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, (int) timeout) <= 0) {
+            return 0;
+        }
+        if (fds[1].revents & POLLIN) {
+            (void) ucix_watch_read(uci_Changed, NULL);
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            return 0;
+        }
+        timeout = 0;
+    }
+#else
+    if (uci_Watch_fd >= 0) {
+        /* the datalink has no descriptor to wait on - just check */
+        (void) ucix_watch_read(uci_Changed, NULL);
+    }
+#endif
+
+#if defined(SERVER_RECEIVE_BATCH)
+    if (bip_receive_batch(timeout)) {
+        return bip_receive_batch_next(src, npdu);
+    }
+
+    return 0;
+#else
+    *npdu = &Rx_Buf[0];
+
+    return datalink_receive(src, &Rx_Buf[0], MAX_MPDU, timeout);
+#endif
+}
+
+/* the house keeping of the main loop is done once a second */
+#define SERVER_TICK_MILLISECONDS 1000
+
+/* monotonic milliseconds, for the timers of the main loop */
+static uint32_t server_milliseconds(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint32_t) ((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+
+/** How long the main loop can wait for a packet before there is work to
+ * do: the COV notifications to send, the next TSM timeout, or the house
+ * keeping.  The timers in seconds are ticked with the house keeping.
+ * @param tick [in] Milliseconds until the next house keeping.
+ * @return milliseconds to wait.
+ */
+static unsigned server_timeout(
+    uint32_t tick)
+{
+    uint64_t timeout = tick;
+    uint32_t next = 0;
+    uint32_t seconds = DEADLINE_NONE;
+
+    if (handler_cov_task_pending()) {
+        return 0;
+    }
+    next = tsm_timer_next_milliseconds();
+    if (next < timeout) {
+        timeout = next;
+    }
+    next = handler_cov_timer_next_seconds();
+    if (next < seconds) {
+        seconds = next;
+    }
+    next = address_cache_timer_next_seconds();
+    if (next < seconds) {
+        seconds = next;
+    }
+    next = trend_log_timer_next_seconds();
+    if (next < seconds) {
+        seconds = next;
+    }
+    if ((seconds > 1) && (seconds != DEADLINE_NONE) &&
+        ((tick + ((uint64_t) (seconds - 1) * SERVER_TICK_MILLISECONDS)) <
+            timeout)) {
+        timeout = tick + ((uint64_t) (seconds - 1) *
+            SERVER_TICK_MILLISECONDS);
+    }
+
+    return (unsigned) timeout;
+}
 
 /** Initialize the handlers we will utilize.
  * @see Device_Init, apdu_set_unconfirmed_handler, apdu_set_confirmed_handler
@@ -444,29 +640,18 @@ int main(
         0
     };  /* address where message came from */
     uint16_t pdu_len = 0;
-    unsigned timeout = 1;       /* milliseconds */
-    time_t last_seconds = 0;
-    time_t current_seconds = 0;
+    uint8_t *npdu = NULL;
+    unsigned timeout = 0;       /* milliseconds */
+    uint32_t last_milliseconds = 0;
+    uint32_t current_milliseconds = 0;
+    uint32_t tick_milliseconds = 0;
     uint32_t elapsed_seconds = 0;
     uint32_t elapsed_milliseconds = 0;
-    uint32_t address_binding_tmr = 0;
     uint32_t recipient_scan_tmr = 0;
     int uci_id = 0;
     struct uci_context *ctx;
-    time_t ucimodtime_bacnet_ai = 0;
-    time_t ucimodtime_bacnet_ao = 0;
-    time_t ucimodtime_bacnet_av = 0;
-    time_t ucimodtime_bacnet_bi = 0;
-    time_t ucimodtime_bacnet_bo = 0;
-    time_t ucimodtime_bacnet_bv = 0;
-    time_t ucimodtime_bacnet_mi = 0;
-    time_t ucimodtime_bacnet_mo = 0;
-    time_t ucimodtime_bacnet_mv = 0;
-    char path[128];
-    struct stat s;
     char *pEnv = NULL;
-    int rewrite = 0;
-    BACNET_OBJECT_TYPE u_object_type;
+    unsigned i = 0;
 
     pEnv = getenv("UCI_SECTION");
     ctx = ucix_init("bacnet_dev");
@@ -485,33 +670,15 @@ int main(
     if(ctx)
         ucix_cleanup(ctx);
 
-	snprintf(path, sizeof(path), "/etc/config/bacnet_ai");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_ai = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_ao");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_ao = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_av");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_av = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_bi");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_bi = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_bo");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_bo = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_bv");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_bi = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_mi");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_mi = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_mo");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_mo = s.st_mtime;
-	snprintf(path, sizeof(path), "/etc/config/bacnet_mv");
-	if( stat(path, &s) > -1 )
-		ucimodtime_bacnet_mv = s.st_mtime;
+    /* wait for changes to the object values in uci */
+    uci_Watch_fd = ucix_watch_init();
+    if (uci_Watch_fd < 0) {
+        for (i = 0; i < UCI_CONFIGS; i++) {
+            uci_Configs[i].mtime = check_uci_update(uci_Configs[i].section, 0);
+        }
+    } else {
+        atexit(ucix_watch_cleanup);
+    }
 
 #if PRINT_ENABLED
     printf("BACnet Server with uci\n" "BACnet Stack Version %s\n"
@@ -525,91 +692,58 @@ int main(
     dlenv_init();
     atexit(datalink_cleanup);
     /* configure the timeout values */
-    last_seconds = time(NULL);
+    last_milliseconds = server_milliseconds();
     /* broadcast an I-Am on startup */
     Send_I_Am(&Handler_Transmit_Buffer[0]);
     /* loop forever */
     for (;;) {
-        /* input */
-        current_seconds = time(NULL);
+        /* wait no longer than until the next timer is due */
+        timeout = server_timeout(SERVER_TICK_MILLISECONDS -
+            tick_milliseconds);
 
         /* returns 0 bytes on timeout */
-        pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, timeout);
+        pdu_len = server_receive(&src, &npdu, timeout);
 
         /* process */
         if (pdu_len) {
-            npdu_handler(&src, &Rx_Buf[0], pdu_len);
+            npdu_handler(&src, npdu, pdu_len);
+        }
+        current_milliseconds = server_milliseconds();
+        elapsed_milliseconds = current_milliseconds - last_milliseconds;
+        last_milliseconds = current_milliseconds;
+        if (elapsed_milliseconds > UINT16_MAX) {
+            elapsed_milliseconds = UINT16_MAX;
         }
+        tsm_timer_milliseconds((uint16_t) elapsed_milliseconds);
         /* at least one second has passed */
-        elapsed_seconds = (uint32_t) (current_seconds - last_seconds);
+        tick_milliseconds += elapsed_milliseconds;
+        elapsed_seconds = tick_milliseconds / SERVER_TICK_MILLISECONDS;
         if (elapsed_seconds) {
-            last_seconds = current_seconds;
+            tick_milliseconds %= SERVER_TICK_MILLISECONDS;
             dcc_timer_seconds(elapsed_seconds);
 #if defined(BACDL_BIP) && BBMD_ENABLED
             bvlc_maintenance_timer(elapsed_seconds);
 #endif
             dlenv_maintenance_timer(elapsed_seconds);
             Load_Control_State_Machine_Handler();
-            elapsed_milliseconds = elapsed_seconds * 1000;
             handler_cov_timer_seconds(elapsed_seconds);
-            tsm_timer_milliseconds(elapsed_milliseconds);
             trend_log_timer(elapsed_seconds);
+            /* only the cache entries that run out are touched */
+            address_cache_timer(elapsed_seconds);
 #if defined(INTRINSIC_REPORTING)
             Device_local_reporting();
+            /* try to find addresses of recipients */
+            recipient_scan_tmr += elapsed_seconds;
+            if (recipient_scan_tmr >= NC_RESCAN_RECIPIENTS_SECS) {
+                Notification_Class_find_recipient();
+                recipient_scan_tmr = 0;
+            }
 #endif
+            if (uci_Watch_fd < 0) {
+                uci_Check();
+            }
         }
         handler_cov_task();
-        /* scan cache address */
-        address_binding_tmr += elapsed_seconds;
-        if (address_binding_tmr >= 60) {
-            address_cache_timer(address_binding_tmr);
-            address_binding_tmr = 0;
-        }
-#if defined(INTRINSIC_REPORTING)
-        /* try to find addresses of recipients */
-        recipient_scan_tmr += elapsed_seconds;
-        if (recipient_scan_tmr >= NC_RESCAN_RECIPIENTS_SECS) {
-            Notification_Class_find_recipient();
-            recipient_scan_tmr = 0;
-        }
-#endif
-//#if false
-        /* output */
-        rewrite++;
-        if (rewrite>100000) {
-#if PRINT_ENABLED
-            printf("rewrite %i\n", rewrite);
-#endif
-            rewrite=0;
-        }
-        /* update Analog Input from uci */
-        u_object_type = OBJECT_ANALOG_INPUT;
-        ucimodtime_bacnet_ai = uci_Update(ucimodtime_bacnet_ai,u_object_type,rewrite);
-        /* update Analog Output from uci */
-        u_object_type = OBJECT_ANALOG_OUTPUT;
-        ucimodtime_bacnet_ao = uci_Update(ucimodtime_bacnet_ao,u_object_type,rewrite);
-        /* update Analog Value from uci */
-        u_object_type = OBJECT_ANALOG_VALUE;
-        ucimodtime_bacnet_av = uci_Update(ucimodtime_bacnet_av,u_object_type,rewrite);
-        /* update Binary Input from uci */
-        u_object_type = OBJECT_BINARY_INPUT;
-        ucimodtime_bacnet_bi = uci_Update(ucimodtime_bacnet_bi,u_object_type,rewrite);
-        /* update Binary Output from uci */
-        u_object_type = OBJECT_BINARY_OUTPUT;
-        ucimodtime_bacnet_bo = uci_Update(ucimodtime_bacnet_bo,u_object_type,rewrite);
-        /* update Binary Output from uci */
-        u_object_type = OBJECT_BINARY_VALUE;
-        ucimodtime_bacnet_bv = uci_Update(ucimodtime_bacnet_bv,u_object_type,rewrite);
-        /* update Multistate Input from uci */
-        u_object_type = OBJECT_MULTI_STATE_INPUT;
-        ucimodtime_bacnet_mi = uci_Update(ucimodtime_bacnet_mi,u_object_type,rewrite);
-        /* update Multistate Output from uci */
-        u_object_type = OBJECT_MULTI_STATE_OUTPUT;
-        ucimodtime_bacnet_mo = uci_Update(ucimodtime_bacnet_mo,u_object_type,rewrite);
-        /* update Multistate Value from uci */
-        u_object_type = OBJECT_MULTI_STATE_VALUE;
-        ucimodtime_bacnet_mv = uci_Update(ucimodtime_bacnet_mv,u_object_type,rewrite);
-//#endif
         /* blink LEDs, Turn on or off outputs, etc */
     }
 
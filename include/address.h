@@ -96,6 +96,9 @@ extern "C" {
     void address_cache_timer(
         uint16_t uSeconds);
 
+    uint32_t address_cache_timer_next_seconds(
+        void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
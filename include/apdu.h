@@ -183,6 +183,14 @@ extern "C" {
         void);
     void apdu_retries_set(
         uint8_t value);
+    uint16_t apdu_segment_timeout(
+        void);
+    void apdu_segment_timeout_set(
+        uint16_t milliseconds);
+    uint8_t apdu_segment_window(
+        void);
+    void apdu_segment_window_set(
+        uint8_t value);
 
     void apdu_handler(
         BACNET_ADDRESS * src,   /* source address */
@@ -80,6 +80,43 @@ extern "C" {
         uint8_t * pdu,  /* PDU data */
         uint16_t max_pdu,       /* amount of space available in the PDU  */
         unsigned timeout);      /* milliseconds to wait for a packet */
+    /* receives a BACnet/IP packet, leaving the NPDU in place */
+    /* returns the number of octets in the NPDU, or zero on failure */
+    uint16_t bip_receive_npdu(
+        BACNET_ADDRESS * src,   /* source address */
+        uint8_t * mtu,  /* buffer for the packet */
+        uint16_t max_mtu,       /* amount of space available in the buffer */
+        unsigned timeout,       /* milliseconds to wait for a packet */
+        uint8_t ** npdu);       /* returns the NPDU within the buffer */
+    /* checks a received BACnet/IP packet and finds its NPDU */
+    uint16_t bip_decode_npdu(
+        BACNET_ADDRESS * src,   /* source address */
+        struct sockaddr_in *sin,        /* address received from */
+        uint8_t * mtu,  /* the packet */
+        uint16_t mtu_len,       /* octets received */
+        uint8_t ** npdu);       /* returns the NPDU within the packet */
+
+    /* note: define the batch receive in your port, where supported */
+    /* receives the packets waiting, up to a batch, with one system call */
+    /* returns the number of packets received */
+    unsigned bip_receive_batch(
+        unsigned timeout);      /* milliseconds to wait for a packet */
+    /* returns the number of octets in the NPDU of the next packet of
+       the batch, or zero when there are no more */
+    uint16_t bip_receive_batch_next(
+        BACNET_ADDRESS * src,   /* source address */
+        uint8_t ** npdu);       /* returns the NPDU within the batch */
+
+    /* note: define the batch send in your port, where supported,
+       and define BIP_SEND_BATCH in its net.h */
+    /* sends one packet to each of the destinations, without blocking */
+    /* returns the number of destinations sent to */
+    unsigned bip_send_mpdu_batch(
+        struct sockaddr_in *dest,       /* destinations in network order */
+        int *result,    /* returns octets sent, or negative errno, for each */
+        unsigned count, /* number of destinations */
+        uint8_t * mtu,  /* the packet */
+        uint16_t mtu_len);      /* octets in the packet */
 
     /* use network byte order for setting */
     void bip_set_port(
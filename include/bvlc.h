@@ -33,6 +33,15 @@
 
 struct sockaddr_in;     /* Defined elsewhere, needed here. */
 
+/* Forwarded-NPDU messages sent by a BBMD to one BDT or FDT entry */
+typedef struct BVLC_Forward_Stats {
+    uint32_t sent;
+    /* the socket was full, so the message was not sent */
+    uint32_t again;
+    /* the message failed for any other reason */
+    uint32_t dropped;
+} BVLC_FORWARD_STATS;
+
 #ifdef __cplusplus
 extern "C" {
 
@@ -41,6 +50,13 @@ extern "C" {
 #if defined(BBMD_ENABLED) && BBMD_ENABLED
     void bvlc_maintenance_timer(
         time_t seconds);
+    /* returns false if the table entry is not valid */
+    bool bvlc_bdt_forward_stats(
+        unsigned index,
+        BVLC_FORWARD_STATS * stats);
+    bool bvlc_fdt_forward_stats(
+        unsigned index,
+        BVLC_FORWARD_STATS * stats);
 #else
 #define bvlc_maintenance_timer(x)
 #endif
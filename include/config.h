@@ -96,11 +96,50 @@
 #if !defined(MAX_TSM_TRANSACTIONS)
 #define MAX_TSM_TRANSACTIONS 255
 #endif
+/* Complex ACKs that are too big for the client's max APDU are sent */
+/* in segments by the TSM, when the client accepts segmented responses. */
+/* This is the number of segmented responses that can be sent at once, */
+/* and the most segments in one response.  Configure the responses */
+/* to zero to leave out segmentation. */
+#if !defined(MAX_SEGMENTED_RESPONSES)
+#if (MAX_TSM_TRANSACTIONS)
+#define MAX_SEGMENTED_RESPONSES 4
+#else
+#define MAX_SEGMENTED_RESPONSES 0
+#endif
+#endif
+#if !defined(MAX_SEGMENTS)
+#define MAX_SEGMENTS 32
+#endif
+/* Complex ACKs to our own requests that arrive in segments are put */
+/* back together by the TSM, in a pool of buffers of MAX_SEGMENTS. */
+/* This is the number of them that can be received at once. */
+/* Configure to zero to only accept unsegmented replies. */
+#if !defined(MAX_SEGMENTED_ACKS)
+#if (MAX_TSM_TRANSACTIONS)
+#define MAX_SEGMENTED_ACKS 2
+#else
+#define MAX_SEGMENTED_ACKS 0
+#endif
+#endif
+/* the largest APDU that is built for sending or put back together */
+/* from segments */
+/* note: APDU lengths are 16 bits in the encoding functions */
+#if (MAX_SEGMENTED_RESPONSES || MAX_SEGMENTED_ACKS)
+#define MAX_SEGMENTED_APDU (MAX_APDU * MAX_SEGMENTS)
+#else
+#define MAX_SEGMENTED_APDU MAX_APDU
+#endif
+#if (MAX_SEGMENTED_APDU > 65535)
+#error "MAX_SEGMENTED_APDU must fit in 16 bits: reduce MAX_SEGMENTS"
+#endif
 /* The address cache is used for binding to BACnet devices */
 /* The number of entries corresponds to the number of */
 /* devices that might respond to an I-Am on the network. */
 /* If your device is a simple server and does not need to bind, */
 /* then you don't need to use this. */
+/* The cache memory is allocated as devices are added, */
+/* so this is the most it will grow to. */
 #if !defined(MAX_ADDRESS_CACHE)
 #define MAX_ADDRESS_CACHE 255
 #endif
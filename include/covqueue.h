@@ -0,0 +1,74 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef COVQUEUE_H
+#define COVQUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bacdef.h"
+#include "bacenum.h"
+
+/* The COV queue holds the objects whose Change_Of_Value flag was set,
+   so that the COV handler only looks at the objects that changed.
+   An object queues itself when its flag goes from false to true, and
+   the COV handler clears the flag when it takes the object off the
+   queue, so an object is in the queue at most once.  If the queue is
+   full, the overflow is remembered and the COV handler falls back to
+   checking the flags of all the subscribed objects. */
+
+#ifndef COV_QUEUE_SIZE
+#define COV_QUEUE_SIZE 256
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void cov_queue_init(
+        void);
+    bool cov_queue_push(
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance);
+    bool cov_queue_pop(
+        BACNET_OBJECT_ID * object_id);
+    unsigned cov_queue_count(
+        void);
+    bool cov_queue_overflow(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -37,6 +37,10 @@ extern "C" {
     uint16_t CRC_Calc_Data(
         uint8_t dataValue,
         uint16_t crcValue);
+    uint16_t CRC_Calc_Data_Buffer(
+        const uint8_t * buffer,
+        size_t length,
+        uint16_t crcValue);
 
 #ifdef __cplusplus
 }
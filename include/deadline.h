@@ -0,0 +1,114 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A deadline queue is a min-heap of pending timeouts.  Each module that
+   has timeouts (TSM, COV, address cache) keeps its own queue and ticks it
+   from its existing timer function, so a tick only touches the entries
+   that are actually expiring.  The tick units (milliseconds or seconds)
+   are chosen by the owner of the queue.
+   The deadlines are stored in the structures of the owner (intrusive),
+   so the owner must stop a deadline before the memory holding it is
+   moved or freed. */
+
+/* returned when no deadline is pending */
+#define DEADLINE_NONE UINT32_MAX
+
+struct BACnet_Deadline;
+typedef void (
+    *deadline_callback_function) (
+    struct BACnet_Deadline * deadline);
+
+typedef struct BACnet_Deadline {
+    /* queue time when this deadline expires */
+    uint32_t expires;
+    /* position in the queue heap + 1, or 0 if not pending */
+    unsigned position;
+    /* called from deadline_queue_timer() when expired */
+    deadline_callback_function callback;
+    /* owner data for the callback */
+    void *context;
+} BACNET_DEADLINE;
+
+typedef struct BACnet_Deadline_Queue {
+    /* elapsed ticks since the queue was started */
+    uint32_t now;
+    /* min-heap of pending deadlines, ordered by expires */
+    BACNET_DEADLINE **heap;
+    unsigned count;
+    unsigned size;
+} BACNET_DEADLINE_QUEUE;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void deadline_init(
+        BACNET_DEADLINE * deadline,
+        deadline_callback_function callback,
+        void *context);
+    bool deadline_start(
+        BACNET_DEADLINE_QUEUE * queue,
+        BACNET_DEADLINE * deadline,
+        uint32_t ticks);
+    void deadline_stop(
+        BACNET_DEADLINE_QUEUE * queue,
+        BACNET_DEADLINE * deadline);
+    bool deadline_active(
+        BACNET_DEADLINE * deadline);
+    uint32_t deadline_remaining(
+        BACNET_DEADLINE_QUEUE * queue,
+        BACNET_DEADLINE * deadline);
+
+    unsigned deadline_queue_timer(
+        BACNET_DEADLINE_QUEUE * queue,
+        uint32_t elapsed_ticks);
+    uint32_t deadline_queue_next(
+        BACNET_DEADLINE_QUEUE * queue);
+    BACNET_DEADLINE *deadline_queue_first(
+        BACNET_DEADLINE_QUEUE * queue);
+    unsigned deadline_queue_count(
+        BACNET_DEADLINE_QUEUE * queue);
+    void deadline_queue_cleanup(
+        BACNET_DEADLINE_QUEUE * queue);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
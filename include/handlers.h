@@ -232,8 +232,12 @@ extern "C" {
         BACNET_CONFIRMED_SERVICE_DATA * service_data);
     void handler_cov_task(
         void);
+    bool handler_cov_task_pending(
+        void);
     void handler_cov_timer_seconds(
         uint32_t elapsed_seconds);
+    uint32_t handler_cov_timer_next_seconds(
+        void);
     void handler_cov_init(
         void);
     int handler_cov_encode_subscriptions(
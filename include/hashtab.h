@@ -0,0 +1,86 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef HASHTAB_H
+#define HASHTAB_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The FNV-1a hash, and the parts of an open addressed hash table with
+   linear probing that do not depend on what its entries hold.  A table
+   has 1 << bits entries, grows to stay at most half full, and an entry
+   is removed by shifting back the entries after it, so that a probe
+   never has to skip over removed entries. */
+
+/* FNV-1a offset basis, the seed of a new hash */
+#define FNV1A32_SEED 2166136261UL
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    uint32_t fnv1a32(
+        const void *data,
+        size_t length,
+        uint32_t seed);
+
+    unsigned hash_table_home(
+        uint32_t hash,
+        unsigned bits);
+    unsigned hash_table_next(
+        unsigned index,
+        unsigned bits);
+    unsigned hash_table_bits(
+        unsigned count,
+        unsigned bits,
+        unsigned min_bits,
+        unsigned max_bits);
+    bool hash_table_shift(
+        unsigned home,
+        unsigned hole,
+        unsigned index,
+        unsigned bits);
+
+#ifdef TEST
+#include "ctest.h"
+    void testHashTable(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,86 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef OBJINDEX_H
+#define OBJINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* An object index maps the object instance numbers of one object type
+   to the index of the object in its table, so that the object accessors
+   do not have to scan the table.  The instances are kept sorted for a
+   binary search, and the last instance found is remembered, since the
+   property handlers call several accessors for the same object in a row.
+   An object type adds its objects to its index when it loads them. */
+
+typedef struct BACnet_Object_Index_Entry {
+    uint32_t instance;
+    unsigned index;
+} BACNET_OBJECT_INDEX_ENTRY;
+
+typedef struct BACnet_Object_Index {
+    /* entries sorted by instance */
+    BACNET_OBJECT_INDEX_ENTRY *list;
+    unsigned count;
+    unsigned size;
+    /* the last instance found */
+    BACNET_OBJECT_INDEX_ENTRY last;
+    bool last_valid;
+} BACNET_OBJECT_INDEX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool object_index_add(
+        BACNET_OBJECT_INDEX * object_index,
+        uint32_t instance,
+        unsigned index);
+    bool object_index_remove(
+        BACNET_OBJECT_INDEX * object_index,
+        uint32_t instance);
+    bool object_index_find(
+        BACNET_OBJECT_INDEX * object_index,
+        uint32_t instance,
+        unsigned *index);
+    unsigned object_index_count(
+        BACNET_OBJECT_INDEX * object_index);
+    void object_index_cleanup(
+        BACNET_OBJECT_INDEX * object_index);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,92 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+#ifndef OBJNAME_H
+#define OBJNAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "bacstr.h"
+
+/* An object name index maps the hash of an object name to the objects
+   that may have that name, so that looking an object up by its name
+   does not have to copy the name of every object in the device.  The
+   names themselves are not kept: each object found is only a candidate,
+   whose name the caller compares.  The table is open addressed with
+   linear probing, and grows to stay at most half full.  An object is
+   removed with the name that it had when it was added. */
+
+typedef struct BACnet_Object_Name_Entry {
+    /* hash of the name, zero for a free entry */
+    uint32_t hash;
+    uint32_t instance;
+    uint16_t type;
+} BACNET_OBJECT_NAME_ENTRY;
+
+typedef struct BACnet_Object_Name_Index {
+    BACNET_OBJECT_NAME_ENTRY *table;
+    /* the table has 1 << bits entries */
+    unsigned bits;
+    unsigned count;
+} BACNET_OBJECT_NAME_INDEX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    bool object_name_index_add(
+        BACNET_OBJECT_NAME_INDEX * name_index,
+        BACNET_CHARACTER_STRING * name,
+        uint16_t type,
+        uint32_t instance);
+    bool object_name_index_remove(
+        BACNET_OBJECT_NAME_INDEX * name_index,
+        BACNET_CHARACTER_STRING * name,
+        uint16_t type,
+        uint32_t instance);
+    bool object_name_index_find(
+        BACNET_OBJECT_NAME_INDEX * name_index,
+        BACNET_CHARACTER_STRING * name,
+        unsigned *cursor,
+        uint16_t * type,
+        uint32_t * instance);
+    unsigned object_name_index_count(
+        BACNET_OBJECT_NAME_INDEX * name_index);
+    void object_name_index_cleanup(
+        BACNET_OBJECT_NAME_INDEX * name_index);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
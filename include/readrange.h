@@ -101,9 +101,12 @@ extern "C" {
 
 /** Define pointer to function type for handling ReadRange request.
    This function will take the following parameters:
-  - 1. A pointer to a buffer of at least MAX_APDU bytes to build the response in.
+  - 1. A pointer to a buffer of at least MAX_SEGMENTED_APDU bytes to build
+      the response in.
   - 2. A pointer to a BACNET_READ_RANGE_DATA structure with all the request
-      information in it. The function is responsible for applying the request
+      information in it, and the application_data_len set to the most octets
+      the whole response can take, which the Overhead is a part of.
+      The function is responsible for applying the request
       to the property in question and returning the response. */
 
     typedef int (
@@ -29,18 +29,36 @@
 #include <stddef.h>
 #include "bacdef.h"
 #include "npdu.h"
+#include "apdu.h"
+#include "deadline.h"
 
 /* note: TSM functionality is optional - only needed if we are
    doing client requests */
 #if (!MAX_TSM_TRANSACTIONS)
 #define tsm_free_invoke_id(x) (void)x;
-#else
+#define tsm_timer_next_milliseconds() DEADLINE_NONE
+#endif
+/* without segmented responses, a complex ACK must fit in one APDU */
+#if (!MAX_SEGMENTED_RESPONSES)
+#define tsm_segmented_response_max(x) \
+    (((x)->max_resp < MAX_APDU) ? (x)->max_resp : MAX_APDU)
+#define tsm_set_segmented_complex_ack(d, n, x, a, l) false
+#define tsm_segment_ack_received(s, i, n, w) (void)s;
+#define tsm_segmented_response_abort(s, i) (void)s;
+#endif
+/* without a reassembly pool, we only accept unsegmented replies */
+#if (!MAX_SEGMENTED_ACKS)
+#define tsm_segmented_ack_accept(a) (void)a;
+#define tsm_segmented_ack_received(s, d, c, r, l) false
+#endif
+#if (MAX_TSM_TRANSACTIONS)
 typedef enum {
     TSM_STATE_IDLE,
     TSM_STATE_AWAIT_CONFIRMATION,
     TSM_STATE_AWAIT_RESPONSE,
     TSM_STATE_SEGMENTED_REQUEST,
-    TSM_STATE_SEGMENTED_CONFIRMATION
+    TSM_STATE_SEGMENTED_CONFIRMATION,
+    TSM_STATE_SEGMENTED_RESPONSE
 } BACNET_TSM_STATE;
 
 /* 5.4.1 Variables And Parameters */
@@ -54,19 +72,18 @@ typedef struct BACnet_TSM_Data {
     /* used to control APDU retries and the acceptance of server replies */
     /*bool SentAllSegments;  */
     /* stores the sequence number of the last segment received in order */
-    /*uint8_t LastSequenceNumber; */
+    uint8_t LastSequenceNumber;
     /* stores the sequence number of the first segment of */
     /* a sequence of segments that fill a window */
-    /*uint8_t InitialSequenceNumber; */
+    uint8_t InitialSequenceNumber;
     /* stores the current window size */
-    /*uint8_t ActualWindowSize; */
+    uint8_t ActualWindowSize;
     /* stores the window size proposed by the segment sender */
     /*uint8_t ProposedWindowSize;  */
-    /*  used to perform timeout on PDU segments */
-    /*uint8_t SegmentTimer; */
-    /* used to perform timeout on Confirmed Requests */
+    /* used to perform timeout on Confirmed Requests, */
+    /* and as the SegmentTimer while receiving segments, */
     /* in milliseconds */
-    uint16_t RequestTimer;
+    BACNET_DEADLINE RequestTimer;
     /* unique id */
     uint8_t InvokeID;
     /* state that the TSM is in */
@@ -78,8 +95,58 @@ typedef struct BACnet_TSM_Data {
     /* copy of the APDU, should we need to send it again */
     uint8_t apdu[MAX_PDU];
     unsigned apdu_len;
+#if (MAX_SEGMENTED_ACKS)
+    /* where a segmented Complex ACK is put back together */
+    struct BACnet_TSM_Segmented_Ack *segmented_ack;
+#endif
 } BACNET_TSM_DATA;
 
+#if (MAX_SEGMENTED_ACKS)
+/* 5.4.4 a buffer from the pool for the client side of a transaction
+   whose Complex ACK is received in segments */
+typedef struct BACnet_TSM_Segmented_Ack {
+    /* the transaction using the buffer, or NULL if it is free */
+    BACNET_TSM_DATA *transaction;
+    /* service ACK choice of the first segment */
+    uint8_t service_choice;
+    /* the service data of the segments received in order */
+    uint8_t service_request[MAX_SEGMENTED_APDU];
+    unsigned service_request_len;
+} BACNET_TSM_SEGMENTED_ACK;
+#endif
+
+#if (MAX_SEGMENTED_RESPONSES)
+/* 5.4.5 the server side of a transaction whose Complex ACK
+   is sent in segments */
+typedef struct BACnet_TSM_Segmented_Response {
+    /* used to count segment retries */
+    uint8_t SegmentRetryCount;
+    /* the first segment of the window being sent; its sequence
+       number is the InitialSequenceNumber */
+    unsigned InitialSegment;
+    /* stores the current window size */
+    uint8_t ActualWindowSize;
+    /* stores the window size proposed by the segment sender */
+    uint8_t ProposedWindowSize;
+    /* used to perform timeout on PDU segments, in milliseconds */
+    BACNET_DEADLINE SegmentTimer;
+    /* invoke ID of the client request */
+    uint8_t InvokeID;
+    /* state that the TSM is in */
+    BACNET_TSM_STATE state;
+    /* the client that we are sending it to */
+    BACNET_ADDRESS dest;
+    /* the network layer info */
+    BACNET_NPDU_DATA npdu_data;
+    /* service octets in each segment, and the number of segments */
+    unsigned segment_len;
+    unsigned segment_count;
+    /* the whole Complex ACK, as it would be sent unsegmented */
+    uint8_t apdu[MAX_SEGMENTED_APDU];
+    unsigned apdu_len;
+} BACNET_TSM_SEGMENTED_RESPONSE;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -90,6 +157,9 @@ extern "C" {
         void);
     void tsm_timer_milliseconds(
         uint16_t milliseconds);
+/* milliseconds until the next retry or timeout, or DEADLINE_NONE */
+    uint32_t tsm_timer_next_milliseconds(
+        void);
 /* free the invoke ID when the reply comes back */
     void tsm_free_invoke_id(
         uint8_t invokeID);
@@ -118,6 +188,43 @@ extern "C" {
     bool tsm_invoke_id_failed(
         uint8_t invokeID);
 
+#if (MAX_SEGMENTED_RESPONSES)
+/* the longest Complex ACK APDU that can be sent to the client,
+   in segments if it accepts a segmented response */
+    uint16_t tsm_segmented_response_max(
+        BACNET_CONFIRMED_SERVICE_DATA * service_data);
+/* sends a Complex ACK that is too big for one APDU in segments,
+   returns false if it can't be sent and an Abort is needed */
+    bool tsm_set_segmented_complex_ack(
+        BACNET_ADDRESS * dest,
+        BACNET_NPDU_DATA * npdu_data,
+        BACNET_CONFIRMED_SERVICE_DATA * service_data,
+        uint8_t * apdu,
+        uint16_t apdu_len);
+    void tsm_segment_ack_received(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID,
+        uint8_t sequence_number,
+        uint8_t actual_window_size);
+    void tsm_segmented_response_abort(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+#endif
+
+#if (MAX_SEGMENTED_ACKS)
+/* marks an encoded confirmed request as accepting a segmented reply */
+    void tsm_segmented_ack_accept(
+        uint8_t * apdu);
+/* takes a segment of a Complex ACK to one of our requests, and
+   returns true with the whole service data after the last one */
+    bool tsm_segmented_ack_received(
+        BACNET_ADDRESS * src,
+        BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+        uint8_t service_choice,
+        uint8_t ** service_request,
+        uint16_t * service_request_len);
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
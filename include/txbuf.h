@@ -31,5 +31,8 @@
 #include "datalink.h"
 
 extern uint8_t Handler_Transmit_Buffer[MAX_PDU];
+#if (MAX_SEGMENTED_RESPONSES)
+extern uint8_t Handler_Segment_Buffer[MAX_SEGMENTED_APDU];
+#endif
 
 #endif
@@ -71,4 +71,8 @@ void ucix_for_each_section_type(struct uci_context *ctx,
 time_t check_uci_update(const char *config, time_t mtime);
 /* Add tuple */
 void load_value(const char *sec_idx, struct uci_itr_ctx *itr);
+/* Watch for changed uci files with inotify instead of checking them */
+int ucix_watch_init(void);
+void ucix_watch_cleanup(void);
+int ucix_watch_read(void (*cb)(const char*, void*), void *priv);
 #endif
@@ -32,11 +32,16 @@
  -------------------------------------------
 ####COPYRIGHTEND####*/
 
+/* for recvmmsg() and sendmmsg() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>     /* for standard integer types uint8_t etc. */
 #include <stdbool.h>    /* for the standard bool type. */
 #include "bacdcode.h"
 #include "bip.h"
 #include "net.h"
+#include <poll.h>
 
 /** @file linux/bip-init.c  Initializes BACnet/IP interface (Linux). */
 
@@ -220,6 +225,164 @@ void bip_cleanup(
     return;
 }
 
+/* number of packets received with one system call */
+#ifndef BIP_RX_BATCH
+#define BIP_RX_BATCH 16
+#endif
+/* the packets of the last batch, received in place */
+static uint8_t BIP_Rx_Buf[BIP_RX_BATCH][MAX_MPDU];
+static struct sockaddr_in BIP_Rx_Addr[BIP_RX_BATCH];
+static struct iovec BIP_Rx_Iov[BIP_RX_BATCH];
+static struct mmsghdr BIP_Rx_Msg[BIP_RX_BATCH];
+/* packets in the batch, and the next one to decode */
+static unsigned BIP_Rx_Count;
+static unsigned BIP_Rx_Next;
+
+/** Receive the BACnet/IP packets that are waiting, up to a batch of
+ * BIP_RX_BATCH, with one system call.  The packets stay in the batch
+ * buffers until the next call, and bip_receive_batch_next() decodes them
+ * in place.
+ * @ingroup DLBIP
+ * @param timeout [in] The number of milliseconds to wait for a packet.
+ * @return The number of packets received.
+ */
+unsigned bip_receive_batch(
+    unsigned timeout)
+{
+    struct pollfd fds;
+    unsigned i = 0;
+    int received = 0;
+
+    BIP_Rx_Count = 0;
+    BIP_Rx_Next = 0;
+    if (!bip_valid()) {
+        return 0;
+    }
+    fds.fd = bip_socket();
+    fds.events = POLLIN;
+    fds.revents = 0;
+    if (poll(&fds, 1, (int) timeout) <= 0) {
+        return 0;
+    }
+    for (i = 0; i < BIP_RX_BATCH; i++) {
+        BIP_Rx_Iov[i].iov_base = &BIP_Rx_Buf[i][0];
+        BIP_Rx_Iov[i].iov_len = MAX_MPDU;
+        memset(&BIP_Rx_Msg[i], 0, sizeof(struct mmsghdr));
+        BIP_Rx_Msg[i].msg_hdr.msg_name = &BIP_Rx_Addr[i];
+        BIP_Rx_Msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        BIP_Rx_Msg[i].msg_hdr.msg_iov = &BIP_Rx_Iov[i];
+        BIP_Rx_Msg[i].msg_hdr.msg_iovlen = 1;
+    }
+    received =
+        recvmmsg(bip_socket(), BIP_Rx_Msg, BIP_RX_BATCH, MSG_DONTWAIT, NULL);
+    if (received > 0) {
+        BIP_Rx_Count = (unsigned) received;
+    }
+
+    return BIP_Rx_Count;
+}
+
+/** Decode the next packet of the last batch received, skipping any that
+ * do not carry an NPDU for us.
+ * @ingroup DLBIP
+ * @param src [out] Source of the packet - who should receive any response.
+ * @param npdu [out] Set to the start of the NPDU within the batch buffer.
+ * @return The number of octets in the NPDU, or zero when there are no more.
+ */
+uint16_t bip_receive_batch_next(
+    BACNET_ADDRESS * src,
+    uint8_t ** npdu)
+{
+    uint16_t npdu_len = 0;
+    unsigned i = 0;
+
+    while ((npdu_len == 0) && (BIP_Rx_Next < BIP_Rx_Count)) {
+        i = BIP_Rx_Next++;
+        if (BIP_Rx_Msg[i].msg_len > 0) {
+            npdu_len =
+                bip_decode_npdu(src, &BIP_Rx_Addr[i], &BIP_Rx_Buf[i][0],
+                (uint16_t) BIP_Rx_Msg[i].msg_len, npdu);
+        }
+    }
+
+    return npdu_len;
+}
+
+/* number of packets sent with one system call */
+#ifndef BIP_TX_BATCH
+#define BIP_TX_BATCH 64
+#endif
+
+/** Send the same BACnet/IP packet to each of a list of destinations,
+ * with one system call for each BIP_TX_BATCH of them.  The socket is not
+ * waited on: a destination that would block is given -EAGAIN.
+ *
+ * @param dest [in] The destinations, in network byte order.
+ * @param result [out] For each destination, the octets sent, or the
+ *  negative errno of the failure.
+ * @param count [in] The number of destinations.
+ * @param mtu [in] The packet to send.
+ * @param mtu_len [in] The number of octets in the packet.
+ * @return The number of destinations the packet was sent to.
+ */
+unsigned bip_send_mpdu_batch(
+    struct sockaddr_in *dest,
+    int *result,
+    unsigned count,
+    uint8_t * mtu,
+    uint16_t mtu_len)
+{
+    struct sockaddr_in addr[BIP_TX_BATCH];
+    struct mmsghdr msg[BIP_TX_BATCH];
+    struct iovec iov;
+    unsigned sent = 0;
+    unsigned n = 0;
+    unsigned i = 0;
+    unsigned j = 0;
+    int rv = 0;
+
+    if (bip_socket() < 0) {
+        for (i = 0; i < count; i++) {
+            result[i] = -EBADF;
+        }
+        return 0;
+    }
+    iov.iov_base = mtu;
+    iov.iov_len = mtu_len;
+    while (i < count) {
+        n = count - i;
+        if (n > BIP_TX_BATCH) {
+            n = BIP_TX_BATCH;
+        }
+        for (j = 0; j < n; j++) {
+            memset(&addr[j], 0, sizeof(struct sockaddr_in));
+            addr[j].sin_family = AF_INET;
+            addr[j].sin_addr.s_addr = dest[i + j].sin_addr.s_addr;
+            addr[j].sin_port = dest[i + j].sin_port;
+            memset(&msg[j], 0, sizeof(struct mmsghdr));
+            msg[j].msg_hdr.msg_name = &addr[j];
+            msg[j].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            msg[j].msg_hdr.msg_iov = &iov;
+            msg[j].msg_hdr.msg_iovlen = 1;
+        }
+        rv = sendmmsg(bip_socket(), msg, n, MSG_DONTWAIT);
+        if (rv > 0) {
+            /* the messages up to the first failure were sent */
+            for (j = 0; j < (unsigned) rv; j++) {
+                result[i + j] = (int) msg[j].msg_len;
+            }
+            sent += (unsigned) rv;
+            i += (unsigned) rv;
+        } else {
+            /* the first message failed, skip it and send the rest */
+            result[i] = (errno == EWOULDBLOCK) ? -EAGAIN : -errno;
+            i++;
+        }
+    }
+
+    return sent;
+}
+
 /** Get the netmask of the BACnet/IP's interface via an ioctl() call.
  * @param netmask [out] The netmask, in host order.
  * @return 0 on success, else the error from the ioctl() call.
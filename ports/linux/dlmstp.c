@@ -47,7 +47,13 @@
 uint16_t MSTP_Packets = 0;
 
 /* packet queues */
-static DLMSTP_PACKET Receive_Packet;
+/* frames received and waiting for the application,
+   count must be a power of 2 for ringbuf library */
+#ifndef MSTP_RECEIVE_PACKET_COUNT
+#define MSTP_RECEIVE_PACKET_COUNT 8
+#endif
+static DLMSTP_PACKET Receive_Buffer[MSTP_RECEIVE_PACKET_COUNT];
+static RING_BUFFER Receive_Queue;
 /* mechanism to wait for a packet */
 /*
 static RT_COND Receive_Packet_Flag;
@@ -125,8 +131,8 @@ static void get_abstime(
     struct timeval now, offset, result;
 
     gettimeofday(&now, NULL);
-    offset.tv_sec = 0;
-    offset.tv_usec = milliseconds * 1000;
+    offset.tv_sec = milliseconds / 1000;
+    offset.tv_usec = (milliseconds % 1000) * 1000;
     timeradd(&now, &offset, &result);
     abstime->tv_sec = result.tv_sec;
     abstime->tv_nsec = result.tv_usec * 1000;
@@ -152,14 +158,14 @@ int dlmstp_send_pdu(
 {       /* number of bytes of data */
     int bytes_sent = 0;
     struct mstp_pdu_packet *pkt;
-    unsigned i = 0;
 
+    if (pdu_len > sizeof(pkt->buffer)) {
+        return 0;
+    }
     pkt = (struct mstp_pdu_packet *) Ringbuf_Alloc(&PDU_Queue);
     if (pkt) {
         pkt->data_expecting_reply = npdu_data->data_expecting_reply;
-        for (i = 0; i < pdu_len; i++) {
-            pkt->buffer[i] = pdu[i];
-        }
+        memcpy(pkt->buffer, pdu, pdu_len);
         pkt->length = pdu_len;
         pkt->destination_mac = dest->mac[0];
         bytes_sent = pdu_len;
@@ -175,36 +181,66 @@ uint16_t dlmstp_receive(
     unsigned timeout)
 {       /* milliseconds to wait for a packet */
     uint16_t pdu_len = 0;
+    DLMSTP_PACKET *pkt;
     struct timespec abstime;
     int rv = 0;
 
-    (void) max_pdu;
     /* see if there is a packet available, and a place
        to put the reply (if necessary) and process it */
     get_abstime(&abstime, timeout);
-    rv = pthread_cond_timedwait(&Receive_Packet_Flag, &Receive_Packet_Mutex,
-        &abstime);
-    if (rv == 0) {
-        if (Receive_Packet.ready) {
-            if (Receive_Packet.pdu_len) {
-                MSTP_Packets++;
-                if (src) {
-                    memmove(src, &Receive_Packet.address,
-                        sizeof(Receive_Packet.address));
-                }
-                if (pdu) {
-                    memmove(pdu, &Receive_Packet.pdu,
-                        sizeof(Receive_Packet.pdu));
-                }
-                pdu_len = Receive_Packet.pdu_len;
+    pthread_mutex_lock(&Receive_Packet_Mutex);
+    while (Ringbuf_Empty(&Receive_Queue) && (rv == 0)) {
+        rv = pthread_cond_timedwait(&Receive_Packet_Flag,
+            &Receive_Packet_Mutex, &abstime);
+    }
+    pkt = (DLMSTP_PACKET *) Ringbuf_Peek(&Receive_Queue);
+    if (pkt) {
+        /* only the octets received, and only if they fit */
+        if (pkt->pdu_len && (pkt->pdu_len <= max_pdu)) {
+            MSTP_Packets++;
+            if (src) {
+                memcpy(src, &pkt->address, sizeof(pkt->address));
+            }
+            if (pdu) {
+                memcpy(pdu, pkt->pdu, pkt->pdu_len);
             }
-            Receive_Packet.ready = false;
+            pdu_len = pkt->pdu_len;
         }
+        (void) Ringbuf_Pop(&Receive_Queue, NULL);
     }
+    pthread_mutex_unlock(&Receive_Packet_Mutex);
 
     return pdu_len;
 }
 
+/* milliseconds that the node state machine can wait for received data */
+static unsigned dlmstp_receive_timeout(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    uint32_t silence = mstp_port->SilenceTimer(NULL);
+    uint32_t timeout = 0;
+
+    switch (mstp_port->master_state) {
+        case MSTP_MASTER_STATE_IDLE:
+            timeout = Tno_token;
+            break;
+        case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
+            timeout = Treply_timeout;
+            break;
+        case MSTP_MASTER_STATE_POLL_FOR_MASTER:
+            timeout = Tusage_timeout;
+            break;
+        default:
+            /* the node state machine is passing through this state */
+            break;
+    }
+    if (silence >= timeout) {
+        return 0;
+    }
+
+    return timeout - silence;
+}
+
 static void *dlmstp_master_fsm_task(
     void *pArg)
 {
@@ -215,8 +251,9 @@ static void *dlmstp_master_fsm_task(
     for (;;) {
         if (MSTP_Port.ReceivedValidFrame == false &&
             MSTP_Port.ReceivedInvalidFrame == false) {
-            RS485_Check_UART_Data(&MSTP_Port);
-            MSTP_Receive_Frame_FSM(&MSTP_Port);
+            /* block until data arrives or the node needs to run */
+            RS485_Receive_Frame_Data(&MSTP_Port,
+                dlmstp_receive_timeout(&MSTP_Port));
         }
         if (MSTP_Port.ReceivedValidFrame || MSTP_Port.ReceivedInvalidFrame) {
             run_master = true;
@@ -284,20 +321,23 @@ uint16_t MSTP_Put_Receive(
     volatile struct mstp_port_struct_t *mstp_port)
 {
     uint16_t pdu_len = 0;
+    DLMSTP_PACKET *pkt;
 
-    if (!Receive_Packet.ready) {
+    /* queue the frame, unless the application is too far behind */
+    pthread_mutex_lock(&Receive_Packet_Mutex);
+    pkt = (DLMSTP_PACKET *) Ringbuf_Alloc(&Receive_Queue);
+    if (pkt) {
         /* bounds check - maybe this should send an abort? */
         pdu_len = mstp_port->DataLength;
-        if (pdu_len > sizeof(Receive_Packet.pdu))
-            pdu_len = sizeof(Receive_Packet.pdu);
-        memmove((void *) &Receive_Packet.pdu[0],
-            (void *) &mstp_port->InputBuffer[0], pdu_len);
-        dlmstp_fill_bacnet_address(&Receive_Packet.address,
-            mstp_port->SourceAddress);
-        Receive_Packet.pdu_len = mstp_port->DataLength;
-        Receive_Packet.ready = true;
+        if (pdu_len > sizeof(pkt->pdu))
+            pdu_len = sizeof(pkt->pdu);
+        memcpy(pkt->pdu, (void *) &mstp_port->InputBuffer[0], pdu_len);
+        dlmstp_fill_bacnet_address(&pkt->address, mstp_port->SourceAddress);
+        pkt->pdu_len = pdu_len;
+        pkt->ready = true;
         pthread_cond_signal(&Receive_Packet_Flag);
     }
+    pthread_mutex_unlock(&Receive_Packet_Mutex);
 
     return pdu_len;
 }
@@ -659,8 +699,8 @@ bool dlmstp_init(
     Ringbuf_Init(&PDU_Queue, (uint8_t *) & PDU_Buffer,
         sizeof(struct mstp_pdu_packet), MSTP_PDU_PACKET_COUNT);
     /* initialize packet queue */
-    Receive_Packet.ready = false;
-    Receive_Packet.pdu_len = 0;
+    Ringbuf_Init(&Receive_Queue, (uint8_t *) & Receive_Buffer,
+        sizeof(DLMSTP_PACKET), MSTP_RECEIVE_PACKET_COUNT);
     rv = pthread_cond_init(&Receive_Packet_Flag, NULL);
     if (rv != 0) {
         fprintf(stderr,
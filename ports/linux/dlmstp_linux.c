@@ -40,6 +40,9 @@
 /* OS Specific include */
 #include "net.h"
 #include "ringbuf.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 /** @file linux/dlmstp.c  Provides Linux-specific DataLink functions for MS/TP. */
 
@@ -48,10 +51,21 @@
 #define BACNET_DATA_EXPECTING_REPLY(control) ( (control & (1 << BACNET_DATA_EXPECTING_REPLY_BIT) ) > 0 )
 
 #define INCREMENT_AND_LIMIT_UINT16(x) {if (x < 0xFFFF) x++;}
+
+/* The maximum time a node may wait after reception of a frame that expects */
+/* a reply before sending the first octet of a reply or Reply Postponed */
+/* frame: 250 milliseconds. */
+#ifndef Treply_delay
+#define Treply_delay 250
+#endif
+
+/* the node state machine has nothing to wait for */
+#define DLMSTP_DEADLINE_NONE UINT32_MAX
+
 uint32_t Timer_Silence(
     void *poPort)
 {
-    struct timeval now, tmp_diff;
+    struct timespec now;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
         (struct mstp_port_struct_t *) poPort;
@@ -65,9 +79,9 @@ uint32_t Timer_Silence(
 
     int32_t res;
 
-    gettimeofday(&now, NULL);
-    timersub(&poSharedData->start, &now, &tmp_diff);
-    res = ((tmp_diff.tv_sec) * 1000 + (tmp_diff.tv_usec) / 1000);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    res = (now.tv_sec - poSharedData->start.tv_sec) * 1000;
+    res += (now.tv_nsec - poSharedData->start.tv_nsec) / 1000000;
 
     return (res >= 0 ? res : -res);
 }
@@ -86,7 +100,7 @@ void Timer_Silence_Reset(
         return;
     }
 
-    gettimeofday(&poSharedData->start, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &poSharedData->start);
 }
 
 void get_abstime(
@@ -96,8 +110,8 @@ void get_abstime(
     struct timeval now, offset, result;
 
     gettimeofday(&now, NULL);
-    offset.tv_sec = 0;
-    offset.tv_usec = milliseconds * 1000;
+    offset.tv_sec = milliseconds / 1000;
+    offset.tv_usec = (milliseconds % 1000) * 1000;
     timeradd(&now, &offset, &result);
     abstime->tv_sec = result.tv_sec;
     abstime->tv_nsec = result.tv_usec * 1000;
@@ -121,6 +135,10 @@ void dlmstp_cleanup(
     tcsetattr(poSharedData->RS485_Handle, TCSANOW,
         &poSharedData->RS485_oldtio);
     close(poSharedData->RS485_Handle);
+    close(poSharedData->Epoll_Handle);
+    close(poSharedData->Timer_Handle);
+    close(poSharedData->Event_Handle);
+    close(poSharedData->Receive_Event_Handle);
 
     pthread_cond_destroy(&poSharedData->Received_Frame_Flag);
     pthread_cond_destroy(&poSharedData->Receive_Packet_Flag);
@@ -139,7 +157,6 @@ int dlmstp_send_pdu(
 {       /* number of bytes of data */
     int bytes_sent = 0;
     struct mstp_pdu_packet *pkt;
-    unsigned i = 0;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
         (struct mstp_port_struct_t *) poPort;
@@ -150,111 +167,253 @@ int dlmstp_send_pdu(
     if (!poSharedData) {
         return 0;
     }
+    if (pdu_len > sizeof(pkt->buffer)) {
+        return 0;
+    }
 
     pkt = (struct mstp_pdu_packet *) Ringbuf_Alloc(&poSharedData->PDU_Queue);
     if (pkt) {
         pkt->data_expecting_reply =
             BACNET_DATA_EXPECTING_REPLY(pdu[BACNET_PDU_CONTROL_BYTE_OFFSET]);
-        for (i = 0; i < pdu_len; i++) {
-            pkt->buffer[i] = pdu[i];
-        }
+        memcpy(pkt->buffer, pdu, pdu_len);
         pkt->length = pdu_len;
         pkt->destination_mac = dest->mac[0];
         bytes_sent = pdu_len;
+        /* wake the node, it may be waiting to answer a request */
+        eventfd_write(poSharedData->Event_Handle, 1);
     }
 
     return bytes_sent;
 }
 
-uint16_t dlmstp_receive(
+DLMSTP_PACKET *dlmstp_receive_packet(
     void *poPort,
-    BACNET_ADDRESS * src,       /* source address */
-    uint8_t * pdu,      /* PDU data */
-    uint16_t max_pdu,   /* amount of space available in the PDU  */
     unsigned timeout)
 {       /* milliseconds to wait for a packet */
-    uint16_t pdu_len = 0;
+    DLMSTP_PACKET *pkt = NULL;
     struct timespec abstime;
     int rv = 0;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
         (struct mstp_port_struct_t *) poPort;
     if (!mstp_port) {
-        return 0;
+        return NULL;
     }
     poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
     if (!poSharedData) {
-        return 0;
+        return NULL;
     }
-    (void) max_pdu;
-    /* see if there is a packet available, and a place
-       to put the reply (if necessary) and process it */
     get_abstime(&abstime, timeout);
-    rv = pthread_cond_timedwait(&poSharedData->Receive_Packet_Flag,
-        &poSharedData->Receive_Packet_Mutex, &abstime);
-    if (rv == 0) {
-        if (poSharedData->Receive_Packet.ready) {
-            if (poSharedData->Receive_Packet.pdu_len) {
-                poSharedData->MSTP_Packets++;
-                if (src) {
-                    memmove(src, &poSharedData->Receive_Packet.address,
-                        sizeof(poSharedData->Receive_Packet.address));
-                }
-                if (pdu) {
-                    memmove(pdu, &poSharedData->Receive_Packet.pdu,
-                        sizeof(poSharedData->Receive_Packet.pdu));
-                }
-                pdu_len = poSharedData->Receive_Packet.pdu_len;
-            }
-            poSharedData->Receive_Packet.ready = false;
-        }
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
+    while (Ringbuf_Empty(&poSharedData->Receive_Queue) && (rv == 0)) {
+        rv = pthread_cond_timedwait(&poSharedData->Receive_Packet_Flag,
+            &poSharedData->Receive_Packet_Mutex, &abstime);
     }
+    /* the reference held by the queue passes to the caller */
+    if (Ringbuf_Pop(&poSharedData->Receive_Queue, (uint8_t *) & pkt)) {
+        poSharedData->MSTP_Packets++;
+    }
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
 
-    return pdu_len;
+    return pkt;
 }
 
-void *dlmstp_receive_fsm_task(
-    void *pArg)
+void dlmstp_packet_hold(
+    void *poPort,
+    DLMSTP_PACKET * pkt)
 {
-    bool received_frame;
     SHARED_MSTP_DATA *poSharedData;
-    struct mstp_port_struct_t *mstp_port = (struct mstp_port_struct_t *) pArg;
+    struct mstp_port_struct_t *mstp_port =
+        (struct mstp_port_struct_t *) poPort;
+
+    if (!mstp_port || !pkt) {
+        return;
+    }
+    poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+    if (!poSharedData) {
+        return;
+    }
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
+    pkt->refs++;
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
+}
+
+int dlmstp_receive_fd(
+    void *poPort)
+{
+    SHARED_MSTP_DATA *poSharedData;
+    struct mstp_port_struct_t *mstp_port =
+        (struct mstp_port_struct_t *) poPort;
     if (!mstp_port) {
-        return NULL;
+        return -1;
+    }
+    poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+    if (!poSharedData) {
+        return -1;
     }
 
-    poSharedData =
-        (SHARED_MSTP_DATA *) ((struct mstp_port_struct_t *) pArg)->UserData;
+    return poSharedData->Receive_Event_Handle;
+}
+
+void dlmstp_packet_release(
+    void *poPort,
+    DLMSTP_PACKET * pkt)
+{
+    SHARED_MSTP_DATA *poSharedData;
+    struct mstp_port_struct_t *mstp_port =
+        (struct mstp_port_struct_t *) poPort;
+
+    if (!mstp_port || !pkt) {
+        return;
+    }
+    poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
     if (!poSharedData) {
-        return NULL;
+        return;
+    }
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
+    if (pkt->refs) {
+        pkt->refs--;
     }
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
+}
 
-    for (;;) {
-        /* only do receive state machine while we don't have a frame */
-        if ((mstp_port->ReceivedValidFrame == false) &&
-            (mstp_port->ReceivedInvalidFrame == false)) {
-            do {
-                RS485_Check_UART_Data(mstp_port);
-                MSTP_Receive_Frame_FSM((volatile struct mstp_port_struct_t *)
-                    pArg);
-                received_frame = mstp_port->ReceivedValidFrame ||
-                    mstp_port->ReceivedInvalidFrame;
-                if (received_frame) {
-                    pthread_cond_signal(&poSharedData->Received_Frame_Flag);
-                    break;
+uint16_t dlmstp_receive(
+    void *poPort,
+    BACNET_ADDRESS * src,       /* source address */
+    uint8_t * pdu,      /* PDU data */
+    uint16_t max_pdu,   /* amount of space available in the PDU  */
+    unsigned timeout)
+{       /* milliseconds to wait for a packet */
+    uint16_t pdu_len = 0;
+    DLMSTP_PACKET *pkt;
+
+    pkt = dlmstp_receive_packet(poPort, timeout);
+    if (!pkt) {
+        return 0;
+    }
+    pdu_len = pkt->pdu_len;
+    if (pdu) {
+        if (pdu_len > max_pdu) {
+            /* too big for the caller, drop it */
+            pdu_len = 0;
+        } else {
+            memcpy(pdu, pkt->pdu, pdu_len);
+        }
+    }
+    if (src && pdu_len) {
+        memcpy(src, &pkt->address, sizeof(pkt->address));
+    }
+    dlmstp_packet_release(poPort, pkt);
+
+    return pdu_len;
+}
+
+/* The silence time, in milliseconds, at which the node state machine
+   next needs to run without a frame having been received.
+   Zero means that the node is passing through its state. */
+static uint32_t dlmstp_node_deadline(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+    uint32_t silence = 0;
+    uint32_t my_timeout = 0;
+    uint32_t ns_timeout = 0;
+
+    if (mstp_port->This_Station > DEFAULT_MAX_MASTER) {
+        /* a slave only waits to answer the request it is holding */
+        if (mstp_port->ReceivedValidFrame) {
+            return Treply_delay;
+        }
+        return DLMSTP_DEADLINE_NONE;
+    }
+    switch (mstp_port->master_state) {
+        case MSTP_MASTER_STATE_IDLE:
+            return Tno_token;
+        case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
+            return poSharedData->Treply_timeout;
+        case MSTP_MASTER_STATE_POLL_FOR_MASTER:
+            return poSharedData->Tusage_timeout;
+        case MSTP_MASTER_STATE_ANSWER_DATA_REQUEST:
+            return Treply_delay;
+        case MSTP_MASTER_STATE_NO_TOKEN:
+            /* wait for the time slot of this node */
+            my_timeout = Tno_token + (Tslot * mstp_port->This_Station);
+            ns_timeout = Tno_token + (Tslot * (mstp_port->This_Station + 1));
+            silence = mstp_port->SilenceTimer((void *) mstp_port);
+            if ((silence < my_timeout) || (silence >= ns_timeout)) {
+                if (silence >= ns_timeout) {
+                    /* missed the slot, wait for the last one */
+                    my_timeout =
+                        Tno_token + (Tslot * (mstp_port->Nmax_master + 1)) +
+                        1;
                 }
-            } while (mstp_port->DataAvailable);
+                return my_timeout;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/* run the node state machine once */
+static void dlmstp_node_fsm(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    if (mstp_port->This_Station <= DEFAULT_MAX_MASTER) {
+        while (MSTP_Master_Node_FSM(mstp_port)) {
+            /* do nothing while immediate transitioning */
         }
+    } else if (mstp_port->This_Station < 255) {
+        MSTP_Slave_Node_FSM(mstp_port);
     }
+}
 
-    return NULL;
+/* Sleep until data arrives, a PDU is queued to send, or the silence
+   timer reaches the deadline.  The timer is armed at an absolute time
+   from when the silence timer was reset, so that the time spent
+   processing does not add to the token timing. */
+static void dlmstp_node_wait(
+    volatile struct mstp_port_struct_t *mstp_port,
+    uint32_t deadline)
+{
+    SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+    struct itimerspec timer;
+    struct epoll_event events[3];
+    uint64_t value = 0;
+    int n = 0;
+    int i = 0;
+
+    memset(&timer, 0, sizeof(timer));
+    if (deadline != DLMSTP_DEADLINE_NONE) {
+        timer.it_value.tv_sec = poSharedData->start.tv_sec + (deadline / 1000);
+        timer.it_value.tv_nsec =
+            poSharedData->start.tv_nsec + ((deadline % 1000) * 1000000L);
+        if (timer.it_value.tv_nsec >= 1000000000L) {
+            timer.it_value.tv_sec++;
+            timer.it_value.tv_nsec -= 1000000000L;
+        }
+    }
+    /* a zero time disarms the timer */
+    timerfd_settime(poSharedData->Timer_Handle, TFD_TIMER_ABSTIME, &timer,
+        NULL);
+    n = epoll_wait(poSharedData->Epoll_Handle, events, 3, -1);
+    for (i = 0; i < n; i++) {
+        if (events[i].data.fd == poSharedData->Timer_Handle) {
+            if (read(poSharedData->Timer_Handle, &value, sizeof(value)) < 0) {
+                /* already read */
+            }
+        } else if (events[i].data.fd == poSharedData->Event_Handle) {
+            eventfd_read(poSharedData->Event_Handle, &value);
+        }
+    }
 }
 
 void *dlmstp_master_fsm_task(
     void *pArg)
 {
     uint32_t silence = 0;
-    bool run_master = false;
+    uint32_t deadline = 0;
+    MSTP_MASTER_STATE master_state = MSTP_MASTER_STATE_INITIALIZE;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port = (struct mstp_port_struct_t *) pArg;
     if (!mstp_port) {
@@ -268,42 +427,39 @@ void *dlmstp_master_fsm_task(
     }
 
     for (;;) {
+        /* run the receive state machine over the data that has arrived */
         if (mstp_port->ReceivedValidFrame == false &&
             mstp_port->ReceivedInvalidFrame == false) {
-            RS485_Check_UART_Data(mstp_port);
-            MSTP_Receive_Frame_FSM(mstp_port);
-        }
-        if (mstp_port->ReceivedValidFrame || mstp_port->ReceivedInvalidFrame) {
-            run_master = true;
+            RS485_Receive_Frame_Data(mstp_port, 0);
         } else {
-            silence = mstp_port->SilenceTimer(NULL);
-            switch (mstp_port->master_state) {
-                case MSTP_MASTER_STATE_IDLE:
-                    if (silence >= Tno_token)
-                        run_master = true;
-                    break;
-                case MSTP_MASTER_STATE_WAIT_FOR_REPLY:
-                    if (silence >= poSharedData->Treply_timeout)
-                        run_master = true;
-                    break;
-                case MSTP_MASTER_STATE_POLL_FOR_MASTER:
-                    if (silence >= poSharedData->Tusage_timeout)
-                        run_master = true;
-                    break;
-                default:
-                    run_master = true;
-                    break;
-            }
+            /* keep the data for after the frame, so the port
+               does not stay readable while we wait */
+            RS485_Read_UART_Data(mstp_port, 0);
         }
-        if (run_master) {
-            if (mstp_port->This_Station <= DEFAULT_MAX_MASTER) {
-                while (MSTP_Master_Node_FSM(mstp_port)) {
-                    /* do nothing while immediate transitioning */
-                }
-            } else if (mstp_port->This_Station < 255) {
-                MSTP_Slave_Node_FSM(mstp_port);
+        silence = mstp_port->SilenceTimer(mstp_port);
+        deadline = dlmstp_node_deadline(mstp_port);
+        if (mstp_port->ReceivedValidFrame || mstp_port->ReceivedInvalidFrame ||
+            (silence >= deadline)) {
+            master_state = mstp_port->master_state;
+            dlmstp_node_fsm(mstp_port);
+            deadline = dlmstp_node_deadline(mstp_port);
+            if ((deadline <= silence) &&
+                (mstp_port->master_state == master_state) &&
+                (mstp_port->SilenceTimer(mstp_port) >= silence)) {
+                /* nothing happened: the state machine is waiting
+                   for a longer timeout of its own */
+                deadline = silence + 1;
             }
         }
+        if ((mstp_port->ReceivedValidFrame == false) &&
+            (mstp_port->ReceivedInvalidFrame == false) &&
+            !FIFO_Empty(&poSharedData->Rx_FIFO)) {
+            /* more frames are waiting */
+            continue;
+        }
+        if (mstp_port->SilenceTimer(mstp_port) < deadline) {
+            dlmstp_node_wait(mstp_port, deadline);
+        }
     }
 
     return NULL;
@@ -339,25 +495,38 @@ uint16_t MSTP_Put_Receive(
     volatile struct mstp_port_struct_t *mstp_port)
 {
     uint16_t pdu_len = 0;
+    DLMSTP_PACKET *pkt = NULL;
+    unsigned i = 0;
     SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
 
     if (!poSharedData) {
         return 0;
     }
 
-    if (!poSharedData->Receive_Packet.ready) {
+    pthread_mutex_lock(&poSharedData->Receive_Packet_Mutex);
+    /* any buffer that neither the queue nor the application holds */
+    for (i = 0; i < MSTP_RECEIVE_PACKET_COUNT; i++) {
+        if (poSharedData->Receive_Buffer[i].refs == 0) {
+            pkt = &poSharedData->Receive_Buffer[i];
+            break;
+        }
+    }
+    if (pkt) {
         /* bounds check - maybe this should send an abort? */
         pdu_len = mstp_port->DataLength;
-        if (pdu_len > sizeof(poSharedData->Receive_Packet.pdu))
-            pdu_len = sizeof(poSharedData->Receive_Packet.pdu);
-        memmove((void *) &poSharedData->Receive_Packet.pdu[0],
-            (void *) &mstp_port->InputBuffer[0], pdu_len);
-        dlmstp_fill_bacnet_address(&poSharedData->Receive_Packet.address,
-            mstp_port->SourceAddress);
-        poSharedData->Receive_Packet.pdu_len = mstp_port->DataLength;
-        poSharedData->Receive_Packet.ready = true;
+        if (pdu_len > sizeof(pkt->pdu))
+            pdu_len = sizeof(pkt->pdu);
+        memcpy(pkt->pdu, (void *) &mstp_port->InputBuffer[0], pdu_len);
+        dlmstp_fill_bacnet_address(&pkt->address, mstp_port->SourceAddress);
+        pkt->pdu_len = pdu_len;
+        pkt->ready = true;
+        /* the queue holds the first reference */
+        pkt->refs = 1;
+        Ringbuf_Put(&poSharedData->Receive_Queue, (uint8_t *) & pkt);
         pthread_cond_signal(&poSharedData->Receive_Packet_Flag);
+        eventfd_write(poSharedData->Receive_Event_Handle, 1);
     }
+    pthread_mutex_unlock(&poSharedData->Receive_Packet_Mutex);
 
     return pdu_len;
 }
@@ -862,11 +1031,28 @@ void dlmstp_get_broadcast_address(
     return;
 }
 
+/* wake the node thread when the file descriptor is readable */
+static void dlmstp_epoll_add(
+    SHARED_MSTP_DATA * poSharedData,
+    int fd)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(poSharedData->Epoll_Handle, EPOLL_CTL_ADD, fd, &event) < 0) {
+        perror(poSharedData->RS485_Port_Name);
+        exit(-1);
+    }
+}
+
 bool dlmstp_init(
     void *poPort,
     char *ifname)
 {
     unsigned long hThread = 0;
+    unsigned i = 0;
     int rv = 0;
     SHARED_MSTP_DATA *poSharedData;
     struct mstp_port_struct_t *mstp_port =
@@ -888,8 +1074,14 @@ bool dlmstp_init(
         (uint8_t *) & poSharedData->PDU_Buffer, sizeof(struct mstp_pdu_packet),
         MSTP_PDU_PACKET_COUNT);
     /* initialize packet queue */
-    poSharedData->Receive_Packet.ready = false;
-    poSharedData->Receive_Packet.pdu_len = 0;
+    for (i = 0; i < MSTP_RECEIVE_PACKET_COUNT; i++) {
+        poSharedData->Receive_Buffer[i].ready = false;
+        poSharedData->Receive_Buffer[i].pdu_len = 0;
+        poSharedData->Receive_Buffer[i].refs = 0;
+    }
+    Ringbuf_Init(&poSharedData->Receive_Queue,
+        (uint8_t *) & poSharedData->Receive_Queue_Buffer,
+        sizeof(DLMSTP_PACKET *), MSTP_RECEIVE_PACKET_COUNT);
     rv = pthread_cond_init(&poSharedData->Receive_Packet_Flag, NULL);
     if (rv != 0) {
         fprintf(stderr,
@@ -951,12 +1143,29 @@ bool dlmstp_init(
     /* ringbuffer */
     FIFO_Init(&poSharedData->Rx_FIFO, poSharedData->Rx_Buffer,
         sizeof(poSharedData->Rx_Buffer));
+    /* the node thread sleeps until the port, its deadline timer,
+       or a PDU to send wakes it */
+    poSharedData->Timer_Handle =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    poSharedData->Event_Handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    poSharedData->Receive_Event_Handle =
+        eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    poSharedData->Epoll_Handle = epoll_create1(EPOLL_CLOEXEC);
+    if ((poSharedData->Timer_Handle < 0) || (poSharedData->Event_Handle < 0)
+        || (poSharedData->Receive_Event_Handle < 0)
+        || (poSharedData->Epoll_Handle < 0)) {
+        perror(poSharedData->RS485_Port_Name);
+        exit(-1);
+    }
+    dlmstp_epoll_add(poSharedData, poSharedData->RS485_Handle);
+    dlmstp_epoll_add(poSharedData, poSharedData->Timer_Handle);
+    dlmstp_epoll_add(poSharedData, poSharedData->Event_Handle);
     printf("=success!\n");
     mstp_port->InputBuffer = &poSharedData->RxBuffer[0];
     mstp_port->InputBufferSize = sizeof(poSharedData->RxBuffer);
     mstp_port->OutputBuffer = &poSharedData->TxBuffer[0];
     mstp_port->OutputBufferSize = sizeof(poSharedData->TxBuffer);
-    gettimeofday(&poSharedData->start, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &poSharedData->start);
     mstp_port->SilenceTimer = Timer_Silence;
     mstp_port->SilenceTimerReset = Timer_Silence_Reset;
     MSTP_Init(mstp_port);
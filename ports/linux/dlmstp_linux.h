@@ -45,6 +45,11 @@
 #ifndef MSTP_PDU_PACKET_COUNT
 #define MSTP_PDU_PACKET_COUNT 8
 #endif
+/* received frames waiting for the application,
+   count must be a power of 2 for ringbuf library */
+#ifndef MSTP_RECEIVE_PACKET_COUNT
+#define MSTP_RECEIVE_PACKET_COUNT 8
+#endif
 
 typedef struct dlmstp_packet {
     bool ready; /* true if ready to be sent or received */
@@ -52,6 +57,9 @@ typedef struct dlmstp_packet {
     uint8_t frame_type; /* type of message */
     uint16_t pdu_len;   /* packet length */
     uint8_t pdu[MAX_MPDU];      /* packet */
+    /* held by the receive queue and the application,
+       the buffer is free again when this drops to zero */
+    unsigned refs;
 } DLMSTP_PACKET;
 
 /* data structure for MS/TP PDU Queue */
@@ -67,7 +75,10 @@ typedef struct shared_mstp_data {
     uint16_t MSTP_Packets;
 
     /* packet queues */
-    DLMSTP_PACKET Receive_Packet;
+    DLMSTP_PACKET Receive_Buffer[MSTP_RECEIVE_PACKET_COUNT];
+    /* pointers into Receive_Buffer, in the order received */
+    RING_BUFFER Receive_Queue;
+    DLMSTP_PACKET *Receive_Queue_Buffer[MSTP_RECEIVE_PACKET_COUNT];
     DLMSTP_PACKET Transmit_Packet;
     /*
        RT_COND Receive_Packet_Flag;
@@ -116,7 +127,17 @@ typedef struct shared_mstp_data {
     FIFO_BUFFER Rx_FIFO;
     /* buffer size needs to be a power of 2 */
     uint8_t Rx_Buffer[4096];
-    struct timeval start;
+    /* when the silence timer was reset, on the monotonic clock */
+    struct timespec start;
+    /* the node thread waits on the port, the timer and the event */
+    int Epoll_Handle;
+    /* armed for the next deadline of the node state machine */
+    int Timer_Handle;
+    /* signaled when a PDU is queued to send */
+    int Event_Handle;
+    /* signaled when a received packet is queued, for waiting on it
+       with other file descriptors instead of dlmstp_receive_packet() */
+    int Receive_Event_Handle;
 
     RING_BUFFER PDU_Queue;
 
@@ -151,6 +172,25 @@ extern "C" {
         uint16_t max_pdu,       /* amount of space available in the PDU  */
         unsigned timeout);      /* milliseconds to wait for a packet */
 
+    /* the oldest received packet, without copying it, or NULL when none
+       arrived in time. The caller holds a reference to the packet and
+       gives it back with dlmstp_packet_release() */
+    DLMSTP_PACKET *dlmstp_receive_packet(
+        void *poShared,
+        unsigned timeout);      /* milliseconds to wait for a packet */
+    /* a file descriptor that is readable when a received packet has been
+       queued. Read it to clear it before taking the packets. */
+    int dlmstp_receive_fd(
+        void *poShared);
+    /* take another reference to a received packet, for handing it on */
+    void dlmstp_packet_hold(
+        void *poShared,
+        DLMSTP_PACKET * pkt);
+    /* give back a reference, the last one frees the buffer for a frame */
+    void dlmstp_packet_release(
+        void *poShared,
+        DLMSTP_PACKET * pkt);
+
     /* This parameter represents the value of the Max_Info_Frames property of */
     /* the node's Device object. The value of Max_Info_Frames specifies the */
     /* maximum number of information frames the node may send before it must */
@@ -96,6 +96,9 @@
 
 /** @file linux/net.h  Includes Linux network headers. */
 
+/* this port sends the BBMD broadcast fan-out with bip_send_mpdu_batch() */
+#define BIP_SEND_BATCH 1
+
 /* Local helper functions for this port */
 int get_local_address_ioctl(
     char *ifname,
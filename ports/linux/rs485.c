@@ -65,6 +65,7 @@
 
 #include <sys/select.h>
 #include <sys/time.h>
+#include <poll.h>
 
 #include "dlmstp_linux.h"
 
@@ -530,6 +531,111 @@ void RS485_Check_UART_Data(
     }
 }
 
+/* the UART handle of the port */
+static int RS485_Port_Handle(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+
+    if (poSharedData) {
+        return poSharedData->RS485_Handle;
+    }
+
+    return RS485_Handle;
+}
+
+/* the receive FIFO of the port */
+static FIFO_BUFFER *RS485_Port_FIFO(
+    volatile struct mstp_port_struct_t *mstp_port)
+{
+    SHARED_MSTP_DATA *poSharedData = (SHARED_MSTP_DATA *) mstp_port->UserData;
+
+    if (poSharedData) {
+        return &poSharedData->Rx_FIFO;
+    }
+
+    return &Rx_FIFO;
+}
+
+/****************************************************************************
+* DESCRIPTION: Wait for receive data, then read all of it into the FIFO
+* RETURN:      number of bytes in the FIFO
+* ALGORITHM:   the UART is only waited on while the FIFO is empty, and is
+*              read until it is drained or the FIFO is full
+* NOTES:       timeout is in milliseconds
+*****************************************************************************/
+unsigned RS485_Read_UART_Data(
+    volatile struct mstp_port_struct_t *mstp_port,
+    unsigned timeout)
+{
+    struct pollfd input;
+    uint8_t buf[2048];
+    FIFO_BUFFER *fifo = RS485_Port_FIFO(mstp_port);
+    unsigned space = 0;
+    ssize_t n = 0;
+
+    input.fd = RS485_Port_Handle(mstp_port);
+    input.events = POLLIN;
+    input.revents = 0;
+    if (!FIFO_Empty(fifo)) {
+        timeout = 0;
+    }
+    if (poll(&input, 1, (int) timeout) <= 0) {
+        return FIFO_Count(fifo);
+    }
+    if (input.revents & POLLIN) {
+        do {
+            space = fifo->buffer_len - FIFO_Count(fifo);
+            if (space > sizeof(buf)) {
+                space = sizeof(buf);
+            }
+            if (space == 0) {
+                break;
+            }
+            n = read(input.fd, buf, space);
+            if (n > 0) {
+                FIFO_Add(fifo, &buf[0], (unsigned) n);
+            }
+            /* a short read means the UART is drained */
+        } while (n == (ssize_t) space);
+    }
+
+    return FIFO_Count(fifo);
+}
+
+/****************************************************************************
+* DESCRIPTION: Run the receive state machine over all of the receive data
+* RETURN:      true if a frame was received
+* ALGORITHM:   waits up to timeout milliseconds for data, then gives each
+*              byte in the FIFO to the receive state machine until a frame
+*              is received or the FIFO is empty
+* NOTES:       the state machine runs at least once, to check its timers
+*****************************************************************************/
+bool RS485_Receive_Frame_Data(
+    volatile struct mstp_port_struct_t *mstp_port,
+    unsigned timeout)
+{
+    FIFO_BUFFER *fifo = RS485_Port_FIFO(mstp_port);
+
+    if (mstp_port->ReceivedValidFrame || mstp_port->ReceivedInvalidFrame) {
+        return true;
+    }
+    RS485_Read_UART_Data(mstp_port, timeout);
+    do {
+        if ((mstp_port->DataAvailable == false) &&
+            (mstp_port->ReceiveError == false) && !FIFO_Empty(fifo)) {
+            mstp_port->DataRegister = FIFO_Get(fifo);
+            mstp_port->DataAvailable = true;
+        }
+        MSTP_Receive_Frame_FSM(mstp_port);
+        if (mstp_port->ReceivedValidFrame || mstp_port->ReceivedInvalidFrame) {
+            return true;
+        }
+    } while (!FIFO_Empty(fifo));
+
+    return false;
+}
+
 void RS485_Cleanup(
     void)
 {
@@ -58,6 +58,12 @@ extern "C" {
 
     void RS485_Check_UART_Data(
         volatile struct mstp_port_struct_t *mstp_port); /* port specific data */
+    unsigned RS485_Read_UART_Data(
+        volatile struct mstp_port_struct_t *mstp_port,  /* port specific data */
+        unsigned timeout);      /* milliseconds to wait for data */
+    bool RS485_Receive_Frame_Data(
+        volatile struct mstp_port_struct_t *mstp_port,  /* port specific data */
+        unsigned timeout);      /* milliseconds to wait for data */
     uint32_t RS485_Get_Port_Baud_Rate(
         volatile struct mstp_port_struct_t *mstp_port);
     uint32_t RS485_Get_Baud_Rate(
@@ -42,6 +42,8 @@
 #include "bacdef.h"
 #include "bacdcode.h"
 #include "readrange.h"
+#include "deadline.h"
+#include "hashtab.h"
 
 /** @file address.c  Handle address binding */
 
@@ -49,13 +51,54 @@
 /* occurs in BACnet.  A device id is bound to a MAC address. */
 /* The normal method is using Who-Is, and using the data from I-Am */
 
-static struct Address_Cache_Entry {
+/* The cache grows on demand in blocks of entries, up to MAX_ADDRESS_CACHE
+   entries. The blocks are never moved, so the entries can be linked into
+   the hash chains and the time to live queues by pointer. */
+#ifndef ADDRESS_CACHE_BLOCK
+#define ADDRESS_CACHE_BLOCK 32
+#endif
+#define ADDRESS_CACHE_BLOCKS \
+    ((MAX_ADDRESS_CACHE + ADDRESS_CACHE_BLOCK - 1) / ADDRESS_CACHE_BLOCK)
+
+/* number of hash buckets for each of the device ID and MAC indexes */
+#ifndef ADDRESS_CACHE_HASH_SIZE
+#if (MAX_ADDRESS_CACHE > 2048)
+#define ADDRESS_CACHE_HASH_SIZE 1024
+#elif (MAX_ADDRESS_CACHE > 256)
+#define ADDRESS_CACHE_HASH_SIZE 256
+#else
+#define ADDRESS_CACHE_HASH_SIZE 64
+#endif
+#endif
+
+struct Address_Cache_Entry {
     uint8_t Flags;
     uint32_t device_id;
     unsigned max_apdu;
     BACNET_ADDRESS address;
-    uint32_t TimeToLive;
-} Address_Cache[MAX_ADDRESS_CACHE];
+    BACNET_DEADLINE TimeToLive; /* not pending when static */
+    BACNET_DEADLINE_QUEUE *TTL_Queue;   /* queue timing the TTL, or NULL */
+    /* next in device ID hash chain when in use, or in the free list */
+    struct Address_Cache_Entry *Next_Device;
+    /* next in MAC hash chain, only when bound */
+    struct Address_Cache_Entry *Next_Address;
+};
+
+static struct Address_Cache_Entry *Address_Block[ADDRESS_CACHE_BLOCKS];
+/* number of entries handed out from the blocks so far */
+static unsigned Address_Slots;
+/* entries handed out and freed again */
+static struct Address_Cache_Entry *Address_Free;
+static struct Address_Cache_Entry *Address_Device_Hash[ADDRESS_CACHE_HASH_SIZE];
+static struct Address_Cache_Entry *Address_MAC_Hash[ADDRESS_CACHE_HASH_SIZE];
+/* number of bound entries */
+static unsigned Address_Bound_Count;
+
+/* time to live of the entries, in seconds. Bound entries and entries
+   waiting for a bind are timed separately, so that the next entry to
+   throw out when full is always at the front of one of the queues. */
+static BACNET_DEADLINE_QUEUE Address_Timers;
+static BACNET_DEADLINE_QUEUE Address_Bind_Timers;
 
 /* State flags for cache entries */
 
@@ -63,7 +106,6 @@ static struct Address_Cache_Entry {
 #define BAC_ADDR_BIND_REQ  2    /* Bind request outstanding for entry */
 #define BAC_ADDR_STATIC    4    /* Static address mapping - does not expire */
 #define BAC_ADDR_SHORT_TTL 8    /* Oppertunistaclly added address with short TTL */
-#define BAC_ADDR_RESERVED  128  /* Freed up but held for caller to fill */
 
 #define BAC_ADDR_SECS_1HOUR 3600        /* 60x60 */
 #define BAC_ADDR_SECS_1DAY  86400       /* 60x60x24 */
@@ -72,6 +114,217 @@ static struct Address_Cache_Entry {
 #define BAC_ADDR_SHORT_TIME BAC_ADDR_SECS_1HOUR
 #define BAC_ADDR_FOREVER    0xFFFFFFFF  /* Permenant entry */
 
+static void address_entry_free(
+    struct Address_Cache_Entry *pMatch);
+
+/* the time to live of an entry ran out */
+static void address_ttl_expired(
+    BACNET_DEADLINE * deadline)
+{
+    struct Address_Cache_Entry *pMatch =
+        (struct Address_Cache_Entry *) deadline->context;
+
+    address_entry_free(pMatch);
+}
+
+/* start counting down the time to live of an entry */
+static void address_ttl_set(
+    struct Address_Cache_Entry *pMatch,
+    uint32_t TimeToLive)
+{
+    BACNET_DEADLINE_QUEUE *queue = &Address_Timers;
+
+    if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) {
+        queue = &Address_Bind_Timers;
+    }
+    if (!pMatch->TimeToLive.callback) {
+        deadline_init(&pMatch->TimeToLive, address_ttl_expired, pMatch);
+    }
+    if ((TimeToLive == BAC_ADDR_FOREVER) || (pMatch->TTL_Queue != queue)) {
+        deadline_stop(pMatch->TTL_Queue, &pMatch->TimeToLive);
+        pMatch->TTL_Queue = NULL;
+    }
+    if (TimeToLive != BAC_ADDR_FOREVER) {
+        if (deadline_start(queue, &pMatch->TimeToLive, TimeToLive)) {
+            pMatch->TTL_Queue = queue;
+        }
+    }
+}
+
+/* time to live remaining for an entry */
+static uint32_t address_ttl(
+    struct Address_Cache_Entry *pMatch)
+{
+    if (!deadline_active(&pMatch->TimeToLive)) {
+        return BAC_ADDR_FOREVER;
+    }
+
+    return deadline_remaining(pMatch->TTL_Queue, &pMatch->TimeToLive);
+}
+
+/* the entry in a slot, or NULL if the slot has not been used yet */
+static struct Address_Cache_Entry *address_slot(
+    unsigned index)
+{
+    if (index < Address_Slots) {
+        return &Address_Block[index / ADDRESS_CACHE_BLOCK][index %
+            ADDRESS_CACHE_BLOCK];
+    }
+
+    return NULL;
+}
+
+static bool address_entry_bound(
+    struct Address_Cache_Entry *pMatch)
+{
+    return ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
+        BAC_ADDR_IN_USE);
+}
+
+/* next bound entry at or after the slot, in slot order */
+static struct Address_Cache_Entry *address_bound_next(
+    unsigned *slot)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    while (*slot < Address_Slots) {
+        pMatch = address_slot(*slot);
+        (*slot)++;
+        if (address_entry_bound(pMatch)) {
+            return pMatch;
+        }
+    }
+
+    return NULL;
+}
+
+static unsigned address_device_hash(
+    uint32_t device_id)
+{
+    return (unsigned) (device_id % ADDRESS_CACHE_HASH_SIZE);
+}
+
+/* hash of the fields that bacnet_address_same() compares */
+static unsigned address_mac_hash(
+    BACNET_ADDRESS * src)
+{
+    uint32_t hash = 0;
+    uint8_t octets[3];
+    uint8_t max_len = 0;
+
+    max_len = src->len;
+    if (max_len > MAX_MAC_LEN)
+        max_len = MAX_MAC_LEN;
+    octets[0] = (uint8_t) (src->net & 0xFF);
+    octets[1] = (uint8_t) (src->net >> 8);
+    octets[2] = max_len;
+    hash = fnv1a32(octets, 3, FNV1A32_SEED);
+    hash = fnv1a32(src->adr, max_len, hash);
+    if (src->net == 0) {
+        max_len = src->mac_len;
+        if (max_len > MAX_MAC_LEN)
+            max_len = MAX_MAC_LEN;
+        hash = fnv1a32(&max_len, 1, hash);
+        hash = fnv1a32(src->mac, max_len, hash);
+    }
+
+    return (unsigned) (hash % ADDRESS_CACHE_HASH_SIZE);
+}
+
+/* the in use (bound or bind requested) entry for a device, or NULL */
+static struct Address_Cache_Entry *address_device_find(
+    uint32_t device_id)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    pMatch = Address_Device_Hash[address_device_hash(device_id)];
+    while (pMatch) {
+        if (pMatch->device_id == device_id) {
+            break;
+        }
+        pMatch = pMatch->Next_Device;
+    }
+
+    return pMatch;
+}
+
+static void address_device_unlink(
+    struct Address_Cache_Entry *pMatch)
+{
+    struct Address_Cache_Entry **ppLink;
+
+    ppLink = &Address_Device_Hash[address_device_hash(pMatch->device_id)];
+    while (*ppLink) {
+        if (*ppLink == pMatch) {
+            *ppLink = pMatch->Next_Device;
+            pMatch->Next_Device = NULL;
+            break;
+        }
+        ppLink = &(*ppLink)->Next_Device;
+    }
+}
+
+static void address_mac_link(
+    struct Address_Cache_Entry *pMatch)
+{
+    unsigned hash = address_mac_hash(&pMatch->address);
+
+    pMatch->Next_Address = Address_MAC_Hash[hash];
+    Address_MAC_Hash[hash] = pMatch;
+    Address_Bound_Count++;
+}
+
+static void address_mac_unlink(
+    struct Address_Cache_Entry *pMatch)
+{
+    struct Address_Cache_Entry **ppLink;
+
+    ppLink = &Address_MAC_Hash[address_mac_hash(&pMatch->address)];
+    while (*ppLink) {
+        if (*ppLink == pMatch) {
+            *ppLink = pMatch->Next_Address;
+            pMatch->Next_Address = NULL;
+            Address_Bound_Count--;
+            break;
+        }
+        ppLink = &(*ppLink)->Next_Address;
+    }
+}
+
+/* empty an entry and put it on the free list */
+static void address_entry_free(
+    struct Address_Cache_Entry *pMatch)
+{
+    if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
+        /* already free */
+        return;
+    }
+    deadline_stop(pMatch->TTL_Queue, &pMatch->TimeToLive);
+    pMatch->TTL_Queue = NULL;
+    if (address_entry_bound(pMatch)) {
+        address_mac_unlink(pMatch);
+    }
+    address_device_unlink(pMatch);
+    pMatch->Flags = 0;
+    pMatch->Next_Device = Address_Free;
+    Address_Free = pMatch;
+}
+
+/* update the address of an entry and mark it as bound */
+static void address_entry_bind(
+    struct Address_Cache_Entry *pMatch,
+    unsigned max_apdu,
+    BACNET_ADDRESS * src)
+{
+    if (address_entry_bound(pMatch)) {
+        address_mac_unlink(pMatch);
+    }
+    pMatch->address = *src;
+    pMatch->max_apdu = max_apdu;
+    pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
+    address_mac_link(pMatch);
+}
+
 bool address_match(
     BACNET_ADDRESS * dest,
     BACNET_ADDRESS * src)
@@ -113,83 +366,87 @@ void address_remove_device(
 {
     struct Address_Cache_Entry *pMatch;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            pMatch->Flags = 0;
-            break;
-        }
-        pMatch++;
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        address_entry_free(pMatch);
     }
 
     return;
 }
 
 /*****************************************************************************
- * Search the cache for the entry nearest expiry and delete it. Mark the     *
- * entry as reserved with a 1 hour TTL and return a pointer to the reserved  *
- * entry. Will not delete a static entry and returns NULL pointer if no      *
- * entry available to free up. Does not check for free entries as it is      *
- * assumed we are calling this due to the lack of those.                     *
+ * Delete the non static entry nearest expiry, trying bound entries first    *
+ * and entries awaiting a bind as a last resort. The entry goes on the free  *
+ * list. Returns false if there is no entry to free up. Does not check for   *
+ * free entries as it is assumed we are calling this due to the lack of      *
+ * those. The time to live queues are ordered by expiry, so the candidate is *
+ * always at the front of one of them.                                       *
  *****************************************************************************/
 
-
-static struct Address_Cache_Entry *address_remove_oldest(
+static bool address_remove_oldest(
     void)
 {
-    struct Address_Cache_Entry *pMatch;
-    struct Address_Cache_Entry *pCandidate;
-    uint32_t ulTime;
-
-    pCandidate = NULL;
-    ulTime = BAC_ADDR_FOREVER - 1;      /* Longest possible non static time to live */
-
-    /* First pass - try only in use and bound entries */
-
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->
-                Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ |
-                    BAC_ADDR_STATIC)) == BAC_ADDR_IN_USE) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
-        }
-        pMatch++;
-    }
+    BACNET_DEADLINE *pOldest;
 
-    if (pCandidate != NULL) {   /* Found something to free up */
-        pCandidate->Flags = BAC_ADDR_RESERVED;
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;   /* only reserve it for a short while */
-        return (pCandidate);
+    /* First try only in use and bound entries */
+    pOldest = deadline_queue_first(&Address_Timers);
+    if (pOldest == NULL) {
+        /* then in use and un bound as last resort */
+        pOldest = deadline_queue_first(&Address_Bind_Timers);
     }
+    if (pOldest == NULL) {
+        return false;
+    }
+    address_entry_free((struct Address_Cache_Entry *) pOldest->context);
 
-    /* Second pass - try in use and un bound as last resort */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->
-                Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ |
-                    BAC_ADDR_STATIC)) ==
-            ((uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ))) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
-                pCandidate = pMatch;
-            }
+    return true;
+}
+
+/*****************************************************************************
+ * Get an empty entry for a device and add it to the device index: a freed   *
+ * entry, a new one if the cache can still grow, or else the entry nearest   *
+ * expiry. Returns NULL if all the entries are static.                       *
+ *****************************************************************************/
+
+static struct Address_Cache_Entry *address_entry_new(
+    uint32_t device_id)
+{
+    struct Address_Cache_Entry *pMatch = NULL;
+    unsigned block = 0;
+    unsigned hash = 0;
+
+    if ((Address_Free == NULL) && (Address_Slots < MAX_ADDRESS_CACHE)) {
+        block = Address_Slots / ADDRESS_CACHE_BLOCK;
+        if (Address_Block[block] == NULL) {
+            Address_Block[block] =
+                calloc(ADDRESS_CACHE_BLOCK,
+                sizeof(struct Address_Cache_Entry));
+        }
+        if (Address_Block[block] != NULL) {
+            Address_Slots++;
+            pMatch = address_slot(Address_Slots - 1);
         }
-        pMatch++;
     }
-
-    if (pCandidate != NULL) {   /* Found something to free up */
-        pCandidate->Flags = BAC_ADDR_RESERVED;
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;   /* only reserve it for a short while */
+    if (pMatch == NULL) {
+        if (Address_Free == NULL) {
+            /* See if we can squeeze it in */
+            (void) address_remove_oldest();
+        }
+        if (Address_Free == NULL) {
+            return NULL;
+        }
+        pMatch = Address_Free;
+        Address_Free = pMatch->Next_Device;
     }
+    pMatch->Flags = BAC_ADDR_IN_USE;
+    pMatch->device_id = device_id;
+    hash = address_device_hash(device_id);
+    pMatch->Next_Device = Address_Device_Hash[hash];
+    Address_Device_Hash[hash] = pMatch;
 
-    return (pCandidate);
+    return pMatch;
 }
 
-
 /* File format:
 DeviceID MAC SNET SADR MAX-APDU
 4194303 05 0 0 50
@@ -264,12 +521,10 @@ static void address_file_init(
 void address_init(
     void)
 {
-    struct Address_Cache_Entry *pMatch;
+    unsigned index;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        pMatch->Flags = 0;
-        pMatch++;
+    for (index = 0; index < Address_Slots; index++) {
+        address_entry_free(address_slot(index));
     }
     address_file_init(Address_Cache_Filename);
 
@@ -288,20 +543,15 @@ void address_init_partial(
     void)
 {
     struct Address_Cache_Entry *pMatch;
+    unsigned index;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+    for (index = 0; index < Address_Slots; index++) {
+        pMatch = address_slot(index);
         if ((pMatch->Flags & BAC_ADDR_IN_USE) != 0) {   /* It's in use so let's check further */
             if (((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) ||
-                (pMatch->TimeToLive == 0))
-                pMatch->Flags = 0;
-        }
-
-        if ((pMatch->Flags & BAC_ADDR_RESERVED) != 0) { /* Reserved entries should be cleared */
-            pMatch->Flags = 0;
+                (address_ttl(pMatch) == 0))
+                address_entry_free(pMatch);
         }
-
-        pMatch++;
     }
     address_file_init(Address_Cache_Filename);
 
@@ -323,24 +573,19 @@ void address_set_device_TTL(
 {
     struct Address_Cache_Entry *pMatch;
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {     /* If bound then we have either static or normaal */
-                if (StaticFlag) {
-                    pMatch->Flags |= BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = BAC_ADDR_FOREVER;
-                } else {
-                    pMatch->Flags &= ~BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = TimeOut;
-                }
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) { /* If bound then we have either static or normaal */
+            if (StaticFlag) {
+                pMatch->Flags |= BAC_ADDR_STATIC;
+                address_ttl_set(pMatch, BAC_ADDR_FOREVER);
             } else {
-                pMatch->TimeToLive = TimeOut;   /* For unbound we can only set the time to live */
+                pMatch->Flags &= ~BAC_ADDR_STATIC;
+                address_ttl_set(pMatch, TimeOut);
             }
-            break;      /* Exit now if found at all - bound or unbound */
+        } else {
+            address_ttl_set(pMatch, TimeOut);       /* For unbound we can only set the time to live */
         }
-        pMatch++;
     }
 }
 
@@ -353,18 +598,13 @@ bool address_get_by_device(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {     /* If bound then fetch data */
-                *src = pMatch->address;
-                *max_apdu = pMatch->max_apdu;
-                found = true;   /* Prove we found it */
-            }
-            break;      /* Exit now if found at all - bound or unbound */
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) { /* If bound then fetch data */
+            *src = pMatch->address;
+            *max_apdu = pMatch->max_apdu;
+            found = true;       /* Prove we found it */
         }
-        pMatch++;
     }
 
     return found;
@@ -379,18 +619,17 @@ bool address_get_device_id(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) == BAC_ADDR_IN_USE) {       /* If bound */
-            if (bacnet_address_same(&pMatch->address, src)) {
-                if (device_id) {
-                    *device_id = pMatch->device_id;
-                }
-                found = true;
-                break;
+    /* only bound entries are in the MAC index */
+    pMatch = Address_MAC_Hash[address_mac_hash(src)];
+    while (pMatch) {
+        if (bacnet_address_same(&pMatch->address, src)) {
+            if (device_id) {
+                *device_id = pMatch->device_id;
             }
+            found = true;
+            break;
         }
-        pMatch++;
+        pMatch = pMatch->Next_Address;
     }
 
     return found;
@@ -401,8 +640,8 @@ void address_add(
     unsigned max_apdu,
     BACNET_ADDRESS * src)
 {
-    bool found = false; /* return value */
     struct Address_Cache_Entry *pMatch;
+    uint8_t Flags = 0;
 
     /* Note: Previously this function would ignore bind request
        marked entries and in fact would probably overwrite the first
@@ -411,59 +650,32 @@ void address_add(
        bind request if it exists */
 
     /* existing device or bind request outstanding - update address */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            pMatch->address = *src;
-            pMatch->max_apdu = max_apdu;
-
-            /* Pick the right time to live */
-
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0)       /* Bind requested so long time */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            else if ((pMatch->Flags & BAC_ADDR_STATIC) != 0)    /* Static already so make sure it never expires */
-                pMatch->TimeToLive = BAC_ADDR_FOREVER;
-            else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) /* Opportunistic entry so leave on short fuse */
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            else
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;        /* Renewing existing entry */
-
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ;        /* Clear bind request flag just in case */
-            found = true;
-            break;
-        }
-        pMatch++;
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        Flags = pMatch->Flags;
+        /* also clears bind request flag just in case */
+        address_entry_bind(pMatch, max_apdu, src);
+
+        /* Pick the right time to live */
+
+        if ((Flags & BAC_ADDR_BIND_REQ) != 0)   /* Bind requested so long time */
+            address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
+        else if ((Flags & BAC_ADDR_STATIC) != 0)        /* Static already so make sure it never expires */
+            address_ttl_set(pMatch, BAC_ADDR_FOREVER);
+        else if ((Flags & BAC_ADDR_SHORT_TTL) != 0)     /* Opportunistic entry so leave on short fuse */
+            address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
+        else
+            address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);    /* Renewing existing entry */
+        return;
     }
 
     /* new device - add to cache if there is room */
-    if (!found) {
-        pMatch = Address_Cache;
-        while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-            if ((pMatch->Flags & BAC_ADDR_IN_USE) == 0) {
-                pMatch->Flags = BAC_ADDR_IN_USE;
-                pMatch->device_id = device_id;
-                pMatch->max_apdu = max_apdu;
-                pMatch->address = *src;
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;       /* Opportunistic entry so leave on short fuse */
-                found = true;
-                break;
-            }
-            pMatch++;
-        }
+    pMatch = address_entry_new(device_id);
+    if (pMatch != NULL) {
+        address_entry_bind(pMatch, max_apdu, src);
+        address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);       /* Opportunistic entry so leave on short fuse */
     }
 
-    /* See if we can squeeze it in */
-    if (!found) {
-        pMatch = address_remove_oldest();
-        if (pMatch != NULL) {
-            pMatch->Flags = BAC_ADDR_IN_USE;
-            pMatch->device_id = device_id;
-            pMatch->max_apdu = max_apdu;
-            pMatch->address = *src;
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;   /* Opportunistic entry so leave on short fuse */
-        }
-    }
     return;
 }
 
@@ -478,46 +690,29 @@ bool address_bind_request(
     struct Address_Cache_Entry *pMatch;
 
     /* existing device - update address info if currently bound */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {     /* Already bound */
-                found = true;
-                *src = pMatch->address;
-                *max_apdu = pMatch->max_apdu;
-                if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {        /* Was picked up opportunistacilly */
-                    pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;       /* Convert to normal entry  */
-                    pMatch->TimeToLive = BAC_ADDR_LONG_TIME;    /* And give it a decent time to live */
-                }
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) { /* Already bound */
+            found = true;
+            *src = pMatch->address;
+            *max_apdu = pMatch->max_apdu;
+            if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {    /* Was picked up opportunistacilly */
+                pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;   /* Convert to normal entry  */
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);        /* And give it a decent time to live */
             }
-            return (found);     /* True if bound, false if bind request outstanding */
-        }
-        pMatch++;
-    }
-
-    /* Not there already so look for a free entry to put it in */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) == 0) {
-            /* In use and awaiting binding */
-            pMatch->Flags = (uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
-            pMatch->device_id = device_id;
-            /* No point in leaving bind requests in for long haul */
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
-            /* now would be a good time to do a Who-Is request */
-            return (false);
         }
-        pMatch++;
+        return (found); /* True if bound, false if bind request outstanding */
     }
 
-    /* No free entries, See if we can squeeze it in by dropping an existing one */
-    pMatch = address_remove_oldest();
+    /* Not there already so put it in a free entry, or squeeze it in
+       by dropping an existing one */
+    pMatch = address_entry_new(device_id);
     if (pMatch != NULL) {
+        /* In use and awaiting binding */
         pMatch->Flags = (uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
-        pMatch->device_id = device_id;
         /* No point in leaving bind requests in for long haul */
-        pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
+        /* now would be a good time to do a Who-Is request */
     }
     return (false);
 }
@@ -531,22 +726,15 @@ void address_add_binding(
     struct Address_Cache_Entry *pMatch;
 
     /* existing device or bind request - update address */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
-            (pMatch->device_id == device_id)) {
-            pMatch->address = *src;
-            pMatch->max_apdu = max_apdu;
-            /* Clear bind request flag in case it was set */
-            pMatch->Flags &= ~BAC_ADDR_BIND_REQ;
-            /* Only update TTL if not static */
-            if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
-                /* and set it on a long fuse */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
-            }
-            break;
+    pMatch = address_device_find(device_id);
+    if (pMatch) {
+        /* Clear bind request flag in case it was set */
+        address_entry_bind(pMatch, max_apdu, src);
+        /* Only update TTL if not static */
+        if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
+            /* and set it on a long fuse */
+            address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
         }
-        pMatch++;
     }
     return;
 }
@@ -560,15 +748,12 @@ bool address_get_by_index(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
-    if (index < MAX_ADDRESS_CACHE) {
-        pMatch = &Address_Cache[index];
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) {
-            *src = pMatch->address;
-            *device_id = pMatch->device_id;
-            *max_apdu = pMatch->max_apdu;
-            found = true;
-        }
+    pMatch = address_slot(index);
+    if (pMatch && address_entry_bound(pMatch)) {
+        *src = pMatch->address;
+        *device_id = pMatch->device_id;
+        *max_apdu = pMatch->max_apdu;
+        found = true;
     }
 
     return found;
@@ -577,20 +762,8 @@ bool address_get_by_index(
 unsigned address_count(
     void)
 {
-    struct Address_Cache_Entry *pMatch;
-    unsigned count = 0; /* return value */
-
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        /* Only count bound entries */
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE)
-            count++;
-
-        pMatch++;
-    }
-
-    return count;
+    /* Only count bound entries */
+    return Address_Bound_Count;
 }
 
 /****************************************************************************
@@ -605,37 +778,33 @@ int address_list_encode(
     int iLen = 0;
     struct Address_Cache_Entry *pMatch;
     BACNET_OCTET_STRING MAC_Address;
+    unsigned uiSlot = 0;
 
     /* FIXME: I really shouild check the length remaining here but it is
        fairly pointless until we have the true length remaining in
        the packet to work with as at the moment it is just MAX_APDU */
     apdu_len = apdu_len;
-    /* look for matching address */
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
-            BAC_ADDR_IN_USE) {
-            iLen +=
-                encode_application_object_id(&apdu[iLen], OBJECT_DEVICE,
-                pMatch->device_id);
-            iLen +=
-                encode_application_unsigned(&apdu[iLen], pMatch->address.net);
+    /* bound entries in slot order */
+    while ((pMatch = address_bound_next(&uiSlot)) != NULL) {
+        iLen +=
+            encode_application_object_id(&apdu[iLen], OBJECT_DEVICE,
+            pMatch->device_id);
+        iLen +=
+            encode_application_unsigned(&apdu[iLen], pMatch->address.net);
 
-            /* pick the appropriate type of entry from the cache */
+        /* pick the appropriate type of entry from the cache */
 
-            if (pMatch->address.len != 0) {
-                octetstring_init(&MAC_Address, pMatch->address.adr,
-                    pMatch->address.len);
-                iLen +=
-                    encode_application_octet_string(&apdu[iLen], &MAC_Address);
-            } else {
-                octetstring_init(&MAC_Address, pMatch->address.mac,
-                    pMatch->address.mac_len);
-                iLen +=
-                    encode_application_octet_string(&apdu[iLen], &MAC_Address);
-            }
+        if (pMatch->address.len != 0) {
+            octetstring_init(&MAC_Address, pMatch->address.adr,
+                pMatch->address.len);
+            iLen +=
+                encode_application_octet_string(&apdu[iLen], &MAC_Address);
+        } else {
+            octetstring_init(&MAC_Address, pMatch->address.mac,
+                pMatch->address.mac_len);
+            iLen +=
+                encode_application_octet_string(&apdu[iLen], &MAC_Address);
         }
-        pMatch++;
     }
 
     return (iLen);
@@ -680,6 +849,7 @@ int rr_address_list_encode(
     uint32_t uiLast = 0;        /* Entry number we finished encoding on */
     uint32_t uiTarget = 0;      /* Last entry we are required to encode */
     uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
+    unsigned uiSlot = 0;        /* Cache slot to look for the next entry from */
 
     /* Initialise result flags to all false */
     bitstring_init(&pRequest->ResultFlags);
@@ -687,7 +857,8 @@ int rr_address_list_encode(
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_LAST_ITEM, false);
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
     /* See how much space we have */
-    uiRemaining = (uint32_t) (MAX_APDU - pRequest->Overhead);
+    uiRemaining =
+        (uint32_t) (pRequest->application_data_len - pRequest->Overhead);
 
     pRequest->ItemCount = 0;    /* Start out with nothing */
     uiTotal = address_count();  /* What do we have to work with here ? */
@@ -738,18 +909,13 @@ int rr_address_list_encode(
     if (uiTarget > uiTotal)     /* Capped at end of list if necessary */
         uiTarget = uiTotal;
 
-    pMatch = Address_Cache;
+    pMatch = address_bound_next(&uiSlot);       /* Find first bound entry */
     uiIndex = 1;
-    while ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) != BAC_ADDR_IN_USE)  /* Find first bound entry */
-        pMatch++;
 
     /* Seek to start position */
     while (uiIndex != pRequest->Range.RefIndex) {
-        if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) == BAC_ADDR_IN_USE) {       /* Only count bound entries */
-            pMatch++;
-            uiIndex++;
-        } else
-            pMatch++;
+        pMatch = address_bound_next(&uiSlot);   /* Only count bound entries */
+        uiIndex++;
     }
 
     uiFirst = uiIndex;  /* Record where we started from */
@@ -792,11 +958,9 @@ int rr_address_list_encode(
 
         uiLast = uiIndex;       /* Record the last entry encoded */
         uiIndex++;      /* and get ready for next one */
-        pMatch++;
         pRequest->ItemCount++;  /* Chalk up another one for the response count */
 
-        while ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) != BAC_ADDR_IN_USE)      /* Find next bound entry */
-            pMatch++;
+        pMatch = address_bound_next(&uiSlot);   /* Find next bound entry */
     }
 
     /* Set remaining result flags if necessary */
@@ -820,20 +984,27 @@ int rr_address_list_encode(
 void address_cache_timer(
     uint16_t uSeconds)
 {       /* Approximate number of seconds since last call to this function */
-    struct Address_Cache_Entry *pMatch;
+    /* Only entries holding a slot except statics have a running TTL,
+       and only those that run out are touched */
+    (void) deadline_queue_timer(&Address_Timers, uSeconds);
+    (void) deadline_queue_timer(&Address_Bind_Timers, uSeconds);
+}
 
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) != 0)
-            && ((pMatch->Flags & BAC_ADDR_STATIC) == 0)) {      /* Check all entries holding a slot except statics */
-            if (pMatch->TimeToLive >= uSeconds)
-                pMatch->TimeToLive -= uSeconds;
-            else
-                pMatch->Flags = 0;
-        }
+/****************************************************************************
+ * Seconds until the next entry in the cache expires, or DEADLINE_NONE.     *
+ ****************************************************************************/
+
+uint32_t address_cache_timer_next_seconds(
+    void)
+{
+    uint32_t seconds = deadline_queue_next(&Address_Timers);
+    uint32_t bind_seconds = deadline_queue_next(&Address_Bind_Timers);
 
-        pMatch++;
+    if (bind_seconds < seconds) {
+        seconds = bind_seconds;
     }
+
+    return seconds;
 }
 
 
@@ -989,6 +1160,90 @@ void testAddress(
         count = address_count();
         ct_test(pTest, count == (MAX_ADDRESS_CACHE - i - 1));
     }
+    ct_test(pTest, address_cache_timer_next_seconds() == DEADLINE_NONE);
+
+    /* opportunistic entries expire, static entries do not */
+    set_address(0, &src);
+    address_add(1, max_apdu, &src);
+    set_address(1, &src);
+    address_add(2, max_apdu, &src);
+    address_set_device_TTL(2, 0, true);
+    ct_test(pTest, address_count() == 2);
+    ct_test(pTest,
+        address_cache_timer_next_seconds() == BAC_ADDR_SHORT_TIME);
+    address_cache_timer(BAC_ADDR_SHORT_TIME - 1);
+    ct_test(pTest, address_count() == 2);
+    ct_test(pTest, address_cache_timer_next_seconds() == 1);
+    address_cache_timer(1);
+    ct_test(pTest, address_count() == 1);
+    ct_test(pTest, !address_get_by_device(1, &test_max_apdu, &test_address));
+    ct_test(pTest, address_get_by_device(2, &test_max_apdu, &test_address));
+    ct_test(pTest, address_cache_timer_next_seconds() == DEADLINE_NONE);
+    address_remove_device(2);
+    ct_test(pTest, address_count() == 0);
+}
+
+void testAddressEviction(
+    Test * pTest)
+{
+    unsigned i;
+    BACNET_ADDRESS src;
+    unsigned max_apdu = 480;
+    BACNET_ADDRESS test_address;
+    uint32_t test_device_id = 0;
+    unsigned test_max_apdu = 0;
+
+    /* fill the cache, all on a long fuse except one */
+    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+        set_address(i, &src);
+        address_add(i, max_apdu, &src);
+        if (i != 7) {
+            address_add_binding(i, max_apdu, &src);
+        }
+    }
+    ct_test(pTest, address_count() == MAX_ADDRESS_CACHE);
+    /* a new device pushes out the one nearest expiry */
+    ct_test(pTest, !address_bind_request(1000, &test_max_apdu,
+            &test_address));
+    ct_test(pTest, address_count() == (MAX_ADDRESS_CACHE - 1));
+    ct_test(pTest, !address_get_by_device(7, &test_max_apdu, &test_address));
+    set_address(7, &src);
+    ct_test(pTest, !address_get_device_id(&src, &test_device_id));
+    /* and takes its MAC address when it answers */
+    address_add_binding(1000, max_apdu, &src);
+    ct_test(pTest, address_count() == MAX_ADDRESS_CACHE);
+    ct_test(pTest, address_get_device_id(&src, &test_device_id));
+    ct_test(pTest, test_device_id == 1000);
+    /* the MAC index follows a device that moves */
+    set_address(MAX_ADDRESS_CACHE, &src);
+    address_add_binding(1, max_apdu, &src);
+    ct_test(pTest, address_get_device_id(&src, &test_device_id));
+    ct_test(pTest, test_device_id == 1);
+    set_address(1, &src);
+    ct_test(pTest, !address_get_device_id(&src, &test_device_id));
+    ct_test(pTest, address_count() == MAX_ADDRESS_CACHE);
+    /* static entries are never pushed out */
+    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+        address_set_device_TTL(i, 0, true);
+    }
+    address_set_device_TTL(1000, 0, true);
+    ct_test(pTest, address_cache_timer_next_seconds() == DEADLINE_NONE);
+    set_address(0, &src);
+    address_add(2000, max_apdu, &src);
+    ct_test(pTest, !address_get_by_device(2000, &test_max_apdu,
+            &test_address));
+    ct_test(pTest, address_count() == MAX_ADDRESS_CACHE);
+    /* the slots are reused once freed */
+    for (i = 0; i < MAX_ADDRESS_CACHE; i++) {
+        address_remove_device(i);
+    }
+    address_remove_device(1000);
+    ct_test(pTest, address_count() == 0);
+    address_add(2000, max_apdu, &src);
+    ct_test(pTest, address_get_by_device(2000, &test_max_apdu,
+            &test_address));
+    ct_test(pTest, address_count() == 1);
+    address_remove_device(2000);
 }
 
 #ifdef TEST_ADDRESS
@@ -1002,6 +1257,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testAddress);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testAddressEviction);
+    assert(rc);
     rc = ct_addTestFunction(pTest, testAddressFile);
     assert(rc);
 
@@ -56,6 +56,11 @@ extern int Routed_Device_Service_Approval(
 static uint16_t Timeout_Milliseconds = 3000;
 /* Number of APDU Retries */
 static uint8_t Number_Of_Retries = 3;
+/* APDU Segment Timeout in Milliseconds */
+static uint16_t Segment_Timeout_Milliseconds = 2000;
+/* Segments sent before waiting for a SegmentACK, and the most
+   that we take from a server before acknowledging them */
+static uint8_t Segment_Window_Size = 8;
 
 /* a simple table for crossing the services supported */
 static BACNET_SERVICES_SUPPORTED
@@ -374,6 +379,36 @@ void apdu_retries_set(
     Number_Of_Retries = value;
 }
 
+uint16_t apdu_segment_timeout(
+    void)
+{
+    return Segment_Timeout_Milliseconds;
+}
+
+void apdu_segment_timeout_set(
+    uint16_t milliseconds)
+{
+    Segment_Timeout_Milliseconds = milliseconds;
+}
+
+uint8_t apdu_segment_window(
+    void)
+{
+    return Segment_Window_Size;
+}
+
+/* the window size is 1..127 segments */
+void apdu_segment_window_set(
+    uint8_t value)
+{
+    if (value < 1) {
+        value = 1;
+    } else if (value > 127) {
+        value = 127;
+    }
+    Segment_Window_Size = value;
+}
+
 
 /* When network communications are completely disabled,
    only DeviceCommunicationControl and ReinitializeDevice APDUs
@@ -547,6 +582,14 @@ void apdu_handler(
                 service_choice = apdu[len++];
                 service_request = &apdu[len];
                 service_request_len = apdu_len - (uint16_t) len;
+                if (service_ack_data.segmented_message &&
+                    !tsm_segmented_ack_received(src, &service_ack_data,
+                        service_choice, &service_request,
+                        &service_request_len)) {
+                    /* the TSM acknowledges the segments, and hands
+                       back the whole Complex ACK with the last one */
+                    break;
+                }
                 switch (service_choice) {
                     case SERVICE_CONFIRMED_GET_ALARM_SUMMARY:
                     case SERVICE_CONFIRMED_GET_ENROLLMENT_SUMMARY:
@@ -578,9 +621,14 @@ void apdu_handler(
                 }
                 break;
             case PDU_TYPE_SEGMENT_ACK:
-                /* FIXME: what about a denial of service attack here?
-                   we could check src to see if that matched the tsm */
-                tsm_free_invoke_id(invoke_id);
+                /* we only send segmented responses, so only a client
+                   acknowledging them is of interest; the TSM checks
+                   that src matches the transaction */
+                server = apdu[0] & 0x01;
+                if (!server && (apdu_len >= 4)) {
+                    tsm_segment_ack_received(src, apdu[1], apdu[2],
+                        apdu[3]);
+                }
                 break;
             case PDU_TYPE_ERROR:
                 invoke_id = apdu[1];
@@ -634,7 +682,12 @@ void apdu_handler(
                 reason = apdu[2];
                 if (Abort_Function)
                     Abort_Function(src, invoke_id, reason, server);
-                tsm_free_invoke_id(invoke_id);
+                if (server) {
+                    tsm_free_invoke_id(invoke_id);
+                } else {
+                    /* the client gave up on our segmented response */
+                    tsm_segmented_response_abort(src, invoke_id);
+                }
                 break;
             default:
                 break;
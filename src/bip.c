@@ -197,32 +197,106 @@ int bip_send_pdu(
     return bytes_sent;
 }
 
-/** Implementation of the receive() function for BACnet/IP; receives one
- * packet, verifies its BVLC header, and removes the BVLC header from
- * the PDU data before returning.
+/** Check the BVLC header of a BACnet/IP packet that has been received,
+ * and find the NPDU within it, without moving it.
  *
  * @param src [out] Source of the packet - who should receive any response.
- * @param pdu [out] A buffer to hold the PDU portion of the received packet,
- * 					after the BVLC portion has been stripped off.
- * @param max_pdu [in] Size of the pdu[] buffer.
+ * @param sin [in] The address the packet was received from.
+ * @param mtu [in] The packet, starting with the BVLC header.
+ * @param mtu_len [in] The number of octets received.
+ * @param npdu [out] Set to the start of the NPDU within mtu[].
+ * @return The number of octets in the NPDU, or zero if there is none.
+ */
+uint16_t bip_decode_npdu(
+    BACNET_ADDRESS * src,
+    struct sockaddr_in *sin,
+    uint8_t * mtu,
+    uint16_t mtu_len,
+    uint8_t ** npdu)
+{
+    uint16_t npdu_len = 0;      /* return value */
+    uint16_t bvlc_len = 0;
+    uint16_t header_len = 4;
+    struct sockaddr_in original_sin = { 0 };
+    int function = 0;
+
+    /* the signature of a BACnet/IP packet */
+    if ((mtu_len < 4) || (mtu[0] != BVLL_TYPE_BACNET_IP))
+        return 0;
+
+    if (bvlc_for_non_bbmd(sin, mtu, mtu_len) > 0) {
+        /* Handled, usually with a NACK. */
+#if PRINT_ENABLED
+        fprintf(stderr, "BIP: BVLC discarded!\n");
+#endif
+        return 0;
+    }
+
+    function = bvlc_get_function_code();        /* aka, mtu[1] */
+    if ((function == BVLC_ORIGINAL_UNICAST_NPDU) ||
+        (function == BVLC_ORIGINAL_BROADCAST_NPDU)) {
+        original_sin.sin_addr.s_addr = sin->sin_addr.s_addr;
+        original_sin.sin_port = sin->sin_port;
+    } else if ((function == BVLC_FORWARDED_NPDU) && (mtu_len >= 10)) {
+        memcpy(&original_sin.sin_addr.s_addr, &mtu[4], 4);
+        memcpy(&original_sin.sin_port, &mtu[8], 2);
+        header_len = 10;
+    } else {
+        return 0;
+    }
+    /* ignore messages from me */
+    if ((original_sin.sin_addr.s_addr == BIP_Address.s_addr) &&
+        (original_sin.sin_port == BIP_Port)) {
+#if 0
+        fprintf(stderr, "BIP: src is me. Discarded!\n");
+#endif
+        return 0;
+    }
+    /* decode the length of the PDU - length is inclusive of BVLC */
+    (void) decode_unsigned16(&mtu[2], &bvlc_len);
+    if ((bvlc_len < header_len) || (bvlc_len > mtu_len)) {
+        /* ignore packets that are truncated or too large */
+        /* clients should check my max-apdu first */
+#if PRINT_ENABLED
+        fprintf(stderr, "BIP: PDU length invalid. Discarded!\n");
+#endif
+        return 0;
+    }
+    /* data in src->mac[] is in network format */
+    src->mac_len = 6;
+    memcpy(&src->mac[0], &original_sin.sin_addr.s_addr, 4);
+    memcpy(&src->mac[4], &original_sin.sin_port, 2);
+    /* FIXME: check destination address */
+    /* see if it is broadcast or for us */
+    npdu_len = bvlc_len - header_len;
+    *npdu = &mtu[header_len];
+
+    return npdu_len;
+}
+
+/** Receive one BACnet/IP packet, and find the NPDU within it without
+ * moving it, so that it can be decoded in place.
+ *
+ * @param src [out] Source of the packet - who should receive any response.
+ * @param mtu [out] A buffer to hold the received packet.
+ * @param max_mtu [in] Size of the mtu[] buffer.
  * @param timeout [in] The number of milliseconds to wait for a packet.
- * @return The number of octets (remaining) in the PDU, or zero on failure.
+ * @param npdu [out] Set to the start of the NPDU within mtu[].
+ * @return The number of octets in the NPDU, or zero on failure.
  */
-uint16_t bip_receive(
-    BACNET_ADDRESS * src,       /* source address */
-    uint8_t * pdu,      /* PDU data */
-    uint16_t max_pdu,   /* amount of space available in the PDU  */
-    unsigned timeout)
+uint16_t bip_receive_npdu(
+    BACNET_ADDRESS * src,
+    uint8_t * mtu,
+    uint16_t max_mtu,
+    unsigned timeout,
+    uint8_t ** npdu)
 {
     int received_bytes = 0;
-    uint16_t pdu_len = 0;       /* return value */
     fd_set read_fds;
     int max = 0;
     struct timeval select_timeout;
     struct sockaddr_in sin = { 0 };
     socklen_t sin_len = sizeof(sin);
-    uint16_t i = 0;
-    int function = 0;
 
     /* Make sure the socket is open */
     if (BIP_Socket < 0)
@@ -245,106 +319,44 @@ uint16_t bip_receive(
     /* see if there is a packet for us */
     if (select(max + 1, &read_fds, NULL, NULL, &select_timeout) > 0)
         received_bytes =
-            recvfrom(BIP_Socket, (char *) &pdu[0], max_pdu, 0,
+            recvfrom(BIP_Socket, (char *) &mtu[0], max_mtu, 0,
             (struct sockaddr *) &sin, &sin_len);
     else
         return 0;
 
-    /* See if there is a problem */
-    if (received_bytes < 0) {
+    /* See if there is a problem, or no bytes */
+    if (received_bytes <= 0) {
         return 0;
     }
 
-    /* no problem, just no bytes */
-    if (received_bytes == 0)
-        return 0;
-
-    /* the signature of a BACnet/IP packet */
-    if (pdu[0] != BVLL_TYPE_BACNET_IP)
-        return 0;
+    return bip_decode_npdu(src, &sin, mtu, (uint16_t) received_bytes, npdu);
+}
 
-    if (bvlc_for_non_bbmd(&sin, pdu, received_bytes) > 0) {
-        /* Handled, usually with a NACK. */
-#if PRINT_ENABLED
-        fprintf(stderr, "BIP: BVLC discarded!\n");
-#endif
-        return 0;
-    }
+/** Implementation of the receive() function for BACnet/IP; receives one
+ * packet, verifies its BVLC header, and removes the BVLC header from
+ * the PDU data before returning.
+ * Use bip_receive_npdu() to decode the NPDU in place instead.
+ *
+ * @param src [out] Source of the packet - who should receive any response.
+ * @param pdu [out] A buffer to hold the PDU portion of the received packet,
+ * 					after the BVLC portion has been stripped off.
+ * @param max_pdu [in] Size of the pdu[] buffer.
+ * @param timeout [in] The number of milliseconds to wait for a packet.
+ * @return The number of octets (remaining) in the PDU, or zero on failure.
+ */
+uint16_t bip_receive(
+    BACNET_ADDRESS * src,       /* source address */
+    uint8_t * pdu,      /* PDU data */
+    uint16_t max_pdu,   /* amount of space available in the PDU  */
+    unsigned timeout)
+{
+    uint16_t pdu_len = 0;       /* return value */
+    uint8_t *npdu = NULL;
 
-    function = bvlc_get_function_code();        /* aka, pdu[1] */
-    if ((function == BVLC_ORIGINAL_UNICAST_NPDU) ||
-        (function == BVLC_ORIGINAL_BROADCAST_NPDU)) {
-        /* ignore messages from me */
-        if ((sin.sin_addr.s_addr == BIP_Address.s_addr) &&
-            (sin.sin_port == BIP_Port)) {
-            pdu_len = 0;
-#if 0
-            fprintf(stderr, "BIP: src is me. Discarded!\n");
-#endif
-        } else {
-            /* data in src->mac[] is in network format */
-            src->mac_len = 6;
-            memcpy(&src->mac[0], &sin.sin_addr.s_addr, 4);
-            memcpy(&src->mac[4], &sin.sin_port, 2);
-            /* FIXME: check destination address */
-            /* see if it is broadcast or for us */
-            /* decode the length of the PDU - length is inclusive of BVLC */
-            (void) decode_unsigned16(&pdu[2], &pdu_len);
-            /* subtract off the BVLC header */
-            pdu_len -= 4;
-            if (pdu_len < max_pdu) {
-#if 0
-                fprintf(stderr, "BIP: NPDU[%hu]:", pdu_len);
-#endif
-                /* shift the buffer to return a valid PDU */
-                for (i = 0; i < pdu_len; i++) {
-                    pdu[i] = pdu[4 + i];
-#if 0
-                    fprintf(stderr, "%02X ", pdu[i]);
-#endif
-                }
-#if 0
-                fprintf(stderr, "\n");
-#endif
-            }
-            /* ignore packets that are too large */
-            /* clients should check my max-apdu first */
-            else {
-                pdu_len = 0;
-#if PRINT_ENABLED
-                fprintf(stderr, "BIP: PDU too large. Discarded!.\n");
-#endif
-            }
-        }
-    } else if (function == BVLC_FORWARDED_NPDU) {
-        memcpy(&sin.sin_addr.s_addr, &pdu[4], 4);
-        memcpy(&sin.sin_port, &pdu[8], 2);
-        if ((sin.sin_addr.s_addr == BIP_Address.s_addr) &&
-            (sin.sin_port == BIP_Port)) {
-            /* ignore messages from me */
-            pdu_len = 0;
-        } else {
-            /* data in src->mac[] is in network format */
-            src->mac_len = 6;
-            memcpy(&src->mac[0], &sin.sin_addr.s_addr, 4);
-            memcpy(&src->mac[4], &sin.sin_port, 2);
-            /* FIXME: check destination address */
-            /* see if it is broadcast or for us */
-            /* decode the length of the PDU - length is inclusive of BVLC */
-            (void) decode_unsigned16(&pdu[2], &pdu_len);
-            /* subtract off the BVLC header */
-            pdu_len -= 10;
-            if (pdu_len < max_pdu) {
-                /* shift the buffer to return a valid PDU */
-                for (i = 0; i < pdu_len; i++) {
-                    pdu[i] = pdu[4 + 6 + i];
-                }
-            } else {
-                /* ignore packets that are too large */
-                /* clients should check my max-apdu first */
-                pdu_len = 0;
-            }
-        }
+    pdu_len = bip_receive_npdu(src, pdu, max_pdu, timeout, &npdu);
+    if (pdu_len) {
+        /* shift the buffer to return a valid PDU */
+        memmove(pdu, npdu, pdu_len);
     }
 
     return pdu_len;
@@ -35,6 +35,7 @@
 #include <stdint.h>     /* for standard integer types uint8_t etc. */
 #include <stdbool.h>    /* for the standard bool type. */
 #include <time.h>
+#include <errno.h>
 #include "bacenum.h"
 #include "bacdcode.h"
 #include "bacint.h"
@@ -77,6 +78,8 @@ typedef struct {
     uint16_t dest_port; /* in network format */
     /* Broadcast Distribution Mask */
     struct in_addr broadcast_mask;      /* in tework format */
+    /* Forwarded-NPDU messages sent to this entry */
+    BVLC_FORWARD_STATS stats;
 } BBMD_TABLE_ENTRY;
 
 #ifndef MAX_BBMD_ENTRIES
@@ -103,6 +106,8 @@ typedef struct {
     uint16_t time_to_live;
     /* our counter */
     time_t seconds_remaining;   /* includes 30 second grace period */
+    /* Forwarded-NPDU messages sent to this entry */
+    BVLC_FORWARD_STATS stats;
 } FD_TABLE_ENTRY;
 
 #ifndef MAX_FD_ENTRIES
@@ -110,6 +115,16 @@ typedef struct {
 #endif
 static FD_TABLE_ENTRY FD_Table[MAX_FD_ENTRIES];
 
+/* The destinations of one Forwarded-NPDU message: the local broadcast,
+   the BDT and the FDT.  The message is built once and sent to all of
+   them together. */
+#define BVLC_FANOUT_MAX (1 + MAX_BBMD_ENTRIES + MAX_FD_ENTRIES)
+static struct sockaddr_in Fanout_Dest[BVLC_FANOUT_MAX];
+/* the counters of each destination, NULL for the local broadcast */
+static BVLC_FORWARD_STATS *Fanout_Stats[BVLC_FANOUT_MAX];
+static int Fanout_Result[BVLC_FANOUT_MAX];
+static unsigned Fanout_Count;
+
 
 void bvlc_maintenance_timer(
     time_t seconds)
@@ -132,6 +147,34 @@ void bvlc_maintenance_timer(
     }
 }
 
+bool bvlc_bdt_forward_stats(
+    unsigned index,
+    BVLC_FORWARD_STATS * stats)
+{
+    if ((index < MAX_BBMD_ENTRIES) && BBMD_Table[index].valid) {
+        if (stats) {
+            *stats = BBMD_Table[index].stats;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool bvlc_fdt_forward_stats(
+    unsigned index,
+    BVLC_FORWARD_STATS * stats)
+{
+    if ((index < MAX_FD_ENTRIES) && FD_Table[index].valid) {
+        if (stats) {
+            *stats = FD_Table[index].stats;
+        }
+        return true;
+    }
+
+    return false;
+}
+
 /* copy the source internet address to the BACnet address */
 /* FIXME: IPv6? */
 static void bvlc_internet_to_bacnet_address(
@@ -564,6 +607,7 @@ static bool bvlc_create_bdt(
             pdu_offset += 2;
             memcpy(&BBMD_Table[i].broadcast_mask.s_addr, &npdu[pdu_offset], 4);
             pdu_offset += 4;
+            memset(&BBMD_Table[i].stats, 0, sizeof(BVLC_FORWARD_STATS));
             npdu_length -= (4 + 2 + 4);
         } else {
             BBMD_Table[i].valid = false;
@@ -611,6 +655,7 @@ static bool bvlc_register_foreign_device(
                 FD_Table[i].dest_port = sin->sin_port;
                 FD_Table[i].time_to_live = time_to_live;
                 FD_Table[i].seconds_remaining = time_to_live + 30;
+                memset(&FD_Table[i].stats, 0, sizeof(BVLC_FORWARD_STATS));
                 FD_Table[i].valid = true;
                 status = true;
                 break;
@@ -680,101 +725,147 @@ int bvlc_send_mpdu(
 }
 
 #if defined(BBMD_ENABLED) && BBMD_ENABLED
-static void bvlc_bdt_forward_npdu(
-    struct sockaddr_in *sin,    /* source address in network order */
-    uint8_t * npdu,     /* the NPDU */
-    uint16_t npdu_length)
-{       /* length of the NPDU  */
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
+/* add a destination to the Forwarded-NPDU fan-out */
+static void bvlc_fanout_add(
+    uint32_t addr,      /* in network format */
+    uint16_t port,      /* in network format */
+    BVLC_FORWARD_STATS * stats)
+{
+    if (Fanout_Count < BVLC_FANOUT_MAX) {
+        Fanout_Dest[Fanout_Count].sin_addr.s_addr = addr;
+        Fanout_Dest[Fanout_Count].sin_port = port;
+        Fanout_Stats[Fanout_Count] = stats;
+        Fanout_Count++;
+    }
+}
+
+/* add the local B/IP broadcast address to the fan-out */
+static void bvlc_fanout_local(
+    void)
+{
+    bvlc_fanout_add(bip_get_broadcast_addr(), bip_get_port(), NULL);
+}
+
+/* add each entry in the BDT to the fan-out, except us */
+static void bvlc_fanout_bdt(
+    void)
+{
     unsigned i = 0;     /* loop counter */
-    struct sockaddr_in bip_dest = { 0 };
+    uint32_t addr = 0;
 
-    mtu_len =
-        (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0], sin, npdu, npdu_length);
-    /* loop through the BDT and send one to each entry, except us */
     for (i = 0; i < MAX_BBMD_ENTRIES; i++) {
         if (BBMD_Table[i].valid) {
             /* The B/IP address to which the Forwarded-NPDU message is
                sent is formed by inverting the broadcast distribution
                mask in the BDT entry and logically ORing it with the
                BBMD address of the same entry. */
-            bip_dest.sin_addr.s_addr =
+            addr =
                 ((~BBMD_Table[i].broadcast_mask.
                     s_addr) | BBMD_Table[i].dest_address.s_addr);
-            bip_dest.sin_port = BBMD_Table[i].dest_port;
-            /* don't send to my broadcast address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_broadcast_addr())
-                && (bip_dest.sin_port == bip_get_port())) {
-                continue;
-            }
-            /* don't send to my ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_addr()) &&
-                (bip_dest.sin_port == bip_get_port())) {
-                continue;
+            if (BBMD_Table[i].dest_port == bip_get_port()) {
+                /* don't send to my broadcast address and same port */
+                if (addr == bip_get_broadcast_addr()) {
+                    continue;
+                }
+                /* don't send to my ip address and same port */
+                if (addr == bip_get_addr()) {
+                    continue;
+                }
             }
-            bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_printf("BVLC: BDT Sent Forwarded-NPDU to %s:%04X\n",
-                inet_ntoa(bip_dest.sin_addr), ntohs(bip_dest.sin_port));
+            bvlc_fanout_add(addr, BBMD_Table[i].dest_port,
+                &BBMD_Table[i].stats);
         }
     }
-
-    return;
-}
-
-/* Generate BVLL Forwarded-NPDU message on its local IP subnet using
-   the local B/IP broadcast address as the destination address.  */
-static void bvlc_forward_npdu(
-    struct sockaddr_in *sin,    /* source address in network order */
-    uint8_t * npdu,     /* the NPDU */
-    uint16_t npdu_length)
-{       /* length of the NPDU  */
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
-    struct sockaddr_in bip_dest = { 0 };
-
-    mtu_len =
-        (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0], sin, npdu, npdu_length);
-    bip_dest.sin_addr.s_addr = bip_get_broadcast_addr();
-    bip_dest.sin_port = bip_get_port();
-    bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-    debug_printf("BVLC: Sent Forwarded-NPDU as local broadcast.\n");
 }
 
-static void bvlc_fdt_forward_npdu(
-    struct sockaddr_in *sin,    /* source address in network order */
-    uint8_t * npdu,     /* returns the NPDU */
-    uint16_t max_npdu)
-{       /* amount of space available in the NPDU  */
-    uint8_t mtu[MAX_MPDU] = { 0 };
-    uint16_t mtu_len = 0;
+/* add each entry in the FDT to the fan-out, except us and the source */
+static void bvlc_fanout_fdt(
+    struct sockaddr_in *sin)
+{       /* source address in network order */
     unsigned i = 0;     /* loop counter */
-    struct sockaddr_in bip_dest = { 0 };
 
-    mtu_len =
-        (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0], sin, npdu, max_npdu);
-    /* loop through the FDT and send one to each entry */
     for (i = 0; i < MAX_FD_ENTRIES; i++) {
         if (FD_Table[i].valid && FD_Table[i].seconds_remaining) {
-            bip_dest.sin_addr.s_addr = FD_Table[i].dest_address.s_addr;
-            bip_dest.sin_port = FD_Table[i].dest_port;
             /* don't send to my ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == bip_get_addr()) &&
-                (bip_dest.sin_port == bip_get_port())) {
+            if ((FD_Table[i].dest_address.s_addr == bip_get_addr()) &&
+                (FD_Table[i].dest_port == bip_get_port())) {
                 continue;
             }
             /* don't send to src ip address and same port */
-            if ((bip_dest.sin_addr.s_addr == sin->sin_addr.s_addr) &&
-                (bip_dest.sin_port == sin->sin_port)) {
+            if ((FD_Table[i].dest_address.s_addr == sin->sin_addr.s_addr) &&
+                (FD_Table[i].dest_port == sin->sin_port)) {
                 continue;
             }
-            bvlc_send_mpdu(&bip_dest, mtu, mtu_len);
-            debug_printf("BVLC: FDT Sent Forwarded-NPDU to %s:%04X\n",
-                inet_ntoa(bip_dest.sin_addr), ntohs(bip_dest.sin_port));
+            bvlc_fanout_add(FD_Table[i].dest_address.s_addr,
+                FD_Table[i].dest_port, &FD_Table[i].stats);
         }
     }
+}
 
-    return;
+/* send the message to each destination in the fan-out,
+   and count the results against their table entries */
+static void bvlc_fanout_send(
+    uint8_t * mtu,
+    uint16_t mtu_len)
+{
+    unsigned i = 0;     /* loop counter */
+    BVLC_FORWARD_STATS *stats = NULL;
+
+    if (Fanout_Count == 0) {
+        return;
+    }
+#if defined(BIP_SEND_BATCH) && BIP_SEND_BATCH
+    bip_send_mpdu_batch(Fanout_Dest, Fanout_Result, Fanout_Count, mtu,
+        mtu_len);
+#else
+    for (i = 0; i < Fanout_Count; i++) {
+        Fanout_Result[i] = bvlc_send_mpdu(&Fanout_Dest[i], mtu, mtu_len);
+        if (Fanout_Result[i] < 0) {
+            Fanout_Result[i] = -errno;
+        }
+    }
+#endif
+    for (i = 0; i < Fanout_Count; i++) {
+        stats = Fanout_Stats[i];
+        if (stats == NULL) {
+            continue;
+        }
+        if (Fanout_Result[i] >= 0) {
+            stats->sent++;
+        } else if (Fanout_Result[i] == -EAGAIN) {
+            stats->again++;
+        } else {
+            stats->dropped++;
+        }
+    }
+    debug_printf("BVLC: Sent Forwarded-NPDU to %u destinations.\n",
+        Fanout_Count);
+    Fanout_Count = 0;
+}
+
+/* Build one Forwarded-NPDU message and send it to each entry in the BDT
+   and the FDT, and optionally on the local IP subnet using the local
+   B/IP broadcast address as the destination address. */
+static void bvlc_forward_npdu(
+    struct sockaddr_in *sin,    /* source address in network order */
+    uint8_t * npdu,     /* the NPDU */
+    uint16_t npdu_length,       /* length of the NPDU  */
+    bool local)
+{       /* true to broadcast on the local IP subnet */
+    uint8_t mtu[MAX_MPDU] = { 0 };
+    uint16_t mtu_len = 0;
+
+    if ((4 + 6 + npdu_length) > MAX_MPDU) {
+        return;
+    }
+    mtu_len =
+        (uint16_t) bvlc_encode_forwarded_npdu(&mtu[0], sin, npdu, npdu_length);
+    if (local) {
+        bvlc_fanout_local();
+    }
+    bvlc_fanout_bdt();
+    bvlc_fanout_fdt(sin);
+    bvlc_fanout_send(mtu, mtu_len);
 }
 #endif
 
@@ -991,16 +1082,19 @@ uint16_t bvlc_receive(
             bvlc_decode_bip_address(&npdu[4], &original_sin.sin_addr,
                 &original_sin.sin_port);
             npdu_len -= 6;
-            /*  Broadcast locally if received via unicast from a BDT member */
-            if (bvlc_bdt_member_mask_is_unicast(&sin)) {
-                dest.sin_addr.s_addr = bip_get_broadcast_addr();
-                dest.sin_port = bip_get_port();
-                bvlc_send_mpdu(&dest, &npdu[4 + 6], npdu_len);
-            }
             /* use the original addr from the BVLC for src */
             dest.sin_addr.s_addr = original_sin.sin_addr.s_addr;
             dest.sin_port = original_sin.sin_port;
-            bvlc_fdt_forward_npdu(&dest, &npdu[4 + 6], npdu_len);
+            if ((4 + 6 + npdu_len) <= received_bytes) {
+                /*  Broadcast locally if received via unicast from a BDT
+                   member */
+                if (bvlc_bdt_member_mask_is_unicast(&sin)) {
+                    bvlc_fanout_local();
+                }
+                bvlc_fanout_fdt(&dest);
+                /* the message received is forwarded as it is */
+                bvlc_fanout_send(&npdu[0], (uint16_t) (4 + 6 + npdu_len));
+            }
             debug_printf("BVLC: Received Forwarded-NPDU from %s:%04X.\n",
                 inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
             bvlc_internet_to_bacnet_address(src, &dest);
@@ -1094,9 +1188,7 @@ uint16_t bvlc_receive(
                it shall return a BVLC-Result message to the foreign device
                with a result code of X'0060' indicating that the forwarding
                attempt was unsuccessful */
-            bvlc_forward_npdu(&sin, &npdu[4], npdu_len);
-            bvlc_bdt_forward_npdu(&sin, &npdu[4], npdu_len);
-            bvlc_fdt_forward_npdu(&sin, &npdu[4], npdu_len);
+            bvlc_forward_npdu(&sin, &npdu[4], npdu_len, true);
             /* not an NPDU */
             npdu_len = 0;
             break;
@@ -1142,8 +1234,7 @@ uint16_t bvlc_receive(
                     npdu[i] = npdu[4 + i];
                 }
                 /* if BDT or FDT entries exist, Forward the NPDU */
-                bvlc_bdt_forward_npdu(&sin, &npdu[0], npdu_len);
-                bvlc_fdt_forward_npdu(&sin, &npdu[0], npdu_len);
+                bvlc_forward_npdu(&sin, &npdu[0], npdu_len, false);
             } else {
                 /* ignore packets that are too large */
                 npdu_len = 0;
@@ -0,0 +1,190 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+
+/* Functional Description: Queue of the objects with a change of value
+   waiting to be reported, kept as a ring buffer. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "covqueue.h"
+
+/** @file covqueue.c  Queue of objects with a change of value */
+
+/* the ring indexes are free running, and wrap at the queue size */
+#if (COV_QUEUE_SIZE & (COV_QUEUE_SIZE - 1))
+#error COV_QUEUE_SIZE must be a power of two
+#endif
+static BACNET_OBJECT_ID COV_Queue[COV_QUEUE_SIZE];
+static unsigned COV_Queue_Head;
+static unsigned COV_Queue_Tail;
+/* an object could not be queued since the last check */
+static bool COV_Queue_Overflow;
+
+/** Empty the queue.
+ */
+void cov_queue_init(
+    void)
+{
+    COV_Queue_Head = 0;
+    COV_Queue_Tail = 0;
+    COV_Queue_Overflow = false;
+}
+
+/** Queue an object that has a change of value.
+ * @param object_type [in] The type of the object that changed.
+ * @param object_instance [in] The instance of the object that changed.
+ * @return true if the object was queued, false if the queue was full.
+ */
+bool cov_queue_push(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    BACNET_OBJECT_ID *object_id;
+
+    if ((COV_Queue_Tail - COV_Queue_Head) >= COV_QUEUE_SIZE) {
+        COV_Queue_Overflow = true;
+        return false;
+    }
+    object_id = &COV_Queue[COV_Queue_Tail % COV_QUEUE_SIZE];
+    object_id->type = object_type;
+    object_id->instance = object_instance;
+    COV_Queue_Tail++;
+
+    return true;
+}
+
+/** Take the oldest object off the queue.
+ * @param object_id [out] The object that changed.
+ * @return true if an object was taken, false if the queue was empty.
+ */
+bool cov_queue_pop(
+    BACNET_OBJECT_ID * object_id)
+{
+    if (COV_Queue_Head == COV_Queue_Tail) {
+        return false;
+    }
+    *object_id = COV_Queue[COV_Queue_Head % COV_QUEUE_SIZE];
+    COV_Queue_Head++;
+
+    return true;
+}
+
+/** Get the number of objects in the queue.
+ * @return The number of objects in the queue.
+ */
+unsigned cov_queue_count(
+    void)
+{
+    return COV_Queue_Tail - COV_Queue_Head;
+}
+
+/** Check and clear the overflow of the queue.
+ * @return true if an object could not be queued since the last check.
+ */
+bool cov_queue_overflow(
+    void)
+{
+    bool overflow = COV_Queue_Overflow;
+
+    COV_Queue_Overflow = false;
+
+    return overflow;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+void testCOVQueue(
+    Test * pTest)
+{
+    BACNET_OBJECT_ID object_id;
+    unsigned i = 0;
+
+    cov_queue_init();
+    ct_test(pTest, cov_queue_count() == 0);
+    ct_test(pTest, !cov_queue_pop(&object_id));
+    ct_test(pTest, !cov_queue_overflow());
+    /* in order, and across the wrap of the ring */
+    for (i = 0; i < (COV_QUEUE_SIZE * 3); i++) {
+        ct_test(pTest, cov_queue_push(OBJECT_ANALOG_INPUT, i));
+        ct_test(pTest, cov_queue_pop(&object_id));
+        ct_test(pTest, object_id.type == OBJECT_ANALOG_INPUT);
+        ct_test(pTest, object_id.instance == i);
+    }
+    ct_test(pTest, cov_queue_count() == 0);
+    /* full */
+    for (i = 0; i < COV_QUEUE_SIZE; i++) {
+        ct_test(pTest, cov_queue_push(OBJECT_BINARY_VALUE, i));
+    }
+    ct_test(pTest, cov_queue_count() == COV_QUEUE_SIZE);
+    ct_test(pTest, !cov_queue_overflow());
+    ct_test(pTest, !cov_queue_push(OBJECT_BINARY_VALUE, i));
+    ct_test(pTest, cov_queue_count() == COV_QUEUE_SIZE);
+    ct_test(pTest, cov_queue_overflow());
+    ct_test(pTest, !cov_queue_overflow());
+    for (i = 0; i < COV_QUEUE_SIZE; i++) {
+        ct_test(pTest, cov_queue_pop(&object_id));
+        ct_test(pTest, object_id.type == OBJECT_BINARY_VALUE);
+        ct_test(pTest, object_id.instance == i);
+    }
+    ct_test(pTest, !cov_queue_pop(&object_id));
+    cov_queue_init();
+    ct_test(pTest, cov_queue_count() == 0);
+}
+
+#ifdef TEST_COV_QUEUE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("COV Queue", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testCOVQueue);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_COV_QUEUE */
+#endif /* TEST */
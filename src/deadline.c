@@ -0,0 +1,482 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+/* Functional Description: Queue of pending timeouts (deadlines) kept in
+   a binary min-heap, so that finding and expiring the next deadline does
+   not need to scan every timer of the owner. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "deadline.h"
+
+/** @file deadline.c  Deadline (timeout) queue */
+
+/* number of heap entries to grow by */
+#define DEADLINE_CHUNK 16
+
+/* true if time a is before time b, allowing for the clock wrapping */
+static bool deadline_before(
+    uint32_t a,
+    uint32_t b)
+{
+    return ((int32_t) (a - b) < 0);
+}
+
+static void deadline_heap_set(
+    BACNET_DEADLINE_QUEUE * queue,
+    unsigned index,
+    BACNET_DEADLINE * deadline)
+{
+    queue->heap[index] = deadline;
+    deadline->position = index + 1;
+}
+
+/* move the entry at index towards the root until it is in order */
+static void deadline_sift_up(
+    BACNET_DEADLINE_QUEUE * queue,
+    unsigned index)
+{
+    BACNET_DEADLINE *deadline = queue->heap[index];
+    unsigned parent = 0;
+
+    while (index > 0) {
+        parent = (index - 1) / 2;
+        if (!deadline_before(deadline->expires,
+                queue->heap[parent]->expires)) {
+            break;
+        }
+        deadline_heap_set(queue, index, queue->heap[parent]);
+        index = parent;
+    }
+    deadline_heap_set(queue, index, deadline);
+}
+
+/* move the entry at index towards the leaves until it is in order */
+static void deadline_sift_down(
+    BACNET_DEADLINE_QUEUE * queue,
+    unsigned index)
+{
+    BACNET_DEADLINE *deadline = queue->heap[index];
+    unsigned child = 0;
+
+    for (;;) {
+        child = (index * 2) + 1;
+        if (child >= queue->count) {
+            break;
+        }
+        if (((child + 1) < queue->count) &&
+            deadline_before(queue->heap[child + 1]->expires,
+                queue->heap[child]->expires)) {
+            child++;
+        }
+        if (!deadline_before(queue->heap[child]->expires,
+                deadline->expires)) {
+            break;
+        }
+        deadline_heap_set(queue, index, queue->heap[child]);
+        index = child;
+    }
+    deadline_heap_set(queue, index, deadline);
+}
+
+/* takes the entry at index out of the heap */
+static void deadline_heap_remove(
+    BACNET_DEADLINE_QUEUE * queue,
+    unsigned index)
+{
+    BACNET_DEADLINE *last = NULL;
+
+    queue->heap[index]->position = 0;
+    queue->count--;
+    if (index < queue->count) {
+        last = queue->heap[queue->count];
+        deadline_heap_set(queue, index, last);
+        if ((index > 0) &&
+            deadline_before(last->expires,
+                queue->heap[(index - 1) / 2]->expires)) {
+            deadline_sift_up(queue, index);
+        } else {
+            deadline_sift_down(queue, index);
+        }
+    }
+}
+
+/** Prepare a deadline for use.  Must not be called while it is pending.
+ * @param deadline [in] The deadline to initialize.
+ * @param callback [in] Function called when the deadline expires.
+ * @param context [in] Owner data available to the callback.
+ */
+void deadline_init(
+    BACNET_DEADLINE * deadline,
+    deadline_callback_function callback,
+    void *context)
+{
+    if (deadline) {
+        deadline->expires = 0;
+        deadline->position = 0;
+        deadline->callback = callback;
+        deadline->context = context;
+    }
+}
+
+/** Start (or restart) a deadline to expire after the given ticks.
+ *  A deadline of zero ticks expires at the next queue tick.
+ * @param queue [in] The queue that times the deadline.
+ * @param deadline [in] The deadline to start.
+ * @param ticks [in] Ticks from now until it expires.
+ * @return true if the deadline is pending, false if out of memory.
+ */
+bool deadline_start(
+    BACNET_DEADLINE_QUEUE * queue,
+    BACNET_DEADLINE * deadline,
+    uint32_t ticks)
+{
+    BACNET_DEADLINE **heap = NULL;
+    unsigned index = 0;
+
+    if (!queue || !deadline) {
+        return false;
+    }
+    if (ticks == 0) {
+        /* so that a callback restarting itself cannot loop forever */
+        ticks = 1;
+    }
+    if (ticks > INT32_MAX) {
+        ticks = INT32_MAX;
+    }
+    if (deadline->position) {
+        /* already pending - just move it */
+        index = deadline->position - 1;
+        deadline->expires = queue->now + ticks;
+        deadline_sift_up(queue, index);
+        deadline_sift_down(queue, deadline->position - 1);
+        return true;
+    }
+    if (queue->count == queue->size) {
+        heap = realloc(queue->heap,
+            (queue->size + DEADLINE_CHUNK) * sizeof(BACNET_DEADLINE *));
+        if (!heap) {
+            return false;
+        }
+        queue->heap = heap;
+        queue->size += DEADLINE_CHUNK;
+    }
+    deadline->expires = queue->now + ticks;
+    index = queue->count;
+    queue->count++;
+    queue->heap[index] = deadline;
+    deadline_sift_up(queue, index);
+
+    return true;
+}
+
+/** Stop a deadline so that it does not expire.
+ * @param queue [in] The queue that times the deadline.
+ * @param deadline [in] The deadline to stop.  Not pending is okay.
+ */
+void deadline_stop(
+    BACNET_DEADLINE_QUEUE * queue,
+    BACNET_DEADLINE * deadline)
+{
+    if (queue && deadline && deadline->position) {
+        deadline_heap_remove(queue, deadline->position - 1);
+    }
+}
+
+/** Check if a deadline is pending.
+ * @param deadline [in] The deadline to check.
+ * @return true if the deadline is started and has not expired.
+ */
+bool deadline_active(
+    BACNET_DEADLINE * deadline)
+{
+    return (deadline && deadline->position);
+}
+
+/** Get the time remaining until a deadline expires.
+ * @param queue [in] The queue that times the deadline.
+ * @param deadline [in] The deadline to check.
+ * @return ticks remaining, or 0 if not pending.
+ */
+uint32_t deadline_remaining(
+    BACNET_DEADLINE_QUEUE * queue,
+    BACNET_DEADLINE * deadline)
+{
+    uint32_t ticks = 0;
+
+    if (queue && deadline && deadline->position) {
+        if (deadline_before(queue->now, deadline->expires)) {
+            ticks = deadline->expires - queue->now;
+        }
+    }
+
+    return ticks;
+}
+
+/** Advance the queue time and expire the deadlines that are due.
+ *  The callback of each expired deadline is called after it has been
+ *  removed from the queue, so the callback may start it again.
+ * @param queue [in] The queue to tick.
+ * @param elapsed_ticks [in] Ticks since the last call.
+ * @return number of deadlines that expired.
+ */
+unsigned deadline_queue_timer(
+    BACNET_DEADLINE_QUEUE * queue,
+    uint32_t elapsed_ticks)
+{
+    BACNET_DEADLINE *deadline = NULL;
+    unsigned expired = 0;
+
+    if (!queue) {
+        return 0;
+    }
+    queue->now += elapsed_ticks;
+    while (queue->count &&
+        !deadline_before(queue->now, queue->heap[0]->expires)) {
+        deadline = queue->heap[0];
+        deadline_heap_remove(queue, 0);
+        expired++;
+        if (deadline->callback) {
+            deadline->callback(deadline);
+        }
+    }
+
+    return expired;
+}
+
+/** Get the time until the next deadline in the queue expires.
+ *  Useful as a timeout for a blocking receive.
+ * @param queue [in] The queue to check.
+ * @return ticks until the next deadline (0 if overdue),
+ *         or DEADLINE_NONE if none are pending.
+ */
+uint32_t deadline_queue_next(
+    BACNET_DEADLINE_QUEUE * queue)
+{
+    uint32_t ticks = DEADLINE_NONE;
+
+    if (queue && queue->count) {
+        ticks = 0;
+        if (deadline_before(queue->now, queue->heap[0]->expires)) {
+            ticks = queue->heap[0]->expires - queue->now;
+        }
+    }
+
+    return ticks;
+}
+
+/** Get the deadline that expires next, without expiring it.
+ * @param queue [in] The queue to check.
+ * @return the next deadline, or NULL if none are pending.
+ */
+BACNET_DEADLINE *deadline_queue_first(
+    BACNET_DEADLINE_QUEUE * queue)
+{
+    BACNET_DEADLINE *deadline = NULL;
+
+    if (queue && queue->count) {
+        deadline = queue->heap[0];
+    }
+
+    return deadline;
+}
+
+/** Get the number of pending deadlines.
+ * @param queue [in] The queue to check.
+ * @return number of deadlines in the queue.
+ */
+unsigned deadline_queue_count(
+    BACNET_DEADLINE_QUEUE * queue)
+{
+    unsigned count = 0;
+
+    if (queue) {
+        count = queue->count;
+    }
+
+    return count;
+}
+
+/** Stop all the pending deadlines and free the queue memory.
+ * @param queue [in] The queue to clean up.
+ */
+void deadline_queue_cleanup(
+    BACNET_DEADLINE_QUEUE * queue)
+{
+    unsigned i = 0;
+
+    if (queue) {
+        for (i = 0; i < queue->count; i++) {
+            queue->heap[i]->position = 0;
+        }
+        free(queue->heap);
+        queue->heap = NULL;
+        queue->count = 0;
+        queue->size = 0;
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include "ctest.h"
+
+static unsigned Expired_Count;
+static uint32_t Expired_Order[64];
+
+static void testDeadlineCallback(
+    BACNET_DEADLINE * deadline)
+{
+    uint32_t *value = (uint32_t *) deadline->context;
+
+    if (Expired_Count < 64) {
+        Expired_Order[Expired_Count] = *value;
+    }
+    Expired_Count++;
+}
+
+static void testDeadlineRestart(
+    BACNET_DEADLINE * deadline)
+{
+    BACNET_DEADLINE_QUEUE *queue = (BACNET_DEADLINE_QUEUE *)
+        deadline->context;
+
+    Expired_Count++;
+    (void) deadline_start(queue, deadline, 0);
+}
+
+void testDeadlineQueue(
+    Test * pTest)
+{
+    BACNET_DEADLINE_QUEUE queue = { 0 };
+    BACNET_DEADLINE deadline[64];
+    uint32_t value[64];
+    unsigned i = 0;
+    unsigned count = 0;
+
+    ct_test(pTest, deadline_queue_next(&queue) == DEADLINE_NONE);
+    ct_test(pTest, deadline_queue_first(&queue) == NULL);
+    ct_test(pTest, deadline_queue_timer(&queue, 1000) == 0);
+    /* add them in a scrambled order */
+    for (i = 0; i < 64; i++) {
+        value[i] = ((i * 37) % 64) + 1;
+        deadline_init(&deadline[i], testDeadlineCallback, &value[i]);
+        ct_test(pTest, deadline_active(&deadline[i]) == false);
+        ct_test(pTest, deadline_start(&queue, &deadline[i], value[i]));
+        ct_test(pTest, deadline_active(&deadline[i]));
+        ct_test(pTest, deadline_remaining(&queue,
+                &deadline[i]) == value[i]);
+    }
+    ct_test(pTest, deadline_queue_count(&queue) == 64);
+    ct_test(pTest, deadline_queue_next(&queue) == 1);
+    /* stop some of them */
+    for (i = 0; i < 64; i += 4) {
+        deadline_stop(&queue, &deadline[i]);
+        ct_test(pTest, deadline_active(&deadline[i]) == false);
+        ct_test(pTest, deadline_remaining(&queue, &deadline[i]) == 0);
+    }
+    ct_test(pTest, deadline_queue_count(&queue) == 48);
+    /* they expire in order, and only the ones due */
+    Expired_Count = 0;
+    count = deadline_queue_timer(&queue, 10);
+    ct_test(pTest, count == Expired_Count);
+    for (i = 0; i < Expired_Count; i++) {
+        ct_test(pTest, Expired_Order[i] <= 10);
+        if (i) {
+            ct_test(pTest, Expired_Order[i - 1] <= Expired_Order[i]);
+        }
+    }
+    count = deadline_queue_timer(&queue, 100);
+    ct_test(pTest, Expired_Count == 48);
+    for (i = 1; i < Expired_Count; i++) {
+        ct_test(pTest, Expired_Order[i - 1] <= Expired_Order[i]);
+    }
+    ct_test(pTest, deadline_queue_count(&queue) == 0);
+    ct_test(pTest, deadline_queue_next(&queue) == DEADLINE_NONE);
+    /* restart moves a pending deadline */
+    ct_test(pTest, deadline_start(&queue, &deadline[0], 50));
+    ct_test(pTest, deadline_start(&queue, &deadline[1], 20));
+    ct_test(pTest, deadline_queue_next(&queue) == 20);
+    ct_test(pTest, deadline_start(&queue, &deadline[0], 5));
+    ct_test(pTest, deadline_queue_next(&queue) == 5);
+    ct_test(pTest, deadline_queue_first(&queue) == &deadline[0]);
+    ct_test(pTest, deadline_queue_count(&queue) == 2);
+    ct_test(pTest, deadline_start(&queue, &deadline[0], 500));
+    ct_test(pTest, deadline_queue_next(&queue) == 20);
+    deadline_queue_cleanup(&queue);
+    ct_test(pTest, deadline_active(&deadline[0]) == false);
+    ct_test(pTest, deadline_queue_count(&queue) == 0);
+    /* the queue clock may wrap */
+    queue.now = UINT32_MAX - 5;
+    ct_test(pTest, deadline_start(&queue, &deadline[0], 10));
+    Expired_Count = 0;
+    (void) deadline_queue_timer(&queue, 5);
+    ct_test(pTest, Expired_Count == 0);
+    ct_test(pTest, deadline_remaining(&queue, &deadline[0]) == 5);
+    (void) deadline_queue_timer(&queue, 5);
+    ct_test(pTest, Expired_Count == 1);
+    /* a callback may restart its own deadline */
+    deadline_init(&deadline[2], testDeadlineRestart, &queue);
+    ct_test(pTest, deadline_start(&queue, &deadline[2], 0));
+    Expired_Count = 0;
+    (void) deadline_queue_timer(&queue, 1);
+    ct_test(pTest, Expired_Count == 1);
+    ct_test(pTest, deadline_active(&deadline[2]));
+    deadline_queue_cleanup(&queue);
+}
+
+#ifdef TEST_DEADLINE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("deadline", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testDeadlineQueue);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_DEADLINE */
+#endif /* TEST */
@@ -0,0 +1,208 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+/* Functional Description: FNV-1a hashing, and the probing and growth of
+   the open addressed hash tables. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "hashtab.h"
+
+/** @file hashtab.c  Hashing and open addressed hash tables */
+
+/** Hash some octets with FNV-1a.
+ * @param data [in] The octets to hash.
+ * @param length [in] The number of octets.
+ * @param seed [in] FNV1A32_SEED for a new hash, or the hash of the
+ *        octets that come before these.
+ * @return the hash.
+ */
+uint32_t fnv1a32(
+    const void *data,
+    size_t length,
+    uint32_t seed)
+{
+    const uint8_t *octets = (const uint8_t *) data;
+    uint32_t hash = seed;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        hash ^= octets[i];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/** Get the entry where the probe for a hash starts.
+ * Multiplicative hashing, taking the top bits, so that keys that differ
+ * only in their low bits, such as network numbers, are spread out.
+ * @param hash [in] The hash or key of the entry.
+ * @param bits [in] The table has 1 << bits entries.
+ * @return the index of the entry.
+ */
+unsigned hash_table_home(
+    uint32_t hash,
+    unsigned bits)
+{
+    return (unsigned) ((uint32_t) (hash * 2654435761UL) >> (32 - bits));
+}
+
+/** Get the entry to probe after the given one.
+ * @param index [in] The entry just probed.
+ * @param bits [in] The table has 1 << bits entries.
+ * @return the index of the next entry, wrapping at the end.
+ */
+unsigned hash_table_next(
+    unsigned index,
+    unsigned bits)
+{
+    return (index + 1) & ((1U << bits) - 1);
+}
+
+/** Get the size of table needed to add an entry.
+ * @param count [in] The number of entries in the table.
+ * @param bits [in] The table has 1 << bits entries, or zero if there
+ *        is no table yet.
+ * @param min_bits [in] The size of a new table.
+ * @param max_bits [in] The largest table allowed.
+ * @return bits if the table has room, the size to grow it to if not,
+ *         or zero if it can't grow any more.
+ */
+unsigned hash_table_bits(
+    unsigned count,
+    unsigned bits,
+    unsigned min_bits,
+    unsigned max_bits)
+{
+    if (bits == 0) {
+        return min_bits;
+    }
+    if ((2 * (count + 1)) <= (1U << bits)) {
+        return bits;
+    }
+    if (bits >= max_bits) {
+        return 0;
+    }
+
+    return bits + 1;
+}
+
+/** Find out if an entry moves back into a free entry before it,
+ * when removing an entry empties the free one.
+ * @param home [in] Where the probe for the entry starts.
+ * @param hole [in] The free entry.
+ * @param index [in] Where the entry is, after the hole and with no
+ *        free entry between them.
+ * @param bits [in] The table has 1 << bits entries.
+ * @return true if the entry would no longer be found unless moved,
+ *         which is when its probe starts at or before the hole.
+ */
+bool hash_table_shift(
+    unsigned home,
+    unsigned hole,
+    unsigned index,
+    unsigned bits)
+{
+    unsigned mask = (1U << bits) - 1;
+
+    return (((index - home) & mask) >= ((index - hole) & mask));
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include "ctest.h"
+
+void testHashTable(
+    Test * pTest)
+{
+    const char *text = "foobar";
+    uint32_t hash = 0;
+
+    /* the published FNV-1a test vectors */
+    ct_test(pTest, fnv1a32(NULL, 0, FNV1A32_SEED) == 0x811c9dc5UL);
+    ct_test(pTest, fnv1a32("a", 1, FNV1A32_SEED) == 0xe40c292cUL);
+    ct_test(pTest, fnv1a32(text, strlen(text), FNV1A32_SEED) ==
+        0xbf9cf968UL);
+    /* hashing in parts gives the same hash */
+    hash = fnv1a32(text, 3, FNV1A32_SEED);
+    ct_test(pTest, fnv1a32(&text[3], 3, hash) == 0xbf9cf968UL);
+
+    ct_test(pTest, hash_table_home(0, 6) == 0);
+    ct_test(pTest, hash_table_home(0xFFFFFFFFUL, 6) < 64);
+    ct_test(pTest, hash_table_home(1, 6) != hash_table_home(2, 6));
+    ct_test(pTest, hash_table_next(62, 6) == 63);
+    ct_test(pTest, hash_table_next(63, 6) == 0);
+
+    /* a new table, then grow at more than half full, up to the limit */
+    ct_test(pTest, hash_table_bits(0, 0, 4, 5) == 4);
+    ct_test(pTest, hash_table_bits(7, 4, 4, 5) == 4);
+    ct_test(pTest, hash_table_bits(8, 4, 4, 5) == 5);
+    ct_test(pTest, hash_table_bits(15, 5, 4, 5) == 5);
+    ct_test(pTest, hash_table_bits(16, 5, 4, 5) == 0);
+
+    /* an entry at its home stays, one probed past the hole moves */
+    ct_test(pTest, !hash_table_shift(5, 4, 5, 4));
+    ct_test(pTest, hash_table_shift(4, 4, 5, 4));
+    ct_test(pTest, hash_table_shift(3, 4, 6, 4));
+    ct_test(pTest, !hash_table_shift(5, 4, 6, 4));
+    /* and the same across the end of the table */
+    ct_test(pTest, hash_table_shift(14, 15, 1, 4));
+    ct_test(pTest, !hash_table_shift(0, 15, 1, 4));
+}
+
+#ifdef TEST_HASHTAB
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Hash Table", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testHashTable);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_HASHTAB */
+#endif /* TEST */
@@ -48,6 +48,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #if PRINT_ENABLED
 #include <stdio.h>
 #endif
@@ -206,12 +207,13 @@ uint16_t MSTP_Create_Frame(
     buffer[7] = ~crc8;
 
     index = 8;
-    while (data_len && data && (index < buffer_len)) {
-        buffer[index] = *data;
-        crc16 = CRC_Calc_Data(buffer[index], crc16);
-        data++;
-        index++;
-        data_len--;
+    if (data && data_len) {
+        if (data_len > (buffer_len - index)) {
+            data_len = buffer_len - index;
+        }
+        memcpy(&buffer[index], data, data_len);
+        crc16 = CRC_Calc_Data_Buffer(&buffer[index], data_len, crc16);
+        index += data_len;
     }
     /* append the data CRC if necessary */
     if (index > 8) {
@@ -493,9 +495,12 @@ void MSTP_Receive_Frame_FSM(
                 printf_receive_data("%02X ", mstp_port->DataRegister);
                 if (mstp_port->Index < mstp_port->DataLength) {
                     /* DataOctet */
-                    mstp_port->DataCRC =
-                        CRC_Calc_Data(mstp_port->DataRegister,
-                        mstp_port->DataCRC);
+                    if (mstp_port->DataLength > mstp_port->InputBufferSize) {
+                        /* not all of the data is kept for the CRC below */
+                        mstp_port->DataCRC =
+                            CRC_Calc_Data(mstp_port->DataRegister,
+                            mstp_port->DataCRC);
+                    }
                     if (mstp_port->Index < mstp_port->InputBufferSize) {
                         mstp_port->InputBuffer[mstp_port->Index] =
                             mstp_port->DataRegister;
@@ -504,6 +509,12 @@ void MSTP_Receive_Frame_FSM(
                     mstp_port->receive_state = MSTP_RECEIVE_STATE_DATA;
                 } else if (mstp_port->Index == mstp_port->DataLength) {
                     /* CRC1 */
+                    if (mstp_port->DataLength <= mstp_port->InputBufferSize) {
+                        /* the data octets are all in the input buffer */
+                        mstp_port->DataCRC =
+                            CRC_Calc_Data_Buffer(mstp_port->InputBuffer,
+                            mstp_port->DataLength, mstp_port->DataCRC);
+                    }
                     mstp_port->DataCRC =
                         CRC_Calc_Data(mstp_port->DataRegister,
                         mstp_port->DataCRC);
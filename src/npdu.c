@@ -581,6 +581,42 @@ void tsm_free_invoke_id(
     (void) invokeID;
 }
 
+void tsm_segment_ack_received(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID,
+    uint8_t sequence_number,
+    uint8_t actual_window_size)
+{
+    (void) src;
+    (void) invokeID;
+    (void) sequence_number;
+    (void) actual_window_size;
+}
+
+void tsm_segmented_response_abort(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    (void) src;
+    (void) invokeID;
+}
+
+bool tsm_segmented_ack_received(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+    uint8_t service_choice,
+    uint8_t ** service_request,
+    uint16_t * service_request_len)
+{
+    (void) src;
+    (void) service_data;
+    (void) service_choice;
+    (void) service_request;
+    (void) service_request_len;
+
+    return false;
+}
+
 void iam_handler(
     uint8_t * service_request,
     uint16_t service_len,
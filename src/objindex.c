@@ -0,0 +1,280 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+/* Functional Description: Index of object instance numbers to object
+   table indexes, kept as a sorted array for a binary search. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "objindex.h"
+
+/** @file objindex.c  Object instance to table index lookup */
+
+/* number of entries to grow by */
+#define OBJECT_INDEX_CHUNK 32
+
+/* position of the first entry with an instance not less than the given one */
+static unsigned object_index_position(
+    BACNET_OBJECT_INDEX * object_index,
+    uint32_t instance)
+{
+    unsigned low = 0;
+    unsigned high = object_index->count;
+    unsigned middle = 0;
+
+    while (low < high) {
+        middle = low + ((high - low) / 2);
+        if (object_index->list[middle].instance < instance) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/** Add an object to the index.
+ * @param object_index [in] The index of the object type.
+ * @param instance [in] The object instance number.
+ * @param index [in] The index of the object in its table.
+ * @return true if added, false if the instance is already in the index
+ *         (the first one added is kept) or out of memory.
+ */
+bool object_index_add(
+    BACNET_OBJECT_INDEX * object_index,
+    uint32_t instance,
+    unsigned index)
+{
+    BACNET_OBJECT_INDEX_ENTRY *list = NULL;
+    unsigned position = 0;
+
+    if (!object_index) {
+        return false;
+    }
+    position = object_index_position(object_index, instance);
+    if ((position < object_index->count) &&
+        (object_index->list[position].instance == instance)) {
+        return false;
+    }
+    if (object_index->count == object_index->size) {
+        list = realloc(object_index->list,
+            (object_index->size +
+                OBJECT_INDEX_CHUNK) * sizeof(BACNET_OBJECT_INDEX_ENTRY));
+        if (!list) {
+            return false;
+        }
+        object_index->list = list;
+        object_index->size += OBJECT_INDEX_CHUNK;
+    }
+    memmove(&object_index->list[position + 1],
+        &object_index->list[position],
+        (object_index->count - position) * sizeof(BACNET_OBJECT_INDEX_ENTRY));
+    object_index->list[position].instance = instance;
+    object_index->list[position].index = index;
+    object_index->count++;
+
+    return true;
+}
+
+/** Remove an object from the index.
+ * @param object_index [in] The index of the object type.
+ * @param instance [in] The object instance number.
+ * @return true if the instance was in the index.
+ */
+bool object_index_remove(
+    BACNET_OBJECT_INDEX * object_index,
+    uint32_t instance)
+{
+    unsigned position = 0;
+
+    if (!object_index) {
+        return false;
+    }
+    position = object_index_position(object_index, instance);
+    if ((position >= object_index->count) ||
+        (object_index->list[position].instance != instance)) {
+        return false;
+    }
+    object_index->count--;
+    memmove(&object_index->list[position],
+        &object_index->list[position + 1],
+        (object_index->count - position) * sizeof(BACNET_OBJECT_INDEX_ENTRY));
+    if (object_index->last_valid && (object_index->last.instance == instance)) {
+        object_index->last_valid = false;
+    }
+
+    return true;
+}
+
+/** Look up the table index of an object.
+ * @param object_index [in] The index of the object type.
+ * @param instance [in] The object instance number.
+ * @param index [out] The index of the object in its table, if found.
+ * @return true if the instance was found.
+ */
+bool object_index_find(
+    BACNET_OBJECT_INDEX * object_index,
+    uint32_t instance,
+    unsigned *index)
+{
+    unsigned position = 0;
+
+    if (!object_index) {
+        return false;
+    }
+    if (!object_index->last_valid || (object_index->last.instance != instance)) {
+        position = object_index_position(object_index, instance);
+        if ((position >= object_index->count) ||
+            (object_index->list[position].instance != instance)) {
+            return false;
+        }
+        object_index->last = object_index->list[position];
+        object_index->last_valid = true;
+    }
+    if (index) {
+        *index = object_index->last.index;
+    }
+
+    return true;
+}
+
+/** Get the number of objects in the index.
+ * @param object_index [in] The index of the object type.
+ * @return number of objects.
+ */
+unsigned object_index_count(
+    BACNET_OBJECT_INDEX * object_index)
+{
+    unsigned count = 0;
+
+    if (object_index) {
+        count = object_index->count;
+    }
+
+    return count;
+}
+
+/** Remove all the objects and free the index memory.
+ * @param object_index [in] The index to clean up.
+ */
+void object_index_cleanup(
+    BACNET_OBJECT_INDEX * object_index)
+{
+    if (object_index) {
+        free(object_index->list);
+        object_index->list = NULL;
+        object_index->count = 0;
+        object_index->size = 0;
+        object_index->last_valid = false;
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include "ctest.h"
+
+void testObjectIndex(
+    Test * pTest)
+{
+    BACNET_OBJECT_INDEX object_index = { 0 };
+    unsigned index = 0;
+    unsigned i = 0;
+
+    ct_test(pTest, object_index_count(&object_index) == 0);
+    ct_test(pTest, !object_index_find(&object_index, 0, &index));
+    /* add them in a scrambled order */
+    for (i = 0; i < 1000; i++) {
+        ct_test(pTest, object_index_add(&object_index, ((i * 37) % 1000) * 3,
+                i));
+    }
+    ct_test(pTest, object_index_count(&object_index) == 1000);
+    for (i = 1; i < object_index.count; i++) {
+        ct_test(pTest,
+            object_index.list[i - 1].instance < object_index.list[i].instance);
+    }
+    for (i = 0; i < 1000; i++) {
+        ct_test(pTest, object_index_find(&object_index, ((i * 37) % 1000) * 3,
+                &index));
+        ct_test(pTest, index == i);
+        /* again, from the last one found */
+        index = 0;
+        ct_test(pTest, object_index_find(&object_index, ((i * 37) % 1000) * 3,
+                &index));
+        ct_test(pTest, index == i);
+        ct_test(pTest, !object_index_find(&object_index,
+                (((i * 37) % 1000) * 3) + 1, &index));
+    }
+    ct_test(pTest, !object_index_find(&object_index, UINT32_MAX, &index));
+    /* the first one added is kept */
+    ct_test(pTest, !object_index_add(&object_index, 3, 5000));
+    ct_test(pTest, object_index_find(&object_index, 3, &index));
+    ct_test(pTest, index != 5000);
+    /* removed, even when it was the last one found */
+    ct_test(pTest, object_index_remove(&object_index, 3));
+    ct_test(pTest, !object_index_remove(&object_index, 3));
+    ct_test(pTest, !object_index_find(&object_index, 3, &index));
+    ct_test(pTest, object_index_find(&object_index, 0, &index));
+    ct_test(pTest, object_index_find(&object_index, 6, &index));
+    ct_test(pTest, object_index_count(&object_index) == 999);
+    object_index_cleanup(&object_index);
+    ct_test(pTest, object_index_count(&object_index) == 0);
+    ct_test(pTest, !object_index_find(&object_index, 6, &index));
+}
+
+#ifdef TEST_OBJINDEX
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Object Index", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testObjectIndex);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_OBJINDEX */
+#endif /* TEST */
@@ -0,0 +1,396 @@
+/*####COPYRIGHTBEGIN####
+ -------------------------------------------
+ Copyright (C) 2026 by the BACnet Stack contributors
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to:
+ The Free Software Foundation, Inc.
+ 59 Temple Place - Suite 330
+ Boston, MA  02111-1307
+ USA.
+
+ As a special exception, if other files instantiate templates or
+ use macros or inline functions from this file, or you compile
+ this file and link it with other works to produce a work based
+ on this file, this file does not by itself cause the resulting
+ work to be covered by the GNU General Public License. However
+ the source code for this file must still be made available in
+ accordance with section (3) of the GNU General Public License.
+
+ This exception does not invalidate any other reasons why a work
+ based on this file might be covered by the GNU General Public
+ License.
+ -------------------------------------------
+####COPYRIGHTEND####*/
+
+/* Functional Description: Index of object name hashes to the objects
+   that may have the name, kept in an open addressed hash table. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bacstr.h"
+#include "hashtab.h"
+#include "objname.h"
+
+/** @file objname.c  Object name to object lookup */
+
+/* the smallest and largest tables, as powers of two */
+#define OBJECT_NAME_INDEX_MIN_BITS 4
+#define OBJECT_NAME_INDEX_MAX_BITS 24
+
+/* FNV-1a hash of the encoding and the characters of a name, never zero */
+static uint32_t object_name_hash(
+    BACNET_CHARACTER_STRING * name)
+{
+    uint32_t hash = 0;
+    uint8_t encoding = 0;
+
+    encoding = characterstring_encoding(name);
+    hash = fnv1a32(&encoding, 1, FNV1A32_SEED);
+    hash = fnv1a32(characterstring_value(name),
+        characterstring_length(name), hash);
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    return hash;
+}
+
+/* put an entry into a table that has room for it */
+static void object_name_insert(
+    BACNET_OBJECT_NAME_ENTRY * table,
+    unsigned bits,
+    BACNET_OBJECT_NAME_ENTRY * entry)
+{
+    unsigned i = hash_table_home(entry->hash, bits);
+
+    while (table[i].hash) {
+        i = hash_table_next(i, bits);
+    }
+    table[i] = *entry;
+}
+
+/* move the entries to a table of the given size */
+static bool object_name_resize(
+    BACNET_OBJECT_NAME_INDEX * name_index,
+    unsigned bits)
+{
+    BACNET_OBJECT_NAME_ENTRY *table = NULL;
+    unsigned size = 0;
+    unsigned i = 0;
+
+    table = calloc(1U << bits, sizeof(BACNET_OBJECT_NAME_ENTRY));
+    if (!table) {
+        return false;
+    }
+    if (name_index->table) {
+        size = 1U << name_index->bits;
+        for (i = 0; i < size; i++) {
+            if (name_index->table[i].hash) {
+                object_name_insert(table, bits, &name_index->table[i]);
+            }
+        }
+        free(name_index->table);
+    }
+    name_index->table = table;
+    name_index->bits = bits;
+
+    return true;
+}
+
+/** Add an object with the given name to the index.
+ * @param name_index [in] The index.
+ * @param name [in] The name of the object.
+ * @param type [in] The object type.
+ * @param instance [in] The object instance number.
+ * @return true if added or already there with this name,
+ *         false if out of memory.
+ */
+bool object_name_index_add(
+    BACNET_OBJECT_NAME_INDEX * name_index,
+    BACNET_CHARACTER_STRING * name,
+    uint16_t type,
+    uint32_t instance)
+{
+    BACNET_OBJECT_NAME_ENTRY entry;
+    unsigned bits = 0;
+    unsigned cursor = 0;
+    uint16_t found_type = 0;
+    uint32_t found_instance = 0;
+
+    if (!name_index || !name) {
+        return false;
+    }
+    while (object_name_index_find(name_index, name, &cursor, &found_type,
+            &found_instance)) {
+        if ((found_type == type) && (found_instance == instance)) {
+            return true;
+        }
+    }
+    bits = hash_table_bits(name_index->count,
+        name_index->table ? name_index->bits : 0,
+        OBJECT_NAME_INDEX_MIN_BITS, OBJECT_NAME_INDEX_MAX_BITS);
+    if (bits == 0) {
+        return false;
+    }
+    if (!name_index->table || (bits != name_index->bits)) {
+        if (!object_name_resize(name_index, bits)) {
+            return false;
+        }
+    }
+    entry.hash = object_name_hash(name);
+    entry.type = type;
+    entry.instance = instance;
+    object_name_insert(name_index->table, name_index->bits, &entry);
+    name_index->count++;
+
+    return true;
+}
+
+/** Remove an object from the index.
+ * @param name_index [in] The index.
+ * @param name [in] The name the object had when it was added.
+ * @param type [in] The object type.
+ * @param instance [in] The object instance number.
+ * @return true if the object was in the index with this name.
+ */
+bool object_name_index_remove(
+    BACNET_OBJECT_NAME_INDEX * name_index,
+    BACNET_CHARACTER_STRING * name,
+    uint16_t type,
+    uint32_t instance)
+{
+    BACNET_OBJECT_NAME_ENTRY *table = NULL;
+    uint32_t hash = 0;
+    unsigned bits = 0;
+    unsigned home = 0;
+    unsigned i = 0;
+    unsigned j = 0;
+
+    if (!name_index || !name || !name_index->table) {
+        return false;
+    }
+    table = name_index->table;
+    bits = name_index->bits;
+    hash = object_name_hash(name);
+    i = hash_table_home(hash, bits);
+    while ((table[i].hash != hash) || (table[i].type != type) ||
+        (table[i].instance != instance)) {
+        if (!table[i].hash) {
+            return false;
+        }
+        i = hash_table_next(i, bits);
+    }
+    /* shift back the entries after it that would no longer be found */
+    j = i;
+    for (;;) {
+        j = hash_table_next(j, bits);
+        if (!table[j].hash) {
+            break;
+        }
+        home = hash_table_home(table[j].hash, bits);
+        if (hash_table_shift(home, i, j, bits)) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].hash = 0;
+    name_index->count--;
+
+    return true;
+}
+
+/** Find the next object that may have the given name.
+ * The objects found have a name with the same hash, and the caller
+ * compares the name of each of them until it finds the one it wants.
+ * @param name_index [in] The index.
+ * @param name [in] The name to look for.
+ * @param cursor [in,out] Zero to find the first object, then left as
+ *        it was by the last call to find the next one.
+ * @param type [out] The object type found.
+ * @param instance [out] The object instance number found.
+ * @return true if an object was found, false if there are no more.
+ */
+bool object_name_index_find(
+    BACNET_OBJECT_NAME_INDEX * name_index,
+    BACNET_CHARACTER_STRING * name,
+    unsigned *cursor,
+    uint16_t * type,
+    uint32_t * instance)
+{
+    BACNET_OBJECT_NAME_ENTRY *entry = NULL;
+    uint32_t hash = 0;
+    unsigned mask = 0;
+    unsigned home = 0;
+
+    if (!name_index || !name || !cursor || !name_index->table) {
+        return false;
+    }
+    mask = (1U << name_index->bits) - 1;
+    hash = object_name_hash(name);
+    home = hash_table_home(hash, name_index->bits);
+    while (*cursor <= mask) {
+        entry = &name_index->table[(home + *cursor) & mask];
+        if (!entry->hash) {
+            break;
+        }
+        (*cursor)++;
+        if (entry->hash == hash) {
+            if (type) {
+                *type = entry->type;
+            }
+            if (instance) {
+                *instance = entry->instance;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Get the number of objects in the index.
+ * @param name_index [in] The index.
+ * @return number of objects.
+ */
+unsigned object_name_index_count(
+    BACNET_OBJECT_NAME_INDEX * name_index)
+{
+    unsigned count = 0;
+
+    if (name_index) {
+        count = name_index->count;
+    }
+
+    return count;
+}
+
+/** Remove all the objects and free the index memory.
+ * @param name_index [in] The index to clean up.
+ */
+void object_name_index_cleanup(
+    BACNET_OBJECT_NAME_INDEX * name_index)
+{
+    if (name_index) {
+        free(name_index->table);
+        name_index->table = NULL;
+        name_index->bits = 0;
+        name_index->count = 0;
+    }
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+
+/* whether the object is one of those found for the name */
+static bool object_name_index_has(
+    BACNET_OBJECT_NAME_INDEX * name_index,
+    const char *text,
+    uint16_t type,
+    uint32_t instance)
+{
+    BACNET_CHARACTER_STRING name;
+    unsigned cursor = 0;
+    uint16_t found_type = 0;
+    uint32_t found_instance = 0;
+
+    characterstring_init_ansi(&name, text);
+    while (object_name_index_find(name_index, &name, &cursor, &found_type,
+            &found_instance)) {
+        if ((found_type == type) && (found_instance == instance)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void testObjectNameIndex(
+    Test * pTest)
+{
+    BACNET_OBJECT_NAME_INDEX name_index = { 0 };
+    BACNET_CHARACTER_STRING name;
+    char text[32];
+    unsigned i = 0;
+
+    ct_test(pTest, object_name_index_count(&name_index) == 0);
+    ct_test(pTest, !object_name_index_has(&name_index, "AI0", 0, 0));
+    for (i = 0; i < 1000; i++) {
+        sprintf(text, "AI%u", i);
+        characterstring_init_ansi(&name, text);
+        ct_test(pTest, object_name_index_add(&name_index, &name, 0, i));
+    }
+    ct_test(pTest, object_name_index_count(&name_index) == 1000);
+    ct_test(pTest, (2 * name_index.count) <= (1U << name_index.bits));
+    /* added again, it is not added twice */
+    characterstring_init_ansi(&name, "AI7");
+    ct_test(pTest, object_name_index_add(&name_index, &name, 0, 7));
+    ct_test(pTest, object_name_index_count(&name_index) == 1000);
+    /* two objects with the same name are both found */
+    ct_test(pTest, object_name_index_add(&name_index, &name, 2, 7));
+    ct_test(pTest, object_name_index_has(&name_index, "AI7", 0, 7));
+    ct_test(pTest, object_name_index_has(&name_index, "AI7", 2, 7));
+    for (i = 0; i < 1000; i++) {
+        sprintf(text, "AI%u", i);
+        ct_test(pTest, object_name_index_has(&name_index, text, 0, i));
+    }
+    ct_test(pTest, !object_name_index_has(&name_index, "AI1000", 0, 1000));
+    /* removed only with the name it was added with */
+    ct_test(pTest, !object_name_index_remove(&name_index, &name, 0, 8));
+    ct_test(pTest, object_name_index_remove(&name_index, &name, 0, 7));
+    ct_test(pTest, !object_name_index_remove(&name_index, &name, 0, 7));
+    ct_test(pTest, !object_name_index_has(&name_index, "AI7", 0, 7));
+    ct_test(pTest, object_name_index_has(&name_index, "AI7", 2, 7));
+    /* the others are still found after every other one is removed */
+    for (i = 0; i < 1000; i += 2) {
+        sprintf(text, "AI%u", i);
+        characterstring_init_ansi(&name, text);
+        ct_test(pTest, object_name_index_remove(&name_index, &name, 0, i));
+    }
+    for (i = 0; i < 1000; i++) {
+        sprintf(text, "AI%u", i);
+        ct_test(pTest, object_name_index_has(&name_index, text, 0,
+                i) == ((i & 1) && (i != 7)));
+    }
+    ct_test(pTest, object_name_index_count(&name_index) == 500);
+    object_name_index_cleanup(&name_index);
+    ct_test(pTest, object_name_index_count(&name_index) == 0);
+    ct_test(pTest, !object_name_index_has(&name_index, "AI9", 0, 9));
+}
+
+#ifdef TEST_OBJNAME
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("Object Name Index", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testObjectNameIndex);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_OBJNAME */
+#endif /* TEST */
@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "bits.h"
 #include "apdu.h"
 #include "bacdef.h"
@@ -46,6 +47,7 @@
 #include "handlers.h"
 #include "address.h"
 #include "bacaddr.h"
+#include "deadline.h"
 
 /** @file tsm.c  BACnet Transaction State Machine operations  */
 
@@ -55,80 +57,151 @@
 /* If we are only a server and only initiate broadcasts, */
 /* then we don't need a TSM layer. */
 
-/* FIXME: not coded for segmentation */
+/* Complex ACKs that are too big for one APDU are sent as segmented
+   responses, and segmented Complex ACKs to our own requests are put
+   back together; segmented requests are neither sent nor accepted */
 
 /* declare space for the TSM transactions, and set it up in the init. */
 /* table rules: an Invoke ID = 0 is an unused spot in the table */
 static BACNET_TSM_DATA TSM_List[MAX_TSM_TRANSACTIONS];
 
+/* direct map of invoke ID to TSM_List index + 1 (0 = invoke ID not in use)
+   so that lookups do not have to scan the table */
+static uint8_t TSM_Invoke_Index[256];
+/* one bit per invoke ID that is in use, so that the next unused
+   invoke ID can be found a byte at a time */
+static uint8_t TSM_Invoke_Used[256 / 8];
+/* stack of TSM_List indexes that were used and have been freed */
+static uint8_t TSM_Free_Stack[MAX_TSM_TRANSACTIONS];
+static unsigned TSM_Free_Count = 0;
+/* TSM_List indexes at or above this have never been used */
+static unsigned TSM_Unused_Index = 0;
+
+/* retry and timeout deadlines of the transactions, in milliseconds */
+static BACNET_DEADLINE_QUEUE TSM_Timers;
+
 /* invoke ID for incrementing between subsequent calls. */
 static uint8_t Current_Invoke_ID = 1;
 
+#if (MAX_SEGMENTED_ACKS)
+/* the pool of buffers for putting segmented Complex ACKs together */
+static BACNET_TSM_SEGMENTED_ACK TSM_Segmented_Acks[MAX_SEGMENTED_ACKS];
+
+/* gives a buffer from the pool to the transaction,
+   returns NULL if all of them are in use */
+static BACNET_TSM_SEGMENTED_ACK *tsm_segmented_ack_alloc(
+    BACNET_TSM_DATA * transaction)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENTED_ACKS; i++) {
+        if (!TSM_Segmented_Acks[i].transaction) {
+            TSM_Segmented_Acks[i].transaction = transaction;
+            TSM_Segmented_Acks[i].service_request_len = 0;
+            transaction->segmented_ack = &TSM_Segmented_Acks[i];
+            return &TSM_Segmented_Acks[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* returns the buffer of the transaction, if any, to the pool */
+static void tsm_segmented_ack_release(
+    BACNET_TSM_DATA * transaction)
+{
+    if (transaction->segmented_ack) {
+        transaction->segmented_ack->transaction = NULL;
+        transaction->segmented_ack = NULL;
+    }
+}
+#endif
+
 /* returns MAX_TSM_TRANSACTIONS if not found */
 static uint8_t tsm_find_invokeID_index(
     uint8_t invokeID)
 {
-    unsigned i = 0;     /* counter */
     uint8_t index = MAX_TSM_TRANSACTIONS;       /* return value */
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == invokeID) {
-            index = (uint8_t) i;
-            break;
-        }
+    if (invokeID && TSM_Invoke_Index[invokeID]) {
+        index = TSM_Invoke_Index[invokeID] - 1;
     }
 
     return index;
 }
 
-static uint8_t tsm_find_first_free_index(
+/* takes a slot off the free list (or from the never-used area)
+   returns MAX_TSM_TRANSACTIONS if the table is full */
+static uint8_t tsm_alloc_index(
     void)
 {
-    unsigned i = 0;     /* counter */
     uint8_t index = MAX_TSM_TRANSACTIONS;       /* return value */
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == 0) {
-            index = (uint8_t) i;
-            break;
-        }
+    if (TSM_Free_Count) {
+        TSM_Free_Count--;
+        index = TSM_Free_Stack[TSM_Free_Count];
+    } else if (TSM_Unused_Index < MAX_TSM_TRANSACTIONS) {
+        index = (uint8_t) TSM_Unused_Index;
+        TSM_Unused_Index++;
     }
 
     return index;
 }
 
-bool tsm_transaction_available(
-    void)
+/* finds the first unused invoke ID at or after the given one,
+   wrapping around and skipping zero.
+   The caller must ensure that at least one is unused. */
+static uint8_t tsm_next_unused_invokeID(
+    uint8_t invokeID)
 {
-    bool status = false;        /* return value */
     unsigned i = 0;     /* counter */
+    unsigned octet = 0;
+    unsigned bit = 0;
+    uint8_t bits = 0;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == 0) {
-            /* one is available! */
-            status = true;
-            break;
+    if (invokeID == 0) {
+        invokeID = 1;
+    }
+    /* check the rest of the starting octet */
+    octet = invokeID / 8;
+    bits = TSM_Invoke_Used[octet];
+    for (bit = invokeID % 8; bit < 8; bit++) {
+        if ((bits & (1 << bit)) == 0) {
+            return (uint8_t) (octet * 8 + bit);
+        }
+    }
+    /* then look for the next octet that is not full */
+    for (i = 1; i <= sizeof(TSM_Invoke_Used); i++) {
+        octet = (invokeID / 8 + i) % sizeof(TSM_Invoke_Used);
+        bits = TSM_Invoke_Used[octet];
+        if (octet == 0) {
+            /* invoke ID zero is never used */
+            bits |= 1;
+        }
+        if (bits != 0xFF) {
+            for (bit = 0; bits & (1 << bit); bit++) {
+                /* find the first clear bit */
+            }
+            return (uint8_t) (octet * 8 + bit);
         }
     }
 
-    return status;
+    return invokeID;
 }
 
-uint8_t tsm_transaction_idle_count(
+bool tsm_transaction_available(
     void)
 {
-    uint8_t count = 0;  /* return value */
-    unsigned i = 0;     /* counter */
-
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if ((TSM_List[i].InvokeID == 0) &&
-            (TSM_List[i].state == TSM_STATE_IDLE)) {
-            /* one is available! */
-            count++;
-        }
-    }
+    return ((TSM_Free_Count > 0) ||
+        (TSM_Unused_Index < MAX_TSM_TRANSACTIONS));
+}
 
-    return count;
+uint8_t tsm_transaction_idle_count(
+    void)
+{
+    /* free slots are always IDLE */
+    return (uint8_t) (TSM_Free_Count +
+        (MAX_TSM_TRANSACTIONS - TSM_Unused_Index));
 }
 
 /* sets the invokeID */
@@ -142,6 +215,36 @@ void tsm_invokeID_set(
     Current_Invoke_ID = invokeID;
 }
 
+/* the RequestTimer of an AWAIT_CONFIRMATION transaction expired */
+static void tsm_request_timer_expired(
+    BACNET_DEADLINE * deadline)
+{
+    BACNET_TSM_DATA *transaction = (BACNET_TSM_DATA *) deadline->context;
+
+    if (transaction->state == TSM_STATE_AWAIT_CONFIRMATION) {
+        if ((transaction->RetryCount < apdu_retries()) &&
+            deadline_start(&TSM_Timers, &transaction->RequestTimer,
+                apdu_timeout())) {
+            transaction->RetryCount++;
+            datalink_send_pdu(&transaction->dest, &transaction->npdu_data,
+                &transaction->apdu[0], transaction->apdu_len);
+        } else {
+            /* out of retries, or the retry could not be timed */
+            /* note: the invoke id has not been cleared yet
+               and this indicates a failed message:
+               IDLE and a valid invoke id */
+            transaction->state = TSM_STATE_IDLE;
+        }
+#if (MAX_SEGMENTED_ACKS)
+    } else if (transaction->state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+        /* the server stopped sending segments: this is a failed
+           message too, and the partial Complex ACK is dropped */
+        tsm_segmented_ack_release(transaction);
+        transaction->state = TSM_STATE_IDLE;
+#endif
+    }
+}
+
 /* gets the next free invokeID,
    and reserves a spot in the table
    returns 0 if none are available */
@@ -150,36 +253,29 @@ uint8_t tsm_next_free_invokeID(
 {
     uint8_t index = 0;
     uint8_t invokeID = 0;
-    bool found = false;
 
     /* is there even space available? */
     if (tsm_transaction_available()) {
-        while (!found) {
-            index = tsm_find_invokeID_index(Current_Invoke_ID);
-            if (index == MAX_TSM_TRANSACTIONS) {
-                /* Not found, so this invokeID is not used */
-                found = true;
-                /* set this id into the table */
-                index = tsm_find_first_free_index();
-                if (index != MAX_TSM_TRANSACTIONS) {
-                    TSM_List[index].InvokeID = invokeID = Current_Invoke_ID;
-                    TSM_List[index].state = TSM_STATE_IDLE;
-                    TSM_List[index].RequestTimer = apdu_timeout();
-                    /* update for the next call or check */
-                    Current_Invoke_ID++;
-                    /* skip zero - we treat that internally as invalid or no free */
-                    if (Current_Invoke_ID == 0) {
-                        Current_Invoke_ID = 1;
-                    }
-                }
-            } else {
-                /* found! This invokeID is already used */
-                /* try next one */
-                Current_Invoke_ID++;
-                /* skip zero - we treat that internally as invalid or no free */
-                if (Current_Invoke_ID == 0) {
-                    Current_Invoke_ID = 1;
-                }
+        /* skip over any invokeID that is already used -
+           there are fewer slots than invoke IDs so one is unused */
+        Current_Invoke_ID = tsm_next_unused_invokeID(Current_Invoke_ID);
+        /* set this id into the table */
+        index = tsm_alloc_index();
+        if (index != MAX_TSM_TRANSACTIONS) {
+            TSM_List[index].InvokeID = invokeID = Current_Invoke_ID;
+            TSM_List[index].state = TSM_STATE_IDLE;
+#if (MAX_SEGMENTED_ACKS)
+            TSM_List[index].segmented_ack = NULL;
+#endif
+            deadline_init(&TSM_List[index].RequestTimer,
+                tsm_request_timer_expired, &TSM_List[index]);
+            TSM_Invoke_Index[invokeID] = index + 1;
+            TSM_Invoke_Used[invokeID / 8] |= (1 << (invokeID % 8));
+            /* update for the next call or check */
+            Current_Invoke_ID++;
+            /* skip zero - we treat that internally as invalid or no free */
+            if (Current_Invoke_ID == 0) {
+                Current_Invoke_ID = 1;
             }
         }
     }
@@ -204,7 +300,12 @@ void tsm_set_confirmed_unsegmented_transaction(
             TSM_List[index].state = TSM_STATE_AWAIT_CONFIRMATION;
             TSM_List[index].RetryCount = 0;
             /* start the timer */
-            TSM_List[index].RequestTimer = apdu_timeout();
+            if (!deadline_start(&TSM_Timers, &TSM_List[index].RequestTimer,
+                    apdu_timeout())) {
+                /* it could never time out: fail it now, as a timeout
+                   would, so that the slot is freed by the client */
+                TSM_List[index].state = TSM_STATE_IDLE;
+            }
             /* copy the data */
             for (j = 0; j < apdu_len; j++) {
                 TSM_List[index].apdu[j] = apdu[j];
@@ -255,31 +356,19 @@ bool tsm_get_transaction_pdu(
 void tsm_timer_milliseconds(
     uint16_t milliseconds)
 {
-    unsigned i = 0;     /* counter */
+    /* only the transactions that are due are touched */
+    (void) deadline_queue_timer(&TSM_Timers, milliseconds);
+}
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].state == TSM_STATE_AWAIT_CONFIRMATION) {
-            if (TSM_List[i].RequestTimer > milliseconds)
-                TSM_List[i].RequestTimer -= milliseconds;
-            else
-                TSM_List[i].RequestTimer = 0;
-            /* AWAIT_CONFIRMATION */
-            if (TSM_List[i].RequestTimer == 0) {
-                if (TSM_List[i].RetryCount < apdu_retries()) {
-                    TSM_List[i].RequestTimer = apdu_timeout();
-                    TSM_List[i].RetryCount++;
-                    datalink_send_pdu(&TSM_List[i].dest,
-                        &TSM_List[i].npdu_data, &TSM_List[i].apdu[0],
-                        TSM_List[i].apdu_len);
-                } else {
-                    /* note: the invoke id has not been cleared yet
-                       and this indicates a failed message:
-                       IDLE and a valid invoke id */
-                    TSM_List[i].state = TSM_STATE_IDLE;
-                }
-            }
-        }
-    }
+/** Get the time until the next confirmed request retry or timeout,
+ *  for example to use as the datalink receive timeout.
+ * @return milliseconds until the next TSM deadline,
+ *         or DEADLINE_NONE if no requests are awaiting confirmation.
+ */
+uint32_t tsm_timer_next_milliseconds(
+    void)
+{
+    return deadline_queue_next(&TSM_Timers);
 }
 
 /* frees the invokeID and sets its state to IDLE */
@@ -290,8 +379,16 @@ void tsm_free_invoke_id(
 
     index = tsm_find_invokeID_index(invokeID);
     if (index < MAX_TSM_TRANSACTIONS) {
+        deadline_stop(&TSM_Timers, &TSM_List[index].RequestTimer);
+#if (MAX_SEGMENTED_ACKS)
+        tsm_segmented_ack_release(&TSM_List[index]);
+#endif
         TSM_List[index].state = TSM_STATE_IDLE;
         TSM_List[index].InvokeID = 0;
+        TSM_Invoke_Index[invokeID] = 0;
+        TSM_Invoke_Used[invokeID / 8] &= ~(1 << (invokeID % 8));
+        TSM_Free_Stack[TSM_Free_Count] = index;
+        TSM_Free_Count++;
     }
 }
 
@@ -336,14 +433,495 @@ bool tsm_invoke_id_failed(
 }
 
 
+#if (MAX_SEGMENTED_RESPONSES)
+/* the Complex ACKs being sent in segments */
+static BACNET_TSM_SEGMENTED_RESPONSE TSM_Segmented_Responses
+    [MAX_SEGMENTED_RESPONSES];
+
+/* octets in front of the service data: type, invoke ID and service
+   choice, and in a segment the sequence number and window size too */
+#define TSM_COMPLEX_ACK_HEADER 3
+#define TSM_SEGMENT_HEADER 5
+
+/* returns NULL if not found */
+static BACNET_TSM_SEGMENTED_RESPONSE *tsm_segmented_response_find(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        if ((TSM_Segmented_Responses[i].state ==
+                TSM_STATE_SEGMENTED_RESPONSE) &&
+            (TSM_Segmented_Responses[i].InvokeID == invokeID) &&
+            bacnet_address_same(&TSM_Segmented_Responses[i].dest, src)) {
+            return &TSM_Segmented_Responses[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* returns NULL if all of them are being sent */
+static BACNET_TSM_SEGMENTED_RESPONSE *tsm_segmented_response_idle(
+    void)
+{
+    unsigned i = 0;
+
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        if (TSM_Segmented_Responses[i].state == TSM_STATE_IDLE) {
+            return &TSM_Segmented_Responses[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void tsm_segmented_response_free(
+    BACNET_TSM_SEGMENTED_RESPONSE * response)
+{
+    deadline_stop(&TSM_Timers, &response->SegmentTimer);
+    response->state = TSM_STATE_IDLE;
+}
+
+/* sends one segment of the Complex ACK */
+static void tsm_segment_send(
+    BACNET_TSM_SEGMENTED_RESPONSE * response,
+    unsigned segment)
+{
+    static uint8_t pdu[MAX_PDU];
+    BACNET_ADDRESS my_address;
+    unsigned offset = 0;
+    unsigned len = 0;
+    int pdu_len = 0;
+
+    datalink_get_my_address(&my_address);
+    pdu_len =
+        npdu_encode_pdu(&pdu[0], &response->dest, &my_address,
+        &response->npdu_data);
+    offset = TSM_COMPLEX_ACK_HEADER + (segment * response->segment_len);
+    len = response->apdu_len - offset;
+    if (len > response->segment_len) {
+        len = response->segment_len;
+    }
+    pdu[pdu_len] = PDU_TYPE_COMPLEX_ACK | BIT3;
+    if ((segment + 1) < response->segment_count) {
+        /* more follows */
+        pdu[pdu_len] |= BIT2;
+    }
+    pdu[pdu_len + 1] = response->InvokeID;
+    pdu[pdu_len + 2] = (uint8_t) segment;
+    pdu[pdu_len + 3] = response->ProposedWindowSize;
+    /* service ACK choice */
+    pdu[pdu_len + 4] = response->apdu[2];
+    pdu_len += TSM_SEGMENT_HEADER;
+    memcpy(&pdu[pdu_len], &response->apdu[offset], len);
+    pdu_len += len;
+    datalink_send_pdu(&response->dest, &response->npdu_data, &pdu[0],
+        pdu_len);
+}
+
+/* 5.4.5.3 FillWindow: sends the segments of the window that starts at
+   InitialSegment, and waits for the SegmentACK */
+static void tsm_segment_window_send(
+    BACNET_TSM_SEGMENTED_RESPONSE * response)
+{
+    unsigned segment = 0;
+    unsigned last = 0;
+
+    last = response->InitialSegment + response->ActualWindowSize;
+    if (last > response->segment_count) {
+        last = response->segment_count;
+    }
+    for (segment = response->InitialSegment; segment < last; segment++) {
+        tsm_segment_send(response, segment);
+    }
+    if (!deadline_start(&TSM_Timers, &response->SegmentTimer,
+            apdu_segment_timeout())) {
+        /* it could never time out, so give up on it now */
+        tsm_segmented_response_free(response);
+    }
+}
+
+/* the SegmentTimer of a SEGMENTED_RESPONSE transaction expired */
+static void tsm_segment_timer_expired(
+    BACNET_DEADLINE * deadline)
+{
+    BACNET_TSM_SEGMENTED_RESPONSE *response =
+        (BACNET_TSM_SEGMENTED_RESPONSE *) deadline->context;
+
+    if (response->SegmentRetryCount < apdu_retries()) {
+        /* Timeout: send the window again */
+        response->SegmentRetryCount++;
+        tsm_segment_window_send(response);
+    } else {
+        /* FinalTimeout */
+        tsm_segmented_response_free(response);
+    }
+}
+
+/** Get the longest Complex ACK that can be sent in reply to a request.
+ * @param service_data [in] The header of the confirmed request.
+ * @return the most APDU octets, which are more than the client's
+ *         max APDU if the Complex ACK can be sent in segments.
+ */
+uint16_t tsm_segmented_response_max(
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+{
+    unsigned max_apdu = MAX_APDU;
+    unsigned segments = MAX_SEGMENTS;
+    unsigned len = 0;
+
+    if (service_data->max_resp < max_apdu) {
+        max_apdu = service_data->max_resp;
+    }
+    if (!service_data->segmented_response_accepted ||
+        (max_apdu <= TSM_SEGMENT_HEADER) ||
+        !tsm_segmented_response_idle()) {
+        return (uint16_t) max_apdu;
+    }
+    /* zero is an unspecified number of segments */
+    if ((service_data->max_segs > 0) &&
+        ((unsigned) service_data->max_segs < segments)) {
+        segments = service_data->max_segs;
+    }
+    len = TSM_COMPLEX_ACK_HEADER +
+        (segments * (max_apdu - TSM_SEGMENT_HEADER));
+    if (len > MAX_SEGMENTED_APDU) {
+        len = MAX_SEGMENTED_APDU;
+    }
+
+    return (uint16_t) len;
+}
+
+/** Send a Complex ACK that is too big for the client's max APDU,
+ *  as a segmented response (5.4.5.2 SendConfirmedSegmented).
+ *  The first segment is sent now and the rest as the client
+ *  acknowledges them, with the retries driven by tsm_timer_milliseconds().
+ * @param dest [in] The client that made the request.
+ * @param npdu_data [in] The network layer info for the reply.
+ * @param service_data [in] The header of the confirmed request.
+ * @param apdu [in] The Complex ACK, encoded as if it were unsegmented.
+ * @param apdu_len [in] The length of the Complex ACK.
+ * @return true if it is being sent, or false if the client does not
+ *         accept it or there is no room, and an Abort is to be sent.
+ */
+bool tsm_set_segmented_complex_ack(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data,
+    uint8_t * apdu,
+    uint16_t apdu_len)
+{
+    BACNET_TSM_SEGMENTED_RESPONSE *response = NULL;
+    unsigned max_apdu = MAX_APDU;
+
+    if ((apdu_len <= TSM_COMPLEX_ACK_HEADER) ||
+        (apdu_len > tsm_segmented_response_max(service_data))) {
+        return false;
+    }
+    /* a repeated request starts the response again */
+    response = tsm_segmented_response_find(dest, service_data->invoke_id);
+    if (!response) {
+        response = tsm_segmented_response_idle();
+    }
+    if (!response) {
+        return false;
+    }
+    if (service_data->max_resp < max_apdu) {
+        max_apdu = service_data->max_resp;
+    }
+    response->segment_len = max_apdu - TSM_SEGMENT_HEADER;
+    response->segment_count =
+        ((apdu_len - TSM_COMPLEX_ACK_HEADER) + response->segment_len -
+        1) / response->segment_len;
+    memcpy(&response->apdu[0], apdu, apdu_len);
+    response->apdu_len = apdu_len;
+    response->InvokeID = service_data->invoke_id;
+    bacnet_address_copy(&response->dest, dest);
+    npdu_copy_data(&response->npdu_data, npdu_data);
+    response->state = TSM_STATE_SEGMENTED_RESPONSE;
+    deadline_init(&response->SegmentTimer, tsm_segment_timer_expired,
+        response);
+    /* the first segment goes alone, then the client sets the window */
+    response->SegmentRetryCount = 0;
+    response->InitialSegment = 0;
+    response->ActualWindowSize = 1;
+    response->ProposedWindowSize = apdu_segment_window();
+    tsm_segment_window_send(response);
+
+    return true;
+}
+
+/** Handle a SegmentACK from a client for our segmented response.
+ * @param src [in] The client that sent the SegmentACK.
+ * @param invokeID [in] The invoke ID of the client request.
+ * @param sequence_number [in] The last segment received in order.
+ * @param actual_window_size [in] The segments to send before the next ACK.
+ */
+void tsm_segment_ack_received(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID,
+    uint8_t sequence_number,
+    uint8_t actual_window_size)
+{
+    BACNET_TSM_SEGMENTED_RESPONSE *response = NULL;
+    unsigned segment = 0;
+    uint8_t offset = 0;
+
+    response = tsm_segmented_response_find(src, invokeID);
+    if (!response) {
+        return;
+    }
+    /* the sequence numbers wrap, so find it in the window */
+    offset = (uint8_t) (sequence_number - (uint8_t) response->InitialSegment);
+    if (offset >= response->ActualWindowSize) {
+        /* DuplicateACK_Received */
+        if (!deadline_start(&TSM_Timers, &response->SegmentTimer,
+                apdu_segment_timeout())) {
+            tsm_segmented_response_free(response);
+        }
+        return;
+    }
+    segment = response->InitialSegment + offset;
+    if ((segment + 1) >= response->segment_count) {
+        /* FinalACK_Received */
+        tsm_segmented_response_free(response);
+        return;
+    }
+    /* NewACK_Received */
+    if (actual_window_size < 1) {
+        actual_window_size = 1;
+    } else if (actual_window_size > 127) {
+        actual_window_size = 127;
+    }
+    response->InitialSegment = segment + 1;
+    response->ActualWindowSize = actual_window_size;
+    response->SegmentRetryCount = 0;
+    tsm_segment_window_send(response);
+}
+
+/** Stop sending a segmented response when the client aborts it.
+ * @param src [in] The client that sent the Abort.
+ * @param invokeID [in] The invoke ID of the client request.
+ */
+void tsm_segmented_response_abort(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_SEGMENTED_RESPONSE *response = NULL;
+
+    response = tsm_segmented_response_find(src, invokeID);
+    if (response) {
+        tsm_segmented_response_free(response);
+    }
+}
+#endif
+
+#if (MAX_SEGMENTED_ACKS)
+/* octets of the SegmentACK and Abort PDUs sent by the client */
+#define TSM_SEGMENT_ACK_LEN 4
+#define TSM_ABORT_LEN 3
+
+/* sends a SegmentACK or an Abort to the server of the transaction */
+static void tsm_segmented_ack_apdu_send(
+    BACNET_TSM_DATA * transaction,
+    uint8_t * apdu,
+    unsigned apdu_len)
+{
+    static uint8_t pdu[MAX_PDU];
+    BACNET_ADDRESS my_address;
+    BACNET_NPDU_DATA npdu_data;
+    int pdu_len = 0;
+
+    datalink_get_my_address(&my_address);
+    npdu_encode_npdu_data(&npdu_data, false,
+        transaction->npdu_data.priority);
+    pdu_len =
+        npdu_encode_pdu(&pdu[0], &transaction->dest, &my_address,
+        &npdu_data);
+    memcpy(&pdu[pdu_len], apdu, apdu_len);
+    pdu_len += apdu_len;
+    datalink_send_pdu(&transaction->dest, &npdu_data, &pdu[0], pdu_len);
+}
+
+/* acknowledges the segments received in order, and waits for more */
+static void tsm_segment_ack_send(
+    BACNET_TSM_DATA * transaction,
+    bool negative_ack)
+{
+    uint8_t apdu[TSM_SEGMENT_ACK_LEN];
+
+    apdu[0] = PDU_TYPE_SEGMENT_ACK;
+    if (negative_ack) {
+        apdu[0] |= BIT1;
+    }
+    apdu[1] = transaction->InvokeID;
+    apdu[2] = transaction->LastSequenceNumber;
+    apdu[3] = transaction->ActualWindowSize;
+    tsm_segmented_ack_apdu_send(transaction, &apdu[0], sizeof(apdu));
+}
+
+/* gives up on the Complex ACK: the server is told, and the message
+   fails as IDLE with a valid invoke ID, as if it timed out */
+static void tsm_segmented_ack_abort(
+    BACNET_TSM_DATA * transaction,
+    uint8_t abort_reason)
+{
+    uint8_t apdu[TSM_ABORT_LEN];
+
+    apdu[0] = PDU_TYPE_ABORT;
+    apdu[1] = transaction->InvokeID;
+    apdu[2] = abort_reason;
+    tsm_segmented_ack_apdu_send(transaction, &apdu[0], sizeof(apdu));
+    deadline_stop(&TSM_Timers, &transaction->RequestTimer);
+    tsm_segmented_ack_release(transaction);
+    transaction->state = TSM_STATE_IDLE;
+}
+
+/** Mark a confirmed request that is about to be sent as accepting a
+ *  segmented Complex ACK, of as many segments as the reassembly
+ *  buffers hold.
+ * @param apdu [in,out] The encoded confirmed request APDU.
+ */
+void tsm_segmented_ack_accept(
+    uint8_t * apdu)
+{
+    apdu[0] |= BIT1;
+    apdu[1] = encode_max_segs_max_apdu(MAX_SEGMENTS, MAX_APDU);
+}
+
+/** Handle a segment of a Complex ACK to one of our requests
+ *  (5.4.4 AWAIT_CONFIRMATION and SEGMENTED_CONFIRMATION).
+ *  The segments are acknowledged a window at a time, and put back
+ *  together in a buffer from the pool, which is returned to it when
+ *  the invoke ID is freed.
+ * @param src [in] The server that sent the segment.
+ * @param service_data [in] The header of the segment.
+ * @param service_choice [in] The service ACK choice of the segment.
+ * @param service_request [in,out] The service data of the segment,
+ *        and of the whole Complex ACK when true is returned.
+ * @param service_request_len [in,out] The length of the service data.
+ * @return true if this was the last segment and the whole Complex ACK
+ *         is ready for its handler, or false if there is more to come
+ *         or the segment was not wanted.
+ */
+bool tsm_segmented_ack_received(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+    uint8_t service_choice,
+    uint8_t ** service_request,
+    uint16_t * service_request_len)
+{
+    BACNET_TSM_DATA *transaction = NULL;
+    BACNET_TSM_SEGMENTED_ACK *segmented_ack = NULL;
+    bool first_segment = false;
+    uint8_t window = 0;
+    uint8_t index;
+
+    index = tsm_find_invokeID_index(service_data->invoke_id);
+    if (index >= MAX_TSM_TRANSACTIONS) {
+        return false;
+    }
+    transaction = &TSM_List[index];
+    if (!bacnet_address_same(&transaction->dest, src)) {
+        return false;
+    }
+    if (transaction->state == TSM_STATE_AWAIT_CONFIRMATION) {
+        if (service_data->sequence_number != 0) {
+            /* UnexpectedPDU_Received */
+            tsm_segmented_ack_abort(transaction,
+                ABORT_REASON_INVALID_APDU_IN_THIS_STATE);
+            return false;
+        }
+        segmented_ack = tsm_segmented_ack_alloc(transaction);
+        if (!segmented_ack) {
+            /* no room to put it together */
+            tsm_segmented_ack_abort(transaction,
+                ABORT_REASON_BUFFER_OVERFLOW);
+            return false;
+        }
+        /* SegmentedComplexACK_Received */
+        segmented_ack->service_choice = service_choice;
+        window = service_data->proposed_window_number;
+        if (window > apdu_segment_window()) {
+            window = apdu_segment_window();
+        } else if (window < 1) {
+            window = 1;
+        }
+        transaction->ActualWindowSize = window;
+        transaction->InitialSequenceNumber = 0;
+        transaction->LastSequenceNumber = 0;
+        transaction->state = TSM_STATE_SEGMENTED_CONFIRMATION;
+        first_segment = true;
+    } else if ((transaction->state == TSM_STATE_SEGMENTED_CONFIRMATION) &&
+        transaction->segmented_ack) {
+        segmented_ack = transaction->segmented_ack;
+        if ((service_data->sequence_number !=
+                (uint8_t) (transaction->LastSequenceNumber + 1)) ||
+            (service_choice != segmented_ack->service_choice)) {
+            /* SegmentReceivedOutOfOrder: the server goes back to
+               the one after the last segment received in order */
+            transaction->InitialSequenceNumber =
+                transaction->LastSequenceNumber;
+            tsm_segment_ack_send(transaction, true);
+            if (!deadline_start(&TSM_Timers, &transaction->RequestTimer,
+                    4UL * apdu_segment_timeout())) {
+                tsm_segmented_ack_abort(transaction, ABORT_REASON_OTHER);
+            }
+            return false;
+        }
+        transaction->LastSequenceNumber = service_data->sequence_number;
+    } else {
+        return false;
+    }
+    if ((segmented_ack->service_request_len + *service_request_len) >
+        sizeof(segmented_ack->service_request)) {
+        tsm_segmented_ack_abort(transaction, ABORT_REASON_BUFFER_OVERFLOW);
+        return false;
+    }
+    memcpy(&segmented_ack->service_request[segmented_ack->
+            service_request_len], *service_request, *service_request_len);
+    segmented_ack->service_request_len += *service_request_len;
+    if (!service_data->more_follows) {
+        /* LastSegmentOfComplexACK_Received */
+        tsm_segment_ack_send(transaction, false);
+        deadline_stop(&TSM_Timers, &transaction->RequestTimer);
+        *service_request = &segmented_ack->service_request[0];
+        *service_request_len = (uint16_t) segmented_ack->service_request_len;
+        return true;
+    }
+    if (first_segment ||
+        (transaction->LastSequenceNumber ==
+            (uint8_t) (transaction->InitialSequenceNumber +
+                transaction->ActualWindowSize))) {
+        /* LastSegmentOfGroupReceived: the server fills the next window */
+        transaction->InitialSequenceNumber = transaction->LastSequenceNumber;
+        tsm_segment_ack_send(transaction, false);
+    }
+    /* NewSegmentReceived */
+    if (!deadline_start(&TSM_Timers, &transaction->RequestTimer,
+            4UL * apdu_segment_timeout())) {
+        /* it could never time out, so give up on it now */
+        tsm_segmented_ack_abort(transaction, ABORT_REASON_OTHER);
+    }
+
+    return false;
+}
+#endif
+
 #ifdef TEST
 #include <assert.h>
-#include <string.h>
 #include "ctest.h"
 
 /* flag to send an I-Am */
 bool I_Am_Request = true;
 
+static unsigned Datalink_Send_Count;
+/* the last PDU sent */
+static uint8_t Datalink_PDU[MAX_PDU];
+static unsigned Datalink_PDU_Len;
+
 /* dummy function stubs */
 int datalink_send_pdu(
     BACNET_ADDRESS * dest,
@@ -351,10 +929,11 @@ int datalink_send_pdu(
     uint8_t * pdu,
     unsigned pdu_len)
 {
+    Datalink_Send_Count++;
     (void) dest;
     (void) npdu_data;
-    (void) pdu;
-    (void) pdu_len;
+    memcpy(Datalink_PDU, pdu, pdu_len);
+    Datalink_PDU_Len = pdu_len;
 
     return 0;
 }
@@ -366,13 +945,367 @@ void datalink_get_broadcast_address(
     (void) dest;
 }
 
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(BACNET_ADDRESS));
+}
+
 void testTSM(
     Test * pTest)
 {
-    /* FIXME: add some unit testing... */
+    uint8_t invokeID = 0;
+    uint8_t firstID = 0;
+    unsigned i = 0;
+    bool used[256] = { false };
+
+    ct_test(pTest, tsm_transaction_available());
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+    /* fill the table - every invoke ID must be unique */
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        invokeID = tsm_next_free_invokeID();
+        ct_test(pTest, invokeID != 0);
+        ct_test(pTest, used[invokeID] == false);
+        used[invokeID] = true;
+        ct_test(pTest, tsm_invoke_id_free(invokeID) == false);
+        ct_test(pTest, tsm_invoke_id_failed(invokeID) == true);
+        if (i == 0) {
+            firstID = invokeID;
+        }
+    }
+    ct_test(pTest, tsm_transaction_available() == false);
+    ct_test(pTest, tsm_transaction_idle_count() == 0);
+    ct_test(pTest, tsm_next_free_invokeID() == 0);
+    /* free one and it can be used again */
+    tsm_free_invoke_id(firstID);
+    ct_test(pTest, tsm_invoke_id_free(firstID));
+    ct_test(pTest, tsm_transaction_available());
+    ct_test(pTest, tsm_transaction_idle_count() == 1);
+    tsm_invokeID_set(firstID);
+    invokeID = tsm_next_free_invokeID();
+    ct_test(pTest, invokeID == firstID);
+    ct_test(pTest, tsm_next_free_invokeID() == 0);
+    /* free them all */
+    for (i = 1; i < 256; i++) {
+        if (used[i]) {
+            tsm_free_invoke_id((uint8_t) i);
+            ct_test(pTest, tsm_invoke_id_free((uint8_t) i));
+        }
+    }
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+    /* freeing an unused invoke ID does not change anything */
+    tsm_free_invoke_id(firstID);
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+    /* invoke ID zero is never valid */
+    tsm_invokeID_set(0);
+    invokeID = tsm_next_free_invokeID();
+    ct_test(pTest, invokeID == 1);
+    tsm_free_invoke_id(invokeID);
+
     return;
 }
 
+void testTSMTimer(
+    Test * pTest)
+{
+    uint8_t invokeID = 0;
+    uint8_t otherID = 0;
+    uint8_t apdu[8] = { 0 };
+    BACNET_ADDRESS dest = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    unsigned retry = 0;
+
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    invokeID = tsm_next_free_invokeID();
+    otherID = tsm_next_free_invokeID();
+    ct_test(pTest, invokeID != 0);
+    /* not sent yet, so nothing is timing */
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    tsm_set_confirmed_unsegmented_transaction(invokeID, &dest, &npdu_data,
+        &apdu[0], sizeof(apdu));
+    ct_test(pTest, tsm_timer_next_milliseconds() == apdu_timeout());
+    Datalink_Send_Count = 0;
+    tsm_timer_milliseconds(apdu_timeout() - 1);
+    ct_test(pTest, Datalink_Send_Count == 0);
+    ct_test(pTest, tsm_timer_next_milliseconds() == 1);
+    /* each timeout is a retry until the retries are used up */
+    for (retry = 1; retry <= apdu_retries(); retry++) {
+        tsm_timer_milliseconds(apdu_timeout());
+        ct_test(pTest, Datalink_Send_Count == retry);
+        ct_test(pTest, tsm_invoke_id_failed(invokeID) == false);
+    }
+    tsm_timer_milliseconds(apdu_timeout());
+    ct_test(pTest, Datalink_Send_Count == apdu_retries());
+    ct_test(pTest, tsm_invoke_id_failed(invokeID));
+    ct_test(pTest, tsm_invoke_id_free(invokeID) == false);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    tsm_free_invoke_id(invokeID);
+    ct_test(pTest, tsm_invoke_id_free(invokeID));
+    /* freeing a transaction stops its timer */
+    tsm_set_confirmed_unsegmented_transaction(otherID, &dest, &npdu_data,
+        &apdu[0], sizeof(apdu));
+    ct_test(pTest, tsm_timer_next_milliseconds() == apdu_timeout());
+    tsm_free_invoke_id(otherID);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    Datalink_Send_Count = 0;
+    tsm_timer_milliseconds(apdu_timeout());
+    ct_test(pTest, Datalink_Send_Count == 0);
+}
+
+#if (MAX_SEGMENTED_RESPONSES)
+void testTSMSegmentedResponse(
+    Test * pTest)
+{
+    static uint8_t apdu[MAX_SEGMENTED_APDU];
+    BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
+    BACNET_ADDRESS client = { 0 };
+    BACNET_ADDRESS other = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint16_t apdu_len = 0;
+    unsigned i = 0;
+    uint8_t *segment = NULL;
+
+    /* no NPCI addresses, so the APDU follows the two octet NPDU header */
+    segment = &Datalink_PDU[2];
+    client.mac_len = 1;
+    client.mac[0] = 1;
+    other.mac_len = 1;
+    other.mac[0] = 2;
+    service_data.invoke_id = 7;
+    service_data.max_resp = 50;
+    service_data.max_segs = 0;
+    /* not accepted, so it must fit in one APDU */
+    service_data.segmented_response_accepted = false;
+    ct_test(pTest, tsm_segmented_response_max(&service_data) == 50);
+    service_data.segmented_response_accepted = true;
+    ct_test(pTest, tsm_segmented_response_max(&service_data) ==
+        3 + (MAX_SEGMENTS * 45));
+    service_data.max_segs = 4;
+    ct_test(pTest, tsm_segmented_response_max(&service_data) == 3 + (4 * 45));
+    ct_test(pTest, tsm_set_segmented_complex_ack(&client, &npdu_data,
+            &service_data, &apdu[0], 3 + (4 * 45) + 1) == false);
+    /* ten segments: 45 octets each, and 20 in the last one */
+    service_data.max_segs = 16;
+    apdu[0] = PDU_TYPE_COMPLEX_ACK;
+    apdu[1] = service_data.invoke_id;
+    apdu[2] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE;
+    apdu_len = 3 + (9 * 45) + 20;
+    for (i = 3; i < apdu_len; i++) {
+        apdu[i] = (uint8_t) i;
+    }
+    Datalink_Send_Count = 0;
+    ct_test(pTest, tsm_set_segmented_complex_ack(&client, &npdu_data,
+            &service_data, &apdu[0], apdu_len));
+    /* the first segment goes alone */
+    ct_test(pTest, Datalink_Send_Count == 1);
+    ct_test(pTest, Datalink_PDU_Len == 2 + 5 + 45);
+    ct_test(pTest, segment[0] == (PDU_TYPE_COMPLEX_ACK | BIT3 | BIT2));
+    ct_test(pTest, segment[1] == 7);
+    ct_test(pTest, segment[2] == 0);
+    ct_test(pTest, segment[3] == apdu_segment_window());
+    ct_test(pTest, segment[4] == SERVICE_CONFIRMED_READ_PROP_MULTIPLE);
+    ct_test(pTest, segment[5] == 3);
+    ct_test(pTest, tsm_timer_next_milliseconds() == apdu_segment_timeout());
+    /* an ACK from another client is not for this response */
+    tsm_segment_ack_received(&other, 7, 0, 4);
+    ct_test(pTest, Datalink_Send_Count == 1);
+    /* the client asks for windows of four */
+    tsm_segment_ack_received(&client, 7, 0, 4);
+    ct_test(pTest, Datalink_Send_Count == 5);
+    ct_test(pTest, segment[2] == 4);
+    /* a timeout sends the window again */
+    tsm_timer_milliseconds(apdu_segment_timeout());
+    ct_test(pTest, Datalink_Send_Count == 9);
+    /* an ACK for a segment outside of the window is a duplicate */
+    tsm_segment_ack_received(&client, 7, 0, 4);
+    ct_test(pTest, Datalink_Send_Count == 9);
+    /* a negative ACK in the window sends from the next segment */
+    tsm_segment_ack_received(&client, 7, 2, 4);
+    ct_test(pTest, Datalink_Send_Count == 13);
+    ct_test(pTest, segment[2] == 6);
+    tsm_segment_ack_received(&client, 7, 6, 4);
+    ct_test(pTest, Datalink_Send_Count == 16);
+    /* the last segment is shorter, and no more follows */
+    ct_test(pTest, segment[0] == (PDU_TYPE_COMPLEX_ACK | BIT3));
+    ct_test(pTest, segment[2] == 9);
+    ct_test(pTest, Datalink_PDU_Len == 2 + 5 + 20);
+    ct_test(pTest, segment[5] == (uint8_t) (3 + (9 * 45)));
+    /* the final ACK ends the response */
+    tsm_segment_ack_received(&client, 7, 9, 4);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    tsm_segment_ack_received(&client, 7, 9, 4);
+    ct_test(pTest, Datalink_Send_Count == 16);
+    /* the retries run out without any ACK */
+    ct_test(pTest, tsm_set_segmented_complex_ack(&client, &npdu_data,
+            &service_data, &apdu[0], apdu_len));
+    for (i = 0; i < apdu_retries(); i++) {
+        tsm_timer_milliseconds(apdu_segment_timeout());
+    }
+    ct_test(pTest, Datalink_Send_Count == 17 + apdu_retries());
+    tsm_timer_milliseconds(apdu_segment_timeout());
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    /* an abort from the client ends the response */
+    ct_test(pTest, tsm_set_segmented_complex_ack(&client, &npdu_data,
+            &service_data, &apdu[0], apdu_len));
+    tsm_segmented_response_abort(&client, 7);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    /* only so many responses can be sent at once */
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        service_data.invoke_id = (uint8_t) i;
+        apdu[1] = (uint8_t) i;
+        ct_test(pTest, tsm_set_segmented_complex_ack(&client, &npdu_data,
+                &service_data, &apdu[0], apdu_len));
+    }
+    ct_test(pTest, tsm_segmented_response_max(&service_data) == 50);
+    ct_test(pTest, tsm_set_segmented_complex_ack(&other, &npdu_data,
+            &service_data, &apdu[0], apdu_len) == false);
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        tsm_segmented_response_abort(&client, (uint8_t) i);
+    }
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+}
+#endif
+
+#if (MAX_SEGMENTED_ACKS)
+void testTSMSegmentedAck(
+    Test * pTest)
+{
+    BACNET_CONFIRMED_SERVICE_ACK_DATA service_data = { 0 };
+    BACNET_ADDRESS server = { 0 };
+    BACNET_ADDRESS other = { 0 };
+    BACNET_NPDU_DATA npdu_data = { 0 };
+    uint8_t request[8] = { 0 };
+    uint8_t data[10] = { 0 };
+    uint8_t invokeID[MAX_SEGMENTED_ACKS + 1] = { 0 };
+    uint8_t *service_request = NULL;
+    uint16_t service_request_len = 0;
+    uint8_t sequence = 0;
+    unsigned i = 0;
+    uint8_t *segment = NULL;
+
+    /* no NPCI addresses, so the APDU follows the two octet NPDU header */
+    segment = &Datalink_PDU[2];
+    server.mac_len = 1;
+    server.mac[0] = 3;
+    other.mac_len = 1;
+    other.mac[0] = 4;
+    request[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+    tsm_segmented_ack_accept(&request[0]);
+    ct_test(pTest, request[0] == (PDU_TYPE_CONFIRMED_SERVICE_REQUEST | BIT1));
+    ct_test(pTest, request[1] == encode_max_segs_max_apdu(MAX_SEGMENTS,
+            MAX_APDU));
+    invokeID[0] = tsm_next_free_invokeID();
+    tsm_set_confirmed_unsegmented_transaction(invokeID[0], &server,
+        &npdu_data, &request[0], sizeof(request));
+    service_data.segmented_message = true;
+    service_data.more_follows = true;
+    service_data.invoke_id = invokeID[0];
+    service_data.proposed_window_number = 127;
+    /* a segment from another device is not for this request */
+    Datalink_Send_Count = 0;
+    service_request = &data[0];
+    service_request_len = sizeof(data);
+    ct_test(pTest, tsm_segmented_ack_received(&other, &service_data,
+            SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+            &service_request_len) == false);
+    ct_test(pTest, Datalink_Send_Count == 0);
+    /* the first segment is acknowledged with our window */
+    for (sequence = 0; sequence < 10; sequence++) {
+        memset(data, sequence, sizeof(data));
+        service_data.sequence_number = sequence;
+        service_data.more_follows = (sequence < 9);
+        service_request = &data[0];
+        service_request_len = sizeof(data);
+        if (sequence == 9) {
+            /* one out of order asks for the window again */
+            service_data.sequence_number = 10;
+            ct_test(pTest, tsm_segmented_ack_received(&server, &service_data,
+                    SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+                    &service_request_len) == false);
+            ct_test(pTest, Datalink_Send_Count == 3);
+            ct_test(pTest, segment[0] == (PDU_TYPE_SEGMENT_ACK | BIT1));
+            ct_test(pTest, segment[2] == 8);
+            service_data.sequence_number = sequence;
+            service_request = &data[0];
+            service_request_len = sizeof(data);
+            ct_test(pTest, tsm_segmented_ack_received(&server, &service_data,
+                    SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+                    &service_request_len));
+        } else {
+            ct_test(pTest, tsm_segmented_ack_received(&server, &service_data,
+                    SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+                    &service_request_len) == false);
+            ct_test(pTest, tsm_timer_next_milliseconds() ==
+                4UL * apdu_segment_timeout());
+        }
+        if (sequence == 0) {
+            ct_test(pTest, Datalink_Send_Count == 1);
+            ct_test(pTest, segment[0] == PDU_TYPE_SEGMENT_ACK);
+            ct_test(pTest, segment[1] == invokeID[0]);
+            ct_test(pTest, segment[2] == 0);
+            ct_test(pTest, segment[3] == apdu_segment_window());
+        } else if (sequence < apdu_segment_window()) {
+            ct_test(pTest, Datalink_Send_Count == 1);
+        } else if (sequence == apdu_segment_window()) {
+            /* the last segment of the window */
+            ct_test(pTest, Datalink_Send_Count == 2);
+            ct_test(pTest, segment[2] == sequence);
+        }
+    }
+    /* the last segment is acknowledged, and the whole ACK handed back */
+    ct_test(pTest, Datalink_Send_Count == 4);
+    ct_test(pTest, segment[0] == PDU_TYPE_SEGMENT_ACK);
+    ct_test(pTest, segment[2] == 9);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    ct_test(pTest, service_request_len == 10 * sizeof(data));
+    for (i = 0; i < service_request_len; i++) {
+        ct_test(pTest, service_request[i] == (i / sizeof(data)));
+    }
+    ct_test(pTest, tsm_invoke_id_free(invokeID[0]) == false);
+    tsm_free_invoke_id(invokeID[0]);
+    /* only so many can be put together at once */
+    service_data.sequence_number = 0;
+    service_data.more_follows = true;
+    for (i = 0; i <= MAX_SEGMENTED_ACKS; i++) {
+        invokeID[i] = tsm_next_free_invokeID();
+        tsm_set_confirmed_unsegmented_transaction(invokeID[i], &server,
+            &npdu_data, &request[0], sizeof(request));
+        service_data.invoke_id = invokeID[i];
+        service_request = &data[0];
+        service_request_len = sizeof(data);
+        ct_test(pTest, tsm_segmented_ack_received(&server, &service_data,
+                SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+                &service_request_len) == false);
+    }
+    ct_test(pTest, segment[0] == PDU_TYPE_ABORT);
+    ct_test(pTest, segment[1] == invokeID[MAX_SEGMENTED_ACKS]);
+    ct_test(pTest, segment[2] == ABORT_REASON_BUFFER_OVERFLOW);
+    ct_test(pTest, tsm_invoke_id_failed(invokeID[MAX_SEGMENTED_ACKS]));
+    tsm_free_invoke_id(invokeID[MAX_SEGMENTED_ACKS]);
+    /* a server that stops sending segments fails the message */
+    tsm_timer_milliseconds(4 * apdu_segment_timeout());
+    for (i = 0; i < MAX_SEGMENTED_ACKS; i++) {
+        ct_test(pTest, tsm_invoke_id_failed(invokeID[i]));
+        tsm_free_invoke_id(invokeID[i]);
+    }
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+    /* and its buffer can be used again */
+    invokeID[0] = tsm_next_free_invokeID();
+    tsm_set_confirmed_unsegmented_transaction(invokeID[0], &server,
+        &npdu_data, &request[0], sizeof(request));
+    service_data.invoke_id = invokeID[0];
+    service_request = &data[0];
+    service_request_len = sizeof(data);
+    Datalink_Send_Count = 0;
+    ct_test(pTest, tsm_segmented_ack_received(&server, &service_data,
+            SERVICE_CONFIRMED_READ_PROP_MULTIPLE, &service_request,
+            &service_request_len) == false);
+    ct_test(pTest, segment[0] == PDU_TYPE_SEGMENT_ACK);
+    tsm_free_invoke_id(invokeID[0]);
+    ct_test(pTest, tsm_timer_next_milliseconds() == DEADLINE_NONE);
+}
+#endif
+
 #ifdef TEST_TSM
 int main(
     void)
@@ -384,6 +1317,16 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testTSM);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMTimer);
+    assert(rc);
+#if (MAX_SEGMENTED_RESPONSES)
+    rc = ct_addTestFunction(pTest, testTSMSegmentedResponse);
+    assert(rc);
+#endif
+#if (MAX_SEGMENTED_ACKS)
+    rc = ct_addTestFunction(pTest, testTSMSegmentedAck);
+    assert(rc);
+#endif
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
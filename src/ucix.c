@@ -20,7 +20,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 
 #include <uci_config.h>
 #include <uci.h>
@@ -291,10 +294,10 @@ void load_value(const char *sec_idx, struct uci_itr_ctx *itr)
 		"value_time",0);
 	Out_Of_Service = ucix_get_option_int(itr->ctx, itr->section, sec_idx,
 		"Out_Of_Service",1);
-	if( (t = (value_tuple_t *)malloc(sizeof(value_tuple_t))) != NULL ) {
-		strncpy(t->idx, sec_idx, sizeof(t->idx));
+	if( (t = (value_tuple_t *)calloc(1, sizeof(value_tuple_t))) != NULL ) {
+		strncpy(t->idx, sec_idx, sizeof(t->idx) - 1);
 		if ( value != NULL ) {
-			strncpy(t->value, value, sizeof(t->value));
+			strncpy(t->value, value, sizeof(t->value) - 1);
 		}
 		t->value_time=value_time;
 		t->Out_Of_Service=Out_Of_Service;
@@ -303,4 +306,69 @@ void load_value(const char *sec_idx, struct uci_itr_ctx *itr)
 	}
 }
 
+static int watch_fd = -1;
 
+/* Watch the uci config and state directories for files being written,
+ * returns a file descriptor that becomes readable on a change, or -1 */
+int ucix_watch_init(void)
+{
+	if (watch_fd >= 0)
+		return watch_fd;
+	watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch_fd < 0)
+		return -1;
+	/* uci commits by renaming a temporary file over the config */
+	if (inotify_add_watch(watch_fd, "/etc/config",
+		IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(watch_fd);
+		watch_fd = -1;
+		return -1;
+	}
+	/* state is optional, it may not exist yet */
+	inotify_add_watch(watch_fd, "/var/state", IN_CLOSE_WRITE | IN_MOVED_TO);
+	return watch_fd;
+}
+
+void ucix_watch_cleanup(void)
+{
+	if (watch_fd >= 0) {
+		close(watch_fd);
+		watch_fd = -1;
+	}
+}
+
+/* Read the pending changes without blocking and call cb once for each
+ * config file that changed, returns the number of calls */
+int ucix_watch_read(void (*cb)(const char*, void*), void *priv)
+{
+	char buf[4096]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const char *changed[32];
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	int n, i, count = 0;
+
+	if (watch_fd < 0)
+		return 0;
+	while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+		/* a burst of writes to one file is reported once */
+		n = 0;
+		for (p = buf; p < buf + len;
+			p += sizeof(struct inotify_event) + ev->len) {
+			ev = (const struct inotify_event *) p;
+			/* skip the temporary files */
+			if (!ev->len || (ev->name[0] == '.'))
+				continue;
+			for (i = 0; i < n; i++)
+				if (!strcmp(changed[i], ev->name))
+					break;
+			if ((i == n) && (n < 32))
+				changed[n++] = ev->name;
+		}
+		for (i = 0; i < n; i++)
+			cb(changed[i], priv);
+		count += n;
+	}
+	return count;
+}
@@ -10,9 +10,9 @@
 LOGFILE = test.log
 
 all: abort address arf awf bacapp bacdcode bacerror bacint bacstr \
-	cov crc datetime dcc event filename fifo getevent iam ihave \
-	indtext keylist key memcopy npdu ptransfer \
-	rd reject ringbuf rp rpm sbuf timesync \
+	cov covqueue crc datetime dcc deadline event filename fifo getevent iam ihave \
+	indtext hashtab keylist key memcopy npdu objindex objname ptransfer \
+	rd reject ringbuf rp rpm sbuf timesync tsm \
 	whohas whois wp objects
 
 clean: logfile
@@ -71,6 +71,11 @@ cov: logfile test/cov.mak
 	( ./test/cov >> ${LOGFILE} )
 	$(MAKE) -s -C test -f cov.mak clean
 
+covqueue: logfile test/covqueue.mak
+	$(MAKE) -s -C test -f covqueue.mak clean all
+	( ./test/covqueue >> ${LOGFILE} )
+	$(MAKE) -s -C test -f covqueue.mak clean
+
 crc: logfile test/crc.mak
 	$(MAKE) -s -C test -f crc.mak clean all
 	( ./test/crc >> ${LOGFILE} )
@@ -86,6 +91,11 @@ dcc: logfile test/dcc.mak
 	( ./test/dcc >> ${LOGFILE} )
 	$(MAKE) -s -C test -f dcc.mak clean
 
+deadline: logfile test/deadline.mak
+	$(MAKE) -s -C test -f deadline.mak clean all
+	( ./test/deadline >> ${LOGFILE} )
+	$(MAKE) -s -C test -f deadline.mak clean
+
 event: logfile test/event.mak
 	$(MAKE) -s -C test -f event.mak clean all
 	( ./test/event >> ${LOGFILE} )
@@ -141,6 +151,21 @@ npdu: logfile test/npdu.mak
 	( ./test/npdu >> ${LOGFILE} )
 	$(MAKE) -s -C test -f npdu.mak clean
 
+objindex: logfile test/objindex.mak
+	$(MAKE) -s -C test -f objindex.mak clean all
+	( ./test/objindex >> ${LOGFILE} )
+	$(MAKE) -s -C test -f objindex.mak clean
+
+hashtab: logfile test/hashtab.mak
+	$(MAKE) -s -C test -f hashtab.mak clean all
+	( ./test/hashtab >> ${LOGFILE} )
+	$(MAKE) -s -C test -f hashtab.mak clean
+
+objname: logfile test/objname.mak
+	$(MAKE) -s -C test -f objname.mak clean all
+	( ./test/objname >> ${LOGFILE} )
+	$(MAKE) -s -C test -f objname.mak clean
+
 ptransfer: logfile test/ptransfer.mak
 	$(MAKE) -s -C test -f ptransfer.mak clean all
 	( ./test/ptransfer >> ${LOGFILE} )
@@ -181,6 +206,11 @@ timesync: logfile test/timesync.mak
 	( ./test/timesync >> ${LOGFILE} )
 	$(MAKE) -s -C test -f timesync.mak clean
 
+tsm: logfile test/tsm.mak
+	$(MAKE) -s -C test -f tsm.mak clean all
+	( ./test/tsm >> ${LOGFILE} )
+	$(MAKE) -s -C test -f tsm.mak clean
+
 whohas: logfile test/whohas.mak
 	$(MAKE) -s -C test -f whohas.mak clean all
 	( ./test/whohas >> ${LOGFILE} )
@@ -196,7 +226,7 @@ wp: logfile test/wp.mak
 	( ./test/wp >> ${LOGFILE} )
 	$(MAKE) -s -C test -f wp.mak clean
 
-objects: ai ao av bi bo bv csv lc lo lso lsp mso msv msi
+objects: ai ao av bi bo bv csv lc lo lso lsp mso msv msi trendlog device
 
 ai: logfile demo/object/ai.mak
 	$(MAKE) -s -C demo/object -f ai.mak clean all
@@ -271,3 +301,8 @@ msv: logfile demo/object/msv.mak
 	$(MAKE) -s -C demo/object -f msv.mak clean all
 	( ./demo/object/multistate_value >> ${LOGFILE} )
 	$(MAKE) -s -C demo/object -f msv.mak clean
+
+trendlog: logfile demo/object/trendlog.mak
+	$(MAKE) -s -C demo/object -f trendlog.mak clean all
+	( ./demo/object/trend_log >> ${LOGFILE} )
+	$(MAKE) -s -C demo/object -f trendlog.mak clean
@@ -7,6 +7,8 @@ DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_ADDRESS
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
 SRCS = $(SRC_DIR)/address.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
 	$(SRC_DIR)/bacaddr.c \
 	$(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacint.c \
@@ -0,0 +1,35 @@
+/* bench.h: helpers shared by the micro-benchmarks in this directory */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+/* monotonic timestamp in nanoseconds */
+static inline double bench_now_ns(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1.0e9) + (double) ts.tv_nsec;
+}
+
+/* prints one result line: label, operations, ns/op and ops/sec */
+static inline void bench_report(
+    const char *label,
+    unsigned long ops,
+    double elapsed_ns)
+{
+    double ns_per_op = 0.0;
+    double ops_per_sec = 0.0;
+
+    if (ops && (elapsed_ns > 0.0)) {
+        ns_per_op = elapsed_ns / (double) ops;
+        ops_per_sec = ((double) ops * 1.0e9) / elapsed_ns;
+    }
+    printf("%-40s %10lu ops %10.1f ns/op %12.0f ops/s\n", label, ops,
+        ns_per_op, ops_per_sec);
+}
+
+#endif
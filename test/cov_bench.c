@@ -0,0 +1,386 @@
+/* cov_bench.c: measures the latency from a present value change to the
+   COV notification datagram being sent, as the number of subscriptions
+   grows */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacstr.h"
+#include "apdu.h"
+#include "npdu.h"
+#include "cov.h"
+#include "datalink.h"
+#include "handlers.h"
+#include "ucix.h"
+#include "bv.h"
+#include "bench.h"
+
+/* the instances of the binary values given by the UCI stubs */
+#define BENCH_OBJECTS 1024
+
+/* time and count of the notifications sent */
+static double Sent_Time;
+static unsigned long Sent_Count;
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    (void) dest;
+    (void) npdu_data;
+    (void) pdu;
+
+    Sent_Time = bench_now_ns();
+    Sent_Count++;
+
+    return (int) pdu_len;
+}
+
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    (void) dest;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(BACNET_ADDRESS));
+}
+
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 260001;
+}
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedType,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    (void) pErrorClass;
+    (void) pErrorCode;
+
+    return pValue->tag == ucExpectedType;
+}
+
+bool Device_Valid_Object_Name(
+    BACNET_CHARACTER_STRING * object_name,
+    int *object_type,
+    uint32_t * object_instance)
+{
+    (void) object_name;
+    (void) object_type;
+    (void) object_instance;
+
+    return false;
+}
+
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+bool Device_Valid_Object_Id(
+    int object_type,
+    uint32_t object_instance)
+{
+    return (object_type == OBJECT_BINARY_VALUE) &&
+        Binary_Value_Valid_Instance(object_instance);
+}
+
+bool Device_Value_List_Supported(
+    BACNET_OBJECT_TYPE object_type)
+{
+    return object_type == OBJECT_BINARY_VALUE;
+}
+
+bool Device_Encode_Value_List(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_VALUE * value_list)
+{
+    (void) object_type;
+
+    return Binary_Value_Encode_Value_List(object_instance, value_list);
+}
+
+bool Device_COV(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+
+    return Binary_Value_Change_Of_Value(object_instance);
+}
+
+void Device_COV_Clear(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+
+    Binary_Value_Change_Of_Value_Clear(object_instance);
+}
+
+/* UCI stubs: each binary value section has a name and nothing else */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    char idx[16];
+    unsigned i = 0;
+
+    (void) ctx;
+    (void) p;
+    (void) t;
+    for (i = BENCH_OBJECTS; i > 0; i--) {
+        snprintf(idx, sizeof(idx), "%u", i - 1);
+        cb(idx, priv);
+    }
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+
+    return strcmp(o, "name") ? NULL : "BV";
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+
+    return def;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i);
+
+    return true;
+}
+
+/* subscribe through the SubscribeCOV service handler */
+static void bench_subscribe(
+    uint32_t process_id,
+    uint32_t object_instance)
+{
+    uint8_t apdu[MAX_APDU];
+    BACNET_SUBSCRIBE_COV_DATA cov_data;
+    BACNET_CONFIRMED_SERVICE_DATA service_data;
+    BACNET_ADDRESS src;
+    int len = 0;
+
+    memset(&cov_data, 0, sizeof(cov_data));
+    cov_data.subscriberProcessIdentifier = process_id;
+    cov_data.monitoredObjectIdentifier.type = OBJECT_BINARY_VALUE;
+    cov_data.monitoredObjectIdentifier.instance = object_instance;
+    cov_data.issueConfirmedNotifications = false;
+    cov_data.lifetime = 0;
+    len = cov_subscribe_encode_apdu(apdu, 1, &cov_data);
+    memset(&service_data, 0, sizeof(service_data));
+    service_data.invoke_id = 1;
+    memset(&src, 0, sizeof(src));
+    src.mac_len = 1;
+    src.mac[0] = (uint8_t) process_id;
+    /* skip the confirmed request header */
+    handler_cov_subscribe(&apdu[4], (uint16_t) (len - 4), &src,
+        &service_data);
+}
+
+/* change one object and run the COV task once, returning the time to the
+   last notification sent, or a negative value if not all were sent */
+static double bench_change(
+    uint32_t object_instance,
+    BACNET_BINARY_PV value,
+    unsigned long subscribers)
+{
+    double start = 0.0;
+
+    Sent_Count = 0;
+    start = bench_now_ns();
+    Binary_Value_Present_Value_Set(object_instance, value, 16);
+    handler_cov_task();
+    if (Sent_Count != subscribers) {
+        return -1.0;
+    }
+
+    return Sent_Time - start;
+}
+
+/* average latency of changing object 0 with the given number of its
+   subscribers, reported with the label */
+static void bench_latency(
+    const char *label,
+    unsigned long iterations,
+    unsigned long subscribers)
+{
+    unsigned long i = 0;
+    unsigned long missed = 0;
+    double elapsed = 0.0;
+    double latency = 0.0;
+    BACNET_BINARY_PV value = BINARY_INACTIVE;
+
+    for (i = 0; i < iterations; i++) {
+        if (Binary_Value_Present_Value(0) == BINARY_ACTIVE) {
+            value = BINARY_INACTIVE;
+        } else {
+            value = BINARY_ACTIVE;
+        }
+        latency = bench_change(0, value, subscribers);
+        if (latency < 0.0) {
+            missed++;
+        } else {
+            elapsed += latency;
+        }
+    }
+    bench_report(label, iterations - missed, elapsed);
+    if (missed) {
+        printf("  %lu changes were not notified in the same loop\n", missed);
+    }
+}
+
+int main(
+    void)
+{
+    static const unsigned subscriptions[] = { 1, 16, 128, 1024, 4096 };
+    unsigned n = 0;
+    unsigned j = 0;
+    double start = 0.0;
+    char label[64];
+
+    Binary_Value_Init();
+    printf("Present_Value_Set to COV notification sent\n");
+    for (n = 0; n < sizeof(subscriptions) / sizeof(subscriptions[0]); n++) {
+        /* the subscriptions are spread over all of the objects,
+           and only object 0 changes */
+        handler_cov_init();
+        start = bench_now_ns();
+        for (j = 0; j < subscriptions[n]; j++) {
+            bench_subscribe(j + 1, j % BENCH_OBJECTS);
+        }
+        snprintf(label, sizeof(label), "subscribe: subscriptions=%u",
+            subscriptions[n]);
+        bench_report(label, subscriptions[n], bench_now_ns() - start);
+        start = bench_now_ns();
+        for (j = 0; j < subscriptions[n]; j++) {
+            bench_subscribe(j + 1, j % BENCH_OBJECTS);
+        }
+        snprintf(label, sizeof(label), "renew: subscriptions=%u",
+            subscriptions[n]);
+        bench_report(label, subscriptions[n], bench_now_ns() - start);
+        handler_cov_task();
+        snprintf(label, sizeof(label), "spread: subscriptions=%u",
+            subscriptions[n]);
+        bench_latency(label, 200000,
+            (subscriptions[n] + BENCH_OBJECTS - 1) / BENCH_OBJECTS);
+        /* all of the subscriptions are for object 0,
+           reported to the last subscriber */
+        handler_cov_init();
+        for (j = 0; j < subscriptions[n]; j++) {
+            bench_subscribe(j + 1, 0);
+        }
+        handler_cov_task();
+        snprintf(label, sizeof(label), "fan-out: subscriptions=%u",
+            subscriptions[n]);
+        bench_latency(label, 100 + (200000 / subscriptions[n]),
+            subscriptions[n]);
+    }
+
+    return 0;
+}
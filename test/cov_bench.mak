@@ -0,0 +1,57 @@
+#Makefile to build benchmark
+CC      = gcc
+SRC_DIR = ../src
+HANDLER_DIR = ../demo/handler
+OBJECT_DIR = ../demo/object
+INCLUDES = -I../include -I. -I$(HANDLER_DIR) -I$(OBJECT_DIR)
+DEFINES = -DBACDL_TEST -DBIG_ENDIAN=0
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -O2
+
+SRCS = $(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/bacerror.c \
+	$(SRC_DIR)/abort.c \
+	$(SRC_DIR)/reject.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/apdu.c \
+	$(SRC_DIR)/dcc.c \
+	$(SRC_DIR)/tsm.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
+	$(SRC_DIR)/cov.c \
+	$(SRC_DIR)/covqueue.c \
+	$(SRC_DIR)/objindex.c \
+	$(HANDLER_DIR)/txbuf.c \
+	$(HANDLER_DIR)/h_cov.c \
+	$(OBJECT_DIR)/bv.c \
+	cov_bench.c
+
+TARGET = cov_bench
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
+
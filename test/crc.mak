@@ -2,7 +2,7 @@
 CC      = gcc
 SRC_DIR = ../src
 INCLUDES = -I../include -I. -I../demo/object 
-DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_CRC
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_CRC -DCRC_USE_TABLE
 
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
@@ -0,0 +1,118 @@
+/* crc_bench.c: compares the MS/TP data CRC accumulated one octet at a
+   time with the buffer CRC, over frame sized and capture sized buffers */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "crc.h"
+#include "bench.h"
+
+/* a large mstpcap capture, in octets */
+#define BENCH_CAPTURE (4UL * 1024UL * 1024UL)
+
+static uint8_t Buffer[BENCH_CAPTURE];
+/* keeps the CRC results live */
+static volatile uint16_t Sink;
+
+/* the per-octet CRC without tables, from the BACnet standard,
+   which hosted builds used before they defined CRC_USE_TABLE */
+static uint16_t bench_crc_bitwise(
+    uint8_t dataValue,
+    uint16_t crcValue)
+{
+    uint16_t crcLow;
+
+    crcLow = (crcValue & 0xff) ^ dataValue;
+
+    return (crcValue >> 8) ^ (crcLow << 8) ^ (crcLow << 3)
+        ^ (crcLow << 12) ^ (crcLow >> 4)
+        ^ (crcLow & 0x0f) ^ ((crcLow & 0x0f) << 7);
+}
+
+static uint16_t bench_octets_bitwise(
+    const uint8_t * buffer,
+    size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        crc = bench_crc_bitwise(buffer[i], crc);
+    }
+
+    return crc;
+}
+
+static uint16_t bench_octets_table(
+    const uint8_t * buffer,
+    size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        crc = CRC_Calc_Data(buffer[i], crc);
+    }
+
+    return crc;
+}
+
+static uint16_t bench_buffer(
+    const uint8_t * buffer,
+    size_t length)
+{
+    return CRC_Calc_Data_Buffer(buffer, length, 0xFFFF);
+}
+
+/* CRC the first length octets of the buffer, repeating so that about
+   the same number of octets is used for every length, reporting the
+   time per frame and the rate in octets */
+static void bench_crc(
+    const char *name,
+    uint16_t(*crc) (const uint8_t *, size_t),
+    size_t length)
+{
+    unsigned long frames = 0;
+    unsigned long i = 0;
+    double start = 0.0;
+    double elapsed = 0.0;
+    char label[64];
+
+    frames = (64UL * 1024UL * 1024UL) / length;
+    start = bench_now_ns();
+    for (i = 0; i < frames; i++) {
+        Sink = crc(&Buffer[i & 0xFF], length);
+    }
+    elapsed = bench_now_ns() - start;
+    snprintf(label, sizeof(label), "%s: length=%lu", name,
+        (unsigned long) length);
+    bench_report(label, frames, elapsed);
+    printf("  %.0f MB/s\n", ((double) frames * length * 1.0e3) / elapsed);
+}
+
+int main(
+    void)
+{
+    static const size_t lengths[] = { 8, 64, 501, BENCH_CAPTURE - 256 };
+    unsigned n = 0;
+    uint32_t lfsr = 0xACE1u;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(Buffer); i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        Buffer[i] = (uint8_t) lfsr;
+    }
+    if ((bench_octets_bitwise(Buffer, 501) != bench_buffer(Buffer, 501)) ||
+        (bench_octets_table(Buffer, 501) != bench_buffer(Buffer, 501))) {
+        printf("CRC mismatch\n");
+        return 1;
+    }
+    for (n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++) {
+        bench_crc("octet bitwise", bench_octets_bitwise, lengths[n]);
+        bench_crc("octet table", bench_octets_table, lengths[n]);
+        bench_crc("buffer", bench_buffer, lengths[n]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,469 @@
+/* device_bench.c: measures the Device object of a gateway with thousands
+   of objects: reading its Object_List element by element and as a
+   whole, finding objects by name as Who-Has does, writing object
+   names, which checks that the new name is not taken, and the passes
+   of intrinsic reporting made each second, with limits on every analog
+   input and a few of their values changing between passes */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacapp.h"
+#include "bacstr.h"
+#include "apdu.h"
+#include "npdu.h"
+#include "rp.h"
+#include "wp.h"
+#include "datalink.h"
+#include "handlers.h"
+#include "device.h"
+#include "ai.h"
+#include "ucix.h"
+#include "bench.h"
+
+/* the objects of each type given by the UCI stubs */
+#define BENCH_ANALOG_INPUTS 5000
+#define BENCH_BINARY_VALUES 500
+#define BENCH_MULTISTATE_VALUES 100
+/* the largest Object_List, encoded */
+#define BENCH_LIST_APDU 65535
+/* passes of intrinsic reporting, and the analog inputs that change
+   their value before each pass: 1% of them */
+#define BENCH_REPORTING_PASSES 100
+#define BENCH_REPORTING_CHANGES (BENCH_ANALOG_INPUTS / 100)
+/* the limits of the analog inputs, in seconds and units */
+#define BENCH_TIME_DELAY 3
+#define BENCH_HIGH_LIMIT 100.0f
+#define BENCH_LOW_LIMIT 0.0f
+
+static uint8_t Bench_APDU[BENCH_LIST_APDU];
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    (void) dest;
+    (void) npdu_data;
+    (void) pdu;
+
+    return (int) pdu_len;
+}
+
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    memset(dest, 0, sizeof(BACNET_ADDRESS));
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(BACNET_ADDRESS));
+}
+
+/* UCI stubs: the sections of each config are numbered from zero,
+   and have a name made of the config and the section, and a value */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+static unsigned bench_sections(
+    const char *p)
+{
+    unsigned sections = 0;
+
+    if (strcmp(p, "bacnet_ai") == 0) {
+        sections = BENCH_ANALOG_INPUTS;
+    } else if (strcmp(p, "bacnet_bv") == 0) {
+        sections = BENCH_BINARY_VALUES;
+    } else if (strcmp(p, "bacnet_mv") == 0) {
+        sections = BENCH_MULTISTATE_VALUES;
+    }
+
+    return sections;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    char idx[16];
+    unsigned i = 0;
+
+    (void) ctx;
+    (void) t;
+    for (i = bench_sections(p); i > 0; i--) {
+        snprintf(idx, sizeof(idx), "%u", i - 1);
+        cb(idx, priv);
+    }
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    static char name[64];
+
+    (void) ctx;
+
+    if (!s || (bench_sections(p) == 0)) {
+        return NULL;
+    }
+    if (strcmp(o, "value") == 0) {
+        return "0";
+    }
+    if (strcmp(o, "name")) {
+        return NULL;
+    }
+    snprintf(name, sizeof(name), "%s %s", p, s);
+
+    return name;
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+
+    return def;
+}
+
+int ucix_get_list(
+    char *value[254],
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) value;
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+
+    return 0;
+}
+
+void ucix_set_list(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    char value[254][64],
+    int l)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) value;
+    (void) l;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i - 1);
+    dest[i - 1] = 0;
+
+    return true;
+}
+
+/* read the Object_List of the Device object, at the given array index */
+static int bench_read_object_list(
+    uint32_t array_index)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+
+    memset(&rpdata, 0, sizeof(rpdata));
+    rpdata.object_type = OBJECT_DEVICE;
+    rpdata.object_instance = Device_Object_Instance_Number();
+    rpdata.object_property = PROP_OBJECT_LIST;
+    rpdata.array_index = array_index;
+    rpdata.application_data = Bench_APDU;
+    rpdata.application_data_len = sizeof(Bench_APDU);
+
+    return Device_Read_Property(&rpdata);
+}
+
+/* write a property of an analog input */
+static bool bench_write_property(
+    uint32_t instance,
+    BACNET_PROPERTY_ID property,
+    BACNET_APPLICATION_DATA_VALUE * value)
+{
+    BACNET_WRITE_PROPERTY_DATA wp_data;
+
+    memset(&wp_data, 0, sizeof(wp_data));
+    wp_data.object_type = OBJECT_ANALOG_INPUT;
+    wp_data.object_instance = instance;
+    wp_data.object_property = property;
+    wp_data.array_index = BACNET_ARRAY_ALL;
+    wp_data.priority = BACNET_NO_PRIORITY;
+    wp_data.application_data_len =
+        bacapp_encode_application_data(wp_data.application_data, value);
+
+    return Device_Write_Property(&wp_data);
+}
+
+/* write the Object_Name of an analog input */
+static bool bench_write_name(
+    uint32_t instance,
+    const char *name)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+
+    value.tag = BACNET_APPLICATION_TAG_CHARACTER_STRING;
+    characterstring_init_ansi(&value.type.Character_String, name);
+
+    return bench_write_property(instance, PROP_OBJECT_NAME, &value);
+}
+
+/* enable the high and low limits of an analog input, and the events
+   of all its transitions */
+static bool bench_write_limits(
+    uint32_t instance)
+{
+    BACNET_APPLICATION_DATA_VALUE value;
+    bool status = true;
+
+    value.tag = BACNET_APPLICATION_TAG_REAL;
+    value.type.Real = BENCH_HIGH_LIMIT;
+    status &= bench_write_property(instance, PROP_HIGH_LIMIT, &value);
+    value.type.Real = BENCH_LOW_LIMIT;
+    status &= bench_write_property(instance, PROP_LOW_LIMIT, &value);
+    value.type.Real = 1.0f;
+    status &= bench_write_property(instance, PROP_DEADBAND, &value);
+    value.tag = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+    value.type.Unsigned_Int = BENCH_TIME_DELAY;
+    status &= bench_write_property(instance, PROP_TIME_DELAY, &value);
+    value.tag = BACNET_APPLICATION_TAG_BIT_STRING;
+    /* low-limit-enable, high-limit-enable */
+    bitstring_init(&value.type.Bit_String);
+    bitstring_set_bit(&value.type.Bit_String, 0, true);
+    bitstring_set_bit(&value.type.Bit_String, 1, true);
+    status &= bench_write_property(instance, PROP_LIMIT_ENABLE, &value);
+    /* to-offnormal, to-fault, to-normal */
+    bitstring_set_bit(&value.type.Bit_String, 2, true);
+    status &= bench_write_property(instance, PROP_EVENT_ENABLE, &value);
+
+    return status;
+}
+
+/* the analog inputs that are in alarm */
+static unsigned bench_in_alarm(
+    void)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_APPLICATION_DATA_VALUE value;
+    unsigned count = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < BENCH_ANALOG_INPUTS; i++) {
+        memset(&rpdata, 0, sizeof(rpdata));
+        rpdata.object_type = OBJECT_ANALOG_INPUT;
+        rpdata.object_instance = i;
+        rpdata.object_property = PROP_EVENT_STATE;
+        rpdata.array_index = BACNET_ARRAY_ALL;
+        rpdata.application_data = Bench_APDU;
+        rpdata.application_data_len = sizeof(Bench_APDU);
+        if ((Device_Read_Property(&rpdata) > 0) &&
+            (bacapp_decode_application_data(Bench_APDU,
+                    rpdata.application_data_len, &value) > 0) &&
+            (value.type.Enumerated != EVENT_STATE_NORMAL)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* passes of intrinsic reporting, as the server makes each second,
+   with the given analog inputs given a new value before each pass:
+   one in six of them over the high limit */
+static void bench_reporting(
+    const char *label,
+    unsigned changes)
+{
+    double elapsed = 0.0;
+    double start = 0.0;
+    unsigned long i = 0;
+    unsigned j = 0;
+    static unsigned x = 1;
+
+    for (i = 0; i < BENCH_REPORTING_PASSES; i++) {
+        for (j = 0; j < changes; j++) {
+            x = (x * 1103515245) + 12345;
+            Analog_Input_Present_Value_Set((x >> 8) % BENCH_ANALOG_INPUTS,
+                (float) ((x >> 16) % 120), 16);
+        }
+        start = bench_now_ns();
+        Device_local_reporting();
+        elapsed += bench_now_ns() - start;
+    }
+    bench_report(label, BENCH_REPORTING_PASSES, elapsed);
+    printf("  %u analog inputs in alarm\n", bench_in_alarm());
+}
+
+int main(
+    void)
+{
+    BACNET_CHARACTER_STRING name;
+    char text[64];
+    unsigned long missed = 0;
+    unsigned long i = 0;
+    unsigned count = 0;
+    unsigned x = 1;
+    int object_type = 0;
+    uint32_t instance = 0;
+    double start = 0.0;
+    int len = 0;
+
+    Device_Init(NULL);
+    count = Device_Object_List_Count();
+    printf("Device object with %u objects\n", count);
+
+    start = bench_now_ns();
+    for (i = 1; i <= count; i++) {
+        if (bench_read_object_list(i) <= 0) {
+            missed++;
+        }
+    }
+    bench_report("Object_List: element by element", count,
+        bench_now_ns() - start);
+    start = bench_now_ns();
+    for (i = 0; i < 100; i++) {
+        len = bench_read_object_list(BACNET_ARRAY_ALL);
+        if (len <= 0) {
+            missed++;
+        }
+    }
+    bench_report("Object_List: whole array", 100, bench_now_ns() - start);
+    printf("  %d octets\n", len);
+
+    start = bench_now_ns();
+    for (i = 0; i < 10000; i++) {
+        x = (x * 1103515245) + 12345;
+        snprintf(text, sizeof(text), "bacnet_ai %u",
+            (x >> 8) % BENCH_ANALOG_INPUTS);
+        characterstring_init_ansi(&name, text);
+        if (!Device_Valid_Object_Name(&name, &object_type, &instance)) {
+            missed++;
+        }
+    }
+    bench_report("Who-Has: by name", 10000, bench_now_ns() - start);
+    characterstring_init_ansi(&name, "no such object");
+    start = bench_now_ns();
+    for (i = 0; i < 10000; i++) {
+        if (Device_Valid_Object_Name(&name, &object_type, &instance)) {
+            missed++;
+        }
+    }
+    bench_report("Who-Has: unknown name", 10000, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (i = 0; i < 10000; i++) {
+        snprintf(text, sizeof(text), "renamed %lu", i);
+        if (!bench_write_name(i % BENCH_ANALOG_INPUTS, text)) {
+            missed++;
+        }
+    }
+    bench_report("WriteProperty: Object_Name", 10000,
+        bench_now_ns() - start);
+    /* the old name is free again, and the new one is taken */
+    characterstring_init_ansi(&name, "bacnet_ai 1");
+    if (Device_Valid_Object_Name(&name, &object_type, &instance) ||
+        !bench_write_name(2, "bacnet_ai 1") ||
+        bench_write_name(3, "bacnet_ai 1")) {
+        missed++;
+    }
+
+    for (i = 0; i < BENCH_ANALOG_INPUTS; i++) {
+        if (!bench_write_limits(i)) {
+            missed++;
+        }
+    }
+    /* settle the time delays that the writes started */
+    for (i = 0; i <= BENCH_TIME_DELAY; i++) {
+        Device_local_reporting();
+    }
+    bench_reporting("intrinsic reporting: 1% changed", BENCH_REPORTING_CHANGES);
+    bench_reporting("intrinsic reporting: none changed", 0);
+    if (missed) {
+        printf("  %lu operations failed\n", missed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#Makefile to build benchmark
+CC      = gcc
+SRC_DIR = ../src
+HANDLER_DIR = ../demo/handler
+OBJECT_DIR = ../demo/object
+INCLUDES = -I../include -I. -I$(HANDLER_DIR) -I$(OBJECT_DIR) \
+	-I../ports/linux
+DEFINES = -DBACDL_TEST -DBIG_ENDIAN=0 -DINTRINSIC_REPORTING \
+	-DMAX_ANALOG_INPUTS=5000
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -O2 -fcommon
+
+SRCS = $(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/bacerror.c \
+	$(SRC_DIR)/abort.c \
+	$(SRC_DIR)/reject.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/apdu.c \
+	$(SRC_DIR)/dcc.c \
+	$(SRC_DIR)/tsm.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
+	$(SRC_DIR)/address.c \
+	$(SRC_DIR)/cov.c \
+	$(SRC_DIR)/covqueue.c \
+	$(SRC_DIR)/objindex.c \
+	$(SRC_DIR)/objname.c \
+	$(SRC_DIR)/proplist.c \
+	$(SRC_DIR)/keylist.c \
+	$(SRC_DIR)/memcopy.c \
+	$(SRC_DIR)/rp.c \
+	$(SRC_DIR)/wp.c \
+	$(SRC_DIR)/whois.c \
+	$(SRC_DIR)/version.c \
+	$(SRC_DIR)/event.c \
+	$(SRC_DIR)/timestamp.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/bacpropstates.c \
+	$(SRC_DIR)/readrange.c \
+	$(SRC_DIR)/alarm_ack.c \
+	$(SRC_DIR)/getevent.c \
+	$(SRC_DIR)/get_alarm_sum.c \
+	$(HANDLER_DIR)/txbuf.c \
+	$(HANDLER_DIR)/h_cov.c \
+	$(HANDLER_DIR)/h_wp.c \
+	$(HANDLER_DIR)/h_getevent.c \
+	$(HANDLER_DIR)/h_alarm_ack.c \
+	$(HANDLER_DIR)/h_get_alarm_sum.c \
+	$(HANDLER_DIR)/s_cevent.c \
+	$(HANDLER_DIR)/s_uevent.c \
+	$(HANDLER_DIR)/s_whois.c \
+	$(OBJECT_DIR)/device.c \
+	$(OBJECT_DIR)/ai.c \
+	$(OBJECT_DIR)/ao.c \
+	$(OBJECT_DIR)/av.c \
+	$(OBJECT_DIR)/bi.c \
+	$(OBJECT_DIR)/bo.c \
+	$(OBJECT_DIR)/bv.c \
+	$(OBJECT_DIR)/msi.c \
+	$(OBJECT_DIR)/mso.c \
+	$(OBJECT_DIR)/msv.c \
+	$(OBJECT_DIR)/nc.c \
+	$(OBJECT_DIR)/trendlog.c \
+	device_bench.c
+
+TARGET = device_bench
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
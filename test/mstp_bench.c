@@ -0,0 +1,261 @@
+/* mstp_bench.c: soak test of the Linux MS/TP node threads over pty pairs,
+   reporting the CPU used per port and the jitter of the token rotation.
+   The benchmark is the wire: it copies every octet written by a node
+   to all of the other nodes. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "mstp.h"
+#include "dlmstp_linux.h"
+#include "bench.h"
+
+/* master nodes on the wire, at MAC addresses 1 to BENCH_PORTS */
+#define BENCH_PORTS 4
+/* default seconds to run */
+#define BENCH_SECONDS 10
+/* token rotations recorded for each node */
+#define BENCH_ROTATIONS 100000
+
+/* a node and the master side of its pty */
+struct bench_port {
+    struct mstp_port_struct_t mstp_port;
+    SHARED_MSTP_DATA shared;
+    int pty;
+    char name[64];
+    /* receive state of the frames written by this node */
+    uint8_t header[8];
+    unsigned header_len;
+    unsigned skip;
+    /* when this node last passed the token */
+    double token_time;
+    double rotation[BENCH_ROTATIONS];
+    unsigned rotations;
+};
+
+static struct bench_port Bench_Port[BENCH_PORTS];
+static volatile bool Bench_Running = true;
+static double Bench_Wire_CPU;
+
+/* thread CPU time in nanoseconds */
+static double bench_thread_cpu_ns(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((double) ts.tv_sec * 1.0e9) + (double) ts.tv_nsec;
+}
+
+/* process CPU time in nanoseconds */
+static double bench_process_cpu_ns(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((double) ts.tv_sec * 1.0e9) + (double) ts.tv_nsec;
+}
+
+/* follow the frames written by a node, and time its tokens */
+static void bench_frame_octet(
+    struct bench_port *port,
+    uint8_t octet,
+    double now)
+{
+    unsigned length = 0;
+
+    if (port->skip) {
+        port->skip--;
+        return;
+    }
+    if ((port->header_len == 0) && (octet != 0x55)) {
+        return;
+    }
+    if ((port->header_len == 1) && (octet != 0xFF)) {
+        port->header_len = (octet == 0x55) ? 1 : 0;
+        return;
+    }
+    port->header[port->header_len++] = octet;
+    if (port->header_len < 8) {
+        return;
+    }
+    /* preamble, frame type, destination, source, length, header CRC */
+    port->header_len = 0;
+    length = ((unsigned) port->header[5] << 8) | port->header[6];
+    if (length) {
+        /* data and data CRC */
+        port->skip = length + 2;
+    }
+    if (port->header[2] == FRAME_TYPE_TOKEN) {
+        if ((port->token_time > 0.0) && (port->rotations < BENCH_ROTATIONS)) {
+            port->rotation[port->rotations++] = now - port->token_time;
+        }
+        port->token_time = now;
+    }
+}
+
+/* copy the octets written by each node to all of the other nodes */
+static void *bench_wire_task(
+    void *pArg)
+{
+    struct pollfd fds[BENCH_PORTS];
+    uint8_t buf[1024];
+    double now = 0.0;
+    ssize_t len = 0;
+    unsigned i = 0;
+    unsigned j = 0;
+    ssize_t k = 0;
+
+    (void) pArg;
+    for (i = 0; i < BENCH_PORTS; i++) {
+        fds[i].fd = Bench_Port[i].pty;
+        fds[i].events = POLLIN;
+    }
+    while (Bench_Running) {
+        if (poll(fds, BENCH_PORTS, 100) <= 0) {
+            continue;
+        }
+        now = bench_now_ns();
+        for (i = 0; i < BENCH_PORTS; i++) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            len = read(fds[i].fd, buf, sizeof(buf));
+            if (len <= 0) {
+                continue;
+            }
+            for (j = 0; j < BENCH_PORTS; j++) {
+                if ((j != i) && (write(fds[j].fd, buf, len) != len)) {
+                    fprintf(stderr, "wire: short write to node %u\n", j + 1);
+                }
+            }
+            for (k = 0; k < len; k++) {
+                bench_frame_octet(&Bench_Port[i], buf[k], now);
+            }
+        }
+    }
+    Bench_Wire_CPU = bench_thread_cpu_ns();
+
+    return NULL;
+}
+
+/* open a pty pair for a node, leaving the master side with the wire */
+static bool bench_port_open(
+    struct bench_port *port)
+{
+    struct termios tio;
+
+    port->pty = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((port->pty < 0) || (grantpt(port->pty) < 0) ||
+        (unlockpt(port->pty) < 0) ||
+        (ptsname_r(port->pty, port->name, sizeof(port->name)) != 0)) {
+        return false;
+    }
+    tcgetattr(port->pty, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(port->pty, TCSANOW, &tio);
+
+    return true;
+}
+
+/* the token rotation of one node: mean and standard deviation,
+   and the range, in microseconds */
+static void bench_rotation_report(
+    struct bench_port *port,
+    unsigned mac)
+{
+    double sum = 0.0;
+    double sum2 = 0.0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    unsigned i = 0;
+
+    if (port->rotations == 0) {
+        printf("node %u: no token rotations\n", mac);
+        return;
+    }
+    min = max = port->rotation[0];
+    for (i = 0; i < port->rotations; i++) {
+        sum += port->rotation[i];
+        sum2 += port->rotation[i] * port->rotation[i];
+        if (port->rotation[i] < min) {
+            min = port->rotation[i];
+        }
+        if (port->rotation[i] > max) {
+            max = port->rotation[i];
+        }
+    }
+    mean = sum / port->rotations;
+    printf("node %u: %u rotations, %.1f us mean, %.1f us stddev, "
+        "%.1f..%.1f us\n", mac, port->rotations, mean / 1000.0,
+        sqrt((sum2 / port->rotations) - (mean * mean)) / 1000.0,
+        min / 1000.0, max / 1000.0);
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    pthread_t wire;
+    unsigned seconds = BENCH_SECONDS;
+    double start = 0.0;
+    double elapsed = 0.0;
+    double cpu = 0.0;
+    unsigned i = 0;
+
+    if (argc > 1) {
+        seconds = (unsigned) strtoul(argv[1], NULL, 0);
+    }
+    for (i = 0; i < BENCH_PORTS; i++) {
+        if (!bench_port_open(&Bench_Port[i])) {
+            perror("pty");
+            return 1;
+        }
+    }
+    pthread_create(&wire, NULL, bench_wire_task, NULL);
+    cpu = bench_process_cpu_ns();
+    start = bench_now_ns();
+    for (i = 0; i < BENCH_PORTS; i++) {
+        Bench_Port[i].shared.RS485_Handle = -1;
+        Bench_Port[i].shared.RS485MOD = CS8;
+        Bench_Port[i].shared.Treply_timeout = 260;
+        Bench_Port[i].shared.Tusage_timeout = 50;
+        Bench_Port[i].mstp_port.UserData = &Bench_Port[i].shared;
+        dlmstp_set_baud_rate(&Bench_Port[i].mstp_port, 38400);
+        dlmstp_set_mac_address(&Bench_Port[i].mstp_port, i + 1);
+        dlmstp_set_max_info_frames(&Bench_Port[i].mstp_port, 1);
+        dlmstp_set_max_master(&Bench_Port[i].mstp_port, BENCH_PORTS);
+        dlmstp_init(&Bench_Port[i].mstp_port, Bench_Port[i].name);
+    }
+    printf("MS/TP soak: %u master nodes over pty pairs for %u seconds\n",
+        BENCH_PORTS, seconds);
+    sleep(seconds);
+    elapsed = bench_now_ns() - start;
+    cpu = bench_process_cpu_ns() - cpu;
+    Bench_Running = false;
+    pthread_join(wire, NULL);
+    /* the node threads are all of the process, except the wire */
+    cpu -= Bench_Wire_CPU;
+    printf("CPU per port: %.2f%% (wire %.2f%%)\n",
+        (100.0 * cpu) / (elapsed * BENCH_PORTS),
+        (100.0 * Bench_Wire_CPU) / elapsed);
+    for (i = 0; i < BENCH_PORTS; i++) {
+        bench_rotation_report(&Bench_Port[i], i + 1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#Makefile to build benchmark
+CC      = gcc
+SRC_DIR = ../src
+PORT_DIR = ../ports/linux
+INCLUDES = -I../include -I. -I$(PORT_DIR)
+DEFINES = -DBACDL_MSTP -DBIG_ENDIAN=0
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -O2
+
+SRCS = $(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/crc.c \
+	$(SRC_DIR)/fifo.c \
+	$(SRC_DIR)/ringbuf.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/mstp.c \
+	$(SRC_DIR)/mstptext.c \
+	$(PORT_DIR)/rs485.c \
+	$(PORT_DIR)/dlmstp_linux.c \
+	mstp_bench.c
+
+TARGET = mstp_bench
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread -lm
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
@@ -0,0 +1,337 @@
+/* router_bench.c: replays a flood of I-Am-Router-To-Network updates into
+   the routing table of the router and looks the networks up, then
+   forwards PDUs between two virtual router ports through the message
+   boxes of the router, routed the way its main loop does, and reports
+   the PDUs forwarded each second and the CPU used while forwarding and
+   while idle. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "bacdef.h"
+#include "bacint.h"
+#include "npdu.h"
+#include "msgqueue.h"
+#include "portthread.h"
+#include "bench.h"
+
+/* default seconds to forward */
+#define BENCH_SECONDS 5
+/* PDUs each port keeps on their way to the other port */
+#define BENCH_WINDOW 16
+/* octets of APDU in each PDU */
+#define BENCH_APDU_LEN 50
+/* the most networks that are learned in the flood, from this one up */
+#define BENCH_FLOOD_NETS 60000
+#define BENCH_FLOOD_NET 100
+/* networks listed in each I-Am-Router-To-Network message */
+#define BENCH_FLOOD_NETS_PER_MSG 256
+
+ROUTER_PORT *head = NULL;
+int port_count;
+
+static ROUTER_PORT Bench_Port[2];
+static volatile bool Bench_Running = true;
+static volatile bool Bench_Sending = true;
+static unsigned long Bench_Forwarded;
+/* the network lists of the I-Am-Router-To-Network messages */
+static uint8_t Bench_Flood[BENCH_FLOOD_NETS * 2];
+
+/* process CPU time in nanoseconds */
+static double bench_process_cpu_ns(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((double) ts.tv_sec * 1.0e9) + (double) ts.tv_nsec;
+}
+
+/* learn the networks of I-Am-Router-To-Network messages from a router
+   on the second port, the way the network layer does */
+static void bench_flood_replay(
+    unsigned nets)
+{
+    BACNET_ADDRESS src;
+    uint16_t net;
+    unsigned first;
+    unsigned count;
+    unsigned i;
+
+    memset(&src, 0, sizeof(src));
+    src.len = 1;
+    src.adr[0] = 7;
+    for (first = 0; first < nets; first += count) {
+        count = nets - first;
+        if (count > BENCH_FLOOD_NETS_PER_MSG) {
+            count = BENCH_FLOOD_NETS_PER_MSG;
+        }
+        for (i = 0; i < count; i++) {
+            decode_unsigned16(&Bench_Flood[2 * (first + i)], &net);
+            add_dnet(&Bench_Port[1], net, src);
+        }
+    }
+}
+
+/* a flood of announcements of the given number of networks, announced
+   again, then routed to, then aged out */
+static void bench_flood(
+    unsigned nets)
+{
+    BACNET_ADDRESS dest;
+    unsigned long lookups = 1000000;
+    unsigned long missed = 0;
+    unsigned long i = 0;
+    unsigned x = 1;
+    double start = 0.0;
+    char label[64];
+
+    for (i = 0; i < nets; i++) {
+        encode_unsigned16(&Bench_Flood[2 * i], BENCH_FLOOD_NET + i);
+    }
+    start = bench_now_ns();
+    bench_flood_replay(nets);
+    snprintf(label, sizeof(label), "learn: nets=%u", nets);
+    bench_report(label, nets, bench_now_ns() - start);
+    start = bench_now_ns();
+    bench_flood_replay(nets);
+    snprintf(label, sizeof(label), "refresh: nets=%u", nets);
+    bench_report(label, nets, bench_now_ns() - start);
+    start = bench_now_ns();
+    for (i = 0; i < lookups; i++) {
+        x = (x * 1103515245) + 12345;
+        if (find_dnet(BENCH_FLOOD_NET + ((x >> 8) % nets),
+                &dest) != &Bench_Port[1]) {
+            missed++;
+        }
+    }
+    snprintf(label, sizeof(label), "lookup: nets=%u", nets);
+    bench_report(label, lookups, bench_now_ns() - start);
+    if (missed) {
+        printf("  %lu networks were not found\n", missed);
+    }
+    start = bench_now_ns();
+    i = age_dnets(time(NULL) + DNET_MAX_AGE + 1);
+    snprintf(label, sizeof(label), "age: nets=%u", nets);
+    bench_report(label, i, bench_now_ns() - start);
+    cleanup_dnets();
+}
+
+/* a port receives a PDU for a device on the network of the other port */
+static void bench_port_send(
+    ROUTER_PORT * port,
+    uint16_t dnet)
+{
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS dest;
+    MSG_DATA *data;
+    BACMSG msg;
+    int len = 0;
+
+    data = alloc_data();
+    if (!data) {
+        return;
+    }
+    memset(&dest, 0, sizeof(dest));
+    dest.net = dnet;
+    dest.len = 1;
+    dest.adr[0] = 1;
+    npdu_encode_npdu_data(&npdu_data, false, MESSAGE_PRIORITY_NORMAL);
+    len = npdu_encode_pdu(data->pdu, &dest, NULL, &npdu_data);
+    memset(&data->pdu[len], 0x55, BENCH_APDU_LEN);
+    data->pdu_len = len + BENCH_APDU_LEN;
+    data->src.len = 1;
+    data->src.adr[0] = 2;
+    msg.origin = port->port_id;
+    msg.type = DATA;
+    msg.data = data;
+    if (!send_to_msgbox(port->main_id, &msg)) {
+        free_data(data);
+    }
+}
+
+/* the thread of a port: each PDU forwarded to it makes it send another */
+static void *bench_port_task(
+    void *pArg)
+{
+    ROUTER_PORT *port = (ROUTER_PORT *) pArg;
+    ROUTER_PORT *other = (port == &Bench_Port[0]) ? &Bench_Port[1] :
+        &Bench_Port[0];
+    BACMSG msg_storage, *bacmsg;
+    struct epoll_event event;
+    int epoll_fd;
+    unsigned i;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = msgbox_fd(port->port_id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+    for (i = 0; i < BENCH_WINDOW; i++) {
+        bench_port_send(port, other->route_info.net);
+    }
+    while (Bench_Running) {
+        if (epoll_wait(epoll_fd, &event, 1, 100) <= 0) {
+            continue;
+        }
+        msgbox_clear(port->port_id);
+        while ((bacmsg = recv_from_msgbox(port->port_id, &msg_storage))) {
+            check_data((MSG_DATA *) bacmsg->data);
+            if (Bench_Sending) {
+                bench_port_send(port, other->route_info.net);
+            }
+        }
+    }
+    close(epoll_fd);
+
+    return NULL;
+}
+
+/* route a PDU to the port of its DNET, as the router main loop does */
+static void bench_route(
+    BACMSG * bacmsg)
+{
+    MSG_DATA *in_data = (MSG_DATA *) bacmsg->data;
+    MSG_DATA *msg_data;
+    BACNET_NPDU_DATA npdu_data;
+    BACNET_ADDRESS addr;
+    ROUTER_PORT *srcport;
+    ROUTER_PORT *destport;
+    BACMSG out_msg;
+    int apdu_offset = 0;
+    int npdu_len = 0;
+
+    msg_data = alloc_data();
+    if (!msg_data) {
+        check_data(in_data);
+        return;
+    }
+    memmove(&msg_data->src, &in_data->src, sizeof(BACNET_ADDRESS));
+    apdu_offset =
+        npdu_decode(in_data->pdu, &msg_data->dest, &addr, &npdu_data);
+    srcport = find_snet(bacmsg->origin);
+    destport = find_dnet(msg_data->dest.net, &msg_data->dest);
+    if (srcport && destport) {
+        msg_data->src.net = srcport->route_info.net;
+        npdu_len =
+            npdu_encode_pdu(msg_data->pdu, NULL, &msg_data->src, &npdu_data);
+        memmove(&msg_data->pdu[npdu_len], &in_data->pdu[apdu_offset],
+            in_data->pdu_len - apdu_offset);
+        msg_data->pdu_len = npdu_len + in_data->pdu_len - apdu_offset;
+        out_msg.origin = srcport->main_id;
+        out_msg.type = DATA;
+        out_msg.data = msg_data;
+        if (send_to_msgbox(destport->port_id, &out_msg)) {
+            Bench_Forwarded++;
+        } else {
+            free_data(msg_data);
+        }
+    } else {
+        free_data(msg_data);
+    }
+    check_data(in_data);
+}
+
+/* run the router main loop until the given time */
+static void bench_router(
+    MSGBOX_ID main_id,
+    int epoll_fd,
+    double until)
+{
+    BACMSG msg_storage, *bacmsg;
+    struct epoll_event event;
+
+    while (bench_now_ns() < until) {
+        if (epoll_wait(epoll_fd, &event, 1, 10) <= 0) {
+            continue;
+        }
+        msgbox_clear(main_id);
+        while ((bacmsg = recv_from_msgbox(main_id, &msg_storage))) {
+            bench_route(bacmsg);
+        }
+    }
+}
+
+int main(
+    int argc,
+    char *argv[])
+{
+    pthread_t thread[2];
+    struct epoll_event event;
+    MSGBOX_ID main_id;
+    unsigned seconds = BENCH_SECONDS;
+    double start = 0.0;
+    double elapsed = 0.0;
+    double cpu = 0.0;
+    int epoll_fd;
+    unsigned i = 0;
+
+    if (argc > 1) {
+        seconds = (unsigned) strtoul(argv[1], NULL, 0);
+    }
+    main_id = create_msgbox();
+    for (i = 0; i < 2; i++) {
+        Bench_Port[i].type = BIP;
+        Bench_Port[i].state = RUNNING;
+        Bench_Port[i].main_id = main_id;
+        Bench_Port[i].port_id = create_msgbox();
+        Bench_Port[i].route_info.net = i + 1;
+        Bench_Port[i].next = (i == 0) ? &Bench_Port[1] : NULL;
+        if (Bench_Port[i].port_id == INVALID_MSGBOX_ID) {
+            fprintf(stderr, "no message box for port %u\n", i + 1);
+            return 1;
+        }
+    }
+    head = &Bench_Port[0];
+    port_count = 2;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = msgbox_fd(main_id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event);
+
+    printf("Routing table flood: I-Am-Router-To-Network from port 2\n");
+    bench_flood(16);
+    bench_flood(256);
+    bench_flood(4096);
+    bench_flood(BENCH_FLOOD_NETS);
+
+    printf("Router: %u PDUs in flight from each of 2 ports for %u seconds\n",
+        BENCH_WINDOW, seconds);
+    cpu = bench_process_cpu_ns();
+    start = bench_now_ns();
+    for (i = 0; i < 2; i++) {
+        pthread_create(&thread[i], NULL, bench_port_task, &Bench_Port[i]);
+    }
+    bench_router(main_id, epoll_fd, start + (seconds * 1.0e9));
+    elapsed = bench_now_ns() - start;
+    cpu = bench_process_cpu_ns() - cpu;
+    bench_report("forward: 2 ports", Bench_Forwarded, elapsed);
+    printf("CPU forwarding: %.1f%%\n", (100.0 * cpu) / elapsed);
+
+    /* let the PDUs in flight arrive, then leave every thread waiting */
+    Bench_Sending = false;
+    bench_router(main_id, epoll_fd, bench_now_ns() + 2.0e8);
+    cpu = bench_process_cpu_ns();
+    start = bench_now_ns();
+    bench_router(main_id, epoll_fd, start + 1.0e9);
+    elapsed = bench_now_ns() - start;
+    cpu = bench_process_cpu_ns() - cpu;
+    printf("CPU idle: %.2f%%\n", (100.0 * cpu) / elapsed);
+
+    Bench_Running = false;
+    for (i = 0; i < 2; i++) {
+        pthread_join(thread[i], NULL);
+    }
+    close(epoll_fd);
+
+    return 0;
+}
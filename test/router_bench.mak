@@ -0,0 +1,39 @@
+#Makefile to build benchmark
+CC      = gcc
+SRC_DIR = ../src
+ROUTER_DIR = ../demo/router
+INCLUDES = -I../include -I. -I$(ROUTER_DIR)
+DEFINES = -DBACDL_BIP -DBIG_ENDIAN=0
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -O2
+
+SRCS = $(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/npdu.c \
+	$(ROUTER_DIR)/msgqueue.c \
+	$(ROUTER_DIR)/portthread.c \
+	$(SRC_DIR)/hashtab.c \
+	router_bench.c
+
+TARGET = router_bench
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
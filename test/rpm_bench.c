@@ -0,0 +1,369 @@
+/* rpm_bench.c: measures reading every property of many objects with one
+   ReadProperty per property, with ReadPropertyMultiple replies that fit
+   in one APDU, and with segmented ReadPropertyMultiple replies, counting
+   the round trips that each of them takes on the network */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacdcode.h"
+#include "bacstr.h"
+#include "apdu.h"
+#include "npdu.h"
+#include "tsm.h"
+#include "rp.h"
+#include "rpm.h"
+#include "datalink.h"
+#include "handlers.h"
+#include "device.h"
+#include "bench.h"
+
+/* objects in the device, and read in each pass */
+#define BENCH_OBJECTS 1000
+/* objects in each segmented ReadPropertyMultiple */
+#define BENCH_RPM_OBJECTS 100
+/* objects in each ReadPropertyMultiple whose reply fits in one APDU */
+#define BENCH_RPM_SMALL_OBJECTS 16
+/* the network round trip used to estimate the time taken, in ms */
+#define BENCH_ROUND_TRIP 10.0
+/* passes over all of the objects */
+#define BENCH_PASSES 20
+
+static const int Bench_Properties[] = {
+    PROP_OBJECT_IDENTIFIER,
+    PROP_OBJECT_NAME,
+    PROP_OBJECT_TYPE,
+    PROP_PRESENT_VALUE,
+    PROP_STATUS_FLAGS,
+    PROP_EVENT_STATE,
+    PROP_OUT_OF_SERVICE,
+    PROP_UNITS,
+    -1
+};
+
+#define BENCH_PROPERTIES \
+    ((sizeof(Bench_Properties) / sizeof(Bench_Properties[0])) - 1)
+
+/* the client */
+static BACNET_ADDRESS Bench_Client;
+/* what the server sent back: PDUs, aborts, and the last segment */
+static unsigned long Bench_Sent;
+static unsigned long Bench_Aborts;
+static bool Bench_More_Follows;
+static uint8_t Bench_Sequence;
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    BACNET_ADDRESS npdu_dest;
+    BACNET_ADDRESS npdu_src;
+    BACNET_NPDU_DATA data;
+    uint8_t *apdu = NULL;
+    int len = 0;
+
+    (void) dest;
+    (void) npdu_data;
+    len = npdu_decode(pdu, &npdu_dest, &npdu_src, &data);
+    apdu = &pdu[len];
+    Bench_Sent++;
+    Bench_More_Follows = false;
+    switch (apdu[0] & 0xF0) {
+        case PDU_TYPE_COMPLEX_ACK:
+            if (apdu[0] & BIT3) {
+                Bench_More_Follows = (apdu[0] & BIT2) ? true : false;
+                Bench_Sequence = apdu[2];
+            }
+            break;
+        case PDU_TYPE_ABORT:
+        case PDU_TYPE_REJECT:
+        case PDU_TYPE_ERROR:
+            Bench_Aborts++;
+            break;
+        default:
+            break;
+    }
+
+    return (int) pdu_len;
+}
+
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    (void) dest;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(BACNET_ADDRESS));
+}
+
+/* a device of analog inputs, instances 0 to BENCH_OBJECTS - 1 */
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 260001;
+}
+
+void Device_Objects_Property_List(
+    BACNET_OBJECT_TYPE object_type,
+    struct special_property_list_t *pPropertyList)
+{
+    (void) object_type;
+
+    pPropertyList->Required.pList = Bench_Properties;
+    pPropertyList->Required.count = BENCH_PROPERTIES;
+    pPropertyList->Optional.pList = NULL;
+    pPropertyList->Optional.count = 0;
+    pPropertyList->Proprietary.pList = NULL;
+    pPropertyList->Proprietary.count = 0;
+}
+
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    BACNET_BIT_STRING bit_string;
+    BACNET_CHARACTER_STRING char_string;
+    char name[32];
+    uint8_t *apdu = rpdata->application_data;
+
+    if ((rpdata->object_type != OBJECT_ANALOG_INPUT) ||
+        (rpdata->object_instance >= BENCH_OBJECTS)) {
+        rpdata->error_class = ERROR_CLASS_OBJECT;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_OBJECT;
+        return BACNET_STATUS_ERROR;
+    }
+    switch (rpdata->object_property) {
+        case PROP_OBJECT_IDENTIFIER:
+            return encode_application_object_id(apdu, OBJECT_ANALOG_INPUT,
+                rpdata->object_instance);
+        case PROP_OBJECT_NAME:
+            snprintf(name, sizeof(name), "Analog Input %lu",
+                (unsigned long) rpdata->object_instance);
+            characterstring_init_ansi(&char_string, name);
+            return encode_application_character_string(apdu, &char_string);
+        case PROP_OBJECT_TYPE:
+            return encode_application_enumerated(apdu, OBJECT_ANALOG_INPUT);
+        case PROP_PRESENT_VALUE:
+            return encode_application_real(apdu,
+                (float) rpdata->object_instance / 10.0f);
+        case PROP_STATUS_FLAGS:
+            bitstring_init(&bit_string);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+            bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+            return encode_application_bitstring(apdu, &bit_string);
+        case PROP_EVENT_STATE:
+            return encode_application_enumerated(apdu, EVENT_STATE_NORMAL);
+        case PROP_OUT_OF_SERVICE:
+            return encode_application_boolean(apdu, false);
+        case PROP_UNITS:
+            return encode_application_enumerated(apdu, UNITS_DEGREES_CELSIUS);
+        default:
+            break;
+    }
+    rpdata->error_class = ERROR_CLASS_PROPERTY;
+    rpdata->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+
+    return BACNET_STATUS_ERROR;
+}
+
+/* sends a confirmed request to the server, with the client's limits */
+static void bench_request(
+    uint8_t * apdu,
+    int apdu_len,
+    bool segmented_response_accepted,
+    int max_apdu)
+{
+    if (segmented_response_accepted) {
+        apdu[0] |= BIT1;
+        apdu[1] = encode_max_segs_max_apdu(64, max_apdu);
+    } else {
+        apdu[1] = encode_max_segs_max_apdu(0, max_apdu);
+    }
+    apdu_handler(&Bench_Client, apdu, (uint16_t) apdu_len);
+}
+
+/* acknowledges segments until the server sends the last one,
+   returning the round trips taken */
+static unsigned long bench_segment_acks(
+    uint8_t invoke_id,
+    uint8_t window)
+{
+    uint8_t apdu[4];
+    unsigned long round_trips = 0;
+
+    while (Bench_More_Follows) {
+        apdu[0] = PDU_TYPE_SEGMENT_ACK;
+        apdu[1] = invoke_id;
+        apdu[2] = Bench_Sequence;
+        apdu[3] = window;
+        apdu_handler(&Bench_Client, apdu, sizeof(apdu));
+        round_trips++;
+    }
+    /* the final segment is acknowledged without waiting for a reply */
+    apdu[0] = PDU_TYPE_SEGMENT_ACK;
+    apdu[1] = invoke_id;
+    apdu[2] = Bench_Sequence;
+    apdu[3] = window;
+    apdu_handler(&Bench_Client, apdu, sizeof(apdu));
+
+    return round_trips;
+}
+
+/* one ReadProperty for each property of each object */
+static unsigned long bench_read_property(
+    void)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[MAX_APDU];
+    unsigned long round_trips = 0;
+    uint32_t instance = 0;
+    unsigned i = 0;
+    int len = 0;
+
+    rpdata.object_type = OBJECT_ANALOG_INPUT;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    for (instance = 0; instance < BENCH_OBJECTS; instance++) {
+        rpdata.object_instance = instance;
+        for (i = 0; i < BENCH_PROPERTIES; i++) {
+            rpdata.object_property = Bench_Properties[i];
+            len = rp_encode_apdu(apdu, (uint8_t) round_trips, &rpdata);
+            bench_request(apdu, len, false, MAX_APDU);
+            round_trips++;
+        }
+    }
+
+    return round_trips;
+}
+
+/* ReadPropertyMultiple of all of the properties of some objects
+   at a time, with replies of up to max_apdu octets that are segmented
+   if the window is not zero */
+static unsigned long bench_read_property_multiple(
+    unsigned objects,
+    int max_apdu,
+    uint8_t window)
+{
+    uint8_t apdu[MAX_APDU];
+    unsigned long round_trips = 0;
+    uint8_t invoke_id = 0;
+    uint32_t instance = 0;
+    uint32_t first = 0;
+    int len = 0;
+
+    apdu_segment_window_set(window ? window : 1);
+    for (first = 0; first < BENCH_OBJECTS; first += objects) {
+        invoke_id++;
+        len = rpm_encode_apdu_init(apdu, invoke_id);
+        for (instance = first;
+            (instance < (first + objects)) && (instance < BENCH_OBJECTS);
+            instance++) {
+            len +=
+                rpm_encode_apdu_object_begin(&apdu[len], OBJECT_ANALOG_INPUT,
+                instance);
+            len +=
+                rpm_encode_apdu_object_property(&apdu[len], PROP_ALL,
+                BACNET_ARRAY_ALL);
+            len += rpm_encode_apdu_object_end(&apdu[len]);
+        }
+        Bench_More_Follows = false;
+        bench_request(apdu, len, window != 0, max_apdu);
+        round_trips++;
+        if (window) {
+            round_trips += bench_segment_acks(invoke_id, window);
+        }
+    }
+
+    return round_trips;
+}
+
+/* reports the CPU time and round trips of a pass, and the points per
+   second that would be read with the network round trip */
+static void bench_pass(
+    const char *label,
+    unsigned long (*pass) (unsigned, int, uint8_t),
+    unsigned objects,
+    int max_apdu,
+    uint8_t window)
+{
+    unsigned long points = BENCH_OBJECTS * BENCH_PROPERTIES;
+    unsigned long round_trips = 0;
+    unsigned long sent = 0;
+    unsigned i = 0;
+    double start = 0.0;
+    double elapsed = 0.0;
+    double seconds = 0.0;
+
+    Bench_Sent = 0;
+    Bench_Aborts = 0;
+    start = bench_now_ns();
+    for (i = 0; i < BENCH_PASSES; i++) {
+        round_trips = pass(objects, max_apdu, window);
+    }
+    elapsed = bench_now_ns() - start;
+    sent = Bench_Sent / BENCH_PASSES;
+    bench_report(label, points * BENCH_PASSES, elapsed);
+    seconds = (elapsed / (1.0e9 * BENCH_PASSES)) +
+        ((round_trips * BENCH_ROUND_TRIP) / 1000.0);
+    printf("  %lu round trips, %lu replies, %lu aborts: "
+        "%.0f points/s at %.0f ms\n", round_trips, sent,
+        Bench_Aborts / BENCH_PASSES, points / seconds, BENCH_ROUND_TRIP);
+}
+
+static unsigned long bench_read_property_pass(
+    unsigned objects,
+    int max_apdu,
+    uint8_t window)
+{
+    (void) objects;
+    (void) max_apdu;
+    (void) window;
+
+    return bench_read_property();
+}
+
+int main(
+    void)
+{
+    static const uint8_t windows[] = { 1, 4, 8, 16 };
+    static const int max_apdus[] = { 480, 1476 };
+    char label[64];
+    unsigned i = 0;
+    unsigned j = 0;
+
+    Bench_Client.mac_len = 1;
+    Bench_Client.mac[0] = 1;
+    apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY,
+        handler_read_property);
+    apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+        handler_read_property_multiple);
+    printf("Reading %u properties of %u objects\n",
+        (unsigned) BENCH_PROPERTIES, BENCH_OBJECTS);
+    bench_pass("RP: one per property", bench_read_property_pass, 0,
+        MAX_APDU, 0);
+    snprintf(label, sizeof(label), "RPM: %u objects, unsegmented",
+        BENCH_RPM_SMALL_OBJECTS);
+    bench_pass(label, bench_read_property_multiple, BENCH_RPM_SMALL_OBJECTS,
+        MAX_APDU, 0);
+    for (i = 0; i < sizeof(max_apdus) / sizeof(max_apdus[0]); i++) {
+        for (j = 0; j < sizeof(windows) / sizeof(windows[0]); j++) {
+            snprintf(label, sizeof(label),
+                "RPM: %u objects, max_apdu=%d window=%u",
+                BENCH_RPM_OBJECTS, max_apdus[i], windows[j]);
+            bench_pass(label, bench_read_property_multiple,
+                BENCH_RPM_OBJECTS, max_apdus[i], windows[j]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,416 @@
+/* trendlog_bench.c: runs the sampling of a thousand trend logs for a day,
+   and pages through a full trend log with ReadRange by time and by
+   sequence, the way a historian does, and reports the ticks and the
+   requests per second */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "bacdcode.h"
+#include "bacapp.h"
+#include "readrange.h"
+#include "rp.h"
+#include "wp.h"
+#include "ucix.h"
+#include "bacdevobjpropref.h"
+#include "trendlog.h"
+#include "bench.h"
+
+/* records asked for in each request, more than fit in one APDU */
+#define BENCH_COUNT 1000
+/* seconds between records */
+#define BENCH_INTERVAL 900
+/* time of the first record */
+#define BENCH_START 1000000000L
+/* logs sampled on their own, besides the one that is paged through */
+#define BENCH_LOGS 1000
+/* seconds of sampling */
+#define BENCH_DAY 86400L
+
+/* the clock of the trend logs, advanced as they are sampled or filled */
+static time_t Bench_Time = BENCH_START;
+/* records put in the log so far, and the sequence number of the
+   record taken at BENCH_START */
+static uint32_t Bench_Records;
+static uint32_t Bench_First;
+
+time_t time(
+    time_t * tloc)
+{
+    if (tloc) {
+        *tloc = Bench_Time;
+    }
+
+    return Bench_Time;
+}
+
+/* the trend logs read the time of a tick by CLOCK_REALTIME, which runs
+   with Bench_Time here; the others are left to the system, for timing */
+int clock_gettime(
+    clockid_t clk_id,
+    struct timespec *tp)
+{
+    if (clk_id == CLOCK_REALTIME) {
+        tp->tv_sec = Bench_Time;
+        tp->tv_nsec = 0;
+        return 0;
+    }
+
+    return (int) syscall(SYS_clock_gettime, clk_id, tp);
+}
+
+/* dummy function stubs */
+uint32_t Device_Object_Instance_Number(
+    void)
+{
+    return 260001;
+}
+
+bool Device_Valid_Object_Name(
+    BACNET_CHARACTER_STRING * object_name,
+    int *object_type,
+    uint32_t * object_instance)
+{
+    (void) object_name;
+    (void) object_type;
+    (void) object_instance;
+
+    return false;
+}
+
+void Device_Object_Name_Remove(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+void Device_Object_Name_Add(
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance)
+{
+    (void) object_type;
+    (void) object_instance;
+}
+
+/* the logged property is a REAL that counts the records */
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    static float value;
+    BACNET_BIT_STRING bit_string;
+
+    if (rpdata->object_property == PROP_STATUS_FLAGS) {
+        bitstring_init(&bit_string);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_IN_ALARM, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_FAULT, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OVERRIDDEN, false);
+        bitstring_set_bit(&bit_string, STATUS_FLAG_OUT_OF_SERVICE, false);
+        return encode_application_bitstring(rpdata->application_data,
+            &bit_string);
+    }
+    value += 1.0f;
+
+    return encode_application_real(rpdata->application_data, value);
+}
+
+bool WPValidateArgType(
+    BACNET_APPLICATION_DATA_VALUE * pValue,
+    uint8_t ucExpectedType,
+    BACNET_ERROR_CLASS * pErrorClass,
+    BACNET_ERROR_CODE * pErrorCode)
+{
+    (void) pErrorClass;
+    (void) pErrorCode;
+
+    return pValue->tag == ucExpectedType;
+}
+
+/* UCI stubs: trend log sections with a name, the first one not sampled
+   and the others on intervals of one to fifteen minutes */
+struct uci_context *ucix_init(
+    const char *config_file)
+{
+    static int context;
+
+    (void) config_file;
+
+    return (struct uci_context *) &context;
+}
+
+void ucix_cleanup(
+    struct uci_context *ctx)
+{
+    (void) ctx;
+}
+
+void ucix_for_each_section_type(
+    struct uci_context *ctx,
+    const char *p,
+    const char *t,
+    void (*cb) (const char *, void *),
+    void *priv)
+{
+    char section[16];
+    unsigned n = BENCH_LOGS + 1;
+
+    (void) ctx;
+    (void) p;
+    (void) t;
+    /* the list is built backwards, so section 0 comes first */
+    while (n--) {
+        snprintf(section, sizeof(section), "%u", n);
+        cb(section, priv);
+    }
+}
+
+const char *ucix_get_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+
+    return strcmp(o, "name") ? NULL : "TL";
+}
+
+int ucix_get_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int def)
+{
+    (void) ctx;
+    (void) p;
+
+    if (s && (strcmp(o, "interval") == 0) && (strcmp(s, "default") != 0)) {
+        return atoi(s) ? (60 * (1 + (atoi(s) % 15))) : 0;
+    }
+
+    return def;
+}
+
+void ucix_add_option(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    const char *t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+void ucix_add_option_int(
+    struct uci_context *ctx,
+    const char *p,
+    const char *s,
+    const char *o,
+    int t)
+{
+    (void) ctx;
+    (void) p;
+    (void) s;
+    (void) o;
+    (void) t;
+}
+
+int ucix_commit(
+    struct uci_context *ctx,
+    const char *p)
+{
+    (void) ctx;
+    (void) p;
+
+    return 0;
+}
+
+bool ucix_string_copy(
+    char *dest,
+    size_t i,
+    char *src)
+{
+    strncpy(dest, src, i);
+
+    return true;
+}
+
+/* sample the logs for a day, ticking their timer every second as the
+   server does, or only when the next log is due */
+static void bench_schedule(
+    const char *label,
+    bool skip)
+{
+    unsigned long ticks = 0;
+    time_t end = Bench_Time + BENCH_DAY;
+    uint32_t seconds = 1;
+    double start = 0.0;
+
+    start = bench_now_ns();
+    while (Bench_Time < end) {
+        if (skip) {
+            seconds = trend_log_timer_next_seconds();
+            if (seconds > (uint32_t) (end - Bench_Time)) {
+                seconds = (uint32_t) (end - Bench_Time);
+            }
+            if (seconds > UINT16_MAX) {
+                seconds = UINT16_MAX;
+            }
+        }
+        Bench_Time += seconds;
+        trend_log_timer((uint16_t) seconds);
+        ticks++;
+    }
+    bench_report(label, ticks, bench_now_ns() - start);
+}
+
+/* how late the readings of the logs have been, at worst */
+static void bench_jitter(
+    void)
+{
+    uint32_t last = 0;
+    uint32_t max = 0;
+    uint32_t worst = 0;
+    unsigned i = 0;
+
+    for (i = 0; i < Trend_Log_Count(); i++) {
+        if (Trend_Log_Sampling_Jitter(Trend_Log_Index_To_Instance(i), &last,
+                &max) && (max > worst)) {
+            worst = max;
+        }
+    }
+    printf("  readings at most %lu ms late\n", (unsigned long) worst);
+}
+
+/* fill the log twice over, so the ring has wrapped */
+static void bench_fill(
+    uint32_t buffer_size)
+{
+    uint32_t i = 0;
+
+    TL_Buffer_Size_Set(0, buffer_size);
+    Bench_Time = BENCH_START;
+    Bench_First = Bench_Records + 1;
+    for (i = 0; i < (2 * buffer_size); i++) {
+        TL_fetch_property(0);
+        Bench_Records++;
+        Bench_Time += BENCH_INTERVAL;
+    }
+}
+
+/* one ReadRange of the log buffer, returning the records read */
+static uint32_t bench_read_range(
+    BACNET_READ_RANGE_DATA * rrdata,
+    int type)
+{
+    uint8_t apdu[MAX_APDU];
+
+    rrdata->object_type = OBJECT_TRENDLOG;
+    rrdata->object_instance = Trend_Log_Index_To_Instance(0);
+    rrdata->object_property = PROP_LOG_BUFFER;
+    rrdata->array_index = BACNET_ARRAY_ALL;
+    rrdata->RequestType = type;
+    rrdata->Overhead = RR_OVERHEAD + RR_1ST_SEQ_OVERHEAD;
+    rrdata->application_data_len = sizeof(apdu);
+    rrdata->Count = BENCH_COUNT;
+    rr_trend_log_encode(apdu, rrdata);
+
+    return rrdata->ItemCount;
+}
+
+/* read the whole log from the oldest record, a page at a time,
+   returning the requests made */
+static unsigned long bench_page(
+    uint32_t buffer_size,
+    int type)
+{
+    BACNET_READ_RANGE_DATA rrdata;
+    unsigned long requests = 0;
+    /* the older half of the records has gone */
+    uint32_t sequence = Bench_Records - buffer_size + 1;
+    time_t reference = 0;
+
+    reference =
+        BENCH_START + ((time_t) (sequence - Bench_First) * BENCH_INTERVAL) - 1;
+    for (;;) {
+        memset(&rrdata, 0, sizeof(rrdata));
+        if (type == RR_BY_TIME) {
+            TL_Local_Time_To_BAC(&rrdata.Range.RefTime, reference);
+        } else {
+            rrdata.Range.RefSeqNum = sequence;
+        }
+        requests++;
+        if (bench_read_range(&rrdata, type) == 0) {
+            break;
+        }
+        if (bitstring_bit(&rrdata.ResultFlags, RESULT_FLAG_LAST_ITEM)) {
+            break;
+        }
+        /* carry on after the last record read */
+        sequence = rrdata.FirstSequence + rrdata.ItemCount;
+        reference =
+            BENCH_START + ((time_t) (sequence - 1 - Bench_First) *
+            BENCH_INTERVAL);
+    }
+
+    return requests;
+}
+
+/* page through the whole log until there have been enough requests */
+static void bench_paging(
+    const char *label,
+    uint32_t buffer_size,
+    int type)
+{
+    unsigned long requests = 0;
+    unsigned long pages = 0;
+    double start = 0.0;
+    char text[64];
+
+    start = bench_now_ns();
+    do {
+        requests += bench_page(buffer_size, type);
+        pages++;
+    } while (requests < 20000);
+    snprintf(text, sizeof(text), "%s: buffer=%lu", label,
+        (unsigned long) buffer_size);
+    bench_report(text, requests, bench_now_ns() - start);
+    printf("  %lu requests to read the log\n", requests / pages);
+}
+
+int main(
+    void)
+{
+    static const uint32_t sizes[] = { 1000, 10000, 100000 };
+    unsigned n = 0;
+
+    Trend_Log_Init();
+    printf("Sampling %u trend logs for a day\n", BENCH_LOGS);
+    bench_schedule("tick every second", false);
+    bench_schedule("tick when the next log is due", true);
+    bench_jitter();
+    printf("ReadRange paging through a full trend log\n");
+    for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        bench_fill(sizes[n]);
+        bench_paging("by time", sizes[n], RR_BY_TIME);
+        bench_paging("by sequence", sizes[n], RR_BY_SEQUENCE);
+    }
+
+    return 0;
+}
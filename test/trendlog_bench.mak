@@ -0,0 +1,45 @@
+#Makefile to build benchmark
+CC      = gcc
+SRC_DIR = ../src
+HANDLER_DIR = ../demo/handler
+OBJECT_DIR = ../demo/object
+INCLUDES = -I../include -I. -I$(HANDLER_DIR) -I$(OBJECT_DIR)
+DEFINES = -DBACDL_TEST -DBIG_ENDIAN=0
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -O2
+
+SRCS = $(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/deadline.c \
+	$(SRC_DIR)/hashtab.c \
+	$(OBJECT_DIR)/trendlog.c \
+	trendlog_bench.c
+
+TARGET = trendlog_bench
+
+all: ${TARGET}
+ 
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} 
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+	
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+	
+clean:
+	rm -rf core ${TARGET} $(OBJS) *.bak *.1 *.ini
+
+include: .depend
+
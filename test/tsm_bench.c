@@ -0,0 +1,76 @@
+/* tsm_bench.c: measures TSM invoke ID allocate/lookup/free cost
+   as the number of outstanding transactions grows */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "config.h"
+#include "bacdef.h"
+#include "npdu.h"
+#include "tsm.h"
+#include "bench.h"
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPDU_DATA * npdu_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    (void) dest;
+    (void) npdu_data;
+    (void) pdu;
+    (void) pdu_len;
+
+    return 0;
+}
+
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    (void) dest;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    (void) my_address;
+}
+
+int main(
+    void)
+{
+    static const unsigned outstanding[] = { 0, 1, 16, 64, 128, 200, 254 };
+    uint8_t held[MAX_TSM_TRANSACTIONS];
+    unsigned long iterations = 2000000;
+    unsigned long i = 0;
+    unsigned n = 0;
+    unsigned j = 0;
+    uint8_t invokeID = 0;
+    double start = 0.0;
+    char label[64];
+
+    printf("TSM allocate+lookup+free with N outstanding transactions\n");
+    for (n = 0; n < sizeof(outstanding) / sizeof(outstanding[0]); n++) {
+        if (outstanding[n] >= MAX_TSM_TRANSACTIONS) {
+            continue;
+        }
+        /* hold N transactions open */
+        for (j = 0; j < outstanding[n]; j++) {
+            held[j] = tsm_next_free_invokeID();
+        }
+        start = bench_now_ns();
+        for (i = 0; i < iterations; i++) {
+            invokeID = tsm_next_free_invokeID();
+            (void) tsm_invoke_id_failed(invokeID);
+            tsm_free_invoke_id(invokeID);
+        }
+        snprintf(label, sizeof(label), "outstanding=%u", outstanding[n]);
+        bench_report(label, iterations, bench_now_ns() - start);
+        for (j = 0; j < outstanding[n]; j++) {
+            tsm_free_invoke_id(held[j]);
+        }
+    }
+
+    return 0;
+}